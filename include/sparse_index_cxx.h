@@ -714,6 +714,9 @@ namespace SPARSE {
   struct FFIError;
   struct ScoredPointOffset;
   struct FFIScoreResult;
+  struct FFISearchProfile;
+  struct FFICacheStats;
+  struct FFIScoreProfileResult;
   struct FFIBoolResult;
   struct FFIU64Result;
   struct FFIVecU8Result;
@@ -751,6 +754,57 @@ struct FFIScoreResult final {
 };
 #endif // CXXBRIDGE1_STRUCT_SPARSE$FFIScoreResult
 
+#ifndef CXXBRIDGE1_STRUCT_SPARSE$FFISearchProfile
+#define CXXBRIDGE1_STRUCT_SPARSE$FFISearchProfile
+// Execution counters of one query merged across segments, `*_ns` are nanoseconds.
+struct FFISearchProfile final {
+  ::std::uint64_t segments_searched;
+  ::std::uint64_t postings_opened;
+  ::std::uint64_t elements_scored;
+  ::std::uint64_t blocks_decompressed;
+  ::std::uint64_t batches;
+  ::std::uint64_t prune_attempts;
+  ::std::uint64_t prune_successes;
+  ::std::uint64_t bitmap_rejections;
+  ::std::uint64_t posting_cache_hits;
+  ::std::uint64_t posting_cache_misses;
+  ::std::uint64_t pre_search_ns;
+  ::std::uint64_t scoring_ns;
+  ::std::uint64_t select_ns;
+  ::std::uint64_t merge_ns;
+
+  using IsRelocatable = ::std::true_type;
+};
+#endif // CXXBRIDGE1_STRUCT_SPARSE$FFISearchProfile
+
+#ifndef CXXBRIDGE1_STRUCT_SPARSE$FFICacheStats
+#define CXXBRIDGE1_STRUCT_SPARSE$FFICacheStats
+// Usage of the caches shared by all index readers, hit ratios are 0 before any lookup.
+struct FFICacheStats final {
+  ::std::uint64_t posting_cache_bytes;
+  ::std::uint64_t posting_cache_capacity_bytes;
+  double posting_cache_hit_ratio;
+  ::std::uint64_t decoded_block_cache_bytes;
+  ::std::uint64_t decoded_block_cache_capacity_bytes;
+  ::std::uint64_t decoded_block_cache_hits;
+  ::std::uint64_t decoded_block_cache_misses;
+  double decoded_block_cache_hit_ratio;
+
+  using IsRelocatable = ::std::true_type;
+};
+#endif // CXXBRIDGE1_STRUCT_SPARSE$FFICacheStats
+
+#ifndef CXXBRIDGE1_STRUCT_SPARSE$FFIScoreProfileResult
+#define CXXBRIDGE1_STRUCT_SPARSE$FFIScoreProfileResult
+struct FFIScoreProfileResult final {
+  ::rust::Vec<::SPARSE::ScoredPointOffset> result;
+  ::SPARSE::FFISearchProfile profile;
+  ::SPARSE::FFIError error;
+
+  using IsRelocatable = ::std::true_type;
+};
+#endif // CXXBRIDGE1_STRUCT_SPARSE$FFIScoreProfileResult
+
 #ifndef CXXBRIDGE1_STRUCT_SPARSE$FFIBoolResult
 #define CXXBRIDGE1_STRUCT_SPARSE$FFIBoolResult
 struct FFIBoolResult final {
@@ -805,9 +859,17 @@ struct TupleElement final {
 
 ::SPARSE::FFIBoolResult ffi_free_index_writer(::std::string const &index_path) noexcept;
 
+::SPARSE::FFIBoolResult ffi_convert_index(::std::string const &index_path, ::std::string const &target_index_path, ::std::string const &target_json_parameter) noexcept;
+
 ::SPARSE::FFIBoolResult ffi_load_index_reader(::std::string const &index_path) noexcept;
 
+::SPARSE::FFIBoolResult ffi_load_index_reader_with_parameter(::std::string const &index_path, ::std::string const &reader_json_parameter) noexcept;
+
 ::SPARSE::FFIBoolResult ffi_free_index_reader(::std::string const &index_path) noexcept;
 
 ::SPARSE::FFIScoreResult ffi_sparse_search(::std::string const &index_path, ::rust::Vec<::SPARSE::TupleElement> const &sparse_vector, ::std::vector<::std::uint8_t> const &filter, bool enable_filter, ::std::uint32_t top_k) noexcept;
+
+::SPARSE::FFIScoreProfileResult ffi_sparse_search_with_profile(::std::string const &index_path, ::rust::Vec<::SPARSE::TupleElement> const &sparse_vector, ::std::vector<::std::uint8_t> const &filter, bool enable_filter, ::std::uint32_t top_k) noexcept;
+
+::SPARSE::FFICacheStats ffi_get_cache_stats() noexcept;
 } // namespace SPARSE
@@ -1,6 +1,6 @@
 use crate::api::cxx_ffi::converter::CXX_STRING_CONVERTER;
 use crate::api::cxx_ffi::utils::{ApiUtils, IndexManager};
-use crate::api::cxx_ffi::{ffi_commit_index_impl, ffi_create_index_with_parameter_impl, ffi_free_index_writer_impl, ffi_insert_sparse_vector_impl};
+use crate::api::cxx_ffi::{ffi_commit_index_impl, ffi_convert_index_impl, ffi_create_index_with_parameter_impl, ffi_free_index_writer_impl, ffi_insert_sparse_vector_impl};
 use crate::core::SparseVector;
 use crate::{ffi::*, RowId};
 use cxx::{let_cxx_string, CxxString};
@@ -84,3 +84,26 @@ pub fn ffi_free_index_writer(index_path: &CxxString) -> FFIBoolResult {
         }
     }
 }
+
+/// Rewrite the committed segments of `index_path` into a new index at `target_index_path` with `target_json_parameter` settings.
+pub fn ffi_convert_index(index_path: &CxxString, target_index_path: &CxxString, target_json_parameter: &CxxString) -> FFIBoolResult {
+    static FUNC_NAME: &str = "ffi_convert_index";
+
+    let index_path: String = match CXX_STRING_CONVERTER.convert(index_path) {
+        Ok(path) => path,
+        Err(e) => return ApiUtils::handle_error(FUNC_NAME, "failed convert 'index_path'", e.to_string()),
+    };
+    let target_index_path: String = match CXX_STRING_CONVERTER.convert(target_index_path) {
+        Ok(path) => path,
+        Err(e) => return ApiUtils::handle_error(FUNC_NAME, "failed convert 'target_index_path'", e.to_string()),
+    };
+    let target_json_parameter: String = match CXX_STRING_CONVERTER.convert(target_json_parameter) {
+        Ok(json) => json,
+        Err(e) => return ApiUtils::handle_error(FUNC_NAME, "Can't convert 'target_json_parameter'", e.to_string()),
+    };
+
+    match ffi_convert_index_impl(&index_path, &target_index_path, &target_json_parameter) {
+        Ok(result) => FFIBoolResult { result, error: FFIError { is_error: false, message: String::new() } },
+        Err(e) => ApiUtils::handle_error(FUNC_NAME, "failed to convert index", e.to_string()),
+    }
+}
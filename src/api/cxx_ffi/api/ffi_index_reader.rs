@@ -1,14 +1,26 @@
 use crate::api::cxx_ffi::converter::cxx_vector_converter;
-use crate::api::cxx_ffi::{ffi_free_index_reader_impl, ffi_load_index_reader_impl, ffi_sparse_search_impl};
-use crate::core::{SparseBitmap, SparseVector};
+use crate::api::cxx_ffi::{ffi_free_index_reader_impl, ffi_load_index_reader_with_parameter_impl, ffi_sparse_search_impl, ffi_sparse_search_with_profile_impl};
+use crate::core::{searcher::SearchProfile, DecodedBlockCache, PostingCache, SparseBitmap, SparseVector};
 use crate::{
-    api::cxx_ffi::{converter::CXX_STRING_CONVERTER, utils::ApiUtils},
-    ffi::{FFIBoolResult, FFIError, FFIScoreResult, TupleElement},
+    api::cxx_ffi::{
+        converter::CXX_STRING_CONVERTER,
+        utils::{ApiUtils, FFIResult},
+    },
+    ffi::{FFIBoolResult, FFICacheStats, FFIError, FFIScoreProfileResult, FFIScoreResult, FFISearchProfile, ScoredPointOffset, TupleElement},
 };
-use cxx::{CxxString, CxxVector};
+use cxx::{let_cxx_string, CxxString, CxxVector};
 
 pub fn ffi_load_index_reader(index_path: &CxxString) -> FFIBoolResult {
-    static FUNC_NAME: &str = "ffi_load_index_reader";
+    let_cxx_string!(parameter = "{}");
+    ffi_load_index_reader_with_parameter(index_path, &parameter)
+}
+
+/// `reader_json_parameter` e.g. `{"load_policy": "mlock"}`, load policy is one of `normal`, `random`, `sequential`, `populate`, `mlock`, `in_memory`, `in_memory_huge_pages` and `pread`.
+/// `posting_cache_mb` sets the capacity of the posting cache shared by `pread` segments,
+/// `decoded_block_cache_mb` the capacity of the decoded block cache shared by compressed segments, which is disabled by default.
+/// Both caches are process wide: the first reader giving a capacity sets it, a reader giving another one fails to load.
+pub fn ffi_load_index_reader_with_parameter(index_path: &CxxString, reader_json_parameter: &CxxString) -> FFIBoolResult {
+    static FUNC_NAME: &str = "ffi_load_index_reader_with_parameter";
 
     let index_path: String = match CXX_STRING_CONVERTER.convert(index_path) {
         Ok(path) => path,
@@ -17,7 +29,14 @@ pub fn ffi_load_index_reader(index_path: &CxxString) -> FFIBoolResult {
         }
     };
 
-    match ffi_load_index_reader_impl(&index_path) {
+    let reader_json_parameter: String = match CXX_STRING_CONVERTER.convert(reader_json_parameter) {
+        Ok(json) => json,
+        Err(e) => {
+            return ApiUtils::handle_error(FUNC_NAME, "Can't convert 'reader_json_parameter'", e.to_string());
+        }
+    };
+
+    match ffi_load_index_reader_with_parameter_impl(&index_path, &reader_json_parameter) {
         Ok(result) => FFIBoolResult { result, error: FFIError { is_error: false, message: String::new() } },
         Err(e) => ApiUtils::handle_error(FUNC_NAME, "failed load index reader", e.to_string()),
     }
@@ -43,16 +62,46 @@ pub fn ffi_free_index_reader(index_path: &CxxString) -> FFIBoolResult {
 pub fn ffi_sparse_search(index_path: &CxxString, sparse_vector: &Vec<TupleElement>, filter: &CxxVector<u8>, enable_filter: bool, top_k: u32) -> FFIScoreResult {
     static FUNC_NAME: &str = "ffi_sparse_search";
 
+    sparse_search_with(FUNC_NAME, index_path, sparse_vector, filter, enable_filter, top_k, ffi_sparse_search_impl, |scores| FFIScoreResult {
+        result: scores,
+        error: FFIError { is_error: false, message: "".to_string() },
+    })
+}
+
+pub fn ffi_sparse_search_with_profile(index_path: &CxxString, sparse_vector: &Vec<TupleElement>, filter: &CxxVector<u8>, enable_filter: bool, top_k: u32) -> FFIScoreProfileResult {
+    static FUNC_NAME: &str = "ffi_sparse_search_with_profile";
+
+    sparse_search_with(FUNC_NAME, index_path, sparse_vector, filter, enable_filter, top_k, ffi_sparse_search_with_profile_impl, |(scores, profile)| FFIScoreProfileResult {
+        result: scores,
+        profile: profile.into(),
+        error: FFIError { is_error: false, message: "".to_string() },
+    })
+}
+
+/// Converts the arguments shared by the search functions, runs `search` and wraps its output with `into_result`.
+fn sparse_search_with<T, R>(
+    func_name: &str,
+    index_path: &CxxString,
+    sparse_vector: &Vec<TupleElement>,
+    filter: &CxxVector<u8>,
+    enable_filter: bool,
+    top_k: u32,
+    search: impl FnOnce(&str, &SparseVector, &Option<SparseBitmap>, u32) -> crate::Result<R>,
+    into_result: impl FnOnce(R) -> T,
+) -> T
+where
+    T: FFIResult<Vec<ScoredPointOffset>>,
+{
     let index_path: String = match CXX_STRING_CONVERTER.convert(index_path) {
         Ok(path) => path,
-        Err(e) => return ApiUtils::handle_error(FUNC_NAME, "failed convert 'index_path'", e.to_string()),
+        Err(e) => return ApiUtils::handle_error(func_name, "failed convert 'index_path'", e.to_string()),
     };
 
     // convert `filter` u8_bitmap`
     let u8_alive_bitmap: Vec<u8> = match cxx_vector_converter::<u8>().convert(filter) {
         Ok(bitmap) => bitmap,
         Err(e) => {
-            return ApiUtils::handle_error(FUNC_NAME, "Can't convert 'u8_alive_bitmap'", e.to_string());
+            return ApiUtils::handle_error(func_name, "Can't convert 'u8_alive_bitmap'", e.to_string());
         }
     };
 
@@ -64,12 +113,44 @@ pub fn ffi_sparse_search(index_path: &CxxString, sparse_vector: &Vec<TupleElemen
     // convert `sparse_vector`
     let sparse_vector: SparseVector = sparse_vector.clone().try_into().unwrap();
 
-    let scores = match ffi_sparse_search_impl(&index_path, &sparse_vector, &sparse_bitmap, top_k) {
-        Ok(res) => res,
-        Err(error) => {
-            return ApiUtils::handle_error(FUNC_NAME, "failed execute search", error.to_string());
+    match search(&index_path, &sparse_vector, &sparse_bitmap, top_k) {
+        Ok(res) => into_result(res),
+        Err(error) => ApiUtils::handle_error(func_name, "failed execute search", error.to_string()),
+    }
+}
+
+impl From<SearchProfile> for FFISearchProfile {
+    fn from(profile: SearchProfile) -> Self {
+        FFISearchProfile {
+            segments_searched: profile.segments_searched,
+            postings_opened: profile.postings_opened,
+            elements_scored: profile.elements_scored,
+            blocks_decompressed: profile.blocks_decompressed,
+            batches: profile.batches,
+            prune_attempts: profile.prune_attempts,
+            prune_successes: profile.prune_successes,
+            bitmap_rejections: profile.bitmap_rejections,
+            posting_cache_hits: profile.posting_cache_hits,
+            posting_cache_misses: profile.posting_cache_misses,
+            pre_search_ns: profile.pre_search_ns,
+            scoring_ns: profile.scoring_ns,
+            select_ns: profile.select_ns,
+            merge_ns: profile.merge_ns,
         }
-    };
+    }
+}
 
-    FFIScoreResult { result: scores, error: FFIError { is_error: false, message: "".to_string() } }
+pub fn ffi_get_cache_stats() -> FFICacheStats {
+    let posting_cache = PostingCache::global().stats();
+    let decoded_block_cache = DecodedBlockCache::global().stats();
+    FFICacheStats {
+        posting_cache_bytes: posting_cache.cached_bytes as u64,
+        posting_cache_capacity_bytes: posting_cache.capacity_bytes as u64,
+        posting_cache_hit_ratio: posting_cache.hit_ratio(),
+        decoded_block_cache_bytes: decoded_block_cache.cached_bytes as u64,
+        decoded_block_cache_capacity_bytes: decoded_block_cache.capacity_bytes as u64,
+        decoded_block_cache_hits: decoded_block_cache.hits,
+        decoded_block_cache_misses: decoded_block_cache.misses,
+        decoded_block_cache_hit_ratio: decoded_block_cache.hit_ratio(),
+    }
 }
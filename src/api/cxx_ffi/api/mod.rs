@@ -1,5 +1,7 @@
 mod ffi_index_manager;
 mod ffi_index_reader;
 
-pub use ffi_index_manager::{ffi_commit_index, ffi_create_index, ffi_create_index_with_parameter, ffi_free_index_writer, ffi_insert_sparse_vector};
-pub use ffi_index_reader::{ffi_free_index_reader, ffi_load_index_reader, ffi_sparse_search};
+pub use ffi_index_manager::{ffi_commit_index, ffi_convert_index, ffi_create_index, ffi_create_index_with_parameter, ffi_free_index_writer, ffi_insert_sparse_vector};
+pub use ffi_index_reader::{
+    ffi_free_index_reader, ffi_get_cache_stats, ffi_load_index_reader, ffi_load_index_reader_with_parameter, ffi_sparse_search, ffi_sparse_search_with_profile,
+};
@@ -4,6 +4,7 @@ use crate::{
     api::cxx_ffi::{cache::FFI_INDEX_WRITER_CACHE, utils::IndexManager},
     core::{SparseRowContent, SparseVector},
     index::{Index, IndexSettings},
+    indexer::IndexConverter,
     RowId,
 };
 
@@ -48,3 +49,10 @@ pub fn ffi_free_index_writer_impl(index_path: &str) -> crate::Result<bool> {
     let res = IndexManager::free_index_writer(&index_path)?;
     Ok(res)
 }
+
+/// impl for `ffi_convert_index`
+pub fn ffi_convert_index_impl(index_path: &str, target_index_path: &str, target_json_parameter: &str) -> crate::Result<bool> {
+    let target_settings: IndexSettings = serde_json::from_str(&target_json_parameter)?;
+    let _ = IndexConverter::open(Path::new(index_path))?.convert(Path::new(target_index_path), target_settings)?;
+    Ok(true)
+}
@@ -1,18 +1,47 @@
 use std::sync::Arc;
 
+use serde::Deserialize;
+
 use crate::{
     api::cxx_ffi::{
         cache::{IndexReaderBridge, FFI_INDEX_SEARCHER_CACHE},
         utils::IndexManager,
     },
-    core::{SparseBitmap, SparseVector},
+    common::errors::SparseError,
+    core::{searcher::SearchProfile, DecodedBlockCache, LoadPolicy, PostingCache, SparseBitmap, SparseVector},
     ffi::ScoredPointOffset,
     reader::searcher::Searcher,
 };
 
-/// impl for `ffi_load_index_reader`
-pub fn ffi_load_index_reader_impl(index_path: &str) -> crate::Result<bool> {
-    IndexManager::load_index_reader_bridge(index_path)
+/// Parameters of `ffi_load_index_reader_with_parameter`, missing ones keep the index settings.
+#[derive(Debug, Default, Deserialize)]
+#[serde(deny_unknown_fields)]
+struct IndexReaderParameter {
+    #[serde(default)]
+    load_policy: Option<LoadPolicy>,
+    #[serde(default)]
+    posting_cache_mb: Option<usize>,
+    #[serde(default)]
+    decoded_block_cache_mb: Option<usize>,
+}
+
+fn conflicting_capacity(parameter: &str, capacity_mb: usize, configured_bytes: usize) -> SparseError {
+    SparseError::InvalidArgument(format!("{} is {}, but the process wide cache is already configured with {} MB", parameter, capacity_mb, configured_bytes >> 20))
+}
+
+/// impl for `ffi_load_index_reader_with_parameter`
+pub fn ffi_load_index_reader_with_parameter_impl(index_path: &str, reader_json_parameter: &str) -> crate::Result<bool> {
+    let parameter: IndexReaderParameter = serde_json::from_str(reader_json_parameter)?;
+    // Both caches are shared by the process, a reader can't resize them differently from the ones loaded before.
+    if let Some(posting_cache_mb) = parameter.posting_cache_mb {
+        PostingCache::global().configure_capacity(posting_cache_mb << 20).map_err(|configured| conflicting_capacity("posting_cache_mb", posting_cache_mb, configured))?;
+    }
+    if let Some(decoded_block_cache_mb) = parameter.decoded_block_cache_mb {
+        DecodedBlockCache::global()
+            .configure_capacity(decoded_block_cache_mb << 20)
+            .map_err(|configured| conflicting_capacity("decoded_block_cache_mb", decoded_block_cache_mb, configured))?;
+    }
+    IndexManager::load_index_reader_bridge(index_path, parameter.load_policy)
 }
 
 /// impl for `ffi_free_index_reader`
@@ -20,11 +49,22 @@ pub fn ffi_free_index_reader_impl(index_path: &str) -> crate::Result<()> {
     IndexManager::free_index_reader(index_path)
 }
 
+fn cached_searcher(index_path: &str) -> crate::Result<Searcher> {
+    let reader_bridge: Arc<IndexReaderBridge> = FFI_INDEX_SEARCHER_CACHE.get_index_reader_bridge(index_path.to_string())?;
+    Ok(reader_bridge.reader.searcher())
+}
+
 /// impl for `ffi_sparse_search`
 pub fn ffi_sparse_search_impl(index_path: &str, sparse_vector: &SparseVector, sparse_bitmap: &Option<SparseBitmap>, top_k: u32) -> crate::Result<Vec<ScoredPointOffset>> {
-    let reader_bridge: Arc<IndexReaderBridge> = FFI_INDEX_SEARCHER_CACHE.get_index_reader_bridge(index_path.to_string())?;
-    let searcher: Searcher = reader_bridge.reader.searcher();
+    cached_searcher(index_path)?.search(sparse_vector, sparse_bitmap, top_k)
+}
 
-    let res: Vec<ScoredPointOffset> = searcher.search(sparse_vector, sparse_bitmap, top_k)?;
-    Ok(res)
+/// impl for `ffi_sparse_search_with_profile`
+pub fn ffi_sparse_search_with_profile_impl(
+    index_path: &str,
+    sparse_vector: &SparseVector,
+    sparse_bitmap: &Option<SparseBitmap>,
+    top_k: u32,
+) -> crate::Result<(Vec<ScoredPointOffset>, SearchProfile)> {
+    cached_searcher(index_path)?.search_with_profile(sparse_vector, sparse_bitmap, top_k)
 }
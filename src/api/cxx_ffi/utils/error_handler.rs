@@ -28,6 +28,12 @@ impl FFIResult<Vec<ScoredPointOffset>> for FFIScoreResult {
     }
 }
 
+impl FFIResult<Vec<ScoredPointOffset>> for FFIScoreProfileResult {
+    fn from_error(error_message: String) -> Self {
+        FFIScoreProfileResult { result: vec![], profile: FFISearchProfile::default(), error: FFIError { is_error: true, message: error_message } }
+    }
+}
+
 pub struct ApiUtils;
 
 impl ApiUtils {
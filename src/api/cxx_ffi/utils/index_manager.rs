@@ -3,6 +3,7 @@ use std::sync::{Arc, Mutex};
 
 use crate::api::cxx_ffi::cache::{IndexReaderBridge, IndexWriterBridge, FFI_INDEX_SEARCHER_CACHE, FFI_INDEX_WRITER_CACHE};
 use crate::common::errors::SparseError;
+use crate::core::LoadPolicy;
 use crate::error_ck;
 use crate::index::Index;
 use crate::indexer::LogMergePolicy;
@@ -77,7 +78,8 @@ impl IndexManager {
         return Ok(reload_status);
     }
 
-    pub fn load_index_reader_bridge(index_path: &str) -> crate::Result<bool> {
+    /// `load_policy` overrides the one in index settings.
+    pub fn load_index_reader_bridge(index_path: &str, load_policy: Option<LoadPolicy>) -> crate::Result<bool> {
         // Boundary.
         let index_files_directory = Path::new(index_path);
         if !index_files_directory.exists() || !index_files_directory.is_dir() {
@@ -94,6 +96,9 @@ impl IndexManager {
 
         // Load sparse index with given directory.
         let mut index = Index::open_in_dir(index_files_directory)?;
+        if let Some(load_policy) = load_policy {
+            index.set_load_policy(load_policy);
+        }
 
         // set shared thread pool for index reader
         match FFI_INDEX_SEARCHER_CACHE.get_shared_multi_thread_executor(num_cpus::get()) {
@@ -0,0 +1,31 @@
+//! Offline index conversion, e.g. rewrite an mmap f32 index into a compressed u8 one:
+//!
+//! `convert_index <index_path> <target_index_path> '{"inverted_index_config":{"storage":"compressed_mmap","quantized":true}}'`
+
+use std::process::ExitCode;
+
+use sparse_index::{IndexConverter, IndexSettings};
+
+fn main() -> ExitCode {
+    env_logger::init();
+    let args: Vec<String> = std::env::args().collect();
+    if args.len() != 4 {
+        eprintln!("usage: {} <index_path> <target_index_path> <target_index_json_parameter>", args[0]);
+        return ExitCode::FAILURE;
+    }
+
+    let target_settings: IndexSettings = match serde_json::from_str(&args[3]) {
+        Ok(settings) => settings,
+        Err(e) => {
+            eprintln!("invalid target index parameter: {}", e);
+            return ExitCode::FAILURE;
+        }
+    };
+    match IndexConverter::open(&args[1]).and_then(|converter| converter.convert(&args[2], target_settings)) {
+        Ok(_) => ExitCode::SUCCESS,
+        Err(e) => {
+            eprintln!("failed to convert index: {}", e);
+            ExitCode::FAILURE
+        }
+    }
+}
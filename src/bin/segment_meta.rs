@@ -0,0 +1,27 @@
+//! Print the meta of a single-file segment as json, segments store it in binary.
+//!
+//! `segment_meta <segment_container_path>`
+
+use std::path::Path;
+use std::process::ExitCode;
+
+use sparse_index::export_segment_meta_json;
+
+fn main() -> ExitCode {
+    let args: Vec<String> = std::env::args().collect();
+    if args.len() != 2 {
+        eprintln!("usage: {} <segment_container_path>", args[0]);
+        return ExitCode::FAILURE;
+    }
+
+    match export_segment_meta_json(Path::new(&args[1])) {
+        Ok(json) => {
+            println!("{}", json);
+            ExitCode::SUCCESS
+        }
+        Err(e) => {
+            eprintln!("failed to read segment meta: {}", e);
+            ExitCode::FAILURE
+        }
+    }
+}
@@ -0,0 +1,241 @@
+use std::collections::hash_map::DefaultHasher;
+use std::collections::HashMap;
+use std::hash::{Hash, Hasher};
+use std::sync::atomic::{AtomicU64, AtomicUsize, Ordering};
+use std::sync::Arc;
+
+use parking_lot::Mutex;
+
+const SHARDS_COUNT: usize = 16;
+
+/// Value kept in a [`ClockCache`], capacity is counted in `size` bytes.
+pub trait CacheEntry {
+    fn size(&self) -> usize;
+}
+
+#[derive(Debug, Default, Clone, Copy, PartialEq)]
+pub struct CacheStats {
+    pub hits: u64,
+    pub misses: u64,
+    pub evictions: u64,
+    pub cached_bytes: usize,
+    pub capacity_bytes: usize,
+}
+
+impl CacheStats {
+    /// Hits of all recorded lookups, 0 before any lookup.
+    pub fn hit_ratio(&self) -> f64 {
+        match self.hits + self.misses {
+            0 => 0.0,
+            lookups => self.hits as f64 / lookups as f64,
+        }
+    }
+}
+
+struct Slot<K, V> {
+    key: K,
+    value: Arc<V>,
+    referenced: bool,
+}
+
+/// CLOCK replacement: a hit marks the slot referenced, the hand clears marks and evicts the first unmarked slot.
+struct ClockShard<K, V> {
+    slots: Vec<Slot<K, V>>,
+    index: HashMap<K, usize>,
+    hand: usize,
+    bytes: usize,
+}
+
+impl<K, V> Default for ClockShard<K, V> {
+    fn default() -> Self {
+        Self { slots: Vec::new(), index: HashMap::new(), hand: 0, bytes: 0 }
+    }
+}
+
+impl<K: Hash + Eq + Copy, V: CacheEntry> ClockShard<K, V> {
+    fn get(&mut self, key: &K) -> Option<Arc<V>> {
+        let &slot = self.index.get(key)?;
+        self.slots[slot].referenced = true;
+        Some(self.slots[slot].value.clone())
+    }
+
+    /// Returns the number of evicted values, values larger than `capacity` are not cached.
+    fn insert(&mut self, key: K, value: Arc<V>, capacity: usize) -> usize {
+        let size = value.size();
+        if size > capacity || self.index.contains_key(&key) {
+            return 0;
+        }
+        let mut evicted = 0;
+        while self.bytes + size > capacity {
+            self.evict_one();
+            evicted += 1;
+        }
+        self.bytes += size;
+        self.index.insert(key, self.slots.len());
+        self.slots.push(Slot { key, value, referenced: false });
+        evicted
+    }
+
+    fn evict_one(&mut self) {
+        loop {
+            if self.hand >= self.slots.len() {
+                self.hand = 0;
+            }
+            let slot = &mut self.slots[self.hand];
+            if slot.referenced {
+                slot.referenced = false;
+                self.hand += 1;
+                continue;
+            }
+            let removed = self.slots.swap_remove(self.hand);
+            self.index.remove(&removed.key);
+            if let Some(moved) = self.slots.get(self.hand) {
+                self.index.insert(moved.key, self.hand);
+            }
+            self.bytes -= removed.value.size();
+            return;
+        }
+    }
+}
+
+/// Sharded CLOCK cache bounded by the bytes of cached values, shared by concurrent searches.
+pub struct ClockCache<K, V> {
+    shards: Vec<Mutex<ClockShard<K, V>>>,
+    shard_capacity: AtomicUsize,
+    /// Capacity asked by `configure_capacity`, shared by every user of a process wide cache.
+    configured_capacity: Mutex<Option<usize>>,
+    hits: AtomicU64,
+    misses: AtomicU64,
+    evictions: AtomicU64,
+}
+
+impl<K: Hash + Eq + Copy, V: CacheEntry> ClockCache<K, V> {
+    pub fn new(capacity_bytes: usize) -> Self {
+        Self {
+            shards: (0..SHARDS_COUNT).map(|_| Mutex::new(ClockShard::default())).collect(),
+            shard_capacity: AtomicUsize::new(capacity_bytes / SHARDS_COUNT),
+            configured_capacity: Mutex::new(None),
+            hits: AtomicU64::new(0),
+            misses: AtomicU64::new(0),
+            evictions: AtomicU64::new(0),
+        }
+    }
+
+    /// A smaller capacity takes effect when values are inserted.
+    pub fn set_capacity(&self, capacity_bytes: usize) {
+        self.shard_capacity.store(capacity_bytes / SHARDS_COUNT, Ordering::Relaxed);
+    }
+
+    /// Process level capacity: the first call sets it, later ones must ask for the same capacity or get the configured one back as error.
+    pub fn configure_capacity(&self, capacity_bytes: usize) -> Result<(), usize> {
+        let mut configured = self.configured_capacity.lock();
+        match *configured {
+            Some(configured_bytes) if configured_bytes != capacity_bytes => Err(configured_bytes),
+            Some(_) => Ok(()),
+            None => {
+                *configured = Some(capacity_bytes);
+                self.set_capacity(capacity_bytes);
+                Ok(())
+            }
+        }
+    }
+
+    pub fn capacity(&self) -> usize {
+        self.shard_capacity.load(Ordering::Relaxed) * SHARDS_COUNT
+    }
+
+    /// Count a lookup in the hit ratio, callers decide which lookups are worth counting.
+    pub fn record(&self, hit: bool) {
+        match hit {
+            true => self.hits.fetch_add(1, Ordering::Relaxed),
+            false => self.misses.fetch_add(1, Ordering::Relaxed),
+        };
+    }
+
+    pub fn stats(&self) -> CacheStats {
+        CacheStats {
+            hits: self.hits.load(Ordering::Relaxed),
+            misses: self.misses.load(Ordering::Relaxed),
+            evictions: self.evictions.load(Ordering::Relaxed),
+            cached_bytes: self.shards.iter().map(|shard| shard.lock().bytes).sum(),
+            capacity_bytes: self.capacity(),
+        }
+    }
+
+    fn shard(&self, key: &K) -> &Mutex<ClockShard<K, V>> {
+        let mut hasher = DefaultHasher::new();
+        key.hash(&mut hasher);
+        &self.shards[hasher.finish() as usize % SHARDS_COUNT]
+    }
+
+    /// Cached value of `key`, `load` runs without holding the shard lock on a miss. The flag tells whether it was a hit.
+    pub fn get_or_load<E>(&self, key: K, load: impl FnOnce() -> Result<V, E>) -> Result<(Arc<V>, bool), E> {
+        let shard = self.shard(&key);
+        if let Some(value) = shard.lock().get(&key) {
+            return Ok((value, true));
+        }
+        let value = Arc::new(load()?);
+        let evicted = shard.lock().insert(key, value.clone(), self.shard_capacity.load(Ordering::Relaxed));
+        self.evictions.fetch_add(evicted as u64, Ordering::Relaxed);
+        Ok((value, false))
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    struct Bytes(usize);
+
+    impl CacheEntry for Bytes {
+        fn size(&self) -> usize {
+            self.0
+        }
+    }
+
+    #[test]
+    fn test_clock_shard_eviction() {
+        let mut shard = ClockShard::default();
+        for key in 0..4 {
+            assert_eq!(shard.insert(key, Arc::new(Bytes(64)), 256), 0);
+        }
+        // Referenced values get a second chance.
+        assert!(shard.get(&0).is_some());
+        assert_eq!(shard.insert(4, Arc::new(Bytes(64)), 256), 1);
+        assert!(shard.get(&0).is_some());
+        assert!(shard.get(&1).is_none());
+        assert_eq!(shard.bytes, 256);
+
+        assert_eq!(shard.insert(5, Arc::new(Bytes(512)), 256), 0);
+        assert!(shard.get(&5).is_none());
+        for (slot, entry) in shard.slots.iter().enumerate() {
+            assert_eq!(shard.index[&entry.key], slot);
+        }
+    }
+
+    #[test]
+    fn test_get_or_load() {
+        let cache: ClockCache<u32, Bytes> = ClockCache::new(SHARDS_COUNT * 128);
+        let (_, hit) = cache.get_or_load(7, || Ok::<_, ()>(Bytes(100))).unwrap();
+        assert!(!hit);
+        let (value, hit) = cache.get_or_load(7, || Err(())).unwrap();
+        assert!(hit);
+        assert_eq!(value.0, 100);
+        assert!(cache.get_or_load(8, || Err(())).is_err());
+
+        cache.record(true);
+        cache.record(false);
+        let stats = cache.stats();
+        assert_eq!((stats.cached_bytes, stats.capacity_bytes), (100, SHARDS_COUNT * 128));
+        assert_eq!(stats.hit_ratio(), 0.5);
+    }
+
+    #[test]
+    fn test_configure_capacity() {
+        let cache: ClockCache<u32, Bytes> = ClockCache::new(SHARDS_COUNT * 128);
+        cache.configure_capacity(SHARDS_COUNT * 64).unwrap();
+        cache.configure_capacity(SHARDS_COUNT * 64).unwrap();
+        assert_eq!(cache.configure_capacity(SHARDS_COUNT * 256), Err(SHARDS_COUNT * 64));
+        assert_eq!(cache.capacity(), SHARDS_COUNT * 64);
+    }
+}
@@ -0,0 +1,13 @@
+//! Threads that quantize, compress and write the postings of a flushed segment. They are kept apart from the global
+//! rayon pool, so a flush neither queues behind other rayon work of the host process nor fills the pool for it.
+
+use once_cell::sync::Lazy;
+use rayon::{ThreadPool, ThreadPoolBuilder};
+
+static FLUSH_POOL: Lazy<ThreadPool> =
+    Lazy::new(|| ThreadPoolBuilder::new().num_threads(num_cpus::get()).thread_name(|i| format!("segment_flush_{}", i)).build().expect("failed to build segment flush pool"));
+
+/// Runs `op` on the flush pool, parallel iterators inside it are spread over the flush threads.
+pub fn install_in_flush_pool<R: Send>(op: impl FnOnce() -> R + Send) -> R {
+    FLUSH_POOL.install(op)
+}
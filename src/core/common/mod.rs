@@ -1,5 +1,9 @@
+mod clock_cache;
+mod flush_pool;
 pub mod ops;
 pub mod types;
 
+pub use clock_cache::*;
+pub use flush_pool::*;
 pub use ops::*;
 pub use types::*;
@@ -1,5 +1,5 @@
 use std::fs::File;
-use std::io::{self, BufReader, BufWriter};
+use std::io::{self, BufReader, BufWriter, Write};
 use std::path::Path;
 
 use atomicwrites::{AtomicFile, OverwriteBehavior};
@@ -35,6 +35,35 @@ pub fn read_bin<T: DeserializeOwned>(path: &Path) -> Result<T, FileOperationErro
     Ok(data)
 }
 
+/// Prefix of index files written by `encode_bin_file`, json files never start with it.
+const BIN_FILE_MAGIC: &[u8; 4] = b"SPIB";
+
+/// `object` as bincode after `BIN_FILE_MAGIC`, decoded by `decode_bin_or_json` without parsing json.
+pub fn encode_bin_file<T: Serialize>(object: &T) -> Result<Vec<u8>, FileOperationError> {
+    let mut bytes = BIN_FILE_MAGIC.to_vec();
+    bincode::serialize_into(&mut bytes, object)?;
+    Ok(bytes)
+}
+
+/// Bytes written by `encode_bin_file`, or json written before index files were binary.
+pub fn decode_bin_or_json<T: DeserializeOwned>(bytes: &[u8]) -> Result<T, FileOperationError> {
+    match bytes.strip_prefix(BIN_FILE_MAGIC.as_slice()) {
+        Some(bin) => Ok(bincode::deserialize(bin)?),
+        None => Ok(serde_json::from_slice(bytes)?),
+    }
+}
+
+pub fn atomic_save_bin_file<T: Serialize>(path: &Path, object: &T) -> Result<(), FileOperationError> {
+    let bytes = encode_bin_file(object)?;
+    let af = AtomicFile::new(path, OverwriteBehavior::AllowOverwrite);
+    af.write(|f| f.write_all(&bytes))?;
+    Ok(())
+}
+
+pub fn read_bin_or_json<T: DeserializeOwned>(path: &Path) -> Result<T, FileOperationError> {
+    decode_bin_or_json(&std::fs::read(path)?)
+}
+
 #[derive(Debug, Error)]
 pub enum FileOperationError {
     #[error(transparent)]
@@ -123,6 +152,21 @@ mod tests {
         assert_eq!(data, loaded_data);
     }
 
+    #[test]
+    fn test_bin_file_reads_json_written_before() {
+        let temp_dir = tempdir().unwrap();
+        let file_path = temp_dir.path().join("test.json");
+        let data = TestData { name: "Bob".to_string(), age: 40 };
+
+        atomic_save_bin_file(&file_path, &data).unwrap();
+        assert!(std::fs::read(&file_path).unwrap().starts_with(BIN_FILE_MAGIC));
+        assert_eq!(read_bin_or_json::<TestData>(&file_path).unwrap(), data);
+
+        atomic_save_json(&file_path, &data).unwrap();
+        assert_eq!(read_bin_or_json::<TestData>(&file_path).unwrap(), data);
+        assert!(decode_bin_or_json::<TestData>(b"SPIB").is_err());
+    }
+
     #[test]
     fn test_file_operation_error() {
         let non_existent_path = Path::new("non_existent_file.json");
@@ -3,7 +3,7 @@
 
 use std::io;
 
-use serde::Deserialize;
+use serde::{Deserialize, Serialize};
 
 /// Global [`Advice`] value, to trivially set [`Advice`] value
 /// used by all memmaps created by the `segment` crate.
@@ -51,6 +51,58 @@ pub enum Advice {
     Sequential,
 }
 
+/// How segment files are brought into memory when they are loaded for searching.
+#[derive(Copy, Clone, Debug, Default, PartialEq, Eq, Serialize, Deserialize)]
+#[serde(rename_all = "snake_case")]
+pub enum LoadPolicy {
+    /// Pages are faulted in on demand with default read-ahead.
+    #[default]
+    Normal,
+
+    /// Pages are faulted in on demand without read-ahead, archival indexes don't pollute the page cache.
+    Random,
+
+    /// Aggressive read-ahead, for indexes that are mostly scanned in full.
+    Sequential,
+
+    /// All pages are read when the file is mapped, searches never wait on a page fault.
+    Populate,
+
+    /// Populated and locked into RAM, pages are never evicted. `RLIMIT_MEMLOCK` must cover the index size.
+    Mlock,
+
+    /// Read into anonymous memory, nothing is paged in from the file afterwards. `ram` storage always loads this way.
+    InMemory,
+
+    /// Same as `InMemory`, backed by transparent huge pages where the platform supports them.
+    InMemoryHugePages,
+
+    /// Postings are read with `pread` into the shared posting cache instead of being paged in.
+    /// Only `compressed_mmap` storage reads this way, other storage loads like `Random`.
+    Pread,
+}
+
+impl LoadPolicy {
+    /// Advice given to the mapping, resident pages don't need read-ahead.
+    pub fn advice(&self) -> Advice {
+        match self {
+            LoadPolicy::Normal | LoadPolicy::Populate | LoadPolicy::Mlock | LoadPolicy::InMemory | LoadPolicy::InMemoryHugePages => Advice::Normal,
+            LoadPolicy::Random | LoadPolicy::Pread => Advice::Random,
+            LoadPolicy::Sequential => Advice::Sequential,
+        }
+    }
+
+    /// Whether all pages are read when the file is mapped.
+    pub fn populate(&self) -> bool {
+        matches!(self, LoadPolicy::Populate | LoadPolicy::Mlock)
+    }
+
+    /// Whether the file is copied into anonymous memory.
+    pub fn in_memory(&self) -> bool {
+        matches!(self, LoadPolicy::InMemory | LoadPolicy::InMemoryHugePages)
+    }
+}
+
 #[cfg(unix)]
 impl From<Advice> for memmap2::Advice {
     fn from(advice: Advice) -> Self {
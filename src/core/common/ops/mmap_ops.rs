@@ -1,10 +1,10 @@
 use std::fs::{File, OpenOptions};
-use std::io;
+use std::io::{self, Read};
 use std::path::Path;
 
-use memmap2::{Mmap, MmapMut};
+use memmap2::{Mmap, MmapMut, MmapOptions};
 
-use super::madvise;
+use super::madvise::{self, LoadPolicy};
 
 pub const TEMP_FILE_EXTENSION: &str = "tmp";
 
@@ -50,6 +50,56 @@ pub fn open_read_mmap(path: &Path) -> Result<Mmap, io::Error> {
     Ok(mmap)
 }
 
+/// Map a file for searching, `load_policy` decides how its pages are brought into memory.
+pub fn open_read_mmap_with_policy(path: &Path, load_policy: LoadPolicy) -> Result<Mmap, io::Error> {
+    let file = OpenOptions::new().read(true).write(false).append(true).create(true).truncate(false).open(path)?;
+    if load_policy.in_memory() {
+        return read_into_anonymous_mmap(file, load_policy == LoadPolicy::InMemoryHugePages);
+    }
+
+    let mut options = MmapOptions::new();
+    if load_policy.populate() {
+        // `MAP_POPULATE`, it's ignored outside of linux and pages are touched one by one instead.
+        options.populate();
+    }
+    let mmap = unsafe { options.map(&file)? };
+    madvise::madvise(&mmap, load_policy.advice())?;
+
+    #[cfg(not(target_os = "linux"))]
+    if load_policy.populate() {
+        for offset in (0..mmap.len()).step_by(PAGE_SIZE) {
+            std::hint::black_box(mmap[offset]);
+        }
+    }
+    if load_policy == LoadPolicy::Mlock {
+        #[cfg(unix)]
+        mmap.lock()?;
+        #[cfg(not(unix))]
+        log::debug!("Ignore mlock on this platform");
+    }
+
+    Ok(mmap)
+}
+
+#[cfg(not(target_os = "linux"))]
+const PAGE_SIZE: usize = 4096;
+
+/// Copy the whole file into an anonymous mapping, it's not backed by the page cache of the file.
+fn read_into_anonymous_mmap(mut file: File, huge_pages: bool) -> Result<Mmap, io::Error> {
+    let mut mmap = MmapMut::map_anon(file.metadata()?.len() as usize)?;
+    if huge_pages {
+        // Must be advised before pages are touched, huge pages are only a hint and the copy works without them.
+        #[cfg(target_os = "linux")]
+        if let Err(e) = mmap.advise(memmap2::Advice::HugePage) {
+            log::warn!("Can't back anonymous mmap with huge pages: {}", e);
+        }
+        #[cfg(not(target_os = "linux"))]
+        log::debug!("Ignore huge pages on this platform");
+    }
+    file.read_exact(&mut mmap)?;
+    mmap.make_read_only()
+}
+
 pub fn open_write_mmap(path: &Path) -> Result<MmapMut, io::Error> {
     let file = OpenOptions::new().read(true).write(true).create(false).open(path)?;
 
@@ -81,6 +131,26 @@ mod tests {
         assert_eq!(file.metadata().unwrap().len(), 2048);
     }
 
+    #[test]
+    fn test_open_read_mmap_with_policy() {
+        let temp_dir = tempdir().unwrap();
+        let file_path = temp_dir.path().join("test_file");
+        fs::write(&file_path, vec![7u8; 3 * 4096 + 5]).unwrap();
+
+        for load_policy in
+            [LoadPolicy::Normal, LoadPolicy::Random, LoadPolicy::Sequential, LoadPolicy::Populate, LoadPolicy::InMemory, LoadPolicy::InMemoryHugePages, LoadPolicy::Pread]
+        {
+            let mmap = open_read_mmap_with_policy(&file_path, load_policy).unwrap();
+            assert_eq!(mmap.len(), 3 * 4096 + 5);
+            assert!(mmap.iter().all(|&byte| byte == 7));
+        }
+
+        // A copy in anonymous memory doesn't see later changes of the file.
+        let in_memory = open_read_mmap_with_policy(&file_path, LoadPolicy::InMemory).unwrap();
+        fs::write(&file_path, vec![9u8; 3 * 4096 + 5]).unwrap();
+        assert!(in_memory.iter().all(|&byte| byte == 7));
+    }
+
     #[test]
     fn test_open_read_mmap() {
         let temp_dir = tempdir().unwrap();
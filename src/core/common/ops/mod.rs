@@ -3,7 +3,10 @@ pub mod madvise;
 mod bytes_ops;
 mod file_ops;
 mod mmap_ops;
+mod u8_scores;
 
 pub use bytes_ops::*;
 pub use file_ops::*;
+pub use madvise::LoadPolicy;
 pub use mmap_ops::*;
+pub use u8_scores::{pack_u4_weights, u4_weight, u4_weights_to_scores, u8_weights_to_scores, weights_as_u8};
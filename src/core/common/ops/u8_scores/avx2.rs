@@ -0,0 +1,64 @@
+use std::arch::x86_64::*;
+
+const NUM_LANES: usize = 8;
+/// Nibbles in 16 bytes.
+const NUM_U4_LANES: usize = 32;
+
+pub fn u8_weights_to_scores(weights: &[u8], scale: f32, offset: f32, output: &mut [f32]) {
+    let num_words = weights.len() / NUM_LANES;
+    unsafe { u8_weights_to_scores_avx2_aux(weights.as_ptr(), scale, offset, output.as_mut_ptr(), num_words) };
+    let reminder_start = num_words * NUM_LANES;
+    for i in reminder_start..weights.len() {
+        output[i] = offset + weights[i] as f32 * scale;
+    }
+}
+
+/// Widen 8 u8 into 8 i32 lanes, convert to f32, then `mul` and `add` (no fma, keep same rounding with scalar).
+#[target_feature(enable = "avx2")]
+unsafe fn u8_weights_to_scores_avx2_aux(mut input: *const u8, scale: f32, offset: f32, mut output: *mut f32, num_words: usize) {
+    let scale_simd = _mm256_set1_ps(scale);
+    let offset_simd = _mm256_set1_ps(offset);
+    for _ in 0..num_words {
+        let bytes = _mm_loadl_epi64(input as *const __m128i);
+        let weights_f32 = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(bytes));
+        let scores = _mm256_add_ps(_mm256_mul_ps(weights_f32, scale_simd), offset_simd);
+        _mm256_storeu_ps(output, scores);
+        input = input.add(NUM_LANES);
+        output = output.add(NUM_LANES);
+    }
+}
+
+/// Same with `u8_weights_to_scores`, but weights are nibble packed and the first one is nibble `start` of `packed`.
+pub fn u4_weights_to_scores(packed: &[u8], start: usize, scale: f32, offset: f32, output: &mut [f32]) {
+    // Kernel starts at a byte boundary.
+    let head = (start % 2).min(output.len());
+    for i in 0..head {
+        output[i] = offset + super::u4_weight(packed, start + i) as f32 * scale;
+    }
+    let num_words = (output.len() - head) / NUM_U4_LANES;
+    unsafe { u4_weights_to_scores_avx2_aux(packed[(start + head) / 2..].as_ptr(), scale, offset, output[head..].as_mut_ptr(), num_words) };
+    for i in head + num_words * NUM_U4_LANES..output.len() {
+        output[i] = offset + super::u4_weight(packed, start + i) as f32 * scale;
+    }
+}
+
+/// Split 16 bytes into 32 nibbles in order (low nibble first), then widen them into f32 lanes 8 at a time.
+#[target_feature(enable = "avx2")]
+unsafe fn u4_weights_to_scores_avx2_aux(mut input: *const u8, scale: f32, offset: f32, mut output: *mut f32, num_words: usize) {
+    let scale_simd = _mm256_set1_ps(scale);
+    let offset_simd = _mm256_set1_ps(offset);
+    let low_mask = _mm_set1_epi8(0x0f);
+    for _ in 0..num_words {
+        let bytes = _mm_loadu_si128(input as *const __m128i);
+        let low = _mm_and_si128(bytes, low_mask);
+        let high = _mm_and_si128(_mm_srli_epi16(bytes, 4), low_mask);
+        for nibbles in [_mm_unpacklo_epi8(low, high), _mm_unpackhi_epi8(low, high)] {
+            for half in [nibbles, _mm_srli_si128(nibbles, 8)] {
+                let weights_f32 = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(half));
+                _mm256_storeu_ps(output, _mm256_add_ps(_mm256_mul_ps(weights_f32, scale_simd), offset_simd));
+                output = output.add(NUM_LANES);
+            }
+        }
+        input = input.add(NUM_U4_LANES / 2);
+    }
+}
@@ -0,0 +1,165 @@
+//! Restore a run of u8 (or nibble packed u4) weights into f32 scores: `offset + weight * scale`.
+//! `scale` and `offset` are computed once per posting from the query weight and `QuantizedParam`.
+#[cfg(target_arch = "x86_64")]
+mod avx2;
+
+mod scalar;
+
+use std::any::TypeId;
+
+#[derive(Clone, Copy, Eq, PartialEq, Debug)]
+#[repr(u8)]
+enum ScoresImplPerInstructionSet {
+    #[cfg(target_arch = "x86_64")]
+    AVX2 = 0u8,
+    Scalar = 1u8,
+}
+
+impl ScoresImplPerInstructionSet {
+    #[inline]
+    pub fn is_available(&self) -> bool {
+        match *self {
+            #[cfg(target_arch = "x86_64")]
+            ScoresImplPerInstructionSet::AVX2 => is_x86_feature_detected!("avx2"),
+            ScoresImplPerInstructionSet::Scalar => true,
+        }
+    }
+}
+
+// List of available implementation in preferred order.
+#[cfg(target_arch = "x86_64")]
+const IMPLS: [ScoresImplPerInstructionSet; 2] = [ScoresImplPerInstructionSet::AVX2, ScoresImplPerInstructionSet::Scalar];
+
+#[cfg(not(target_arch = "x86_64"))]
+const IMPLS: [ScoresImplPerInstructionSet; 1] = [ScoresImplPerInstructionSet::Scalar];
+
+impl ScoresImplPerInstructionSet {
+    #[allow(unused_variables)]
+    #[inline]
+    fn from(code: u8) -> ScoresImplPerInstructionSet {
+        #[cfg(target_arch = "x86_64")]
+        if code == ScoresImplPerInstructionSet::AVX2 as u8 {
+            return ScoresImplPerInstructionSet::AVX2;
+        }
+        ScoresImplPerInstructionSet::Scalar
+    }
+
+    #[inline]
+    fn u8_weights_to_scores(self, weights: &[u8], scale: f32, offset: f32, output: &mut [f32]) {
+        match self {
+            #[cfg(target_arch = "x86_64")]
+            ScoresImplPerInstructionSet::AVX2 => avx2::u8_weights_to_scores(weights, scale, offset, output),
+            ScoresImplPerInstructionSet::Scalar => scalar::u8_weights_to_scores(weights, scale, offset, output),
+        }
+    }
+
+    fn u4_weights_to_scores(self, packed: &[u8], start: usize, scale: f32, offset: f32, output: &mut [f32]) {
+        match self {
+            #[cfg(target_arch = "x86_64")]
+            ScoresImplPerInstructionSet::AVX2 => avx2::u4_weights_to_scores(packed, start, scale, offset, output),
+            ScoresImplPerInstructionSet::Scalar => scalar::u4_weights_to_scores(packed, start, scale, offset, output),
+        }
+    }
+}
+
+#[inline]
+fn get_best_available_instruction_set() -> ScoresImplPerInstructionSet {
+    use std::sync::atomic::{AtomicU8, Ordering};
+    static INSTRUCTION_SET_BYTE: AtomicU8 = AtomicU8::new(u8::MAX);
+    let instruction_set_byte: u8 = INSTRUCTION_SET_BYTE.load(Ordering::Relaxed);
+    if instruction_set_byte == u8::MAX {
+        // Let's initialize the instruction set and cache it.
+        let instruction_set = IMPLS.into_iter().find(ScoresImplPerInstructionSet::is_available).unwrap();
+        INSTRUCTION_SET_BYTE.store(instruction_set as u8, Ordering::Relaxed);
+        return instruction_set;
+    }
+    ScoresImplPerInstructionSet::from(instruction_set_byte)
+}
+
+/// View `TW` weights as `u8` when `TW` is `u8`, so that they can be handled by SIMD kernels.
+pub fn weights_as_u8<TW: 'static>(weights: &[TW]) -> Option<&[u8]> {
+    if TypeId::of::<TW>() == TypeId::of::<u8>() {
+        Some(unsafe { std::slice::from_raw_parts(weights.as_ptr() as *const u8, weights.len()) })
+    } else {
+        None
+    }
+}
+
+/// `output[i] = offset + weights[i] * scale`, `output` should have the same length with `weights`.
+pub fn u8_weights_to_scores(weights: &[u8], scale: f32, offset: f32, output: &mut [f32]) {
+    assert_eq!(weights.len(), output.len());
+    get_best_available_instruction_set().u8_weights_to_scores(weights, scale, offset, output)
+}
+
+/// Nibble `idx` of u4 weights packed two in a byte, low nibble first.
+#[inline]
+pub fn u4_weight(packed: &[u8], idx: usize) -> u8 {
+    (packed[idx / 2] >> (4 * (idx % 2))) & 0x0f
+}
+
+/// Pack u4 weights (values in `0..=15`) two in a byte, low nibble first.
+pub fn pack_u4_weights(weights: &[u8]) -> Vec<u8> {
+    weights.chunks(2).map(|pair| (pair[0] & 0x0f) | (pair.get(1).copied().unwrap_or(0) << 4)).collect()
+}
+
+/// `output[i] = offset + u4_weight(packed, start + i) * scale`.
+pub fn u4_weights_to_scores(packed: &[u8], start: usize, scale: f32, offset: f32, output: &mut [f32]) {
+    assert!((start + output.len() + 1) / 2 <= packed.len());
+    get_best_available_instruction_set().u4_weights_to_scores(packed, start, scale, offset, output)
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_get_best_available_instruction_set() {
+        let instruction_set = get_best_available_instruction_set();
+        assert_eq!(get_best_available_instruction_set(), instruction_set);
+    }
+
+    fn test_scores_impl_aux(scores_impl: ScoresImplPerInstructionSet, len: usize) {
+        let weights: Vec<u8> = (0..len).map(|i| (i * 37 % 256) as u8).collect();
+        let (scale, offset) = (0.37f32, -1.25f32);
+        let mut output = vec![0.0f32; len];
+        scores_impl.u8_weights_to_scores(&weights, scale, offset, &mut output);
+        for (weight, score) in weights.iter().zip(output.iter()) {
+            assert_eq!(*score, offset + *weight as f32 * scale);
+        }
+    }
+
+    fn test_u4_scores_impl_aux(scores_impl: ScoresImplPerInstructionSet, start: usize, len: usize) {
+        let weights: Vec<u8> = (0..start + len).map(|i| (i * 7 % 16) as u8).collect();
+        let packed = pack_u4_weights(&weights);
+        assert_eq!(packed.len(), (weights.len() + 1) / 2);
+        let (scale, offset) = (0.37f32, -1.25f32);
+        let mut output = vec![0.0f32; len];
+        scores_impl.u4_weights_to_scores(&packed, start, scale, offset, &mut output);
+        for (weight, score) in weights[start..].iter().zip(output.iter()) {
+            assert_eq!(*score, offset + *weight as f32 * scale);
+        }
+    }
+
+    #[test]
+    fn test_scores_implementation_scalar() {
+        for len in [0, 1, 7, 8, 9, 128, 131] {
+            test_scores_impl_aux(ScoresImplPerInstructionSet::Scalar, len);
+        }
+        for (start, len) in [(0, 0), (1, 1), (0, 31), (1, 64), (3, 125), (0, 128)] {
+            test_u4_scores_impl_aux(ScoresImplPerInstructionSet::Scalar, start, len);
+        }
+    }
+
+    #[test]
+    #[cfg(target_arch = "x86_64")]
+    fn test_scores_implementation_avx2() {
+        if ScoresImplPerInstructionSet::AVX2.is_available() {
+            for len in [0, 1, 7, 8, 9, 128, 131] {
+                test_scores_impl_aux(ScoresImplPerInstructionSet::AVX2, len);
+            }
+            for (start, len) in [(0, 0), (1, 1), (0, 31), (1, 64), (3, 125), (0, 128)] {
+                test_u4_scores_impl_aux(ScoresImplPerInstructionSet::AVX2, start, len);
+            }
+        }
+    }
+}
@@ -0,0 +1,11 @@
+pub fn u8_weights_to_scores(weights: &[u8], scale: f32, offset: f32, output: &mut [f32]) {
+    for (score, &weight) in output.iter_mut().zip(weights.iter()) {
+        *score = offset + weight as f32 * scale;
+    }
+}
+
+pub fn u4_weights_to_scores(packed: &[u8], start: usize, scale: f32, offset: f32, output: &mut [f32]) {
+    for (idx, score) in output.iter_mut().enumerate() {
+        *score = offset + super::u4_weight(packed, start + idx) as f32 * scale;
+    }
+}
@@ -20,6 +20,12 @@ pub enum WeightType {
     WeightU8,
 }
 
+/// Quantized postings keep one [`QuantizedParam`] for every run of this many weights, the range of a run is narrower
+/// than the range of the whole posting, so weights restored from `u8` are closer to the original ones.
+pub const QUANTIZATION_BLOCK_SIZE: usize = 128;
+
+/// Stored as a column in postings, keep the layout fixed.
+#[repr(C)]
 #[derive(Copy, Clone, Debug)]
 pub struct QuantizedParam {
     min: f32,
@@ -39,10 +45,35 @@ impl QuantizedParam {
         Self { min, diff256: (max - min) / 255.0 }
     }
 
+    /// Restore a param from its stored `min` and `min_precision`.
+    pub fn from_parts(min: f32, diff256: f32) -> Self {
+        Self { min, diff256 }
+    }
+
     pub fn min_precision(&self) -> f32 {
         self.diff256
     }
 
+    /// Smallest weight this param can restore, it's the minimum of the quantized posting.
+    pub fn min(&self) -> f32 {
+        self.min
+    }
+
+    /// Largest weight this param can restore, it's the maximum of the quantized posting.
+    pub fn max(&self) -> f32 {
+        self.min + self.diff256 * 255.0
+    }
+
+    /// Same range split into 15 steps for `u4` weights, each one covers 17 `u8` steps.
+    pub fn to_u4(&self) -> Self {
+        Self { min: self.min, diff256: self.diff256 * 17.0 }
+    }
+
+    /// Fold query weight into this param once per posting, then `score = offset + u8_weight * scale`.
+    pub fn scale_and_offset(&self, query_weight: f32) -> (f32, f32) {
+        (self.diff256 * query_weight, self.min * query_weight)
+    }
+
     pub fn approximately_eq<W: QuantizedWeight>(&self, left: W, right: W) -> bool {
         let u8_right = W::to_u8(right);
         let u8_left = W::to_u8(left);
@@ -66,7 +97,18 @@ impl Default for QuantizedParam {
     }
 }
 
-pub trait QuantizedWeight: Clone + Copy + Debug + PartialEq + PartialOrd + 'static {
+/// Param covering the range of `weights`, the default one when there is no weight.
+pub fn gen_quantized_param_of<OW: QuantizedWeight>(weights: impl Iterator<Item = OW>) -> QuantizedParam {
+    weights
+        .fold(None, |bounds, weight| match bounds {
+            None => Some((weight, weight)),
+            Some((min, max)) => Some((OW::min(min, weight), OW::max(max, weight))),
+        })
+        .map(|(min, max)| OW::gen_quantized_param(min, max))
+        .unwrap_or_default()
+}
+
+pub trait QuantizedWeight: Clone + Copy + Debug + PartialEq + PartialOrd + Send + Sync + 'static {
     /// Return current [`Weight`] minimum value.
     #[allow(non_snake_case)]
     fn MINIMUM() -> Self;
@@ -2,19 +2,17 @@ use enum_dispatch::enum_dispatch;
 use log::{debug, error, info};
 use std::path::PathBuf;
 
-use crate::core::{IndexWeightType, InvertedIndexMetrics, StorageType};
+use crate::core::{verify_segment_container, CompressedInvertedIndexMmapConfig, IndexWeightType, InvertedIndexMetrics, InvertedIndexMmapFileConfig, LoadPolicy, StorageType};
 use crate::index::IndexSettings;
 use crate::{
     common::errors::SparseError,
     core::{
-        CompressedInvertedIndexMmap, CompressedInvertedIndexMmapMerger, DimId, ElementRead, ElementType, InvertedIndexMmap, InvertedIndexMmapAccess, InvertedIndexMmapInit,
+        CompressedInvertedIndexMmap, CompressedInvertedIndexMmapMerger, DimId, ElementType, InvertedIndexMmap, InvertedIndexMmapAccess, InvertedIndexMmapInit,
         InvertedIndexMmapMerger, PostingListIter, PostingListIterAccess, QuantizedWeight,
     },
     RowId,
 };
 
-use super::{generic_posting_iterator::PostingListIteratorWrapper, GenericPostingListIterator};
-
 #[derive(Debug, Clone, Copy, PartialEq, Eq, PartialOrd, Ord)]
 pub enum InvertedIndexWrapperType {
     Simple,
@@ -36,51 +34,41 @@ impl<OW: QuantizedWeight, TW: QuantizedWeight> InvertedIndexWrapper<OW, TW> {
         }
     }
 
-    pub(super) fn support_pruning(&self) -> bool {
+    pub(crate) fn dim_ids(&self) -> Vec<DimId> {
         match self {
-            InvertedIndexWrapper::SimpleInvertedIndex(e) => match e.meta.inverted_index_meta.element_type {
-                crate::core::ElementType::SIMPLE => false,
-                crate::core::ElementType::EXTENDED => true,
-            },
-            InvertedIndexWrapper::CompressedInvertedIndex(_) => false,
+            InvertedIndexWrapper::SimpleInvertedIndex(e) => e.dim_ids(),
+            InvertedIndexWrapper::CompressedInvertedIndex(e) => e.dim_ids(),
         }
     }
 
-    #[rustfmt::skip]
-    pub(super) fn get_posting_opt(
-        &self,
-        dim_id: DimId,
-        min_row_id: &mut RowId,
-        max_row_id: &mut RowId,
-    ) -> Option<GenericPostingListIterator<'_>>
-    {
+    /// Row ids and weights restored into `f32` of the posting of `dim_id`, sorted by external row id.
+    pub(crate) fn posting_elements(&self, dim_id: DimId) -> Vec<(RowId, f32)> {
+        let mut elements = Vec::new();
         match self {
             InvertedIndexWrapper::SimpleInvertedIndex(e) => {
-                if let Some(mut value) = e.iter(&dim_id) {
-                    if let (Some(first), Some(last_id)) = (&value.peek(), value.last_id()) {
-                        *min_row_id = std::cmp::min(*min_row_id, first.row_id());
-                        *max_row_id = std::cmp::max(*max_row_id, last_id);
-                    }
-                    let wrapper: PostingListIteratorWrapper<'_, OW, TW> = value.into();
-
-                    Some(GenericPostingListIterator::from(wrapper))
-                } else {
-                    None
+                if let Some(mut iter) = e.iter(&dim_id) {
+                    iter.for_each_weight_till_row_id(RowId::MAX, |row_id, weight| elements.push((row_id, weight)));
                 }
-            },
+            }
             InvertedIndexWrapper::CompressedInvertedIndex(e) => {
-                if let Some(mut value) = e.iter(&dim_id) {
-                    if let (Some(first), Some(last_id)) = (&value.peek(), value.last_id()) {
-                        *min_row_id = std::cmp::min(*min_row_id, first.row_id());
-                        *max_row_id = std::cmp::max(*max_row_id, last_id);
+                if let Some(mut iter) = e.iter(&dim_id) {
+                    iter.for_each_weight_till_row_id(RowId::MAX, |row_id, weight| elements.push((e.external_row_id(row_id), weight)));
+                    if e.row_id_map.is_some() {
+                        elements.sort_unstable_by_key(|&(row_id, _)| row_id);
                     }
-                    let wrapper: PostingListIteratorWrapper<'_, OW, TW> = value.into();
-
-                    Some(GenericPostingListIterator::from(wrapper))
-                } else {
-                    None
                 }
+            }
+        }
+        elements
+    }
+
+    pub(crate) fn support_pruning(&self) -> bool {
+        match self {
+            InvertedIndexWrapper::SimpleInvertedIndex(e) => match e.meta.inverted_index_meta.element_type {
+                crate::core::ElementType::SIMPLE => false,
+                crate::core::ElementType::EXTENDED => true,
             },
+            InvertedIndexWrapper::CompressedInvertedIndex(_) => false,
         }
     }
 }
@@ -120,22 +108,24 @@ impl GenericInvertedIndex {
         index_path: &PathBuf,
         segment_id: Option<&str>,
         index_settings: &IndexSettings,
+        load_policy: LoadPolicy,
     ) -> crate::Result<Self> {
         match (
             index_settings.inverted_index_config.storage_type,
             index_settings.inverted_index_config.weight_type,
             index_settings.inverted_index_config.quantized,
         ) {
-            (StorageType::Mmap, IndexWeightType::Float32, true) => Ok(Self::F32Quantized(InvertedIndexMmap::<f32, u8>::open(index_path, segment_id)?.into())),
-            (StorageType::Mmap, IndexWeightType::Float32, false) => Ok(Self::F32NoQuantized(InvertedIndexMmap::<f32, f32>::open(index_path, segment_id)?.into())),
-            (StorageType::Mmap, IndexWeightType::Float16, true) => Ok(Self::F16Quantized(InvertedIndexMmap::<half::f16, u8>::open(index_path, segment_id)?.into())),
-            (StorageType::Mmap, IndexWeightType::Float16, false) => Ok(Self::F16NoQuantized(InvertedIndexMmap::<half::f16, half::f16>::open(index_path, segment_id)?.into())),
-            (StorageType::Mmap, IndexWeightType::UInt8, false) => Ok(Self::U8NoQuantized(InvertedIndexMmap::<u8, u8>::open(index_path, segment_id)?.into())),
-            (StorageType::CompressedMmap, IndexWeightType::Float32, true) => Ok(Self::F32Quantized(CompressedInvertedIndexMmap::<f32, u8>::open(index_path, segment_id)?.into())),
-            (StorageType::CompressedMmap, IndexWeightType::Float32, false) => Ok(Self::F32NoQuantized(CompressedInvertedIndexMmap::<f32, f32>::open(index_path, segment_id)?.into())),
-            (StorageType::CompressedMmap, IndexWeightType::Float16, true) => Ok(Self::F16Quantized(CompressedInvertedIndexMmap::<half::f16, u8>::open(index_path, segment_id)?.into())),
-            (StorageType::CompressedMmap, IndexWeightType::Float16, false) => Ok(Self::F16NoQuantized(CompressedInvertedIndexMmap::<half::f16, half::f16>::open(index_path, segment_id)?.into())),
-            (StorageType::CompressedMmap, IndexWeightType::UInt8, false) => Ok(Self::U8NoQuantized(CompressedInvertedIndexMmap::<u8, u8>::open(index_path, segment_id)?.into())),
+            (StorageType::Mmap | StorageType::Ram, IndexWeightType::Float32, true) => Ok(Self::F32Quantized(InvertedIndexMmap::<f32, u8>::open_with_policy(index_path, segment_id, load_policy)?.into())),
+            (StorageType::Mmap | StorageType::Ram, IndexWeightType::Float32, false) => Ok(Self::F32NoQuantized(InvertedIndexMmap::<f32, f32>::open_with_policy(index_path, segment_id, load_policy)?.into())),
+            (StorageType::Mmap | StorageType::Ram, IndexWeightType::Float16, true) => Ok(Self::F16Quantized(InvertedIndexMmap::<half::f16, u8>::open_with_policy(index_path, segment_id, load_policy)?.into())),
+            (StorageType::Mmap | StorageType::Ram, IndexWeightType::Float16, false) => Ok(Self::F16NoQuantized(InvertedIndexMmap::<half::f16, half::f16>::open_with_policy(index_path, segment_id, load_policy)?.into())),
+            (StorageType::Mmap | StorageType::Ram, IndexWeightType::UInt8, false) => Ok(Self::U8NoQuantized(InvertedIndexMmap::<u8, u8>::open_with_policy(index_path, segment_id, load_policy)?.into())),
+            (StorageType::CompressedMmap, IndexWeightType::Float32, true) => Ok(Self::F32Quantized(CompressedInvertedIndexMmap::<f32, u8>::open_with_policy(index_path, segment_id, load_policy)?.into())),
+            (StorageType::CompressedMmap, IndexWeightType::Float32, false) => Ok(Self::F32NoQuantized(CompressedInvertedIndexMmap::<f32, f32>::open_with_policy(index_path, segment_id, load_policy)?.into())),
+            (StorageType::CompressedMmap, IndexWeightType::Float16, true) => Ok(Self::F16Quantized(CompressedInvertedIndexMmap::<half::f16, u8>::open_with_policy(index_path, segment_id, load_policy)?.into())),
+            (StorageType::CompressedMmap, IndexWeightType::Float16, false) => Ok(Self::F16NoQuantized(CompressedInvertedIndexMmap::<half::f16, half::f16>::open_with_policy(index_path, segment_id, load_policy)?.into())),
+            (StorageType::CompressedMmap, IndexWeightType::UInt8, false) => Ok(Self::U8NoQuantized(CompressedInvertedIndexMmap::<u8, u8>::open_with_policy(index_path, segment_id, load_policy)?.into())),
+            (StorageType::CompressedMmap, IndexWeightType::UInt4, _) => Ok(Self::F32Quantized(CompressedInvertedIndexMmap::<f32, u8>::open_with_policy(index_path, segment_id, load_policy)?.into())),
             _ => {
                 let error_msg = format!(
                     "Not supported! storage_type:{:?}, weight_type:{:?}, quantized:{}",
@@ -147,6 +137,15 @@ impl GenericInvertedIndex {
         }
     }
 
+    /// Verify the container checksum of a segment, its whole file is read. Segments of the multi-file layout carry none.
+    pub fn verify_checksum(index_path: &PathBuf, segment_id: Option<&str>, index_settings: &IndexSettings) -> crate::Result<()> {
+        let container_file_name = match index_settings.inverted_index_config.storage_type {
+            StorageType::CompressedMmap => CompressedInvertedIndexMmapConfig::container_file_name(segment_id),
+            StorageType::Mmap | StorageType::Ram => InvertedIndexMmapFileConfig::container_file_name(segment_id),
+        };
+        verify_segment_container(&index_path.join(container_file_name))
+    }
+
     #[rustfmt::skip]
     pub fn metrics(&self) -> InvertedIndexMetrics {
         match self {
@@ -159,18 +158,24 @@ impl GenericInvertedIndex {
     }
 
     #[rustfmt::skip]
-    pub fn get_posting_opt(
-        &self,
-        dim_id: DimId,
-        min_row_id: &mut RowId,
-        max_row_id: &mut RowId
-    ) -> Option<GenericPostingListIterator<'_>> {
+    pub fn dim_ids(&self) -> Vec<DimId> {
+        match self {
+            GenericInvertedIndex::F32NoQuantized(e) => e.dim_ids(),
+            GenericInvertedIndex::F32Quantized(e) => e.dim_ids(),
+            GenericInvertedIndex::F16NoQuantized(e) => e.dim_ids(),
+            GenericInvertedIndex::F16Quantized(e) => e.dim_ids(),
+            GenericInvertedIndex::U8NoQuantized(e) => e.dim_ids(),
+        }
+    }
+
+    #[rustfmt::skip]
+    pub fn posting_elements(&self, dim_id: DimId) -> Vec<(RowId, f32)> {
         match self {
-            GenericInvertedIndex::F32NoQuantized(e) => e.get_posting_opt(dim_id, min_row_id, max_row_id),
-            GenericInvertedIndex::F32Quantized(e) => e.get_posting_opt(dim_id, min_row_id, max_row_id),
-            GenericInvertedIndex::F16NoQuantized(e) => e.get_posting_opt(dim_id, min_row_id, max_row_id),
-            GenericInvertedIndex::F16Quantized(e) => e.get_posting_opt(dim_id, min_row_id, max_row_id),
-            GenericInvertedIndex::U8NoQuantized(e) => e.get_posting_opt(dim_id, min_row_id, max_row_id),
+            GenericInvertedIndex::F32NoQuantized(e) => e.posting_elements(dim_id),
+            GenericInvertedIndex::F32Quantized(e) => e.posting_elements(dim_id),
+            GenericInvertedIndex::F16NoQuantized(e) => e.posting_elements(dim_id),
+            GenericInvertedIndex::F16Quantized(e) => e.posting_elements(dim_id),
+            GenericInvertedIndex::U8NoQuantized(e) => e.posting_elements(dim_id),
         }
     }
 
@@ -186,7 +191,8 @@ impl GenericInvertedIndex {
     }
 
     #[rustfmt::skip]
-    pub fn merge(generic_inverted_indexes: Vec<&GenericInvertedIndex>, directory:PathBuf, segment_id: Option<&str>, element_type: Option<ElementType>) -> crate::Result<(usize, Vec<PathBuf>)> {
+    /// `reorder_rows` only applies to compressed indexes.
+    pub fn merge(generic_inverted_indexes: Vec<&GenericInvertedIndex>, directory:PathBuf, segment_id: Option<&str>, element_type: Option<ElementType>, reorder_rows: bool) -> crate::Result<(usize, Vec<PathBuf>)> {
         // Boundary.
         if generic_inverted_indexes.len() <= 1 {
             return Err(SparseError::Error("Candidates size <= 1".to_string()));
@@ -311,7 +317,7 @@ impl GenericInvertedIndex {
                     })
                     .collect();
 
-                let merger = CompressedInvertedIndexMmapMerger::new(&inverted_index_mmaps, element_type.unwrap_or(ElementType::EXTENDED));
+                let merger = CompressedInvertedIndexMmapMerger::new(&inverted_index_mmaps, element_type.unwrap_or(ElementType::EXTENDED)).with_row_reorder(reorder_rows);
                 let merged_index: CompressedInvertedIndexMmap<f32, f32> = merger.merge(&directory, segment_id)?;
                 let vector_count = merged_index.meta.inverted_index_meta.vector_count;
                 let related_files = merged_index.files(segment_id);
@@ -329,7 +335,7 @@ impl GenericInvertedIndex {
                     })
                     .collect();
 
-                let merger = CompressedInvertedIndexMmapMerger::new(&inverted_index_mmaps, element_type.unwrap_or(ElementType::SIMPLE));
+                let merger = CompressedInvertedIndexMmapMerger::new(&inverted_index_mmaps, element_type.unwrap_or(ElementType::SIMPLE)).with_row_reorder(reorder_rows);
                 let merged_index: CompressedInvertedIndexMmap<f32, u8> = merger.merge(&directory, segment_id)?;
                 let vector_count = merged_index.meta.inverted_index_meta.vector_count;
                 let related_files = merged_index.files(segment_id);
@@ -347,7 +353,7 @@ impl GenericInvertedIndex {
                     })
                     .collect();
 
-                let merger = CompressedInvertedIndexMmapMerger::new(&inverted_index_mmaps, element_type.unwrap_or(ElementType::EXTENDED));
+                let merger = CompressedInvertedIndexMmapMerger::new(&inverted_index_mmaps, element_type.unwrap_or(ElementType::EXTENDED)).with_row_reorder(reorder_rows);
                 let merged_index: CompressedInvertedIndexMmap<half::f16, half::f16> = merger.merge(&directory, segment_id)?;
                 let vector_count = merged_index.meta.inverted_index_meta.vector_count;
                 let related_files = merged_index.files(segment_id);
@@ -365,7 +371,7 @@ impl GenericInvertedIndex {
                     })
                     .collect();
 
-                let merger = CompressedInvertedIndexMmapMerger::new(&inverted_index_mmaps, element_type.unwrap_or(ElementType::SIMPLE));
+                let merger = CompressedInvertedIndexMmapMerger::new(&inverted_index_mmaps, element_type.unwrap_or(ElementType::SIMPLE)).with_row_reorder(reorder_rows);
                 let merged_index: CompressedInvertedIndexMmap<half::f16, u8> = merger.merge(&directory, segment_id)?;
                 let vector_count = merged_index.meta.inverted_index_meta.vector_count;
                 let related_files = merged_index.files(segment_id);
@@ -383,7 +389,7 @@ impl GenericInvertedIndex {
                     })
                     .collect();
 
-                let merger = CompressedInvertedIndexMmapMerger::new(&inverted_index_mmaps, element_type.unwrap_or(ElementType::EXTENDED));
+                let merger = CompressedInvertedIndexMmapMerger::new(&inverted_index_mmaps, element_type.unwrap_or(ElementType::EXTENDED)).with_row_reorder(reorder_rows);
                 let merged_index: CompressedInvertedIndexMmap<u8, u8> = merger.merge(&directory, segment_id)?;
                 let vector_count = merged_index.meta.inverted_index_meta.vector_count;
                 let related_files = merged_index.files(segment_id);
@@ -3,7 +3,7 @@ use std::path::PathBuf;
 use log::error;
 
 use crate::{
-    core::{ElementType, IndexWeightType, InvertedIndexRamBuilder, InvertedIndexRamBuilderTrait, SparseVector, StorageType},
+    core::{DimId, ElementType, IndexWeightType, InvertedIndexRamBuilder, InvertedIndexRamBuilderTrait, SparseVector, StorageType},
     RowId,
 };
 
@@ -26,6 +26,7 @@ impl GenericInvertedIndexRamBuilder {
             (IndexWeightType::Float16, true) => Self::F16Quantized(InvertedIndexRamBuilder::<half::f16, u8>::new(ElementType::SIMPLE)),
             (IndexWeightType::Float16, false) => Self::F16NoQuantized(InvertedIndexRamBuilder::<half::f16, half::f16>::new(element_type)),
             (IndexWeightType::UInt8, false) => Self::U8NoQuantized(InvertedIndexRamBuilder::<u8, u8>::new(element_type)),
+            (IndexWeightType::UInt4, _) => Self::F32Quantized(InvertedIndexRamBuilder::<f32, u8>::new(ElementType::SIMPLE).with_u4_weights()),
             (_, _) => {
                 let error_msg = format!("Invalid parameter when create GenericInvertedIndexRamBuilder, weight_type:{:?}, need_quantized:{}", weight_type, need_quantized);
                 error!("{}", error_msg);
@@ -35,6 +36,21 @@ impl GenericInvertedIndexRamBuilder {
 
     }
 
+    /// See [`InvertedIndexRamBuilder::with_bulk_build`].
+    #[rustfmt::skip]
+    pub fn with_bulk_build(self, bulk_build: bool) -> Self {
+        if !bulk_build {
+            return self;
+        }
+        match self {
+            GenericInvertedIndexRamBuilder::F32NoQuantized(e) => GenericInvertedIndexRamBuilder::F32NoQuantized(e.with_bulk_build()),
+            GenericInvertedIndexRamBuilder::F32Quantized(e) => GenericInvertedIndexRamBuilder::F32Quantized(e.with_bulk_build()),
+            GenericInvertedIndexRamBuilder::F16NoQuantized(e) => GenericInvertedIndexRamBuilder::F16NoQuantized(e.with_bulk_build()),
+            GenericInvertedIndexRamBuilder::F16Quantized(e) => GenericInvertedIndexRamBuilder::F16Quantized(e.with_bulk_build()),
+            GenericInvertedIndexRamBuilder::U8NoQuantized(e) => GenericInvertedIndexRamBuilder::U8NoQuantized(e.with_bulk_build()),
+        }
+    }
+
     #[rustfmt::skip]
     pub fn add(&mut self, row_id: RowId, vector: SparseVector) -> crate::Result<bool> {
         match self {
@@ -46,6 +62,38 @@ impl GenericInvertedIndexRamBuilder {
         }
     }
 
+    #[rustfmt::skip]
+    pub fn add_posting(&mut self, dim_id: DimId, elements: &[(RowId, f32)]) -> crate::Result<()> {
+        match self {
+            GenericInvertedIndexRamBuilder::F32NoQuantized(e) => Ok(e.add_posting(dim_id, elements)?),
+            GenericInvertedIndexRamBuilder::F32Quantized(e) => Ok(e.add_posting(dim_id, elements)?),
+            GenericInvertedIndexRamBuilder::F16NoQuantized(e) => Ok(e.add_posting(dim_id, elements)?),
+            GenericInvertedIndexRamBuilder::F16Quantized(e) => Ok(e.add_posting(dim_id, elements)?),
+            GenericInvertedIndexRamBuilder::U8NoQuantized(e) => Ok(e.add_posting(dim_id, elements)?),
+        }
+    }
+
+    #[rustfmt::skip]
+    pub fn add_postings(&mut self, postings: &[(DimId, Vec<(RowId, f32)>)]) -> crate::Result<()> {
+        match self {
+            GenericInvertedIndexRamBuilder::F32NoQuantized(e) => Ok(e.add_postings(postings)?),
+            GenericInvertedIndexRamBuilder::F32Quantized(e) => Ok(e.add_postings(postings)?),
+            GenericInvertedIndexRamBuilder::F16NoQuantized(e) => Ok(e.add_postings(postings)?),
+            GenericInvertedIndexRamBuilder::F16Quantized(e) => Ok(e.add_postings(postings)?),
+            GenericInvertedIndexRamBuilder::U8NoQuantized(e) => Ok(e.add_postings(postings)?),
+        }
+    }
+
+    #[rustfmt::skip]
+    pub fn set_vector_count(&mut self, vector_count: usize) {
+        match self {
+            GenericInvertedIndexRamBuilder::F32NoQuantized(e) => e.set_vector_count(vector_count),
+            GenericInvertedIndexRamBuilder::F32Quantized(e) => e.set_vector_count(vector_count),
+            GenericInvertedIndexRamBuilder::F16NoQuantized(e) => e.set_vector_count(vector_count),
+            GenericInvertedIndexRamBuilder::F16Quantized(e) => e.set_vector_count(vector_count),
+            GenericInvertedIndexRamBuilder::U8NoQuantized(e) => e.set_vector_count(vector_count),
+        }
+    }
 
     #[rustfmt::skip]
     fn build_ram_index(self) -> crate::Result<GenericInvertedIndexRam> {
@@ -79,17 +127,18 @@ impl GenericInvertedIndexRamBuilder {
         segment_id: Option<&str>
     ) -> crate::Result<Vec<PathBuf>> {
         match (storage_type, weight_type, need_quantized) {
-            (StorageType::Mmap, IndexWeightType::Float32, true) => self.build_ram_index()?.save_to_mmap(storage_type, weight_type, need_quantized, directory, segment_id),
-            (StorageType::Mmap, IndexWeightType::Float32, false) => self.build_ram_index()?.save_to_mmap(storage_type, weight_type, need_quantized, directory, segment_id),
-            (StorageType::Mmap, IndexWeightType::Float16, true) => self.build_ram_index()?.save_to_mmap(storage_type, weight_type, need_quantized, directory, segment_id),
-            (StorageType::Mmap, IndexWeightType::Float16, false) => self.build_ram_index()?.save_to_mmap(storage_type, weight_type, need_quantized, directory, segment_id),
-            (StorageType::Mmap, IndexWeightType::UInt8, false) => self.build_ram_index()?.save_to_mmap(storage_type, weight_type, need_quantized, directory, segment_id),
+            (StorageType::Mmap | StorageType::Ram, IndexWeightType::Float32, true) => self.build_ram_index()?.save_to_mmap(storage_type, weight_type, need_quantized, directory, segment_id),
+            (StorageType::Mmap | StorageType::Ram, IndexWeightType::Float32, false) => self.build_ram_index()?.save_to_mmap(storage_type, weight_type, need_quantized, directory, segment_id),
+            (StorageType::Mmap | StorageType::Ram, IndexWeightType::Float16, true) => self.build_ram_index()?.save_to_mmap(storage_type, weight_type, need_quantized, directory, segment_id),
+            (StorageType::Mmap | StorageType::Ram, IndexWeightType::Float16, false) => self.build_ram_index()?.save_to_mmap(storage_type, weight_type, need_quantized, directory, segment_id),
+            (StorageType::Mmap | StorageType::Ram, IndexWeightType::UInt8, false) => self.build_ram_index()?.save_to_mmap(storage_type, weight_type, need_quantized, directory, segment_id),
             (StorageType::CompressedMmap, IndexWeightType::Float32, true) => self.build_ram_index()?.save_to_mmap(storage_type, weight_type, need_quantized, directory, segment_id),
             (StorageType::CompressedMmap, IndexWeightType::Float32, false) => self.build_ram_index()?.save_to_mmap(storage_type, weight_type, need_quantized, directory, segment_id),
             (StorageType::CompressedMmap, IndexWeightType::Float16, true) => self.build_ram_index()?.save_to_mmap(storage_type, weight_type, need_quantized, directory, segment_id),
             (StorageType::CompressedMmap, IndexWeightType::Float16, false) => self.build_ram_index()?.save_to_mmap(storage_type, weight_type, need_quantized, directory, segment_id),
             (StorageType::CompressedMmap, IndexWeightType::UInt8, true) => self.build_ram_index()?.save_to_mmap(storage_type, weight_type, need_quantized, directory, segment_id),
             (StorageType::CompressedMmap, IndexWeightType::UInt8, false) => self.build_ram_index()?.save_to_mmap(storage_type, weight_type, need_quantized, directory, segment_id),
+            (StorageType::CompressedMmap, IndexWeightType::UInt4, _) => self.build_ram_index()?.save_to_mmap(storage_type, weight_type, need_quantized, directory, segment_id),
             (_, _, _) => {
                 let error_msg = format!("Invalid parameter when flush index to disk. storage_type:{:?}, weight_type:{:?}, need_quantized:{}", storage_type, weight_type, need_quantized);
                 error!("{}", error_msg);
@@ -21,16 +21,17 @@ impl GenericInvertedIndexRam {
         segment_id: Option<&str>,
     ) -> crate::Result<Vec<PathBuf>> {
         match (storage_type, weight_type, need_quantized, self) {
-            (StorageType::Mmap, IndexWeightType::Float32, true, GenericInvertedIndexRam::U8RamIndex(e)) => Ok(InvertedIndexMmap::<f32, u8>::from_ram_index(Cow::Owned(e), directory.to_path_buf(), segment_id)?.files(segment_id)),
-            (StorageType::Mmap, IndexWeightType::Float32, false, GenericInvertedIndexRam::F32RamIndex(e)) => Ok(InvertedIndexMmap::<f32, f32>::from_ram_index(Cow::Owned(e), directory.to_path_buf(), segment_id)?.files(segment_id)),
-            (StorageType::Mmap, IndexWeightType::Float16, true, GenericInvertedIndexRam::U8RamIndex(e)) => Ok(InvertedIndexMmap::<half::f16, u8>::from_ram_index(Cow::Owned(e), directory.to_path_buf(), segment_id)?.files(segment_id)),
-            (StorageType::Mmap, IndexWeightType::Float16, false, GenericInvertedIndexRam::F16RamIndex(e)) => Ok(InvertedIndexMmap::<half::f16, half::f16>::from_ram_index(Cow::Owned(e), directory.to_path_buf(), segment_id)?.files(segment_id)),
-            (StorageType::Mmap, IndexWeightType::UInt8, false, GenericInvertedIndexRam::U8RamIndex(e)) => Ok(InvertedIndexMmap::<u8, u8>::from_ram_index(Cow::Owned(e), directory.to_path_buf(), segment_id)?.files(segment_id)),
+            (StorageType::Mmap | StorageType::Ram, IndexWeightType::Float32, true, GenericInvertedIndexRam::U8RamIndex(e)) => Ok(InvertedIndexMmap::<f32, u8>::from_ram_index(Cow::Owned(e), directory.to_path_buf(), segment_id)?.files(segment_id)),
+            (StorageType::Mmap | StorageType::Ram, IndexWeightType::Float32, false, GenericInvertedIndexRam::F32RamIndex(e)) => Ok(InvertedIndexMmap::<f32, f32>::from_ram_index(Cow::Owned(e), directory.to_path_buf(), segment_id)?.files(segment_id)),
+            (StorageType::Mmap | StorageType::Ram, IndexWeightType::Float16, true, GenericInvertedIndexRam::U8RamIndex(e)) => Ok(InvertedIndexMmap::<half::f16, u8>::from_ram_index(Cow::Owned(e), directory.to_path_buf(), segment_id)?.files(segment_id)),
+            (StorageType::Mmap | StorageType::Ram, IndexWeightType::Float16, false, GenericInvertedIndexRam::F16RamIndex(e)) => Ok(InvertedIndexMmap::<half::f16, half::f16>::from_ram_index(Cow::Owned(e), directory.to_path_buf(), segment_id)?.files(segment_id)),
+            (StorageType::Mmap | StorageType::Ram, IndexWeightType::UInt8, false, GenericInvertedIndexRam::U8RamIndex(e)) => Ok(InvertedIndexMmap::<u8, u8>::from_ram_index(Cow::Owned(e), directory.to_path_buf(), segment_id)?.files(segment_id)),
             (StorageType::CompressedMmap, IndexWeightType::Float32, true, GenericInvertedIndexRam::U8RamIndex(e)) => Ok(CompressedInvertedIndexMmap::<f32, u8>::from_ram_index(Cow::Owned(e), directory.to_path_buf(), segment_id)?.files(segment_id)),
             (StorageType::CompressedMmap, IndexWeightType::Float32, false, GenericInvertedIndexRam::F32RamIndex(e)) => Ok(CompressedInvertedIndexMmap::<f32, f32>::from_ram_index(Cow::Owned(e), directory.to_path_buf(), segment_id)?.files(segment_id)),
             (StorageType::CompressedMmap, IndexWeightType::Float16, true, GenericInvertedIndexRam::U8RamIndex(e)) => Ok(CompressedInvertedIndexMmap::<half::f16, u8>::from_ram_index(Cow::Owned(e), directory.to_path_buf(), segment_id)?.files(segment_id)),
             (StorageType::CompressedMmap, IndexWeightType::Float16, false, GenericInvertedIndexRam::F16RamIndex(e)) => Ok(CompressedInvertedIndexMmap::<half::f16, half::f16>::from_ram_index(Cow::Owned(e), directory.to_path_buf(), segment_id)?.files(segment_id)),
             (StorageType::CompressedMmap, IndexWeightType::UInt8, false, GenericInvertedIndexRam::U8RamIndex(e)) => Ok(CompressedInvertedIndexMmap::<u8, u8>::from_ram_index(Cow::Owned(e), directory.to_path_buf(), segment_id)?.files(segment_id)),
+            (StorageType::CompressedMmap, IndexWeightType::UInt4, _, GenericInvertedIndexRam::U8RamIndex(e)) => Ok(CompressedInvertedIndexMmap::<f32, u8>::from_ram_index(Cow::Owned(e), directory.to_path_buf(), segment_id)?.files(segment_id)),
             (_, _, _, _) => {
                 let error_msg = format!("Invalid parameter when save from GenericInvertedIndexRam, storage_type:{:?}, weight_type:{:?}, need_quantized:{:?}", storage_type, weight_type, need_quantized);
                 error!("{}", error_msg);
@@ -1,9 +1,7 @@
 mod generic_inverted_index;
-mod generic_posting_iterator;
 mod generic_ram_builder;
 mod generic_ram_index;
 
 pub(crate) use generic_inverted_index::*;
-pub(crate) use generic_posting_iterator::*;
 pub(crate) use generic_ram_builder::*;
 pub(crate) use generic_ram_index::*;
@@ -0,0 +1,126 @@
+use crate::core::DimId;
+
+/// Dense headers up to this many slots are always cheap enough.
+pub const DENSE_DIM_LIMIT: usize = 1 << 16;
+
+/// Beyond `DENSE_DIM_LIMIT`, headers stay dense only if at least one in this many dims is used.
+pub const SPARSE_DIM_DENSITY: usize = 4;
+
+/// Whether `dims_count` used dims up to `max_dim_id` should be stored with a `DimDirectory`.
+pub fn use_dim_directory(dims_count: usize, max_dim_id: DimId) -> bool {
+    let dense_slots = max_dim_id as usize + 1;
+    dense_slots > DENSE_DIM_LIMIT && dense_slots > dims_count.saturating_mul(SPARSE_DIM_DENSITY)
+}
+
+/// Sorted dim ids laid out in Eytzinger (BFS) order, the slot of a dim is the ordinal of its posting header.
+///
+/// Searching touches one cache line per tree level at the top, and the loop is branch free.
+pub struct DimDirectory;
+
+impl DimDirectory {
+    /// Eytzinger keys for sorted unique `dims`, and the slot of each sorted dim.
+    pub fn build(dims: &[DimId]) -> (Vec<DimId>, Vec<usize>) {
+        fn fill(dims: &[DimId], keys: &mut [DimId], slots: &mut [usize], next: &mut usize, k: usize) {
+            if k <= keys.len() {
+                fill(dims, keys, slots, next, 2 * k);
+                keys[k - 1] = dims[*next];
+                slots[*next] = k - 1;
+                *next += 1;
+                fill(dims, keys, slots, next, 2 * k + 1);
+            }
+        }
+        debug_assert!(dims.windows(2).all(|w| w[0] < w[1]));
+
+        let mut keys = vec![0; dims.len()];
+        let mut slots = vec![0; dims.len()];
+        fill(dims, &mut keys, &mut slots, &mut 0, 1);
+        (keys, slots)
+    }
+
+    /// Slot of `dim_id` in Eytzinger `keys`.
+    pub fn find(keys: &[DimId], dim_id: DimId) -> Option<usize> {
+        let mut k = 1;
+        while k <= keys.len() {
+            k = 2 * k + (keys[k - 1] < dim_id) as usize;
+        }
+        // Drop the trailing right turns plus the last left turn, `k` is then the lower bound.
+        k >>= k.trailing_ones() + 1;
+        if k != 0 && keys[k - 1] == dim_id {
+            Some(k - 1)
+        } else {
+            None
+        }
+    }
+
+    pub fn sorted_dims(keys: &[DimId]) -> Vec<DimId> {
+        let mut dims = keys.to_vec();
+        dims.sort_unstable();
+        dims
+    }
+}
+
+/// Header slot of every posting written into a segment.
+pub struct DimSlots {
+    /// Eytzinger keys, `None` when headers are dense by dim id.
+    pub directory: Option<Vec<DimId>>,
+    /// `(dim_id, slot)` of every header, in dim order.
+    pub slots: Vec<(DimId, usize)>,
+}
+
+impl DimSlots {
+    /// `dims` must be sorted and unique, dense layout also covers the dims missing in `dims`.
+    pub fn new(dims: &[DimId], with_directory: bool) -> Self {
+        if with_directory {
+            let (keys, slots) = DimDirectory::build(dims);
+            Self { directory: Some(keys), slots: dims.iter().copied().zip(slots).collect() }
+        } else {
+            let dense_slots = dims.last().map_or(0, |&max_dim_id| max_dim_id + 1);
+            Self { directory: None, slots: (0..dense_slots).map(|dim_id| (dim_id, dim_id as usize)).collect() }
+        }
+    }
+
+    pub fn slots_count(&self) -> usize {
+        self.slots.len()
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_find() {
+        for count in [0, 1, 2, 3, 7, 8, 100, 1000] {
+            let dims: Vec<DimId> = (0..count).map(|i| i * 7 + 3).collect();
+            let (keys, slots) = DimDirectory::build(&dims);
+            for (i, &dim_id) in dims.iter().enumerate() {
+                assert_eq!(DimDirectory::find(&keys, dim_id), Some(slots[i]));
+                assert_eq!(keys[slots[i]], dim_id);
+                assert_eq!(DimDirectory::find(&keys, dim_id + 1), None);
+            }
+            assert_eq!(DimDirectory::find(&keys, 0), None);
+            assert_eq!(DimDirectory::find(&keys, DimId::MAX), None);
+            assert_eq!(DimDirectory::sorted_dims(&keys), dims);
+        }
+    }
+
+    #[test]
+    fn test_use_dim_directory() {
+        assert!(!use_dim_directory(10, (DENSE_DIM_LIMIT - 1) as DimId));
+        assert!(use_dim_directory(10, DimId::MAX));
+        assert!(!use_dim_directory(DENSE_DIM_LIMIT, (DENSE_DIM_LIMIT * 2) as DimId));
+    }
+
+    #[test]
+    fn test_dim_slots() {
+        let dense = DimSlots::new(&[1, 3], false);
+        assert!(dense.directory.is_none());
+        assert_eq!(dense.slots, vec![(0, 0), (1, 1), (2, 2), (3, 3)]);
+
+        let sparse = DimSlots::new(&[1, 3, 1 << 30], true);
+        let keys = sparse.directory.unwrap();
+        for (dim_id, slot) in sparse.slots {
+            assert_eq!(DimDirectory::find(&keys, dim_id), Some(slot));
+        }
+    }
+}
@@ -11,6 +11,7 @@ pub enum StorageType {
     #[serde(rename = "compressed_mmap")]
     CompressedMmap,
 
+    /// Persisted in the `mmap` format, segments are read into anonymous memory when they are loaded.
     #[serde(rename = "ram")]
     Ram,
 }
@@ -27,6 +28,10 @@ pub enum IndexWeightType {
 
     #[serde(rename = "u8")]
     UInt8,
+
+    /// `f32` weights quantized into 4 bits block by block, nibble packed in compressed blocks.
+    #[serde(rename = "u4")]
+    UInt4,
 }
 
 #[derive(Serialize, Deserialize, Debug, Eq, PartialEq, Default, Copy, Clone)]
@@ -47,11 +52,21 @@ pub struct InvertedIndexConfig {
     #[serde(default)]
     #[serde(rename = "quantized")]
     pub quantized: bool,
+
+    /// Reorder rows by recursive graph bisection while merging segments, so rows sharing dims get close row ids.
+    #[serde(default)]
+    #[serde(rename = "reorder_rows")]
+    pub reorder_rows: bool,
+
+    /// Build segments by sorting appended (dim, row, weight) triples at flush instead of upserting every element.
+    #[serde(default)]
+    #[serde(rename = "bulk_build")]
+    pub bulk_build: bool,
 }
 
 impl InvertedIndexConfig {
     pub fn new(storage_type: StorageType, weight_type: IndexWeightType, element_type: ElementType, enable_quantized: bool) -> Result<Self, InvertedIndexError> {
-        let config = InvertedIndexConfig { storage_type, weight_type, quantized: enable_quantized, element_type };
+        let config = InvertedIndexConfig { storage_type, weight_type, quantized: enable_quantized, element_type, reorder_rows: false, bulk_build: false };
         let _check_valid = config.is_valid()?;
         return Ok(config);
     }
@@ -63,6 +78,15 @@ impl InvertedIndexConfig {
         if self.weight_type == IndexWeightType::UInt8 && self.quantized {
             return Err(InvertedIndexError::InvalidIndexConfig("When IndexWeightType is u8, you can't quantize it.".to_string()));
         }
+        if self.weight_type == IndexWeightType::UInt4 && self.storage_type != StorageType::CompressedMmap {
+            return Err(InvertedIndexError::InvalidIndexConfig("When IndexWeightType is u4, storage type can only be `compressed_mmap`.".to_string()));
+        }
+        if self.weight_type == IndexWeightType::UInt4 && self.element_type == ElementType::EXTENDED {
+            return Err(InvertedIndexError::InvalidIndexConfig("When IndexWeightType is u4, element type can only be `SIMPLE`.".to_string()));
+        }
+        if self.reorder_rows && self.storage_type != StorageType::CompressedMmap {
+            return Err(InvertedIndexError::InvalidIndexConfig("When reorder_rows is enabled, storage type can only be `compressed_mmap`.".to_string()));
+        }
         Ok(true)
     }
 
@@ -74,6 +98,7 @@ impl InvertedIndexConfig {
             (IndexWeightType::Float16, false) => self.element_type,
             (IndexWeightType::UInt8, true) => ElementType::SIMPLE,
             (IndexWeightType::UInt8, false) => self.element_type,
+            (IndexWeightType::UInt4, _) => ElementType::SIMPLE,
         }
     }
 }
@@ -86,6 +86,11 @@ pub struct InvertedIndexMeta {
 
     #[serde(rename = "version")]
     pub version: Version,
+
+    /// Added to the row ids stored in postings, which are local to the segment. Row ids above are local too.
+    #[serde(default)]
+    #[serde(rename = "row_id_base")]
+    pub row_id_base: RowId,
 }
 
 impl InvertedIndexMeta {
@@ -100,7 +105,12 @@ impl InvertedIndexMeta {
         element_type: ElementType,
         version: Version,
     ) -> Self {
-        Self { posting_count, vector_count, min_row_id, max_row_id, min_dim_id, max_dim_id, quantized, element_type, version }
+        Self { posting_count, vector_count, min_row_id, max_row_id, min_dim_id, max_dim_id, quantized, element_type, version, row_id_base: 0 }
+    }
+
+    pub fn with_row_id_base(mut self, row_id_base: RowId) -> Self {
+        self.row_id_base = row_id_base;
+        self
     }
 
     /// get inverted index total postings count.
@@ -1,7 +1,15 @@
+mod dim_directory;
 mod inverted_index_config;
 mod inverted_index_meta;
 mod inverted_index_metrics;
+mod row_reorder;
+mod segment_container;
+mod segment_meta_codec;
 
+pub use dim_directory::*;
 pub use inverted_index_config::*;
 pub use inverted_index_meta::*;
 pub use inverted_index_metrics::InvertedIndexMetrics;
+pub use row_reorder::*;
+pub use segment_container::*;
+pub use segment_meta_codec::*;
@@ -0,0 +1,192 @@
+//! Recursive graph bisection: rows sharing dims get close row ids, so posting gaps shrink and blocks pack with fewer bits.
+
+const MIN_PARTITION_SIZE: usize = 16;
+const MAX_ITERATIONS: usize = 20;
+/// Partitions smaller than this are bisected on the current thread.
+const PARALLEL_PARTITION_SIZE: usize = 4096;
+
+/// Dims of every row in CSR layout.
+struct ForwardIndex {
+    offsets: Vec<usize>,
+    dims: Vec<u32>,
+}
+
+impl ForwardIndex {
+    fn new(rows_count: usize, postings: &[Vec<u32>]) -> Self {
+        let mut offsets = vec![0; rows_count + 1];
+        for posting in postings {
+            for &row in posting {
+                offsets[row as usize + 1] += 1;
+            }
+        }
+        for row in 0..rows_count {
+            offsets[row + 1] += offsets[row];
+        }
+        let mut cursors = offsets.clone();
+        let mut dims = vec![0; offsets[rows_count]];
+        for (dim, posting) in postings.iter().enumerate() {
+            for &row in posting {
+                dims[cursors[row as usize]] = dim as u32;
+                cursors[row as usize] += 1;
+            }
+        }
+        Self { offsets, dims }
+    }
+
+    fn dims(&self, row: u32) -> &[u32] {
+        &self.dims[self.offsets[row as usize]..self.offsets[row as usize + 1]]
+    }
+
+    /// Dims of `rows` renumbered from zero, so degrees of a partition only cost the dims it uses.
+    fn localize(&self, rows: &[u32]) -> (usize, Vec<usize>, Vec<u32>) {
+        let mut used: Vec<u32> = rows.iter().flat_map(|&row| self.dims(row).iter().copied()).collect();
+        used.sort_unstable();
+        used.dedup();
+        let mut offsets = Vec::with_capacity(rows.len() + 1);
+        let mut dims = Vec::new();
+        offsets.push(0);
+        for &row in rows {
+            dims.extend(self.dims(row).iter().map(|dim| used.binary_search(dim).unwrap() as u32));
+            offsets.push(dims.len());
+        }
+        (used.len(), offsets, dims)
+    }
+}
+
+/// Approximate bits of the gaps of a dim with `degree` rows in a partition of `size` rows, indexed by degree.
+fn cost_table(size: usize, max_degree: usize) -> Vec<f32> {
+    (0..=max_degree).map(|degree| degree as f32 * (size as f32 / (degree + 1) as f32).log2()).collect()
+}
+
+fn bisect(rows: &mut [u32], forward_index: &ForwardIndex) {
+    if rows.len() < 2 * MIN_PARTITION_SIZE {
+        return;
+    }
+    let (dims_count, offsets, dims) = forward_index.localize(rows);
+    let local_dims = |member: usize| &dims[offsets[member]..offsets[member + 1]];
+
+    let mid = rows.len() / 2;
+    // `members[pos]` is the row at `pos` of the partition, as an index into `rows`.
+    let mut members: Vec<usize> = (0..rows.len()).collect();
+    let mut degrees = [vec![0u32; dims_count], vec![0u32; dims_count]];
+    for (pos, &member) in members.iter().enumerate() {
+        for &dim in local_dims(member) {
+            degrees[(pos >= mid) as usize][dim as usize] += 1;
+        }
+    }
+    let costs = [cost_table(mid, rows.len() + 1), cost_table(rows.len() - mid, rows.len() + 1)];
+
+    for _ in 0..MAX_ITERATIONS {
+        // Bits saved by moving the row at `pos` alone to the other half.
+        let gains: Vec<f32> = members
+            .iter()
+            .enumerate()
+            .map(|(pos, &member)| {
+                let (from, to) = if pos < mid { (0, 1) } else { (1, 0) };
+                local_dims(member)
+                    .iter()
+                    .map(|&dim| {
+                        let (a, b) = (degrees[from][dim as usize] as usize, degrees[to][dim as usize] as usize);
+                        costs[from][a] + costs[to][b] - costs[from][a - 1] - costs[to][b + 1]
+                    })
+                    .sum()
+            })
+            .collect();
+        let mut left: Vec<usize> = (0..mid).collect();
+        let mut right: Vec<usize> = (mid..rows.len()).collect();
+        left.sort_by(|&a, &b| gains[b].total_cmp(&gains[a]));
+        right.sort_by(|&a, &b| gains[b].total_cmp(&gains[a]));
+
+        let mut swapped = 0;
+        for (&left_pos, &right_pos) in left.iter().zip(right.iter()) {
+            if gains[left_pos] + gains[right_pos] <= 0.0 {
+                break;
+            }
+            for &dim in local_dims(members[left_pos]) {
+                degrees[0][dim as usize] -= 1;
+                degrees[1][dim as usize] += 1;
+            }
+            for &dim in local_dims(members[right_pos]) {
+                degrees[1][dim as usize] -= 1;
+                degrees[0][dim as usize] += 1;
+            }
+            members.swap(left_pos, right_pos);
+            swapped += 1;
+        }
+        if swapped == 0 {
+            break;
+        }
+    }
+
+    let reordered: Vec<u32> = members.iter().map(|&member| rows[member]).collect();
+    rows.copy_from_slice(&reordered);
+    let (left, right) = rows.split_at_mut(mid);
+    if left.len() >= PARALLEL_PARTITION_SIZE {
+        rayon::join(|| bisect(left, forward_index), || bisect(right, forward_index));
+    } else {
+        bisect(left, forward_index);
+        bisect(right, forward_index);
+    }
+}
+
+/// Order of `rows_count` rows where `postings[dim]` lists the rows (`0..rows_count`) storing `dim`.
+/// Returns `order[new_row] = old_row`.
+pub fn bisection_order(rows_count: usize, postings: &[Vec<u32>]) -> Vec<u32> {
+    let forward_index = ForwardIndex::new(rows_count, postings);
+    let mut order: Vec<u32> = (0..rows_count as u32).collect();
+    bisect(&mut order, &forward_index);
+    order
+}
+
+#[cfg(test)]
+mod tests {
+    use rand::{rngs::StdRng, Rng, SeedableRng};
+
+    use super::*;
+
+    /// Sum of `log2` of gaps, roughly the bits needed to pack row ids.
+    fn log_gap_cost(order: &[u32], postings: &[Vec<u32>]) -> f64 {
+        let mut new_rows = vec![0; order.len()];
+        for (new_row, &old_row) in order.iter().enumerate() {
+            new_rows[old_row as usize] = new_row as u32;
+        }
+        postings
+            .iter()
+            .map(|posting| {
+                let mut rows: Vec<u32> = posting.iter().map(|&row| new_rows[row as usize]).collect();
+                rows.sort_unstable();
+                let mut previous = -1i64;
+                rows.iter()
+                    .map(|&row| {
+                        let gap = row as i64 - previous;
+                        previous = row as i64;
+                        (gap as f64).log2()
+                    })
+                    .sum::<f64>()
+            })
+            .sum()
+    }
+
+    #[test]
+    fn test_bisection_order() {
+        // Rows fall into 4 topics of 8 dims each, topics are shuffled across row ids.
+        let mut rng = StdRng::seed_from_u64(12345);
+        let rows_count = 512;
+        let mut postings = vec![vec![]; 32];
+        for row in 0..rows_count as u32 {
+            let topic: u32 = rng.gen_range(0..4);
+            let mut dims: Vec<u32> = (0..4).map(|_| topic * 8 + rng.gen_range(0..8)).collect();
+            dims.sort_unstable();
+            dims.dedup();
+            dims.into_iter().for_each(|dim| postings[dim as usize].push(row));
+        }
+
+        let order = bisection_order(rows_count, &postings);
+        let mut sorted = order.clone();
+        sorted.sort_unstable();
+        assert_eq!(sorted, (0..rows_count as u32).collect::<Vec<_>>());
+
+        let identity: Vec<u32> = (0..rows_count as u32).collect();
+        assert!(log_gap_cost(&order, &postings) < 0.5 * log_gap_cost(&identity, &postings));
+    }
+}
@@ -0,0 +1,322 @@
+use std::fs::{self, OpenOptions};
+use std::io;
+use std::ops::{Deref, Range};
+use std::path::{Path, PathBuf};
+use std::sync::Arc;
+
+use memmap2::{Mmap, MmapMut};
+
+use crate::common::errors::DataCorruption;
+use crate::core::{madvise, open_read_mmap, open_read_mmap_with_policy, open_write_mmap, LoadPolicy, SegmentMetaCodec, TEMP_FILE_EXTENSION};
+use crate::directory::footer::Footer;
+use crate::directory::{FileSlice, OwnedBytes};
+use common::StableDeref;
+
+/// Magic of the container header, `SPSG` in little endian.
+const SEGMENT_CONTAINER_MAGIC: u32 = u32::from_le_bytes(*b"SPSG");
+const SEGMENT_CONTAINER_FORMAT_VERSION: u32 = 1;
+
+/// magic, format version, section count, reserved.
+const CONTAINER_HEADER_SIZE: usize = 16;
+/// kind, reserved, offset, length.
+const SECTION_ENTRY_SIZE: usize = 24;
+
+/// Every section starts on a page boundary, so it can be transmuted and advised on its own.
+pub const SECTION_ALIGNMENT: usize = 4096;
+
+/// How the files of a mmap inverted index are laid out on disk.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum SegmentLayout {
+    /// One file per component, plus a json meta file.
+    MultiFile,
+    /// All components are sections of one container file.
+    SingleFile,
+}
+
+/// Section ids stored in the container section table.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+#[repr(u32)]
+pub enum SectionKind {
+    Meta = 1,
+    Headers = 2,
+    Postings = 3,
+    RowIds = 4,
+    Blocks = 5,
+    /// Eytzinger ordered dim ids, present only when headers are not dense by dim id.
+    DimDirectory = 6,
+    /// External row id of every internal row id, present only when rows were reordered while merging.
+    RowIdMap = 7,
+}
+
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+struct SectionEntry {
+    kind: u32,
+    offset: u64,
+    len: u64,
+}
+
+impl SectionEntry {
+    fn range(&self) -> Range<usize> {
+        self.offset as usize..(self.offset + self.len) as usize
+    }
+}
+
+fn invalid_data(message: String) -> io::Error {
+    io::Error::new(io::ErrorKind::InvalidData, message)
+}
+
+fn read_u32(bytes: &[u8], offset: usize) -> u32 {
+    u32::from_le_bytes(bytes[offset..offset + 4].try_into().unwrap())
+}
+
+fn read_u64(bytes: &[u8], offset: usize) -> u64 {
+    u64::from_le_bytes(bytes[offset..offset + 8].try_into().unwrap())
+}
+
+/// A byte range of a shared read-only mmap.
+#[derive(Debug, Clone)]
+pub struct MmapSection {
+    mmap: Arc<Mmap>,
+    range: Range<usize>,
+}
+
+impl MmapSection {
+    pub fn new(mmap: Arc<Mmap>, range: Range<usize>) -> Self {
+        assert!(range.start <= range.end && range.end <= mmap.len());
+        Self { mmap, range }
+    }
+
+    /// Offset of the section in its file.
+    pub fn offset(&self) -> u64 {
+        self.range.start as u64
+    }
+}
+
+impl From<Mmap> for MmapSection {
+    fn from(mmap: Mmap) -> Self {
+        let len = mmap.len();
+        Self::new(Arc::new(mmap), 0..len)
+    }
+}
+
+impl Deref for MmapSection {
+    type Target = [u8];
+
+    fn deref(&self) -> &[u8] {
+        &self.mmap[self.range.clone()]
+    }
+}
+
+unsafe impl StableDeref for MmapSection {}
+
+/// Read side of a single-file segment.
+///
+/// Layout: fixed header, section table, page aligned sections, then a `Footer` holding the crc of everything before it.
+#[derive(Debug, Clone)]
+pub struct SegmentContainer {
+    mmap: Arc<Mmap>,
+    sections: Vec<SectionEntry>,
+    body_len: usize,
+    crc: u32,
+}
+
+impl SegmentContainer {
+    /// Needs one open and one mmap, the checksum is not verified here, see `verify_checksum`.
+    pub fn open(path: &Path) -> io::Result<Self> {
+        Self::from_mmap(path, open_read_mmap(path)?)
+    }
+
+    /// Open for searching, `load_policy` decides how the file is brought into memory.
+    pub fn open_with_policy(path: &Path, load_policy: LoadPolicy) -> io::Result<Self> {
+        Self::from_mmap(path, open_read_mmap_with_policy(path, load_policy)?)
+    }
+
+    fn from_mmap(path: &Path, mmap: Mmap) -> io::Result<Self> {
+        let mmap = Arc::new(mmap);
+        let whole = MmapSection::new(mmap.clone(), 0..mmap.len());
+        let (footer, body) = Footer::extract_footer(FileSlice::new(Arc::new(OwnedBytes::new(whole))))?;
+        footer.is_compatible().map_err(|e| invalid_data(format!("{:?}", e)))?;
+
+        let body_len = body.len();
+        let bytes = &mmap[..body_len];
+        if body_len < CONTAINER_HEADER_SIZE || read_u32(bytes, 0) != SEGMENT_CONTAINER_MAGIC {
+            return Err(invalid_data(format!("{:?} is not a segment container", path)));
+        }
+        let format_version = read_u32(bytes, 4);
+        if format_version != SEGMENT_CONTAINER_FORMAT_VERSION {
+            return Err(invalid_data(format!("unsupported segment container format version {}", format_version)));
+        }
+
+        let section_count = read_u32(bytes, 8) as usize;
+        if body_len < CONTAINER_HEADER_SIZE + section_count * SECTION_ENTRY_SIZE {
+            return Err(invalid_data(format!("segment container section table is truncated, section count {}", section_count)));
+        }
+        let mut sections = Vec::with_capacity(section_count);
+        for idx in 0..section_count {
+            let entry_offset = CONTAINER_HEADER_SIZE + idx * SECTION_ENTRY_SIZE;
+            let entry = SectionEntry { kind: read_u32(bytes, entry_offset), offset: read_u64(bytes, entry_offset + 8), len: read_u64(bytes, entry_offset + 16) };
+            if entry.offset.checked_add(entry.len).map_or(true, |end| end > body_len as u64) {
+                return Err(invalid_data(format!("segment container section {:?} is out of bounds", entry)));
+            }
+            sections.push(entry);
+        }
+
+        Ok(Self { mmap, sections, body_len, crc: footer.crc() })
+    }
+
+    pub fn section(&self, kind: SectionKind) -> io::Result<MmapSection> {
+        self.optional_section(kind).ok_or_else(|| io::Error::new(io::ErrorKind::NotFound, format!("segment container has no {:?} section", kind)))
+    }
+
+    pub fn optional_section(&self, kind: SectionKind) -> Option<MmapSection> {
+        self.sections.iter().find(|entry| entry.kind == kind as u32).map(|entry| MmapSection::new(self.mmap.clone(), entry.range()))
+    }
+
+    /// Binary meta, or the json one of containers written before.
+    pub fn read_meta<T: SegmentMetaCodec>(&self) -> io::Result<T> {
+        T::from_bytes(&self.section(SectionKind::Meta)?)
+    }
+
+    pub fn advise(&self, advice: madvise::Advice) -> io::Result<()> {
+        madvise::madvise(self.mmap.as_ref(), advice)
+    }
+
+    /// Reads the whole file, only call it when corruption must be detected (e.g. before merging).
+    pub fn verify_checksum(&self) -> io::Result<()> {
+        let crc = crc32fast::hash(&self.mmap[..self.body_len]);
+        if crc != self.crc {
+            return Err(invalid_data(format!("segment container checksum mismatch, expected {}, actual {}", self.crc, crc)));
+        }
+        Ok(())
+    }
+}
+
+/// Verify the container at `path` before reading all of it, a malformed container or checksum mismatch is `DataCorruption`.
+/// Segments of the multi-file layout have no container and carry no checksum.
+pub fn verify_segment_container(path: &Path) -> crate::Result<()> {
+    if !path.exists() {
+        return Ok(());
+    }
+    SegmentContainer::open(path).and_then(|container| container.verify_checksum()).map_err(|e| match e.kind() {
+        io::ErrorKind::InvalidData => DataCorruption::new(path.to_path_buf(), e.to_string()).into(),
+        _ => e.into(),
+    })
+}
+
+/// Write side of a single-file segment, section sizes must be known up front.
+///
+/// The file is written under a temporary name and renamed by `finish`, readers never see a partial container.
+pub struct SegmentContainerWriter {
+    path: PathBuf,
+    temp_path: PathBuf,
+    mmap: MmapMut,
+    sections: Vec<SectionEntry>,
+}
+
+impl SegmentContainerWriter {
+    pub fn create(path: &Path, sections: &[(SectionKind, usize)]) -> io::Result<Self> {
+        let mut offset = CONTAINER_HEADER_SIZE + sections.len() * SECTION_ENTRY_SIZE;
+        let mut entries = Vec::with_capacity(sections.len());
+        for &(kind, len) in sections {
+            offset = (offset + SECTION_ALIGNMENT - 1) / SECTION_ALIGNMENT * SECTION_ALIGNMENT;
+            entries.push(SectionEntry { kind: kind as u32, offset: offset as u64, len: len as u64 });
+            offset += len;
+        }
+
+        let temp_path = PathBuf::from(format!("{}.{}", path.display(), TEMP_FILE_EXTENSION));
+        OpenOptions::new().read(true).write(true).create(true).truncate(true).open(&temp_path)?.set_len(offset as u64)?;
+        let mut mmap = open_write_mmap(&temp_path)?;
+
+        mmap[0..4].copy_from_slice(&SEGMENT_CONTAINER_MAGIC.to_le_bytes());
+        mmap[4..8].copy_from_slice(&SEGMENT_CONTAINER_FORMAT_VERSION.to_le_bytes());
+        mmap[8..12].copy_from_slice(&(entries.len() as u32).to_le_bytes());
+        for (idx, entry) in entries.iter().enumerate() {
+            let entry_offset = CONTAINER_HEADER_SIZE + idx * SECTION_ENTRY_SIZE;
+            mmap[entry_offset..entry_offset + 4].copy_from_slice(&entry.kind.to_le_bytes());
+            mmap[entry_offset + 8..entry_offset + 16].copy_from_slice(&entry.offset.to_le_bytes());
+            mmap[entry_offset + 16..entry_offset + 24].copy_from_slice(&entry.len.to_le_bytes());
+        }
+
+        Ok(Self { path: path.to_path_buf(), temp_path, mmap, sections: entries })
+    }
+
+    /// Mutable section buffers, in the order given to `create`.
+    pub fn sections_mut(&mut self) -> Vec<&mut [u8]> {
+        let mut rest: &mut [u8] = &mut self.mmap[..];
+        let mut consumed = 0;
+        let mut buffers = Vec::with_capacity(self.sections.len());
+        for entry in self.sections.iter() {
+            let (_, tail) = std::mem::take(&mut rest).split_at_mut(entry.offset as usize - consumed);
+            let (section, tail) = tail.split_at_mut(entry.len as usize);
+            buffers.push(section);
+            rest = tail;
+            consumed = (entry.offset + entry.len) as usize;
+        }
+        buffers
+    }
+
+    /// Append the crc footer, sync and publish the container under its final name.
+    pub fn finish(self) -> io::Result<SegmentContainer> {
+        let SegmentContainerWriter { path, temp_path, mmap, .. } = self;
+        mmap.flush()?;
+        let crc = crc32fast::hash(&mmap);
+        drop(mmap);
+
+        let mut file = OpenOptions::new().append(true).open(&temp_path)?;
+        Footer::new(crc).append_footer(&mut file)?;
+        file.sync_all()?;
+        drop(file);
+
+        fs::rename(&temp_path, &path)?;
+        SegmentContainer::open(&path)
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use tempfile::tempdir;
+
+    #[test]
+    fn test_write_and_open() {
+        let dir = tempdir().unwrap();
+        let path = dir.path().join("segment");
+
+        let mut writer = SegmentContainerWriter::create(&path, &[(SectionKind::Headers, 10), (SectionKind::Postings, 0), (SectionKind::Blocks, 5000)]).unwrap();
+        {
+            let mut buffers = writer.sections_mut();
+            buffers[0].copy_from_slice(&[1; 10]);
+            buffers[2].copy_from_slice(&[3; 5000]);
+        }
+        writer.finish().unwrap();
+        assert!(!PathBuf::from(format!("{}.{}", path.display(), TEMP_FILE_EXTENSION)).exists());
+
+        let container = SegmentContainer::open(&path).unwrap();
+        container.verify_checksum().unwrap();
+        assert_eq!(&container.section(SectionKind::Headers).unwrap()[..], &[1; 10]);
+        assert!(container.section(SectionKind::Postings).unwrap().is_empty());
+        let blocks = container.section(SectionKind::Blocks).unwrap();
+        assert_eq!(blocks.as_ptr() as usize % SECTION_ALIGNMENT, 0);
+        assert_eq!(&blocks[..], &[3; 5000]);
+        assert_eq!(container.section(SectionKind::RowIds).unwrap_err().kind(), io::ErrorKind::NotFound);
+    }
+
+    #[test]
+    fn test_checksum_mismatch() {
+        let dir = tempdir().unwrap();
+        let path = dir.path().join("segment");
+
+        let mut writer = SegmentContainerWriter::create(&path, &[(SectionKind::Postings, 8)]).unwrap();
+        writer.sections_mut()[0].copy_from_slice(&[7; 8]);
+        writer.finish().unwrap();
+
+        let mut bytes = fs::read(&path).unwrap();
+        bytes[SECTION_ALIGNMENT] = 0;
+        fs::write(&path, bytes).unwrap();
+
+        let container = SegmentContainer::open(&path).unwrap();
+        assert_eq!(container.verify_checksum().unwrap_err().kind(), io::ErrorKind::InvalidData);
+        assert!(matches!(verify_segment_container(&path), Err(crate::SparseError::DataCorruption(_))));
+        verify_segment_container(&dir.path().join("missing")).unwrap();
+    }
+}
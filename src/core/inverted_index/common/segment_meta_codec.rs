@@ -0,0 +1,216 @@
+//! Compact little endian encoding of segment metas. Opening a segment decodes a few fixed width fields instead of parsing json,
+//! json is still accepted for segments written before and kept as a debug export.
+
+use std::io;
+use std::path::Path;
+
+use serde::{de::DeserializeOwned, Serialize};
+
+use crate::core::{CompressedMmapInvertedIndexMeta, ElementType, MmapInvertedIndexMeta};
+
+use super::{IndexStorageType, InvertedIndexMeta, Revision, SectionKind, SegmentContainer, Version};
+
+/// Magic of binary metas, `SPMB` in little endian. Json metas start with `{`.
+const BINARY_META_MAGIC: u32 = u32::from_le_bytes(*b"SPMB");
+const BINARY_META_FORMAT_VERSION: u32 = 1;
+/// magic, format version.
+const BINARY_META_HEADER_SIZE: usize = 8;
+
+fn invalid_data(message: String) -> io::Error {
+    io::Error::new(io::ErrorKind::InvalidData, message)
+}
+
+/// Appends fixed width little endian fields.
+#[derive(Debug, Default)]
+pub struct MetaWriter {
+    bytes: Vec<u8>,
+}
+
+impl MetaWriter {
+    pub fn put_u8(&mut self, value: u8) {
+        self.bytes.push(value);
+    }
+
+    pub fn put_u32(&mut self, value: u32) {
+        self.bytes.extend_from_slice(&value.to_le_bytes());
+    }
+
+    pub fn put_u64(&mut self, value: u64) {
+        self.bytes.extend_from_slice(&value.to_le_bytes());
+    }
+
+    pub fn put_bool(&mut self, value: bool) {
+        self.put_u8(value as u8);
+    }
+}
+
+/// Reads fields in the order they were written, running past the end is an `InvalidData` error.
+#[derive(Debug)]
+pub struct MetaReader<'a> {
+    bytes: &'a [u8],
+}
+
+impl<'a> MetaReader<'a> {
+    fn take<const N: usize>(&mut self) -> io::Result<[u8; N]> {
+        if self.bytes.len() < N {
+            return Err(invalid_data(format!("binary segment meta is truncated, {} bytes left, {} needed", self.bytes.len(), N)));
+        }
+        let (head, tail) = self.bytes.split_at(N);
+        self.bytes = tail;
+        Ok(head.try_into().unwrap())
+    }
+
+    pub fn get_u8(&mut self) -> io::Result<u8> {
+        Ok(self.take::<1>()?[0])
+    }
+
+    pub fn get_u32(&mut self) -> io::Result<u32> {
+        Ok(u32::from_le_bytes(self.take()?))
+    }
+
+    pub fn get_u64(&mut self) -> io::Result<u64> {
+        Ok(u64::from_le_bytes(self.take()?))
+    }
+
+    pub fn get_bool(&mut self) -> io::Result<bool> {
+        Ok(self.get_u8()? != 0)
+    }
+}
+
+/// Segment meta stored in the `Meta` section of a container.
+pub trait SegmentMetaCodec: Sized + Serialize + DeserializeOwned {
+    fn encode_fields(&self, writer: &mut MetaWriter);
+
+    fn decode_fields(reader: &mut MetaReader) -> io::Result<Self>;
+
+    fn to_bytes(&self) -> Vec<u8> {
+        let mut writer = MetaWriter::default();
+        writer.put_u32(BINARY_META_MAGIC);
+        writer.put_u32(BINARY_META_FORMAT_VERSION);
+        self.encode_fields(&mut writer);
+        writer.bytes
+    }
+
+    /// Binary metas, and json ones of segments written before.
+    fn from_bytes(bytes: &[u8]) -> io::Result<Self> {
+        if !is_binary_meta(bytes) {
+            return Ok(serde_json::from_slice(bytes)?);
+        }
+        let mut reader = MetaReader { bytes };
+        let (_, format_version) = (reader.get_u32()?, reader.get_u32()?);
+        if format_version != BINARY_META_FORMAT_VERSION {
+            return Err(invalid_data(format!("unsupported binary segment meta format version {}", format_version)));
+        }
+        Self::decode_fields(&mut reader)
+    }
+
+    /// Pretty printed json, for debugging only.
+    fn to_json(&self) -> io::Result<String> {
+        Ok(serde_json::to_string_pretty(self)?)
+    }
+}
+
+pub fn is_binary_meta(bytes: &[u8]) -> bool {
+    bytes.len() >= BINARY_META_HEADER_SIZE && bytes[..4] == BINARY_META_MAGIC.to_le_bytes()
+}
+
+/// Meta of a single-file segment as pretty printed json, for debugging.
+pub fn export_segment_meta_json(container_path: &Path) -> io::Result<String> {
+    let container = SegmentContainer::open(container_path)?;
+    let bytes = container.section(SectionKind::Meta)?;
+    // Every segment meta starts with the common fields, they tell the storage type.
+    match InvertedIndexMeta::from_bytes(&bytes)?.version.index_storage_type {
+        IndexStorageType::CompressedMmap => CompressedMmapInvertedIndexMeta::from_bytes(&bytes)?.to_json(),
+        _ => MmapInvertedIndexMeta::from_bytes(&bytes)?.to_json(),
+    }
+}
+
+fn element_type_from_u8(code: u8) -> io::Result<ElementType> {
+    match code {
+        0 => Ok(ElementType::SIMPLE),
+        1 => Ok(ElementType::EXTENDED),
+        _ => Err(invalid_data(format!("unknown element type {} in binary segment meta", code))),
+    }
+}
+
+impl SegmentMetaCodec for InvertedIndexMeta {
+    fn encode_fields(&self, writer: &mut MetaWriter) {
+        writer.put_u64(self.posting_count as u64);
+        writer.put_u64(self.vector_count as u64);
+        writer.put_u32(self.min_row_id);
+        writer.put_u32(self.max_row_id);
+        writer.put_u32(self.min_dim_id);
+        writer.put_u32(self.max_dim_id);
+        writer.put_bool(self.quantized);
+        writer.put_u8(self.element_type as u8);
+        writer.put_u8(self.version.index_storage_type.clone() as u8);
+        writer.put_u8(self.version.revision.clone() as u8);
+        writer.put_u32(self.row_id_base);
+    }
+
+    fn decode_fields(reader: &mut MetaReader) -> io::Result<Self> {
+        let (posting_count, vector_count) = (reader.get_u64()? as usize, reader.get_u64()? as usize);
+        let (min_row_id, max_row_id, min_dim_id, max_dim_id) = (reader.get_u32()?, reader.get_u32()?, reader.get_u32()?, reader.get_u32()?);
+        let quantized = reader.get_bool()?;
+        let element_type = element_type_from_u8(reader.get_u8()?)?;
+        let index_storage_type = match reader.get_u8()? {
+            0 => IndexStorageType::Memory,
+            1 => IndexStorageType::Mmap,
+            2 => IndexStorageType::CompressedMmap,
+            code => return Err(invalid_data(format!("unknown index storage type {} in binary segment meta", code))),
+        };
+        let revision = match reader.get_u8()? {
+            0 => Revision::V1,
+            1 => Revision::V2,
+            2 => Revision::V3,
+            code => return Err(invalid_data(format!("unknown revision {} in binary segment meta", code))),
+        };
+        let meta =
+            InvertedIndexMeta::new(posting_count, vector_count, min_row_id, max_row_id, min_dim_id, max_dim_id, quantized, element_type, Version { index_storage_type, revision });
+        Ok(meta.with_row_id_base(reader.get_u32()?))
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::core::SegmentContainerWriter;
+    use tempfile::tempdir;
+
+    #[test]
+    fn test_binary_and_json_meta() {
+        let meta = InvertedIndexMeta::new(12, 1000, 0, 999, 0, 11, true, ElementType::EXTENDED, Version::compressed_mmap(Revision::V3)).with_row_id_base(4096);
+        let bytes = meta.to_bytes();
+        assert!(is_binary_meta(&bytes));
+        assert_eq!(InvertedIndexMeta::from_bytes(&bytes).unwrap(), meta);
+
+        // Segments written before store json.
+        let json = serde_json::to_vec(&meta).unwrap();
+        assert!(!is_binary_meta(&json));
+        assert_eq!(InvertedIndexMeta::from_bytes(&json).unwrap(), meta);
+        assert_eq!(serde_json::from_str::<InvertedIndexMeta>(&meta.to_json().unwrap()).unwrap(), meta);
+
+        assert_eq!(InvertedIndexMeta::from_bytes(&bytes[..bytes.len() - 1]).unwrap_err().kind(), io::ErrorKind::InvalidData);
+    }
+
+    #[test]
+    fn test_export_segment_meta_json() {
+        let meta = CompressedMmapInvertedIndexMeta {
+            inverted_index_meta: InvertedIndexMeta::new(3, 20, 0, 19, 0, 2, false, ElementType::SIMPLE, Version::compressed_mmap(Revision::V3)),
+            row_ids_storage_size: 40,
+            headers_storage_size: 192,
+            total_blocks_count: 3,
+            blocks_storage_size: 300,
+            u4_weights: false,
+        };
+        let bytes = meta.to_bytes();
+        let dir = tempdir().unwrap();
+        let path = dir.path().join("segment");
+        let mut writer = SegmentContainerWriter::create(&path, &[(SectionKind::Meta, bytes.len())]).unwrap();
+        writer.sections_mut()[0].copy_from_slice(&bytes);
+        assert_eq!(writer.finish().unwrap().read_meta::<CompressedMmapInvertedIndexMeta>().unwrap(), meta);
+
+        let json = export_segment_meta_json(&path).unwrap();
+        assert_eq!(serde_json::from_str::<CompressedMmapInvertedIndexMeta>(&json).unwrap(), meta);
+    }
+}
@@ -2,20 +2,19 @@ use crate::core::common::ops::*;
 use crate::core::common::types::DimId;
 use crate::core::inverted_index::common::{InvertedIndexMeta, InvertedIndexMetrics, Revision, Version};
 use crate::core::{
-    CompressedBlockType, CompressedInvertedIndexRam, CompressedPostingListIterator, CompressedPostingListView, ExtendedCompressedPostingBlock, InvertedIndexMmapAccess,
-    InvertedIndexMmapInit, InvertedIndexRam, InvertedIndexRamAccess, PostingListIter, PostingListIterAccess, QuantizedWeight, SimpleCompressedPostingBlock, WeightType,
+    BlocksLayout, CompressedBlocks, CompressedInvertedIndexRam, CompressedPostingListIterator, CompressedPostingListView, DimDirectory, InvertedIndexMmapAccess,
+    InvertedIndexMmapInit, InvertedIndexRam, InvertedIndexRamAccess, MmapSection, PostingListIter, PostingListIterAccess, QuantizedWeight, SectionKind, SegmentContainer,
+    SegmentLayout, WeightType,
 };
 use crate::{thread_name, RowId};
-use log::{debug, warn};
-use memmap2::Mmap;
+use log::{debug, error, warn};
 use std::borrow::Cow;
 use std::marker::PhantomData;
 use std::mem::size_of;
 use std::path::{Path, PathBuf};
 use std::sync::Arc;
 
-use super::COMPRESSED_POSTING_HEADER_SIZE;
-use super::{CompressedInvertedIndexMmapConfig, CompressedMmapInvertedIndexMeta, CompressedMmapManager, CompressedPostingListHeader};
+use super::{next_segment_key, CompressedInvertedIndexMmapConfig, CompressedMmapInvertedIndexMeta, CompressedMmapManager, CompressedPostingListHeader, PostingFileReader};
 
 /// CompressedInvertedIndexMmap
 ///
@@ -24,17 +23,26 @@ use super::{CompressedInvertedIndexMmapConfig, CompressedMmapInvertedIndexMeta,
 #[derive(Debug, Clone)]
 pub struct CompressedInvertedIndexMmap<OW: QuantizedWeight, TW: QuantizedWeight> {
     pub path: PathBuf,
-    pub headers_mmap: Arc<Mmap>,
-    pub row_ids_mmap: Arc<Mmap>,
-    pub blocks_mmap: Arc<Mmap>,
+    pub headers_mmap: MmapSection,
+    pub row_ids_mmap: MmapSection,
+    pub blocks_mmap: MmapSection,
+    /// Eytzinger ordered dim ids, `None` when headers are dense by dim id.
+    pub dim_directory: Option<MmapSection>,
+    /// External row id of every internal row id, `None` when postings store row ids offset by `row_id_base`.
+    pub row_id_map: Option<MmapSection>,
     pub meta: CompressedMmapInvertedIndexMeta,
+    pub layout: SegmentLayout,
+    /// Key of this segment in the posting cache and the decoded block cache.
+    pub segment_key: u64,
+    /// Set when loaded with `LoadPolicy::Pread`, postings are read through the posting cache instead of `row_ids_mmap` and `blocks_mmap`.
+    pub posting_reader: Option<Arc<PostingFileReader>>,
     pub(crate) _ow: PhantomData<OW>,
     pub(crate) _tw: PhantomData<TW>,
 }
 
 impl<OW: QuantizedWeight, TW: QuantizedWeight> InvertedIndexMmapInit<OW, TW> for CompressedInvertedIndexMmap<OW, TW> {
-    fn open(path: &Path, segment_id: Option<&str>) -> std::io::Result<Self> {
-        Self::load_under_segment(path.to_path_buf(), segment_id)
+    fn open_with_policy(path: &Path, segment_id: Option<&str>, load_policy: LoadPolicy) -> std::io::Result<Self> {
+        Self::load_with_policy(path.to_path_buf(), segment_id, load_policy)
     }
 
     fn from_ram_index(ram_index: Cow<InvertedIndexRam<TW>>, path: PathBuf, segment_id: Option<&str>) -> crate::Result<Self> {
@@ -47,24 +55,59 @@ impl<OW: QuantizedWeight, TW: QuantizedWeight> PostingListIterAccess<OW, TW> for
     type Iter<'a> = CompressedPostingListIterator<'a, OW, TW>;
 
     fn iter(&self, dim_id: &DimId) -> Option<Self::Iter<'_>> {
-        let res_opt: Option<CompressedPostingListView<'_, TW>> = self.posting_with_param(dim_id);
-        if res_opt.is_none() {
-            return None;
+        let Some(posting_reader) = &self.posting_reader else {
+            let view = self.posting_with_param(dim_id)?.with_block_cache_key(self.segment_key, *dim_id);
+            return Some(Self::log_iter(&view, CompressedPostingListIterator::<OW, TW>::new(&view)));
+        };
+
+        let ordinal = self.posting_ordinal(dim_id)?;
+        let header_obj = self.header(ordinal);
+        match posting_reader.read(
+            ordinal,
+            header_obj.compressed_blocks_start..header_obj.compressed_blocks_end,
+            header_obj.compressed_row_ids_start..header_obj.compressed_row_ids_end,
+        ) {
+            Ok((cached, _)) => {
+                let view = Self::view_without_bytes(&header_obj).with_block_cache_key(self.segment_key, *dim_id);
+                Some(Self::log_iter(&view, CompressedPostingListIterator::<OW, TW>::from_cached_posting(view.clone(), Self::blocks_layout(&header_obj), cached)))
+            }
+            Err(e) => {
+                // Sections stay mapped under `LoadPolicy::Pread`, a failed read must not drop the posting from the query.
+                error!("[{}]-[cmp-mmap]-[iter] failed to read posting of dim_id:{}, read it from mmap, {}", thread_name!(), dim_id, e);
+                let view = self.posting_with_param(dim_id)?.with_block_cache_key(self.segment_key, *dim_id);
+                Some(Self::log_iter(&view, CompressedPostingListIterator::<OW, TW>::new(&view)))
+            }
         }
-        let view = res_opt.unwrap();
+    }
 
-        // When using iterator peek func, you will get a `OW` type of weight.
-        let iterator: CompressedPostingListIterator<'_, OW, TW> = CompressedPostingListIterator::<OW, TW>::new(&view);
+    fn row_id_map(&self) -> Option<MmapSection> {
+        self.row_id_map.clone()
+    }
 
-        debug!(
-            "[{}]-[cmp-mmap]-[iter] TW:{:?}, OW:{:?}, quantize param:{:?}, iter size:{}",
-            thread_name!(),
-            TW::weight_type(),
-            OW::weight_type(),
-            view.quantization_params,
-            iterator.remains()
-        );
-        return Some(iterator);
+    fn row_id_base(&self) -> RowId {
+        self.meta.inverted_index_meta.row_id_base
+    }
+
+    fn prefetch(&self, dim_ids: &[DimId]) -> (u64, u64) {
+        let Some(posting_reader) = &self.posting_reader else {
+            return (0, 0);
+        };
+        // Headers are mmapped, only posting reads go to the prefetch pool.
+        let postings: Vec<_> = dim_ids
+            .iter()
+            .filter_map(|dim_id| self.posting_ordinal(dim_id))
+            .map(|ordinal| {
+                let header_obj = self.header(ordinal);
+                (ordinal, header_obj.compressed_blocks_start..header_obj.compressed_blocks_end, header_obj.compressed_row_ids_start..header_obj.compressed_row_ids_end)
+            })
+            .collect();
+        let hits: Vec<bool> = posting_reader
+            .prefetch_all(postings)
+            .into_iter()
+            .filter_map(|(ordinal, hit)| hit.map_err(|e| error!("[{}]-[cmp-mmap]-[prefetch] failed to read posting {}, {}", thread_name!(), ordinal, e)).ok())
+            .collect();
+        let hits_count = hits.iter().filter(|hit| **hit).count() as u64;
+        (hits_count, hits.len() as u64 - hits_count)
     }
 }
 
@@ -93,8 +136,10 @@ impl<OW: QuantizedWeight, TW: QuantizedWeight> InvertedIndexMmapAccess<OW, TW> f
 
     fn files(&self, segment_id: Option<&str>) -> Vec<PathBuf> {
         // relative paths
-        let get_all_files = CompressedInvertedIndexMmapConfig::get_all_files(segment_id);
-        get_all_files.iter().map(|p| PathBuf::from(p)).collect()
+        match self.layout {
+            SegmentLayout::SingleFile => vec![PathBuf::from(CompressedInvertedIndexMmapConfig::container_file_name(segment_id))],
+            SegmentLayout::MultiFile => CompressedInvertedIndexMmapConfig::get_all_files(segment_id).iter().map(|p| PathBuf::from(p)).collect(),
+        }
     }
 
     fn metrics(&self) -> InvertedIndexMetrics {
@@ -121,68 +166,125 @@ impl<OW: QuantizedWeight, TW: QuantizedWeight> CompressedInvertedIndexMmap<OW, T
         self.meta.inverted_index_meta.max_row_id
     }
 
+    /// External row id of a row id stored in postings, mapped when rows were reordered while merging, offset by the row id base otherwise.
+    pub fn external_row_id(&self, row_id: RowId) -> RowId {
+        match &self.row_id_map {
+            Some(row_id_map) => transmute_from_u8_to_slice::<RowId>(row_id_map)[row_id as usize],
+            None => self.meta.inverted_index_meta.row_id_base + row_id,
+        }
+    }
+
     fn slice_part<T>(&self, start: u64, count: u64) -> &[T] {
         let start = start as usize;
         let end = start + count as usize * size_of::<T>();
         transmute_from_u8_to_slice(&self.blocks_mmap[start..end])
     }
 
+    /// Header slot of `dim_id`, dims missing from a sparse segment have none.
+    fn posting_ordinal(&self, dim_id: &DimId) -> Option<usize> {
+        match &self.dim_directory {
+            Some(dim_directory) => DimDirectory::find(transmute_from_u8_to_slice(dim_directory), *dim_id),
+            None => {
+                // check that the id is not out of bounds (posting_count includes the empty zeroth entry)
+                if *dim_id >= self.meta.inverted_index_meta.posting_count as DimId {
+                    warn!("dim_id is overflow, dim_id should smaller than {}", self.meta.inverted_index_meta.posting_count);
+                    return None;
+                }
+                Some(*dim_id as usize)
+            }
+        }
+    }
+
+    /// Sorted dim id of every stored posting.
+    pub fn dim_ids(&self) -> Vec<DimId> {
+        match &self.dim_directory {
+            Some(dim_directory) => DimDirectory::sorted_dims(transmute_from_u8_to_slice(dim_directory)),
+            None => (0..self.size() as DimId).collect(),
+        }
+    }
+
     /// Get `CompressedPostingList` with given dim-id.
     /// Not need consider about quantized.
     /// `TW` means weight storage type in disk.
     pub fn posting_with_param(&self, dim_id: &DimId) -> Option<CompressedPostingListView<TW>> {
-        // check that the id is not out of bounds (posting_count includes the empty zeroth entry)
-        if *dim_id >= self.meta.inverted_index_meta.posting_count as DimId {
-            warn!("dim_id is overflow, dim_id should smaller than {}", self.meta.inverted_index_meta.posting_count);
-            return None;
-        }
-        // loding header-obj with given offsets.
-        let header_start = *dim_id as usize * COMPRESSED_POSTING_HEADER_SIZE;
-        let header_obj: CompressedPostingListHeader =
-            transmute_from_u8::<CompressedPostingListHeader>(&self.headers_mmap[header_start..(header_start + COMPRESSED_POSTING_HEADER_SIZE)]).clone();
+        let ordinal = self.posting_ordinal(dim_id)?;
+        let header_obj = self.header(ordinal);
 
         // TODO: Figure out about transfer of owner ship.
         let row_ids_compressed = &self.row_ids_mmap[header_obj.compressed_row_ids_start..header_obj.compressed_row_ids_end];
         let blocks: &[u8] = &self.blocks_mmap[header_obj.compressed_blocks_start..header_obj.compressed_blocks_end];
-        // Convert into Blocks type.
-        match header_obj.compressed_block_type {
-            CompressedBlockType::Simple => {
-                let raw_simple_blocks: &[SimpleCompressedPostingBlock<TW>] = transmute_from_u8_to_slice(blocks);
-                let view = CompressedPostingListView::new(
-                    row_ids_compressed,
-                    raw_simple_blocks,
-                    &[],
-                    header_obj.compressed_block_type,
-                    header_obj.quantized_params,
-                    header_obj.row_ids_count,
-                    header_obj.max_row_id,
-                );
-                Some(view)
-            }
-            CompressedBlockType::Extended => {
-                let raw_extended_blocks: &[ExtendedCompressedPostingBlock<TW>] = transmute_from_u8_to_slice(blocks);
-                let view = CompressedPostingListView::new(
-                    row_ids_compressed,
-                    &[],
-                    raw_extended_blocks,
-                    header_obj.compressed_block_type,
-                    header_obj.quantized_params,
-                    header_obj.row_ids_count,
-                    header_obj.max_row_id,
-                );
-                Some(view)
+        Some(Self::view(&header_obj, row_ids_compressed, blocks))
+    }
+
+    fn header(&self, ordinal: usize) -> CompressedPostingListHeader {
+        self.read_header(ordinal).expect("posting headers are checked when the segment is loaded")
+    }
+
+    fn read_header(&self, ordinal: usize) -> std::io::Result<CompressedPostingListHeader> {
+        CompressedPostingListHeader::read(&self.headers_mmap, ordinal, &self.meta.inverted_index_meta.version.revision)
+    }
+
+    /// Reject a segment with a corrupted posting header once, instead of failing while searching.
+    fn check_headers(self) -> std::io::Result<Self> {
+        for ordinal in 0..self.meta.inverted_index_meta.posting_count {
+            self.read_header(ordinal)?;
+        }
+        Ok(self)
+    }
+
+    fn log_iter<'a>(view: &CompressedPostingListView<'a, TW>, iterator: CompressedPostingListIterator<'a, OW, TW>) -> CompressedPostingListIterator<'a, OW, TW> {
+        debug!(
+            "[{}]-[cmp-mmap]-[iter] TW:{:?}, OW:{:?}, quantize param:{:?}, iter size:{}",
+            thread_name!(),
+            TW::weight_type(),
+            OW::weight_type(),
+            view.quantization_params,
+            iterator.remains()
+        );
+        iterator
+    }
+
+    /// View over the compressed row ids and blocks of one posting, wherever the bytes live.
+    fn view<'a>(header_obj: &CompressedPostingListHeader, row_ids_compressed: &'a [u8], blocks: &'a [u8]) -> CompressedPostingListView<'a, TW> {
+        Self::view_without_bytes(header_obj).with_bytes(row_ids_compressed, Self::blocks_layout(header_obj).blocks(blocks))
+    }
+
+    fn blocks_layout(header_obj: &CompressedPostingListHeader) -> BlocksLayout {
+        match header_obj.packed_weights {
+            true if header_obj.u4_weights => BlocksLayout::PackedU4 { row_ids_count: header_obj.row_ids_count as usize },
+            true => {
+                BlocksLayout::Packed { row_ids_count: header_obj.row_ids_count as usize, block_type: header_obj.compressed_block_type, block_quantized: header_obj.block_quantized }
             }
+            false => BlocksLayout::Legacy(header_obj.compressed_block_type),
         }
     }
 
-    /// Store inverted-index-ram into mmap files.
-    pub fn convert_and_save(compressed_inv_index_ram: &CompressedInvertedIndexRam<TW>, directory: &PathBuf, segment_id: Option<&str>) -> crate::Result<Self> {
-        let (total_blocks_count, total_row_ids_storage_size, total_blocks_storage_size, total_headers_storage_size, headers_mmap, row_ids_mmap, blocks_mmap) =
-            CompressedMmapManager::write_mmap_files(directory, segment_id, compressed_inv_index_ram)?;
+    /// View of the posting of `header_obj` without its bytes, they are read later through the posting cache.
+    fn view_without_bytes(header_obj: &CompressedPostingListHeader) -> CompressedPostingListView<'static, TW> {
+        CompressedPostingListView::new(
+            &[],
+            CompressedBlocks::default(),
+            header_obj.compressed_block_type,
+            header_obj.row_id_codec,
+            header_obj.quantized_params,
+            header_obj.row_ids_count,
+            header_obj.max_row_id,
+        )
+        .with_weight_bounds(header_obj.min_weight, header_obj.max_weight)
+    }
 
-        // TODO: Refine pathBuf.
-        let meta_file_path = CompressedMmapManager::get_file_path(&directory, segment_id, CompressedInvertedIndexMmapConfig::meta_file_name);
+    /// Store inverted-index-ram into a single-file segment.
+    pub fn convert_and_save(compressed_inv_index_ram: &CompressedInvertedIndexRam<TW>, directory: &PathBuf, segment_id: Option<&str>) -> crate::Result<Self> {
+        Self::convert_and_save_with_row_id_map(compressed_inv_index_ram, directory, segment_id, None)
+    }
 
+    /// Same as `convert_and_save`, postings of a reordered ram index store internal row ids mapped by `row_id_map`.
+    pub fn convert_and_save_with_row_id_map(
+        compressed_inv_index_ram: &CompressedInvertedIndexRam<TW>,
+        directory: &PathBuf,
+        segment_id: Option<&str>,
+        row_id_map: Option<&[RowId]>,
+    ) -> crate::Result<Self> {
         let meta: CompressedMmapInvertedIndexMeta = CompressedMmapInvertedIndexMeta {
             inverted_index_meta: InvertedIndexMeta::new(
                 compressed_inv_index_ram.size(),
@@ -193,17 +295,37 @@ impl<OW: QuantizedWeight, TW: QuantizedWeight> CompressedInvertedIndexMmap<OW, T
                 compressed_inv_index_ram.metrics().max_dim_id,
                 (TW::weight_type() == WeightType::WeightU8) && (OW::weight_type() != TW::weight_type()),
                 compressed_inv_index_ram.element_type(),
-                Version::compressed_mmap(Revision::V1),
-            ),
-            row_ids_storage_size: total_row_ids_storage_size as u64,
-            headers_storage_size: total_headers_storage_size as u64,
-            blocks_storage_size: total_blocks_storage_size as u64,
-            total_blocks_count: total_blocks_count as u64,
+                Version::compressed_mmap(Revision::V3),
+            )
+            .with_row_id_base(compressed_inv_index_ram.row_id_base()),
+            row_ids_storage_size: 0,
+            headers_storage_size: 0,
+            blocks_storage_size: 0,
+            total_blocks_count: 0,
+            u4_weights: compressed_inv_index_ram.u4_weights(),
         };
 
-        atomic_save_json(&meta_file_path, &meta)?;
+        let (meta, container) = CompressedMmapManager::write_segment(directory, segment_id, compressed_inv_index_ram, meta, row_id_map)?;
+
+        Ok(Self::from_container(directory.clone(), &container, meta)?)
+    }
 
-        Ok(Self { path: directory.clone(), headers_mmap, row_ids_mmap, blocks_mmap, meta, _ow: PhantomData, _tw: PhantomData })
+    /// Build index over the sections of an opened container.
+    pub(super) fn from_container(path: PathBuf, container: &SegmentContainer, meta: CompressedMmapInvertedIndexMeta) -> std::io::Result<Self> {
+        Ok(Self {
+            path,
+            headers_mmap: container.section(SectionKind::Headers)?,
+            row_ids_mmap: container.section(SectionKind::RowIds)?,
+            blocks_mmap: container.section(SectionKind::Blocks)?,
+            dim_directory: container.optional_section(SectionKind::DimDirectory),
+            row_id_map: container.optional_section(SectionKind::RowIdMap),
+            meta,
+            layout: SegmentLayout::SingleFile,
+            segment_key: next_segment_key(),
+            posting_reader: None,
+            _ow: PhantomData,
+            _tw: PhantomData,
+        })
     }
 
     /// load without segment name.
@@ -213,31 +335,55 @@ impl<OW: QuantizedWeight, TW: QuantizedWeight> CompressedInvertedIndexMmap<OW, T
 
     /// load with given segment name.
     pub fn load_under_segment(path: PathBuf, segment_id: Option<&str>) -> std::io::Result<Self> {
+        Self::load_with_policy(path, segment_id, LoadPolicy::Normal)
+    }
+
+    /// load with given segment name and load policy, segments written before the container format are still readable.
+    pub fn load_with_policy(path: PathBuf, segment_id: Option<&str>, load_policy: LoadPolicy) -> std::io::Result<Self> {
+        let container_file_path = CompressedMmapManager::get_container_file_path(&path, segment_id);
+        if container_file_path.exists() {
+            let container = SegmentContainer::open_with_policy(&container_file_path, load_policy)?;
+            let meta: CompressedMmapInvertedIndexMeta = container.read_meta()?;
+            let index = Self::from_container(path, &container, meta)?.check_headers()?;
+            return index.with_load_policy(&container_file_path, &container_file_path, load_policy);
+        }
+
         // init directory
         let (headers_mmap_file_path, row_ids_mmap_file_path, blocks_mmap_file_path) = CompressedMmapManager::get_all_files(&path.clone(), segment_id);
-        let meta_file_path = CompressedMmapManager::get_file_path(&path.clone(), segment_id, CompressedInvertedIndexMmapConfig::meta_file_name);
+        let meta_file_path = CompressedMmapManager::get_index_meta_file_path(&path, segment_id);
 
         // read meta file data.
         let meta: CompressedMmapInvertedIndexMeta = read_json(&meta_file_path)?;
         // read inverted index data.
-        let headers_mmap = open_read_mmap(headers_mmap_file_path.as_ref())?;
-        let row_ids_mmap = open_read_mmap(row_ids_mmap_file_path.as_ref())?;
-        let blocks_mmap = open_read_mmap(blocks_mmap_file_path.as_ref())?;
-
-        // TODO: Compare different advice's influence on QPS.
-        madvise::madvise(&headers_mmap, madvise::Advice::Normal)?;
-        madvise::madvise(&row_ids_mmap, madvise::Advice::Normal)?;
-        madvise::madvise(&blocks_mmap, madvise::Advice::Normal)?;
+        let headers_mmap = open_read_mmap_with_policy(headers_mmap_file_path.as_ref(), load_policy)?;
+        let row_ids_mmap = open_read_mmap_with_policy(row_ids_mmap_file_path.as_ref(), load_policy)?;
+        let blocks_mmap = open_read_mmap_with_policy(blocks_mmap_file_path.as_ref(), load_policy)?;
 
-        Ok(Self {
+        let index = Self {
             path: path.clone(),
-            headers_mmap: Arc::new(headers_mmap),
-            row_ids_mmap: Arc::new(row_ids_mmap),
-            blocks_mmap: Arc::new(blocks_mmap),
+            headers_mmap: MmapSection::from(headers_mmap),
+            row_ids_mmap: MmapSection::from(row_ids_mmap),
+            blocks_mmap: MmapSection::from(blocks_mmap),
+            dim_directory: None,
+            row_id_map: None,
             meta,
+            layout: SegmentLayout::MultiFile,
+            segment_key: next_segment_key(),
+            posting_reader: None,
             _ow: PhantomData,
             _tw: PhantomData,
-        })
+        }
+        .check_headers()?;
+        index.with_load_policy(&row_ids_mmap_file_path, &blocks_mmap_file_path, load_policy)
+    }
+
+    /// Postings are read from the row ids and blocks files through the posting cache under `LoadPolicy::Pread`.
+    fn with_load_policy(mut self, row_ids_path: &Path, blocks_path: &Path, load_policy: LoadPolicy) -> std::io::Result<Self> {
+        if load_policy == LoadPolicy::Pread {
+            let posting_reader = PostingFileReader::open(self.segment_key, row_ids_path, self.row_ids_mmap.offset(), blocks_path, self.blocks_mmap.offset())?;
+            self.posting_reader = Some(Arc::new(posting_reader));
+        }
+        Ok(self)
     }
 }
 
@@ -305,3 +451,68 @@ impl<OW: QuantizedWeight, TW: QuantizedWeight> CompressedInvertedIndexMmap<OW, T
 //         assert!(inverted_index_mmap.get(&100).is_none());
 //     }
 // }
+
+#[cfg(all(test, feature = "unstable"))]
+mod bench {
+    use tempfile::TempDir;
+    use test::Bencher;
+
+    use super::*;
+    use crate::core::sparse_vector::SparseVector;
+    use crate::core::{ElementType, InvertedIndexRamBuilder, InvertedIndexRamBuilderTrait, SegmentContainerWriter};
+
+    /// Segments opened per iteration, like an index reader opening every segment of an index.
+    const SEGMENTS_COUNT: usize = 64;
+
+    fn segment_id(segment: usize) -> String {
+        format!("segment_{}", segment)
+    }
+
+    /// Small segments, so the time is spent opening them rather than faulting in postings.
+    fn write_segments(json_meta: bool) -> TempDir {
+        let dir = tempfile::tempdir().unwrap();
+        for segment in 0..SEGMENTS_COUNT {
+            let mut builder = InvertedIndexRamBuilder::<f32, f32>::new(ElementType::SIMPLE);
+            for row_id in 0..1000u32 {
+                builder.add(row_id, SparseVector { indices: (0..16).map(|i| (row_id * 31 + i * 97) % 2000).collect(), values: vec![0.5; 16] }).unwrap();
+            }
+            let id = segment_id(segment);
+            let index = CompressedInvertedIndexMmap::<f32, f32>::from_ram_index(Cow::Owned(builder.build().unwrap()), dir.path().to_path_buf(), Some(&id)).unwrap();
+            if json_meta {
+                // Same container with the meta section still in json, as written before the binary meta codec.
+                assert!(index.dim_directory.is_none() && index.row_id_map.is_none());
+                let meta_bytes = serde_json::to_vec(&index.meta).unwrap();
+                let (headers, row_ids, blocks) = (index.headers_mmap.to_vec(), index.row_ids_mmap.to_vec(), index.blocks_mmap.to_vec());
+                drop(index);
+                let path = CompressedMmapManager::get_container_file_path(&dir.path().to_path_buf(), Some(&id));
+                let sections =
+                    [(SectionKind::Meta, meta_bytes.len()), (SectionKind::Headers, headers.len()), (SectionKind::RowIds, row_ids.len()), (SectionKind::Blocks, blocks.len())];
+                let mut writer = SegmentContainerWriter::create(&path, &sections).unwrap();
+                for (buffer, bytes) in writer.sections_mut().into_iter().zip([&meta_bytes, &headers, &row_ids, &blocks]) {
+                    buffer.copy_from_slice(bytes);
+                }
+                writer.finish().unwrap();
+            }
+        }
+        dir
+    }
+
+    fn open_segments(b: &mut Bencher, json_meta: bool) {
+        let dir = write_segments(json_meta);
+        b.iter(|| {
+            for segment in 0..SEGMENTS_COUNT {
+                CompressedInvertedIndexMmap::<f32, f32>::open_with_policy(dir.path(), Some(&segment_id(segment)), LoadPolicy::Normal).unwrap();
+            }
+        });
+    }
+
+    #[bench]
+    fn bench_open_segments_binary_meta(b: &mut Bencher) {
+        open_segments(b, false);
+    }
+
+    #[bench]
+    fn bench_open_segments_json_meta(b: &mut Bencher) {
+        open_segments(b, true);
+    }
+}
@@ -1,6 +1,6 @@
 use crate::core::{
-    COMPRESSED_INVERTED_INDEX_HEADERS_SUFFIX, COMPRESSED_INVERTED_INDEX_POSTING_BLOCKS_SUFFIX, COMPRESSED_INVERTED_INDEX_ROW_IDS_SUFFIX, INVERTED_INDEX_FILE_NAME,
-    INVERTED_INDEX_META_FILE_SUFFIX,
+    COMPRESSED_INVERTED_INDEX_HEADERS_SUFFIX, COMPRESSED_INVERTED_INDEX_POSTING_BLOCKS_SUFFIX, COMPRESSED_INVERTED_INDEX_ROW_IDS_SUFFIX, INVERTED_INDEX_CONTAINER_SUFFIX,
+    INVERTED_INDEX_FILE_NAME, INVERTED_INDEX_META_FILE_SUFFIX,
 };
 
 pub struct CompressedInvertedIndexMmapConfig;
@@ -28,6 +28,10 @@ impl CompressedInvertedIndexMmapConfig {
     pub fn meta_file_name(segment_id: Option<&str>) -> String {
         format!("{}{}", segment_id.unwrap_or(INVERTED_INDEX_FILE_NAME), INVERTED_INDEX_META_FILE_SUFFIX)
     }
+    pub fn container_file_name(segment_id: Option<&str>) -> String {
+        format!("{}{}", segment_id.unwrap_or(INVERTED_INDEX_FILE_NAME), INVERTED_INDEX_CONTAINER_SUFFIX)
+    }
+    /// Files of the legacy multi-file layout.
     pub fn get_all_files(segment_id: Option<&str>) -> Vec<String> {
         vec![Self::headers_file_name(segment_id), Self::row_ids_file_name(segment_id), Self::blocks_file_name(segment_id), Self::meta_file_name(segment_id)]
     }
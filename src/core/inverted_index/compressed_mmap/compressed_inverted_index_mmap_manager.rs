@@ -1,19 +1,20 @@
 use std::{
     fs, io,
     path::{Path, PathBuf},
-    sync::Arc,
 };
 
-use memmap2::{Mmap, MmapMut};
+use memmap2::MmapMut;
+use rayon::prelude::*;
 
 use crate::core::{
-    create_and_ensure_length,
+    create_and_ensure_length, install_in_flush_pool,
     madvise::{self, Advice},
-    open_write_mmap, transmute_to_u8, transmute_to_u8_slice, CompressedBlockType, CompressedInvertedIndexRam, ExtendedCompressedPostingBlock, InvertedIndexRamAccess,
-    QuantizedWeight, SimpleCompressedPostingBlock,
+    open_write_mmap, transmute_to_u8_slice, CompressedBlockType, CompressedInvertedIndexRam, DimSlots, InvertedIndexRamAccess, QuantizedWeight, SectionKind, SegmentContainer,
+    SegmentContainerWriter, SegmentMetaCodec,
 };
+use crate::RowId;
 
-use super::{CompressedInvertedIndexMmapConfig, CompressedPostingListHeader, COMPRESSED_POSTING_HEADER_SIZE};
+use super::{CompressedInvertedIndexMmapConfig, CompressedMmapInvertedIndexMeta, CompressedPostingListHeader, COMPRESSED_POSTING_HEADER_SIZE};
 
 pub struct CompressedMmapManager;
 
@@ -39,12 +40,6 @@ impl CompressedMmapManager {
         (row_ids_mmap_file_path, blocks_mmap_file_path)
     }
 
-    pub(super) fn get_row_ids_and_blocks_mmap_files(directory: &PathBuf, segment_id: Option<&str>) -> (PathBuf, PathBuf) {
-        let row_ids_mmap_file_path = Self::get_file_path(directory, segment_id, CompressedInvertedIndexMmapConfig::row_ids_file_name);
-        let blocks_mmap_file_path = Self::get_file_path(directory, segment_id, CompressedInvertedIndexMmapConfig::blocks_file_name);
-        (row_ids_mmap_file_path, blocks_mmap_file_path)
-    }
-
     pub(super) fn remove_temp_mmap_file(directory: &PathBuf, segment_id: Option<&str>) {
         let row_ids_mmap_file_path = Self::get_file_path(directory, segment_id, CompressedInvertedIndexMmapConfig::row_ids_temp_file_name);
         let blocks_mmap_file_path = Self::get_file_path(directory, segment_id, CompressedInvertedIndexMmapConfig::blocks_temp_file_name);
@@ -65,62 +60,108 @@ impl CompressedMmapManager {
         return Ok(mmap);
     }
 
-    pub fn write_mmap_files<TW: QuantizedWeight>(
+    pub(super) fn get_container_file_path(directory: &PathBuf, segment_id: Option<&str>) -> PathBuf {
+        Self::get_file_path(directory, segment_id, CompressedInvertedIndexMmapConfig::container_file_name)
+    }
+
+    /// Write meta, headers, row_ids and blocks as sections of a single container file.
+    /// Storage sizes and blocks count in `meta` are filled here, a sparse ram index also gets a dim directory section
+    /// and a reordered one a row id map section.
+    pub fn write_segment<TW: QuantizedWeight>(
         directory: &PathBuf,
         segment_id: Option<&str>,
         compressed_inv_index_ram: &CompressedInvertedIndexRam<TW>,
-    ) -> crate::Result<(usize, usize, usize, usize, Arc<Mmap>, Arc<Mmap>, Arc<Mmap>)> {
+        mut meta: CompressedMmapInvertedIndexMeta,
+        row_id_map: Option<&[RowId]>,
+    ) -> crate::Result<(CompressedMmapInvertedIndexMeta, SegmentContainer)> {
         // compute posting_offsets and elements size.
-        let total_headers_storage_size: usize = compressed_inv_index_ram.size() * COMPRESSED_POSTING_HEADER_SIZE;
-
-        let (total_row_ids_storage_size, total_blocks_storage_size): (usize, usize) = compressed_inv_index_ram.postings().iter().fold((0, 0), |(acc_rows, acc_blocks), posting| {
-            let posting_view = posting.view();
-            (acc_rows + posting_view.row_ids_storage_size(), acc_blocks + posting_view.blocks_storage_size())
-        });
-
-        // 初始化 3 个文件路径.
-        let (headers_mmap_file_path, row_ids_mmap_file_path, blocks_mmap_file_path) = Self::get_all_files(directory, segment_id);
-
-        // 创建 3 个 mmap 文件.
-        let mut headers_mmap = Self::create_mmap_file(headers_mmap_file_path.as_ref(), total_headers_storage_size as u64, madvise::Advice::Normal)?;
-        let mut row_ids_mmap = Self::create_mmap_file(row_ids_mmap_file_path.as_ref(), total_row_ids_storage_size as u64, madvise::Advice::Normal)?;
-        let mut blocks_mmap = Self::create_mmap_file(blocks_mmap_file_path.as_ref(), total_blocks_storage_size as u64, madvise::Advice::Normal)?;
-
-        let total_blocks_count = Self::save_data_to_mmap::<TW>(&mut headers_mmap, &mut row_ids_mmap, &mut blocks_mmap, compressed_inv_index_ram);
-
-        if total_headers_storage_size > 0 {
-            headers_mmap.flush()?;
+        let dim_slots = DimSlots::new(&compressed_inv_index_ram.dim_ids(), compressed_inv_index_ram.is_sparse());
+        let total_headers_storage_size: usize = dim_slots.slots_count() * COMPRESSED_POSTING_HEADER_SIZE;
+
+        let (total_row_ids_storage_size, total_blocks_storage_size, total_blocks_count): (usize, usize, usize) =
+            compressed_inv_index_ram.postings().iter().fold((0, 0, 0), |(acc_rows, acc_blocks, acc_count), posting| {
+                let posting_view = posting.view();
+                (acc_rows + posting_view.row_ids_storage_size(), acc_blocks + posting_view.blocks_storage_size(), acc_count + posting_view.blocks.len())
+            });
+
+        meta.headers_storage_size = total_headers_storage_size as u64;
+        meta.row_ids_storage_size = total_row_ids_storage_size as u64;
+        meta.blocks_storage_size = total_blocks_storage_size as u64;
+        meta.total_blocks_count = total_blocks_count as u64;
+        let meta_bytes = meta.to_bytes();
+
+        let container_path = Self::get_container_file_path(directory, segment_id);
+        let mut sections = vec![
+            (SectionKind::Meta, meta_bytes.len()),
+            (SectionKind::Headers, total_headers_storage_size),
+            (SectionKind::RowIds, total_row_ids_storage_size),
+            (SectionKind::Blocks, total_blocks_storage_size),
+        ];
+        if let Some(directory_keys) = &dim_slots.directory {
+            sections.push((SectionKind::DimDirectory, transmute_to_u8_slice(directory_keys).len()));
         }
-        if total_row_ids_storage_size > 0 {
-            row_ids_mmap.flush()?;
+        if let Some(row_id_map) = row_id_map {
+            sections.push((SectionKind::RowIdMap, transmute_to_u8_slice(row_id_map).len()));
         }
-        if total_blocks_storage_size > 0 {
-            blocks_mmap.flush()?;
+        let mut writer = SegmentContainerWriter::create(&container_path, &sections)?;
+        {
+            let mut buffers = writer.sections_mut().into_iter();
+            buffers.next().unwrap().copy_from_slice(&meta_bytes);
+            let (headers_buffer, row_ids_buffer, blocks_buffer) = (buffers.next().unwrap(), buffers.next().unwrap(), buffers.next().unwrap());
+            Self::save_data_to_mmap::<TW>(headers_buffer, row_ids_buffer, blocks_buffer, compressed_inv_index_ram, &dim_slots)?;
+            if let Some(directory_keys) = &dim_slots.directory {
+                buffers.next().unwrap().copy_from_slice(transmute_to_u8_slice(directory_keys));
+            }
+            if let Some(row_id_map) = row_id_map {
+                buffers.next().unwrap().copy_from_slice(transmute_to_u8_slice(row_id_map));
+            }
         }
 
-        return Ok((
-            total_blocks_count,
-            total_row_ids_storage_size,
-            total_blocks_storage_size,
-            total_headers_storage_size,
-            Arc::new(headers_mmap.make_read_only()?),
-            Arc::new(row_ids_mmap.make_read_only()?),
-            Arc::new(blocks_mmap.make_read_only()?),
-        ));
+        Ok((meta, writer.finish()?))
     }
 
+    /// Postings of a ram index are in dim order, `dim_slots` gives the header slot of each one.
     fn save_data_to_mmap<TW: QuantizedWeight>(
-        headers_mmap: &mut MmapMut,
-        row_ids_mmap: &mut MmapMut,
-        blocks_mmap: &mut MmapMut,
+        headers_mmap: &mut [u8],
+        row_ids_mmap: &mut [u8],
+        blocks_mmap: &mut [u8],
         compressed_inv_index_ram: &CompressedInvertedIndexRam<TW>,
-    ) -> usize {
+        dim_slots: &DimSlots,
+    ) -> io::Result<()> {
+        let postings = compressed_inv_index_ram.postings();
+
+        // Offsets of a posting are the sizes of those before it, so each posting gets a disjoint slice of the sections
+        // and row ids and blocks are written in parallel.
+        let mut row_ids_slices = Vec::with_capacity(postings.len());
+        let mut blocks_slices = Vec::with_capacity(postings.len());
+        let (mut row_ids_rest, mut blocks_rest) = (row_ids_mmap, blocks_mmap);
+        for compressed_posting in postings {
+            let compressed_posting_view = compressed_posting.view();
+            let (row_ids_slice, rest) = std::mem::take(&mut row_ids_rest).split_at_mut(compressed_posting_view.row_ids_storage_size());
+            row_ids_slices.push(row_ids_slice);
+            row_ids_rest = rest;
+            let (blocks_slice, rest) = std::mem::take(&mut blocks_rest).split_at_mut(compressed_posting_view.blocks_storage_size());
+            blocks_slices.push(blocks_slice);
+            blocks_rest = rest;
+        }
+        let weight_bounds: Vec<(f32, f32)> = install_in_flush_pool(|| {
+            postings
+                .par_iter()
+                .zip(row_ids_slices.into_par_iter())
+                .zip(blocks_slices.into_par_iter())
+                .map(|((compressed_posting, row_ids_slice), blocks_slice)| {
+                    let compressed_posting_view = compressed_posting.view();
+                    row_ids_slice.copy_from_slice(&compressed_posting_view.row_ids_compressed);
+                    compressed_posting_view.blocks.write(blocks_slice);
+                    compressed_posting_view.compute_weight_bounds()
+                })
+                .collect()
+        });
+
         let mut cur_row_ids_storage_size = 0;
         let mut cur_blocks_storage_size = 0;
-        let mut total_blocks_count = 0;
-        for (dim_id, compressed_posting) in compressed_inv_index_ram.postings().iter().enumerate() {
+        for ((&(_, slot), compressed_posting), &(min_weight, max_weight)) in dim_slots.slots.iter().zip(postings.iter()).zip(weight_bounds.iter()) {
             let compressed_posting_view = compressed_posting.view();
-            // Step 1.1: Generate header
             let header_obj = CompressedPostingListHeader {
                 compressed_row_ids_start: cur_row_ids_storage_size,
                 compressed_row_ids_end: cur_row_ids_storage_size + compressed_posting_view.row_ids_storage_size(),
@@ -131,39 +172,21 @@ impl CompressedMmapManager {
                 quantized_params: compressed_posting_view.quantization_params,
                 row_ids_count: compressed_posting_view.row_ids_count,
                 max_row_id: compressed_posting_view.max_row_id,
+                row_id_codec: compressed_posting_view.row_id_codec,
+                packed_weights: compressed_posting_view.blocks.is_packed(),
+                block_quantized: compressed_posting_view.blocks.is_block_quantized(),
+                u4_weights: compressed_posting_view.blocks.is_u4(),
                 compressed_block_type: CompressedBlockType::from(compressed_inv_index_ram.element_type()),
+                min_weight,
+                max_weight,
             };
 
-            // Step 1.2: Save the offset object to mmap.
-            let header_bytes = transmute_to_u8(&header_obj);
-            let header_offset_left = dim_id * COMPRESSED_POSTING_HEADER_SIZE;
-            let header_offset_right = (dim_id + 1) * COMPRESSED_POSTING_HEADER_SIZE;
-            headers_mmap[header_offset_left..header_offset_right].copy_from_slice(header_bytes);
-
-            // Step 2: Store row_ids
-            row_ids_mmap[cur_row_ids_storage_size..header_obj.compressed_row_ids_end].copy_from_slice(&compressed_posting_view.row_ids_compressed);
-
-            // Step 3: Store posting blocks
-            match compressed_posting_view.compressed_block_type {
-                CompressedBlockType::Simple => {
-                    let blocks: &[SimpleCompressedPostingBlock<TW>] = compressed_posting_view.simple_blocks;
-                    let block_bytes = transmute_to_u8_slice(blocks);
-                    blocks_mmap[cur_blocks_storage_size..header_obj.compressed_blocks_end].copy_from_slice(block_bytes);
-                    total_blocks_count += compressed_posting_view.simple_blocks.len();
-                }
-                CompressedBlockType::Extended => {
-                    let blocks: &[ExtendedCompressedPostingBlock<TW>] = compressed_posting_view.extended_blocks;
-                    let block_bytes = transmute_to_u8_slice(blocks);
-                    blocks_mmap[cur_blocks_storage_size..header_obj.compressed_blocks_end].copy_from_slice(block_bytes);
-                    total_blocks_count += compressed_posting_view.extended_blocks.len();
-                }
-            }
+            header_obj.write(headers_mmap, slot)?;
 
             // increase offsets.
             cur_row_ids_storage_size = header_obj.compressed_row_ids_end;
             cur_blocks_storage_size = header_obj.compressed_blocks_end;
         }
-
-        return total_blocks_count;
+        Ok(())
     }
 }
@@ -1,19 +1,18 @@
 use std::{
+    borrow::Cow,
     cmp::{max, min},
-    marker::PhantomData,
     path::PathBuf,
-    sync::Arc,
 };
 
 use log::{debug, trace};
 
 use crate::{
     core::{
-        atomic_save_json,
+        bisection_order,
         inverted_index::common::{InvertedIndexMeta, Revision, Version},
-        madvise, transmute_from_u8, transmute_to_u8, transmute_to_u8_slice, CompressedBlockType, CompressedPostingListIterator, CompressedPostingListMerger,
-        CompressedPostingListView, DimId, ElementType, ExtendedCompressedPostingBlock, InvertedIndexMmapAccess, PostingListIterAccess, QuantizedWeight,
-        SimpleCompressedPostingBlock, WeightType,
+        madvise, transmute_to_u8_slice, use_dim_directory, CompressedInvertedIndexRam, CompressedPostingListIterator, CompressedPostingListMerger, CompressedPostingListView,
+        DimId, DimSlots, ElementType, InvertedIndexError, InvertedIndexMmapAccess, InvertedIndexRamBuilder, InvertedIndexRamBuilderTrait, PostingListIter, PostingListIterAccess,
+        QuantizedWeight, SectionKind, SegmentContainerWriter, SegmentMetaCodec, WeightType,
     },
     thread_name, RowId,
 };
@@ -26,25 +25,41 @@ use super::{
 pub struct CompressedInvertedIndexMmapMerger<'a, OW: QuantizedWeight, TW: QuantizedWeight> {
     compressed_inverted_index_mmaps: &'a Vec<&'a CompressedInvertedIndexMmap<OW, TW>>,
     element_type: ElementType,
+    reorder_rows: bool,
 }
 
 impl<'a, OW: QuantizedWeight, TW: QuantizedWeight> CompressedInvertedIndexMmapMerger<'a, OW, TW> {
     pub fn new(compressed_inverted_index_mmaps: &'a Vec<&'a CompressedInvertedIndexMmap<OW, TW>>, element_type: ElementType) -> Self {
-        Self { compressed_inverted_index_mmaps, element_type }
+        Self { compressed_inverted_index_mmaps, element_type, reorder_rows: false }
     }
 
-    fn get_compressed_posting_iterators_with_dim(&self, dim_id: DimId) -> Vec<CompressedPostingListIterator<'_, OW, TW>> {
+    /// Reorder rows of the merged segment by recursive graph bisection.
+    pub fn with_row_reorder(mut self, reorder_rows: bool) -> Self {
+        self.reorder_rows = reorder_rows;
+        self
+    }
+
+    /// Iterators over postings of `dim_id`, with the row id offset of their index relative to `row_id_base`.
+    fn get_compressed_posting_iterators_with_dim(&self, dim_id: DimId, row_id_base: RowId) -> (Vec<CompressedPostingListIterator<'_, OW, TW>>, Vec<RowId>) {
         let mut compressed_postings_iterators = vec![];
+        let mut row_id_offsets = vec![];
         for &mmap_index in self.compressed_inverted_index_mmaps {
             let iter_opt = mmap_index.iter(&dim_id);
             if iter_opt.is_some() {
                 compressed_postings_iterators.push(iter_opt.unwrap());
+                // Wraps below zero for indexes written before row id bases, their stored row ids are large enough.
+                row_id_offsets.push(mmap_index.meta.inverted_index_meta.row_id_base.wrapping_sub(row_id_base));
             }
         }
-        compressed_postings_iterators
+        (compressed_postings_iterators, row_id_offsets)
     }
 
     pub fn merge(&self, directory: &PathBuf, segment_id: Option<&str>) -> crate::Result<CompressedInvertedIndexMmap<OW, TW>> {
+        // Postings of reordered inputs can't be concatenated as they are, their row ids are internal.
+        if self.reorder_rows || self.compressed_inverted_index_mmaps.iter().any(|inverted_index| inverted_index.row_id_map.is_some()) {
+            return self.merge_rebuilt(directory, segment_id);
+        }
+
         // Record all the metrics of the inverted index that are pending to be merged.
         let mut min_dim_id = 0;
         let mut max_dim_id = 0;
@@ -59,24 +74,45 @@ impl<'a, OW: QuantizedWeight, TW: QuantizedWeight> CompressedInvertedIndexMmapMe
             let metrics = inverted_index.metrics();
             min_dim_id = min(min_dim_id, metrics.min_dim_id);
             max_dim_id = max(max_dim_id, metrics.max_dim_id);
-            min_row_id = min(min_row_id, metrics.min_row_id);
-            max_row_id = max(max_row_id, metrics.max_row_id);
+            // Empty inputs have no row id range.
+            if metrics.min_row_id <= metrics.max_row_id {
+                let row_id_base = inverted_index.meta.inverted_index_meta.row_id_base;
+                let overflow =
+                    || InvertedIndexError::InvalidParameter(format!("[CompressedInvertedIndexMmapMerger] row ids of a segment overflow with row id base {}.", row_id_base));
+                min_row_id = min(min_row_id, metrics.min_row_id.checked_add(row_id_base).ok_or_else(overflow)?);
+                max_row_id = max(max_row_id, metrics.max_row_id.checked_add(row_id_base).ok_or_else(overflow)?);
+            }
 
             // TODO: refine approximate storage size, currently it's performance is poor.
             total_vector_counts += metrics.vector_count;
             approximate_row_ids_storage_size += inverted_index.meta.row_ids_storage_size;
             approximate_blocks_storage_size += inverted_index.meta.blocks_storage_size;
         }
-        let total_headers_storage_size = (max_dim_id - min_dim_id + 1) as u64 * COMPRESSED_POSTING_HEADER_SIZE as u64;
+        // The merged segment stores row ids relative to the smallest one.
+        let row_id_base = if min_row_id <= max_row_id { min_row_id } else { 0 };
+        // Segments written with `u4` weights keep them after merging.
+        let u4_weights = self.compressed_inverted_index_mmaps.iter().any(|inverted_index| inverted_index.meta.u4_weights);
+        // Inputs quantized per posting gain a 8 bytes param for each 24 bytes block meta after merging.
+        if self.element_type == ElementType::SIMPLE && TW::weight_type() == WeightType::WeightU8 && OW::weight_type() != TW::weight_type() {
+            approximate_blocks_storage_size += approximate_blocks_storage_size / 3;
+        }
 
-        // Init headers file path.
-        let (headers_mmap_file_path, _, _) = CompressedMmapManager::get_all_files(&directory.clone().to_path_buf(), segment_id);
+        // Only dims stored by some index are merged, the result is sparse when they are few and far apart.
+        let mut dim_ids: Vec<DimId> = self.compressed_inverted_index_mmaps.iter().flat_map(|inverted_index| inverted_index.dim_ids()).collect();
+        dim_ids.sort_unstable();
+        dim_ids.dedup();
+        let with_directory = dim_ids.last().map_or(false, |&last_dim_id| use_dim_directory(dim_ids.len(), last_dim_id));
+        let dim_slots = DimSlots::new(&dim_ids, with_directory);
+
+        let total_headers_storage_size = dim_slots.slots_count() as u64 * COMPRESSED_POSTING_HEADER_SIZE as u64;
+
+        // Headers are small, keep them in memory until the container is written.
+        let mut headers_storage: Vec<u8> = vec![0; total_headers_storage_size as usize];
 
         // Init two temporary mmap file path with given approximate storage size.
         let (row_ids_mmap_temp_path, blocks_mmap_temp_path) = CompressedMmapManager::get_temp_row_ids_and_blocks_mmap_files(&directory.clone(), segment_id);
 
         // Create mmap files.
-        let mut headers_mmap = CompressedMmapManager::create_mmap_file(headers_mmap_file_path.as_ref(), total_headers_storage_size as u64, madvise::Advice::Normal)?;
         let mut row_ids_temp_mmap = CompressedMmapManager::create_mmap_file(row_ids_mmap_temp_path.as_ref(), approximate_row_ids_storage_size as u64, madvise::Advice::Normal)?;
         let mut blocks_temp_mmap = CompressedMmapManager::create_mmap_file(blocks_mmap_temp_path.as_ref(), approximate_blocks_storage_size as u64, madvise::Advice::Normal)?;
 
@@ -84,19 +120,20 @@ impl<'a, OW: QuantizedWeight, TW: QuantizedWeight> CompressedInvertedIndexMmapMe
         let mut true_blocks_storage_size = 0;
         let mut total_blocks_count = 0;
 
-        for dim_id in min_dim_id..(max_dim_id + 1) {
+        for &(dim_id, slot) in dim_slots.slots.iter() {
             // Merging all postings in current dim-id
             trace!("[{}]-[cmp-mmap-merger]-[dim-id:{}] loading a group of cmp-posting-iters.", thread_name!(), dim_id);
-            let mut compressed_posting_iterators: Vec<CompressedPostingListIterator<'_, OW, TW>> = self.get_compressed_posting_iterators_with_dim(dim_id);
+            let (mut compressed_posting_iterators, row_id_offsets) = self.get_compressed_posting_iterators_with_dim(dim_id, row_id_base);
 
             trace!("[{}]-[cmp-mmap-merger]-[dim-id:{}] merging a group of cmp-posting-iters.", thread_name!(), dim_id);
             // TODO Figure out life comment in here
             let (merged_compressed_posting, quantized_param) =
-                CompressedPostingListMerger::merge_posting_lists::<OW, TW>(&mut compressed_posting_iterators, self.element_type).expect("msg");
+                CompressedPostingListMerger::merge_shifted_posting_lists::<OW, TW>(&mut compressed_posting_iterators, &row_id_offsets, self.element_type, u4_weights).expect("msg");
             // `TW` actually means storage type in disk.
             let compressed_posting_view: CompressedPostingListView<'_, TW> = merged_compressed_posting.view();
 
             // Step 1.1: Generate header
+            let (min_weight, max_weight) = compressed_posting_view.compute_weight_bounds();
             let header_obj = CompressedPostingListHeader {
                 compressed_row_ids_start: true_row_ids_storage_size,
                 compressed_row_ids_end: true_row_ids_storage_size + compressed_posting_view.row_ids_storage_size(),
@@ -107,26 +144,27 @@ impl<'a, OW: QuantizedWeight, TW: QuantizedWeight> CompressedInvertedIndexMmapMe
                 quantized_params: quantized_param,
                 row_ids_count: compressed_posting_view.row_ids_count,
                 max_row_id: compressed_posting_view.max_row_id,
+                row_id_codec: compressed_posting_view.row_id_codec,
+                packed_weights: compressed_posting_view.blocks.is_packed(),
+                block_quantized: compressed_posting_view.blocks.is_block_quantized(),
+                u4_weights: compressed_posting_view.blocks.is_u4(),
                 compressed_block_type: compressed_posting_view.compressed_block_type,
+                min_weight,
+                max_weight,
             };
 
             trace!("[{}]-[cmp-mmap-merger]-[dim-id:{}] header-obj generated:{:?}", thread_name!(), dim_id, header_obj.clone());
 
             // Step 1.2: Save the offset object to mmap.
-            let header_bytes = transmute_to_u8(&header_obj);
-            let header_offset_left = (dim_id as usize) * COMPRESSED_POSTING_HEADER_SIZE;
-            let header_offset_right = (dim_id + 1) as usize * COMPRESSED_POSTING_HEADER_SIZE;
-
             trace!(
-                "[{}]-[cmp-mmap-merger]-[dim-id:{}] store header-obj, left:{}, right:{}, copy:{}, approximate_storage:{}",
+                "[{}]-[cmp-mmap-merger]-[dim-id:{}] store header-obj, slot:{}, copy:{}, approximate_storage:{}",
                 thread_name!(),
                 dim_id,
-                header_offset_left,
-                header_offset_right,
-                header_bytes.len(),
+                slot,
+                COMPRESSED_POSTING_HEADER_SIZE,
                 total_headers_storage_size
             );
-            headers_mmap[header_offset_left..header_offset_right].copy_from_slice(header_bytes);
+            header_obj.write(&mut headers_storage, slot)?;
 
             // Step 2: Store row_ids
             trace!(
@@ -142,29 +180,17 @@ impl<'a, OW: QuantizedWeight, TW: QuantizedWeight> CompressedInvertedIndexMmapMe
 
             // Step 3: Store posting blocks
             trace!(
-                "[{}]-[cmp-mmap-merger]-[dim-id:{}] store blocks, left:{}, right:{}, simple_blocks:{}, extended_blocks:{}, approximate_storage:{}",
+                "[{}]-[cmp-mmap-merger]-[dim-id:{}] store blocks, left:{}, right:{}, blocks:{}, weights_packed:{}, approximate_storage:{}",
                 thread_name!(),
                 dim_id,
                 header_obj.compressed_blocks_start,
                 header_obj.compressed_blocks_end,
-                compressed_posting_view.simple_blocks.len(),
-                compressed_posting_view.extended_blocks.len(),
+                compressed_posting_view.blocks.len(),
+                compressed_posting_view.blocks.is_packed(),
                 approximate_blocks_storage_size
             );
-            match compressed_posting_view.compressed_block_type {
-                CompressedBlockType::Simple => {
-                    let blocks: &[SimpleCompressedPostingBlock<TW>] = compressed_posting_view.simple_blocks;
-                    let block_bytes = transmute_to_u8_slice(blocks);
-                    blocks_temp_mmap[header_obj.compressed_blocks_start..header_obj.compressed_blocks_end].copy_from_slice(block_bytes);
-                    total_blocks_count += blocks.len();
-                }
-                CompressedBlockType::Extended => {
-                    let blocks: &[ExtendedCompressedPostingBlock<TW>] = compressed_posting_view.extended_blocks;
-                    let block_bytes = transmute_to_u8_slice(blocks);
-                    blocks_temp_mmap[header_obj.compressed_blocks_start..header_obj.compressed_blocks_end].copy_from_slice(block_bytes);
-                    total_blocks_count += blocks.len();
-                }
-            }
+            compressed_posting_view.blocks.write(&mut blocks_temp_mmap[header_obj.compressed_blocks_start..header_obj.compressed_blocks_end]);
+            total_blocks_count += compressed_posting_view.blocks.len();
 
             trace!("[{}]-[cmp-mmap-merger]-[dim-id:{}] merge has been finished.", thread_name!(), dim_id);
             // increase offsets.
@@ -172,69 +198,266 @@ impl<'a, OW: QuantizedWeight, TW: QuantizedWeight> CompressedInvertedIndexMmapMe
             true_blocks_storage_size += compressed_posting_view.blocks_storage_size();
         }
 
-        // TODO Do some research about the `flush` option, it may has a influence on memory usage.
-        if total_headers_storage_size > 0 {
-            headers_mmap.flush()?;
-        }
-        if true_row_ids_storage_size > 0 {
-            row_ids_temp_mmap.flush()?;
-        }
-        if true_blocks_storage_size > 0 {
-            blocks_temp_mmap.flush()?;
-        }
-
-        // Create final version mmap files with specific storage size.
-        let (row_ids_mmap_path, blocks_mmap_path) = CompressedMmapManager::get_row_ids_and_blocks_mmap_files(&directory.clone(), segment_id);
-        let mut row_ids_mmap = CompressedMmapManager::create_mmap_file(row_ids_mmap_path.as_ref(), true_row_ids_storage_size as u64, madvise::Advice::Normal)?;
-        let mut blocks_mmap = CompressedMmapManager::create_mmap_file(blocks_mmap_path.as_ref(), true_blocks_storage_size as u64, madvise::Advice::Normal)?;
-        debug!("[{}]-[cmp-mmap-merger] rewriting for final version cmp-mmap-index file.", thread_name!());
-        for dim_id in min_dim_id..(max_dim_id + 1) {
-            let header_start = dim_id as usize * COMPRESSED_POSTING_HEADER_SIZE;
-            let header_obj: CompressedPostingListHeader =
-                transmute_from_u8::<CompressedPostingListHeader>(&headers_mmap[header_start..(header_start + COMPRESSED_POSTING_HEADER_SIZE)]).clone();
-            let row_ids_compressed = &row_ids_temp_mmap[header_obj.compressed_row_ids_start..header_obj.compressed_row_ids_end];
-            row_ids_mmap[header_obj.compressed_row_ids_start..header_obj.compressed_row_ids_end].copy_from_slice(row_ids_compressed);
-            let blocks = &blocks_temp_mmap[header_obj.compressed_blocks_start..header_obj.compressed_blocks_end];
-            blocks_mmap[header_obj.compressed_blocks_start..header_obj.compressed_blocks_end].copy_from_slice(blocks);
-        }
-
-        if true_row_ids_storage_size > 0 {
-            row_ids_mmap.flush()?;
-        }
-        if true_blocks_storage_size > 0 {
-            blocks_mmap.flush()?;
-        }
-        CompressedMmapManager::remove_temp_mmap_file(&directory.clone(), segment_id);
-
-        debug!("[{}]-[cmp-mmap-merger] saving cmp-mmap-index meta file.", thread_name!());
+        debug!("[{}]-[cmp-mmap-merger] writing cmp-mmap-index container file.", thread_name!());
         let meta: CompressedMmapInvertedIndexMeta = CompressedMmapInvertedIndexMeta {
             inverted_index_meta: InvertedIndexMeta {
-                posting_count: (max_dim_id - min_dim_id + 1) as usize,
+                posting_count: dim_slots.slots_count(),
                 vector_count: total_vector_counts,
-                min_row_id,
-                max_row_id,
+                min_row_id: min_row_id - row_id_base,
+                max_row_id: max_row_id - row_id_base,
                 min_dim_id,
                 max_dim_id,
                 quantized: (TW::weight_type() == WeightType::WeightU8) && (OW::weight_type() != TW::weight_type()),
-                version: Version::compressed_mmap(Revision::V1),
+                version: Version::compressed_mmap(Revision::V3),
                 element_type: self.element_type,
+                row_id_base,
             },
             row_ids_storage_size: true_row_ids_storage_size as u64,
             total_blocks_count: total_blocks_count as u64,
             blocks_storage_size: true_blocks_storage_size as u64,
             headers_storage_size: total_headers_storage_size,
+            u4_weights,
         };
-        let meta_file_path = CompressedMmapManager::get_index_meta_file_path(&directory.clone(), segment_id);
-        atomic_save_json(&meta_file_path, &meta)?;
-
-        Ok(CompressedInvertedIndexMmap::<OW, TW> {
-            path: directory.clone(),
-            headers_mmap: Arc::new(headers_mmap.make_read_only()?),
-            row_ids_mmap: Arc::new(row_ids_mmap.make_read_only()?),
-            blocks_mmap: Arc::new(blocks_mmap.make_read_only()?),
-            meta,
-            _ow: PhantomData,
-            _tw: PhantomData,
-        })
+        let meta_bytes = meta.to_bytes();
+
+        // Row ids and blocks are contiguous from offset zero in the temporary files, copy their used prefix.
+        let container_file_path = CompressedMmapManager::get_container_file_path(&directory.clone(), segment_id);
+        let mut sections = vec![
+            (SectionKind::Meta, meta_bytes.len()),
+            (SectionKind::Headers, headers_storage.len()),
+            (SectionKind::RowIds, true_row_ids_storage_size),
+            (SectionKind::Blocks, true_blocks_storage_size),
+        ];
+        if let Some(directory_keys) = &dim_slots.directory {
+            sections.push((SectionKind::DimDirectory, transmute_to_u8_slice(directory_keys).len()));
+        }
+        let mut writer = SegmentContainerWriter::create(&container_file_path, &sections)?;
+        {
+            let mut buffers = writer.sections_mut().into_iter();
+            buffers.next().unwrap().copy_from_slice(&meta_bytes);
+            buffers.next().unwrap().copy_from_slice(&headers_storage);
+            buffers.next().unwrap().copy_from_slice(&row_ids_temp_mmap[..true_row_ids_storage_size]);
+            buffers.next().unwrap().copy_from_slice(&blocks_temp_mmap[..true_blocks_storage_size]);
+            if let Some(directory_keys) = &dim_slots.directory {
+                buffers.next().unwrap().copy_from_slice(transmute_to_u8_slice(directory_keys));
+            }
+        }
+        let container = writer.finish()?;
+
+        drop(row_ids_temp_mmap);
+        drop(blocks_temp_mmap);
+        CompressedMmapManager::remove_temp_mmap_file(&directory.clone(), segment_id);
+
+        Ok(CompressedInvertedIndexMmap::from_container(directory.clone(), &container, meta)?)
+    }
+
+    /// Restore every posting with external row ids, then build the merged segment again from ram.
+    /// Rows are reordered when enabled, postings then store internal row ids and the segment keeps the row id map.
+    /// All merged postings are held in memory, weights are quantized again.
+    fn merge_rebuilt(&self, directory: &PathBuf, segment_id: Option<&str>) -> crate::Result<CompressedInvertedIndexMmap<OW, TW>> {
+        let mut dim_ids: Vec<DimId> = self.compressed_inverted_index_mmaps.iter().flat_map(|inverted_index| inverted_index.dim_ids()).collect();
+        dim_ids.sort_unstable();
+        dim_ids.dedup();
+
+        let mut postings: Vec<(DimId, Vec<(RowId, f32)>)> = Vec::with_capacity(dim_ids.len());
+        for dim_id in dim_ids {
+            let mut elements: Vec<(RowId, f32)> = vec![];
+            for inverted_index in self.compressed_inverted_index_mmaps.iter() {
+                if let Some(mut iter) = inverted_index.iter(&dim_id) {
+                    iter.for_each_weight_till_row_id(RowId::MAX, |row_id, weight| elements.push((inverted_index.external_row_id(row_id), weight)));
+                }
+            }
+            if !elements.is_empty() {
+                postings.push((dim_id, elements));
+            }
+        }
+
+        // `external_row_ids[row]` is the external row id of local row `row`.
+        let mut external_row_ids: Vec<RowId> = postings.iter().flat_map(|(_, elements)| elements.iter().map(|&(row_id, _)| row_id)).collect();
+        external_row_ids.sort_unstable();
+        external_row_ids.dedup();
+        let local_row = |row_id: RowId| external_row_ids.binary_search(&row_id).unwrap() as RowId;
+
+        let row_id_map: Option<Vec<RowId>> = if self.reorder_rows {
+            debug!("[{}]-[cmp-mmap-merger] reordering {} rows of {} postings.", thread_name!(), external_row_ids.len(), postings.len());
+            let local_postings: Vec<Vec<u32>> = postings.iter().map(|(_, elements)| elements.iter().map(|&(row_id, _)| local_row(row_id)).collect()).collect();
+            let order = bisection_order(external_row_ids.len(), &local_postings);
+            let mut internal_row_ids = vec![0; order.len()];
+            for (internal_row_id, &row) in order.iter().enumerate() {
+                internal_row_ids[row as usize] = internal_row_id as RowId;
+            }
+            for (_, elements) in postings.iter_mut() {
+                for element in elements.iter_mut() {
+                    element.0 = internal_row_ids[local_row(element.0) as usize];
+                }
+            }
+            Some(order.iter().map(|&row| external_row_ids[row as usize]).collect())
+        } else {
+            None
+        };
+
+        let u4_weights = self.compressed_inverted_index_mmaps.iter().any(|inverted_index| inverted_index.meta.u4_weights);
+        let mut builder = InvertedIndexRamBuilder::<OW, TW>::new(self.element_type);
+        if u4_weights {
+            builder = builder.with_u4_weights();
+        }
+        for (dim_id, mut elements) in postings {
+            elements.sort_unstable_by_key(|&(row_id, _)| row_id);
+            builder.add_posting(dim_id, &elements)?;
+        }
+        builder.set_vector_count(self.compressed_inverted_index_mmaps.iter().map(|inverted_index| inverted_index.metrics().vector_count).sum());
+
+        let compressed_inverted_index_ram = CompressedInvertedIndexRam::<TW>::from_ram_index(Cow::Owned(builder.build()?), directory.clone(), segment_id)?;
+        CompressedInvertedIndexMmap::convert_and_save_with_row_id_map(&compressed_inverted_index_ram, directory, segment_id, row_id_map.as_deref())
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::core::{searcher::Searcher, GenericInvertedIndex, InvertedIndexMmapInit, InvertedIndexWrapper, SparseBitmap, SparseVector};
+    use rand::{rngs::StdRng, Rng, SeedableRng};
+    use tempfile::tempdir;
+
+    /// Rows fall into 4 topics of 8 dims each, topics are shuffled across row ids. Weights are unique per row and dim.
+    fn build_segment(directory: &PathBuf, segment_id: &str, rows: std::ops::Range<RowId>) -> CompressedInvertedIndexMmap<f32, f32> {
+        build_segment_with_dims(directory, segment_id, rows, |dim_id| dim_id)
+    }
+
+    /// Same rows as `build_segment`, with every dim id mapped by `dim_of`.
+    fn build_segment_with_dims(directory: &PathBuf, segment_id: &str, rows: std::ops::Range<RowId>, dim_of: fn(DimId) -> DimId) -> CompressedInvertedIndexMmap<f32, f32> {
+        let mut rng = StdRng::seed_from_u64(rows.start as u64 + 1);
+        let mut builder = InvertedIndexRamBuilder::<f32, f32>::new(ElementType::SIMPLE);
+        for row_id in rows {
+            let topic: DimId = rng.gen_range(0..4);
+            let mut dims: Vec<DimId> = (0..4).map(|_| topic * 8 + rng.gen_range(0..8)).collect();
+            dims.sort_unstable();
+            dims.dedup();
+            let mut elements: Vec<(DimId, f32)> = dims.iter().map(|&dim_id| (dim_of(dim_id), dim_id as f32 + row_id as f32 / 4096.0)).collect();
+            elements.sort_unstable_by_key(|&(dim_id, _)| dim_id);
+            let (indices, values) = elements.into_iter().unzip();
+            builder.add(row_id, SparseVector { indices, values }).unwrap();
+        }
+        CompressedInvertedIndexMmap::from_ram_index(Cow::Owned(builder.build().unwrap()), directory.clone(), Some(segment_id)).unwrap()
+    }
+
+    /// Spreads the 32 dims of `build_segment` over the whole dim id space, like hashed features.
+    fn hashed_dim(dim_id: DimId) -> DimId {
+        (dim_id + 1).wrapping_mul(0x9E37_79B1)
+    }
+
+    fn external_elements(index: &CompressedInvertedIndexMmap<f32, f32>, dim_id: DimId) -> Vec<(RowId, f32)> {
+        let mut elements = vec![];
+        if let Some(mut iter) = index.iter(&dim_id) {
+            iter.for_each_weight_till_row_id(RowId::MAX, |row_id, weight| elements.push((index.external_row_id(row_id), weight)));
+        }
+        elements.sort_unstable_by_key(|&(row_id, _)| row_id);
+        elements
+    }
+
+    #[test]
+    fn test_merge_with_row_reorder() {
+        let temp_dir = tempdir().unwrap();
+        let directory = temp_dir.path().to_path_buf();
+        let segments = vec![build_segment(&directory, "a", 0..1000), build_segment(&directory, "b", 1000..2000)];
+        let inputs: Vec<&CompressedInvertedIndexMmap<f32, f32>> = segments.iter().collect();
+        let plain = CompressedInvertedIndexMmapMerger::new(&inputs, ElementType::SIMPLE).merge(&directory, Some("plain")).unwrap();
+        let reordered = CompressedInvertedIndexMmapMerger::new(&inputs, ElementType::SIMPLE).with_row_reorder(true).merge(&directory, Some("reordered")).unwrap();
+
+        assert!(plain.row_id_map.is_none());
+        let mut external_row_ids: Vec<RowId> = (0..2000).map(|row_id| reordered.external_row_id(row_id)).collect();
+        external_row_ids.sort_unstable();
+        assert_eq!(external_row_ids, (0..2000).collect::<Vec<RowId>>());
+        assert_eq!(reordered.metrics().vector_count, 2000);
+        assert!(reordered.meta.row_ids_storage_size < plain.meta.row_ids_storage_size);
+        for dim_id in plain.dim_ids() {
+            assert_eq!(external_elements(&plain, dim_id), external_elements(&reordered, dim_id));
+        }
+
+        // Results and the bitmap use external row ids.
+        let query = SparseVector { indices: vec![1, 9, 17, 30], values: vec![1.0, 0.5, 2.0, 1.5] };
+        let sparse_bitmap = Some(SparseBitmap::from((0..2000).filter(|row_id| row_id % 3 != 0).collect::<Vec<RowId>>()));
+        for bitmap in [None, sparse_bitmap] {
+            let search = |index: &CompressedInvertedIndexMmap<f32, f32>| {
+                Searcher::new(GenericInvertedIndex::F32NoQuantized(InvertedIndexWrapper::CompressedInvertedIndex(index.clone()))).search(&query, &bitmap, 20).into_vec()
+            };
+            let (expected, actual) = (search(&plain), search(&reordered));
+            assert_eq!(expected.len(), 20);
+            assert_eq!(expected.iter().map(|e| e.row_id).collect::<Vec<_>>(), actual.iter().map(|e| e.row_id).collect::<Vec<_>>());
+        }
+    }
+
+    #[test]
+    fn test_merge_with_row_id_base() {
+        let temp_dir = tempdir().unwrap();
+        let directory = temp_dir.path().to_path_buf();
+        let segments = vec![build_segment(&directory, "a", 500..1000), build_segment(&directory, "b", 3000..3600)];
+        assert_eq!(segments[1].meta.inverted_index_meta.row_id_base, 3000);
+        assert_eq!((segments[1].min_row_id(), segments[1].max_row_id()), (0, 599));
+
+        let inputs: Vec<&CompressedInvertedIndexMmap<f32, f32>> = segments.iter().collect();
+        let merged = CompressedInvertedIndexMmapMerger::new(&inputs, ElementType::SIMPLE).merge(&directory, Some("merged")).unwrap();
+        assert_eq!(merged.meta.inverted_index_meta.row_id_base, 500);
+        assert_eq!((merged.min_row_id(), merged.max_row_id()), (0, 3099));
+        for dim_id in merged.dim_ids() {
+            let mut expected = external_elements(&segments[0], dim_id);
+            expected.extend(external_elements(&segments[1], dim_id));
+            assert_eq!(expected, external_elements(&merged, dim_id));
+        }
+
+        let query = SparseVector { indices: vec![1, 9, 17, 30], values: vec![1.0, 0.5, 2.0, 1.5] };
+        let sparse_bitmap = Some(SparseBitmap::from((3000..3600).filter(|row_id| row_id % 2 == 0).collect::<Vec<RowId>>()));
+        let results = Searcher::new(GenericInvertedIndex::F32NoQuantized(InvertedIndexWrapper::CompressedInvertedIndex(merged))).search(&query, &sparse_bitmap, 20).into_vec();
+        assert_eq!(results.len(), 20);
+        assert!(results.iter().all(|e| e.row_id >= 3000 && e.row_id % 2 == 0));
+    }
+
+    #[test]
+    fn test_merge_row_id_overflow() {
+        let temp_dir = tempdir().unwrap();
+        let directory = temp_dir.path().to_path_buf();
+        let mut segment = build_segment(&directory, "a", 500..1000);
+        segment.meta.inverted_index_meta.row_id_base = RowId::MAX - 100;
+
+        let inputs = vec![&segment];
+        assert!(CompressedInvertedIndexMmapMerger::new(&inputs, ElementType::SIMPLE).merge(&directory, Some("merged")).is_err());
+    }
+
+    #[test]
+    fn test_build_search_merge_hashed_dims() {
+        let temp_dir = tempdir().unwrap();
+        let directory = temp_dir.path().to_path_buf();
+        let dense = vec![build_segment(&directory, "a", 0..1000), build_segment(&directory, "b", 1000..2000)];
+        let hashed = vec![build_segment_with_dims(&directory, "hashed_a", 0..1000, hashed_dim), build_segment_with_dims(&directory, "hashed_b", 1000..2000, hashed_dim)];
+
+        let dense_inputs: Vec<&CompressedInvertedIndexMmap<f32, f32>> = dense.iter().collect();
+        let hashed_inputs: Vec<&CompressedInvertedIndexMmap<f32, f32>> = hashed.iter().collect();
+        let dense_merged = CompressedInvertedIndexMmapMerger::new(&dense_inputs, ElementType::SIMPLE).merge(&directory, Some("merged")).unwrap();
+        let hashed_merged = CompressedInvertedIndexMmapMerger::new(&hashed_inputs, ElementType::SIMPLE).merge(&directory, Some("hashed_merged")).unwrap();
+
+        // Hashed dims are stored only through the directory, and hold the same postings as their dense dims.
+        let query = SparseVector { indices: vec![1, 9, 17, 30], values: vec![1.0, 0.5, 2.0, 1.5] };
+        let mut hashed_query: Vec<(DimId, f32)> = query.indices.iter().map(|&dim_id| hashed_dim(dim_id)).zip(query.values.iter().copied()).collect();
+        hashed_query.sort_unstable_by_key(|&(dim_id, _)| dim_id);
+        let (indices, values) = hashed_query.into_iter().unzip();
+        let hashed_query = SparseVector { indices, values };
+        let bitmap = Some(SparseBitmap::from((0..2000).filter(|row_id| row_id % 3 != 0).collect::<Vec<RowId>>()));
+        for (dense_index, hashed_index) in dense.iter().zip(hashed.iter()).chain([(&dense_merged, &hashed_merged)]) {
+            assert!(dense_index.dim_directory.is_none() && hashed_index.dim_directory.is_some());
+            assert_eq!(hashed_index.size(), dense_index.dim_ids().len());
+            for dim_id in 0..32 {
+                assert_eq!(external_elements(dense_index, dim_id), external_elements(hashed_index, hashed_dim(dim_id)));
+            }
+            assert!(hashed_index.iter(&hashed_dim(32)).is_none());
+
+            for filter in [None, bitmap.clone()] {
+                let search = |index: &CompressedInvertedIndexMmap<f32, f32>, query: &SparseVector| {
+                    Searcher::new(GenericInvertedIndex::F32NoQuantized(InvertedIndexWrapper::CompressedInvertedIndex(index.clone()))).search(query, &filter, 20).into_vec()
+                };
+                let (expected, actual) = (search(dense_index, &query), search(hashed_index, &hashed_query));
+                assert_eq!(expected.len(), 20);
+                assert_eq!(expected.iter().map(|e| e.row_id).collect::<Vec<_>>(), actual.iter().map(|e| e.row_id).collect::<Vec<_>>());
+            }
+        }
     }
 }
@@ -1,6 +1,8 @@
+use std::io;
+
 use serde::{Deserialize, Serialize};
 
-use crate::core::inverted_index::common::InvertedIndexMeta;
+use crate::core::inverted_index::common::{InvertedIndexMeta, MetaReader, MetaWriter, SegmentMetaCodec};
 
 #[derive(Debug, Serialize, Deserialize, Clone, PartialEq, PartialOrd)]
 pub struct CompressedMmapInvertedIndexMeta {
@@ -11,4 +13,30 @@ pub struct CompressedMmapInvertedIndexMeta {
     pub headers_storage_size: u64,
     pub total_blocks_count: u64,
     pub blocks_storage_size: u64,
+
+    /// Quantized weights keep 4 bits, merged segments keep them too.
+    #[serde(default)]
+    pub u4_weights: bool,
+}
+
+impl SegmentMetaCodec for CompressedMmapInvertedIndexMeta {
+    fn encode_fields(&self, writer: &mut MetaWriter) {
+        self.inverted_index_meta.encode_fields(writer);
+        writer.put_u64(self.row_ids_storage_size);
+        writer.put_u64(self.headers_storage_size);
+        writer.put_u64(self.total_blocks_count);
+        writer.put_u64(self.blocks_storage_size);
+        writer.put_bool(self.u4_weights);
+    }
+
+    fn decode_fields(reader: &mut MetaReader) -> io::Result<Self> {
+        Ok(Self {
+            inverted_index_meta: InvertedIndexMeta::decode_fields(reader)?,
+            row_ids_storage_size: reader.get_u64()?,
+            headers_storage_size: reader.get_u64()?,
+            total_blocks_count: reader.get_u64()?,
+            blocks_storage_size: reader.get_u64()?,
+            u4_weights: reader.get_bool()?,
+        })
+    }
 }
@@ -1,8 +1,13 @@
 use crate::{
-    core::{CompressedBlockType, QuantizedParam},
+    core::{
+        common::ops::{transmute_from_u8, transmute_to_u8},
+        inverted_index::common::Revision,
+        CompressedBlockType, QuantizedParam, RowIdCodec,
+    },
     RowId,
 };
 
+/// Decoded posting header, the on-disk layout depends on the revision in meta.
 #[derive(Debug, Default, Clone)]
 pub struct CompressedPostingListHeader {
     // offset for row_ids
@@ -18,8 +23,295 @@ pub struct CompressedPostingListHeader {
 
     pub compressed_block_type: CompressedBlockType,
 
+    /// How row ids of every block are encoded, postings written before codecs were added use bitpacking.
+    pub row_id_codec: RowIdCodec,
+
+    /// Blocks are followed by exactly `row_ids_count` weights, older postings embed 128 weights in each block.
+    pub packed_weights: bool,
+
+    /// Packed blocks hold a quantization param for each block, `quantized_params` only covers the whole posting.
+    pub block_quantized: bool,
+
+    /// Packed blocks hold `u4` weights, two in a byte.
+    pub u4_weights: bool,
+
     pub row_ids_count: RowId,
     pub max_row_id: Option<RowId>,
+
+    /// Smallest and largest (unquantized) weight in this posting, bound the score a query term can contribute.
+    pub min_weight: f32,
+    pub max_weight: f32,
 }
 
-pub const COMPRESSED_POSTING_HEADER_SIZE: usize = std::mem::size_of::<CompressedPostingListHeader>();
+const FLAG_EXTENDED: u8 = 1;
+const FLAG_QUANTIZED: u8 = 1 << 1;
+const FLAG_HAS_MAX_ROW_ID: u8 = 1 << 2;
+/// Bits 3 and 4 of flags hold the [`RowIdCodec`].
+const ROW_ID_CODEC_SHIFT: u8 = 3;
+const ROW_ID_CODEC_MASK: u8 = 0b11 << ROW_ID_CODEC_SHIFT;
+const FLAG_PACKED_WEIGHTS: u8 = 1 << 5;
+const FLAG_BLOCK_QUANTIZED: u8 = 1 << 6;
+const FLAG_U4_WEIGHTS: u8 = 1 << 7;
+
+/// Header layout written by [`Revision::V3`], free of padding and independent of the compiler's struct layout.
+#[repr(C, packed)]
+#[derive(Debug, Default, Clone, Copy)]
+pub struct PackedCompressedPostingListHeader {
+    pub row_ids_start: u64,
+    pub row_ids_len: u32,
+    pub blocks_start: u64,
+    pub blocks_len: u32,
+    pub row_ids_count: RowId,
+    pub max_row_id: RowId,
+    pub quantized_min: f32,
+    pub quantized_diff256: f32,
+    pub min_weight: f32,
+    pub max_weight: f32,
+    pub flags: u8,
+}
+
+pub const COMPRESSED_POSTING_HEADER_SIZE: usize = std::mem::size_of::<PackedCompressedPostingListHeader>();
+
+const _: () = assert!(COMPRESSED_POSTING_HEADER_SIZE == 49);
+
+/// Byte length of a posting section, fails when it does not fit the `u32` length of a packed header.
+fn section_len(start: usize, end: usize, section: &str) -> std::io::Result<u32> {
+    u32::try_from(end - start)
+        .map_err(|_| std::io::Error::new(std::io::ErrorKind::InvalidInput, format!("posting {} of {} bytes overflow the posting header", section, end - start)))
+}
+
+impl TryFrom<&CompressedPostingListHeader> for PackedCompressedPostingListHeader {
+    type Error = std::io::Error;
+
+    fn try_from(header: &CompressedPostingListHeader) -> std::io::Result<Self> {
+        let quantized_params = header.quantized_params.unwrap_or_default();
+        let mut flags = 0;
+        if header.compressed_block_type == CompressedBlockType::Extended {
+            flags |= FLAG_EXTENDED;
+        }
+        if header.quantized_params.is_some() {
+            flags |= FLAG_QUANTIZED;
+        }
+        if header.max_row_id.is_some() {
+            flags |= FLAG_HAS_MAX_ROW_ID;
+        }
+        flags |= (header.row_id_codec as u8) << ROW_ID_CODEC_SHIFT;
+        if header.packed_weights {
+            flags |= FLAG_PACKED_WEIGHTS;
+        }
+        if header.block_quantized {
+            flags |= FLAG_BLOCK_QUANTIZED;
+        }
+        if header.u4_weights {
+            flags |= FLAG_U4_WEIGHTS;
+        }
+        Ok(Self {
+            row_ids_start: header.compressed_row_ids_start as u64,
+            row_ids_len: section_len(header.compressed_row_ids_start, header.compressed_row_ids_end, "row ids")?,
+            blocks_start: header.compressed_blocks_start as u64,
+            blocks_len: section_len(header.compressed_blocks_start, header.compressed_blocks_end, "blocks")?,
+            row_ids_count: header.row_ids_count,
+            max_row_id: header.max_row_id.unwrap_or(0),
+            quantized_min: quantized_params.min(),
+            quantized_diff256: quantized_params.min_precision(),
+            min_weight: header.min_weight,
+            max_weight: header.max_weight,
+            flags,
+        })
+    }
+}
+
+impl TryFrom<PackedCompressedPostingListHeader> for CompressedPostingListHeader {
+    type Error = std::io::Error;
+
+    fn try_from(header: PackedCompressedPostingListHeader) -> std::io::Result<Self> {
+        let (row_ids_start, blocks_start) = (header.row_ids_start as usize, header.blocks_start as usize);
+        let codec = (header.flags & ROW_ID_CODEC_MASK) >> ROW_ID_CODEC_SHIFT;
+        let row_id_codec =
+            RowIdCodec::from_u8(codec).ok_or_else(|| std::io::Error::new(std::io::ErrorKind::InvalidData, format!("unknown row id codec {} in posting header", codec)))?;
+        Ok(Self {
+            compressed_row_ids_start: row_ids_start,
+            compressed_row_ids_end: row_ids_start + header.row_ids_len as usize,
+            compressed_blocks_start: blocks_start,
+            compressed_blocks_end: blocks_start + header.blocks_len as usize,
+            quantized_params: if header.flags & FLAG_QUANTIZED != 0 { Some(QuantizedParam::from_parts(header.quantized_min, header.quantized_diff256)) } else { None },
+            compressed_block_type: if header.flags & FLAG_EXTENDED != 0 { CompressedBlockType::Extended } else { CompressedBlockType::Simple },
+            row_id_codec,
+            packed_weights: header.flags & FLAG_PACKED_WEIGHTS != 0,
+            block_quantized: header.flags & FLAG_BLOCK_QUANTIZED != 0,
+            u4_weights: header.flags & FLAG_U4_WEIGHTS != 0,
+            row_ids_count: header.row_ids_count,
+            max_row_id: if header.flags & FLAG_HAS_MAX_ROW_ID != 0 { Some(header.max_row_id) } else { None },
+            min_weight: header.min_weight,
+            max_weight: header.max_weight,
+        })
+    }
+}
+
+/// Header layout written by [`Revision::V2`], the in-memory layout of the struct at that time.
+#[derive(Debug, Default, Clone)]
+pub struct CompressedPostingListHeaderV2 {
+    pub compressed_row_ids_start: usize,
+    pub compressed_row_ids_end: usize,
+    pub compressed_blocks_start: usize,
+    pub compressed_blocks_end: usize,
+    pub quantized_params: Option<QuantizedParam>,
+    pub compressed_block_type: CompressedBlockType,
+    pub row_ids_count: RowId,
+    pub max_row_id: Option<RowId>,
+    pub min_weight: f32,
+    pub max_weight: f32,
+}
+
+pub const COMPRESSED_POSTING_HEADER_V2_SIZE: usize = std::mem::size_of::<CompressedPostingListHeaderV2>();
+
+impl From<CompressedPostingListHeaderV2> for CompressedPostingListHeader {
+    fn from(header: CompressedPostingListHeaderV2) -> Self {
+        Self {
+            compressed_row_ids_start: header.compressed_row_ids_start,
+            compressed_row_ids_end: header.compressed_row_ids_end,
+            compressed_blocks_start: header.compressed_blocks_start,
+            compressed_blocks_end: header.compressed_blocks_end,
+            quantized_params: header.quantized_params,
+            compressed_block_type: header.compressed_block_type,
+            row_id_codec: RowIdCodec::BitPacking,
+            packed_weights: false,
+            block_quantized: false,
+            u4_weights: false,
+            row_ids_count: header.row_ids_count,
+            max_row_id: header.max_row_id,
+            min_weight: header.min_weight,
+            max_weight: header.max_weight,
+        }
+    }
+}
+
+/// Header layout written by [`Revision::V1`], before weight bounds were added.
+#[derive(Debug, Default, Clone)]
+pub struct CompressedPostingListHeaderV1 {
+    pub compressed_row_ids_start: usize,
+    pub compressed_row_ids_end: usize,
+    pub compressed_blocks_start: usize,
+    pub compressed_blocks_end: usize,
+    pub quantized_params: Option<QuantizedParam>,
+    pub compressed_block_type: CompressedBlockType,
+    pub row_ids_count: RowId,
+    pub max_row_id: Option<RowId>,
+}
+
+pub const COMPRESSED_POSTING_HEADER_V1_SIZE: usize = std::mem::size_of::<CompressedPostingListHeaderV1>();
+
+impl From<CompressedPostingListHeaderV1> for CompressedPostingListHeader {
+    fn from(header: CompressedPostingListHeaderV1) -> Self {
+        Self {
+            compressed_row_ids_start: header.compressed_row_ids_start,
+            compressed_row_ids_end: header.compressed_row_ids_end,
+            compressed_blocks_start: header.compressed_blocks_start,
+            compressed_blocks_end: header.compressed_blocks_end,
+            quantized_params: header.quantized_params,
+            compressed_block_type: header.compressed_block_type,
+            row_id_codec: RowIdCodec::BitPacking,
+            packed_weights: false,
+            block_quantized: false,
+            u4_weights: false,
+            row_ids_count: header.row_ids_count,
+            max_row_id: header.max_row_id,
+            // Quantized range is the posting range, otherwise bounds are unknown.
+            min_weight: header.quantized_params.map(|param| param.min()).unwrap_or(f32::NEG_INFINITY),
+            max_weight: header.quantized_params.map(|param| param.max()).unwrap_or(f32::INFINITY),
+        }
+    }
+}
+
+impl CompressedPostingListHeader {
+    /// Read the header of `dim_id` from a headers file written in given revision, fails on a corrupted header.
+    pub fn read(headers: &[u8], dim_id: usize, revision: &Revision) -> std::io::Result<CompressedPostingListHeader> {
+        match revision {
+            Revision::V1 => {
+                let header_start = dim_id * COMPRESSED_POSTING_HEADER_V1_SIZE;
+                Ok(transmute_from_u8::<CompressedPostingListHeaderV1>(&headers[header_start..(header_start + COMPRESSED_POSTING_HEADER_V1_SIZE)]).clone().into())
+            }
+            Revision::V2 => {
+                let header_start = dim_id * COMPRESSED_POSTING_HEADER_V2_SIZE;
+                Ok(transmute_from_u8::<CompressedPostingListHeaderV2>(&headers[header_start..(header_start + COMPRESSED_POSTING_HEADER_V2_SIZE)]).clone().into())
+            }
+            Revision::V3 => {
+                let header_start = dim_id * COMPRESSED_POSTING_HEADER_SIZE;
+                (*transmute_from_u8::<PackedCompressedPostingListHeader>(&headers[header_start..(header_start + COMPRESSED_POSTING_HEADER_SIZE)])).try_into()
+            }
+        }
+    }
+
+    /// Write this header into slot `dim_id` of a headers file, always in the latest revision.
+    pub fn write(&self, headers: &mut [u8], dim_id: usize) -> std::io::Result<()> {
+        let header_start = dim_id * COMPRESSED_POSTING_HEADER_SIZE;
+        headers[header_start..(header_start + COMPRESSED_POSTING_HEADER_SIZE)].copy_from_slice(transmute_to_u8(&PackedCompressedPostingListHeader::try_from(self)?));
+        Ok(())
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_packed_header_round_trip() {
+        let header = CompressedPostingListHeader {
+            compressed_row_ids_start: 1 << 33,
+            compressed_row_ids_end: (1 << 33) + 300,
+            compressed_blocks_start: 1 << 34,
+            compressed_blocks_end: (1 << 34) + 2048,
+            quantized_params: Some(QuantizedParam::from_minmax(-1.0, 2.0)),
+            compressed_block_type: CompressedBlockType::Extended,
+            row_id_codec: RowIdCodec::EliasFano,
+            packed_weights: true,
+            block_quantized: true,
+            u4_weights: true,
+            row_ids_count: 256,
+            max_row_id: Some(9999),
+            min_weight: -1.0,
+            max_weight: 2.0,
+        };
+        let mut headers = vec![0u8; COMPRESSED_POSTING_HEADER_SIZE * 2];
+        header.write(&mut headers, 1).unwrap();
+
+        let decoded = CompressedPostingListHeader::read(&headers, 1, &Revision::V3).unwrap();
+        assert_eq!((decoded.compressed_row_ids_start, decoded.compressed_row_ids_end), (header.compressed_row_ids_start, header.compressed_row_ids_end));
+        assert_eq!((decoded.compressed_blocks_start, decoded.compressed_blocks_end), (header.compressed_blocks_start, header.compressed_blocks_end));
+        assert_eq!(decoded.quantized_params, header.quantized_params);
+        assert_eq!(decoded.compressed_block_type, header.compressed_block_type);
+        assert_eq!(decoded.row_id_codec, header.row_id_codec);
+        assert!(decoded.packed_weights);
+        assert!(decoded.block_quantized);
+        assert!(decoded.u4_weights);
+        assert_eq!((decoded.row_ids_count, decoded.max_row_id), (header.row_ids_count, header.max_row_id));
+        assert_eq!((decoded.min_weight, decoded.max_weight), (header.min_weight, header.max_weight));
+
+        let empty = CompressedPostingListHeader::read(&headers, 0, &Revision::V3).unwrap();
+        assert!(empty.quantized_params.is_none() && empty.max_row_id.is_none());
+        assert_eq!(empty.compressed_block_type, CompressedBlockType::Simple);
+        assert_eq!(empty.row_id_codec, RowIdCodec::BitPacking);
+        assert!(!empty.packed_weights);
+        assert!(!empty.block_quantized);
+        assert!(!empty.u4_weights);
+    }
+
+    #[test]
+    fn test_unknown_row_id_codec() {
+        let mut headers = vec![0u8; COMPRESSED_POSTING_HEADER_SIZE];
+        CompressedPostingListHeader::default().write(&mut headers, 0).unwrap();
+        headers[COMPRESSED_POSTING_HEADER_SIZE - 1] |= ROW_ID_CODEC_MASK;
+
+        let err = CompressedPostingListHeader::read(&headers, 0, &Revision::V3).unwrap_err();
+        assert_eq!(err.kind(), std::io::ErrorKind::InvalidData);
+    }
+
+    #[test]
+    fn test_section_len_overflow() {
+        let mut headers = vec![0u8; COMPRESSED_POSTING_HEADER_SIZE];
+        let header = CompressedPostingListHeader { compressed_blocks_start: 1 << 33, compressed_blocks_end: (1 << 33) + (1 << 32), ..Default::default() };
+        let err = header.write(&mut headers, 0).unwrap_err();
+        assert_eq!(err.kind(), std::io::ErrorKind::InvalidInput);
+        assert!(headers.iter().all(|&byte| byte == 0));
+    }
+}
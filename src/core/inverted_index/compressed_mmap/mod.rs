@@ -4,6 +4,7 @@ mod compressed_inverted_index_mmap_manager;
 mod compressed_inverted_index_mmap_merger;
 mod compressed_inverted_index_mmap_meta;
 mod compressed_posting_list_header;
+mod posting_cache;
 
 pub use compressed_inverted_index_mmap::*;
 pub use compressed_inverted_index_mmap_config::*;
@@ -11,3 +12,4 @@ pub use compressed_inverted_index_mmap_manager::*;
 pub use compressed_inverted_index_mmap_merger::*;
 pub use compressed_inverted_index_mmap_meta::CompressedMmapInvertedIndexMeta;
 pub use compressed_posting_list_header::{CompressedPostingListHeader, COMPRESSED_POSTING_HEADER_SIZE};
+pub use posting_cache::*;
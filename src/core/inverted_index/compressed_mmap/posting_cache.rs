@@ -0,0 +1,172 @@
+//! Shared cache of compressed posting bytes read with `pread`, used by segments loaded with `LoadPolicy::Pread`.
+
+use std::fmt;
+use std::fs::File;
+use std::io;
+use std::mem::size_of;
+use std::ops::Range;
+use std::path::Path;
+use std::sync::atomic::{AtomicU64, Ordering};
+use std::sync::Arc;
+
+use once_cell::sync::Lazy;
+use rayon::prelude::*;
+
+use crate::core::{transmute_to_u8_slice, CacheEntry, ClockCache};
+
+const DEFAULT_CAPACITY_BYTES: usize = 1 << 30;
+
+static GLOBAL_POSTING_CACHE: Lazy<PostingCache> = Lazy::new(|| PostingCache::new(DEFAULT_CAPACITY_BYTES));
+
+static NEXT_SEGMENT_KEY: AtomicU64 = AtomicU64::new(0);
+
+/// Threads blocked in query `pread`s, kept apart from the global rayon pool that flushes and builds segments.
+const PREFETCH_THREADS: usize = 16;
+
+static PREFETCH_POOL: Lazy<rayon::ThreadPool> = Lazy::new(|| {
+    rayon::ThreadPoolBuilder::new().num_threads(PREFETCH_THREADS).thread_name(|i| format!("posting_io_{}", i)).build().expect("failed to build posting prefetch pool")
+});
+
+/// Every opened segment gets its own key in the shared caches, entries of closed segments are evicted over time.
+pub fn next_segment_key() -> u64 {
+    NEXT_SEGMENT_KEY.fetch_add(1, Ordering::Relaxed)
+}
+
+/// Bytes of one compressed posting. Blocks come first in an 8 bytes aligned buffer, so block metas can be borrowed in place.
+pub struct CachedPosting {
+    buffer: Vec<u64>,
+    blocks_len: usize,
+    row_ids_len: usize,
+}
+
+impl CachedPosting {
+    fn bytes(&self) -> &[u8] {
+        transmute_to_u8_slice(&self.buffer)
+    }
+
+    pub fn blocks(&self) -> &[u8] {
+        &self.bytes()[..self.blocks_len]
+    }
+
+    pub fn row_ids(&self) -> &[u8] {
+        &self.bytes()[self.blocks_len..self.blocks_len + self.row_ids_len]
+    }
+}
+
+impl CacheEntry for CachedPosting {
+    fn size(&self) -> usize {
+        self.buffer.len() * size_of::<u64>()
+    }
+}
+
+impl fmt::Debug for CachedPosting {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        f.debug_struct("CachedPosting").field("blocks_len", &self.blocks_len).field("row_ids_len", &self.row_ids_len).finish()
+    }
+}
+
+/// Postings keyed by (segment key, posting ordinal).
+pub type PostingCache = ClockCache<(u64, usize), CachedPosting>;
+
+impl PostingCache {
+    /// Cache shared by all segments loaded with `LoadPolicy::Pread`, 1 GiB by default.
+    pub fn global() -> &'static PostingCache {
+        &GLOBAL_POSTING_CACHE
+    }
+}
+
+#[cfg(unix)]
+fn read_exact_at(file: &File, buf: &mut [u8], offset: u64) -> io::Result<()> {
+    std::os::unix::fs::FileExt::read_exact_at(file, buf, offset)
+}
+
+#[cfg(windows)]
+fn read_exact_at(file: &File, mut buf: &mut [u8], mut offset: u64) -> io::Result<()> {
+    while !buf.is_empty() {
+        match std::os::windows::fs::FileExt::seek_read(file, buf, offset)? {
+            0 => return Err(io::Error::new(io::ErrorKind::UnexpectedEof, "failed to fill whole buffer")),
+            n => {
+                buf = &mut buf[n..];
+                offset += n as u64;
+            }
+        }
+    }
+    Ok(())
+}
+
+/// Reads postings of one segment from the row ids and blocks sections of its files.
+#[derive(Debug)]
+pub struct PostingFileReader {
+    segment_key: u64,
+    row_ids_file: Arc<File>,
+    row_ids_offset: u64,
+    blocks_file: Arc<File>,
+    blocks_offset: u64,
+}
+
+impl PostingFileReader {
+    /// `*_offset` is where the section starts in its file, both sections may live in the same file.
+    pub fn open(segment_key: u64, row_ids_path: &Path, row_ids_offset: u64, blocks_path: &Path, blocks_offset: u64) -> io::Result<Self> {
+        let row_ids_file = Arc::new(File::open(row_ids_path)?);
+        let blocks_file = if blocks_path == row_ids_path { row_ids_file.clone() } else { Arc::new(File::open(blocks_path)?) };
+        Ok(Self { segment_key, row_ids_file, row_ids_offset, blocks_file, blocks_offset })
+    }
+
+    /// Bytes of posting `ordinal` through the global cache, ranges are relative to their sections.
+    pub fn read(&self, ordinal: usize, blocks: Range<usize>, row_ids: Range<usize>) -> io::Result<(Arc<CachedPosting>, bool)> {
+        PostingCache::global().get_or_load((self.segment_key, ordinal), || self.read_uncached(blocks, row_ids))
+    }
+
+    /// Same as `read`, counted in the cache stats. Queries prefetch every posting once, so stats count query postings.
+    pub fn prefetch(&self, ordinal: usize, blocks: Range<usize>, row_ids: Range<usize>) -> io::Result<bool> {
+        let (_, hit) = self.read(ordinal, blocks, row_ids)?;
+        PostingCache::global().record(hit);
+        Ok(hit)
+    }
+
+    /// `prefetch` of every (ordinal, blocks, row_ids) on the prefetch pool, returns once all of them are cached
+    /// so iterators never issue a second read of a posting still in flight.
+    pub fn prefetch_all(&self, postings: Vec<(usize, Range<usize>, Range<usize>)>) -> Vec<(usize, io::Result<bool>)> {
+        PREFETCH_POOL.install(|| postings.into_par_iter().map(|(ordinal, blocks, row_ids)| (ordinal, self.prefetch(ordinal, blocks, row_ids))).collect())
+    }
+
+    fn read_uncached(&self, blocks: Range<usize>, row_ids: Range<usize>) -> io::Result<CachedPosting> {
+        let (blocks_len, row_ids_len) = (blocks.len(), row_ids.len());
+        let mut buffer = vec![0u64; (blocks_len + row_ids_len + size_of::<u64>() - 1) / size_of::<u64>()];
+        // SAFETY: any bytes are valid `u64`s, the slice covers exactly the buffer.
+        let bytes = unsafe { std::slice::from_raw_parts_mut(buffer.as_mut_ptr() as *mut u8, buffer.len() * size_of::<u64>()) };
+        read_exact_at(&self.blocks_file, &mut bytes[..blocks_len], self.blocks_offset + blocks.start as u64)?;
+        read_exact_at(&self.row_ids_file, &mut bytes[blocks_len..blocks_len + row_ids_len], self.row_ids_offset + row_ids.start as u64)?;
+        Ok(CachedPosting { buffer, blocks_len, row_ids_len })
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use tempfile::tempdir;
+
+    #[test]
+    fn test_read_through_cache() {
+        let temp_dir = tempdir().unwrap();
+        let path = temp_dir.path().join("postings");
+        let bytes: Vec<u8> = (0..200).map(|i| i as u8).collect();
+        std::fs::write(&path, &bytes).unwrap();
+
+        // Row ids section starts at 100, blocks section at 20.
+        let reader = PostingFileReader::open(next_segment_key(), &path, 100, &path, 20).unwrap();
+        let (posting, hit) = reader.read(3, 8..24, 5..12).unwrap();
+        assert!(!hit);
+        assert_eq!(posting.blocks(), &bytes[28..44]);
+        assert_eq!(posting.row_ids(), &bytes[105..112]);
+        assert_eq!(posting.blocks().as_ptr().align_offset(8), 0);
+
+        let stats = PostingCache::global().stats();
+        assert!(reader.prefetch(3, 8..24, 5..12).unwrap());
+        assert!(PostingCache::global().stats().hits > stats.hits);
+
+        let prefetched = reader.prefetch_all(vec![(3, 8..24, 5..12), (4, 0..8, 0..100)]);
+        assert!(matches!(prefetched[0], (3, Ok(true))));
+        assert!(matches!(prefetched[1], (4, Err(_))));
+    }
+}
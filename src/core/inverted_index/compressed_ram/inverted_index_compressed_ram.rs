@@ -1,17 +1,24 @@
 use std::{borrow::Cow, path::PathBuf};
 
-use log::error;
+use rayon::prelude::*;
 
 use crate::core::{
-    inverted_index::common::InvertedIndexMetrics, CompressedBlockType, CompressedPostingBuilder, CompressedPostingList, DimId, ElementRead, ElementType, InvertedIndexRam,
-    InvertedIndexRamAccess, PostingList, QuantizedParam, QuantizedWeight,
+    install_in_flush_pool, inverted_index::common::InvertedIndexMetrics, CompressedBlockType, CompressedPostingBuilder, CompressedPostingList, DimId, ElementRead, ElementType,
+    InvertedIndexRam, InvertedIndexRamAccess, QuantizedWeight,
 };
+use crate::RowId;
 
 #[derive(Debug, Clone)]
 pub struct CompressedInvertedIndexRam<TW: QuantizedWeight> {
     pub(super) postings: Vec<CompressedPostingList<TW>>,
+    /// Sorted dim id of each posting, `None` when postings are dense by dim id.
+    pub(super) dim_ids: Option<Vec<DimId>>,
     pub(super) element_type: ElementType,
+    /// Row ids in `metrics` and postings are local, `row_id_base` is added to restore them.
     pub(super) metrics: InvertedIndexMetrics,
+    pub(super) row_id_base: RowId,
+    /// Postings keep nibble packed `u4` weights.
+    pub(super) u4_weights: bool,
 }
 
 impl<TW: QuantizedWeight> CompressedInvertedIndexRam<TW> {
@@ -19,44 +26,74 @@ impl<TW: QuantizedWeight> CompressedInvertedIndexRam<TW> {
         &self.postings
     }
 
-    pub fn get(&self, dim_id: &DimId) -> Option<&CompressedPostingList<TW>> {
-        self.postings.get(*dim_id as usize)
+    pub fn u4_weights(&self) -> bool {
+        self.u4_weights
     }
 
-    // TODO: Refine ram trait.
-    pub fn from_ram_index(ram_index: Cow<InvertedIndexRam<TW>>, _path: PathBuf, _segment_id: Option<&str>) -> crate::Result<Self> {
-        let mut postings = Vec::with_capacity(ram_index.size());
-        let element_type = ram_index.element_type();
-
-        let empty_posting_list = PostingList::<TW>::new(ram_index.element_type());
-
-        for dim_id in 0..ram_index.size() {
-            // Get the posting list from the ram index.
-            let posting_list_in_ram: &PostingList<TW> = ram_index.get(&(dim_id as DimId)).unwrap_or(&empty_posting_list);
+    pub fn row_id_base(&self) -> RowId {
+        self.row_id_base
+    }
 
-            // Compress the posting list.
-            let mut compressed_posting_builder: CompressedPostingBuilder<TW, TW> = CompressedPostingBuilder::<TW, TW>::new(element_type, true, false)?;
+    pub fn is_sparse(&self) -> bool {
+        self.dim_ids.is_some()
+    }
 
-            // TODO 这个流程可以优化，并不需要逐个的添加到 builder 里面
-            for element in &posting_list_in_ram.elements {
-                compressed_posting_builder.add(element.row_id(), TW::to_f32(element.weight()));
-            }
+    /// Sorted dim id of every stored posting.
+    pub fn dim_ids(&self) -> Vec<DimId> {
+        match &self.dim_ids {
+            Some(dim_ids) => dim_ids.clone(),
+            None => (0..self.postings.len() as DimId).collect(),
+        }
+    }
 
-            let compressed_posting_list = compressed_posting_builder.build()?;
+    pub fn get(&self, dim_id: &DimId) -> Option<&CompressedPostingList<TW>> {
+        match &self.dim_ids {
+            Some(dim_ids) => dim_ids.binary_search(dim_id).ok().map(|ordinal| &self.postings[ordinal]),
+            None => self.postings.get(*dim_id as usize),
+        }
+    }
 
-            // TODO 这里的 quantized param 是重新生成了，估计也没有必要从 ram index 中获取
-            // compressed_posting_list.quantization_params = match ram_index.quantized_params().get(dim_id) {
-            //     Some(param) => param.clone(),
-            //     None => {
-            //         let error_msg = "This error should not occur because the posting must exist in `ram_index`. Its occurrence suggests potential bugs during the construction of `ram_index`.";
-            //         error!("{}", error_msg);
-            //         panic!("{}", error_msg);
-            //     },
-            // };
-            postings.push(compressed_posting_list);
+    // TODO: Refine ram trait.
+    pub fn from_ram_index(ram_index: Cow<InvertedIndexRam<TW>>, _path: PathBuf, _segment_id: Option<&str>) -> crate::Result<Self> {
+        let element_type = ram_index.element_type();
+        // Postings store row ids relative to the smallest one of the segment.
+        let mut metrics = ram_index.metrics();
+        let row_id_base = if metrics.min_row_id > metrics.max_row_id { 0 } else { metrics.min_row_id };
+        if row_id_base != 0 {
+            metrics.min_row_id -= row_id_base;
+            metrics.max_row_id -= row_id_base;
         }
 
-        Ok(Self { postings, metrics: ram_index.metrics(), element_type })
+        // Postings are compressed independently, spread over the flush pool.
+        let u4_weights = ram_index.u4_weights;
+        let postings = install_in_flush_pool(|| {
+            ram_index
+                .postings()
+                .par_iter()
+                .zip(ram_index.quantized_params().par_iter())
+                .zip(ram_index.block_quantized_params().par_iter())
+                .map(|((posting_list_in_ram, quantized_param), block_params)| -> crate::Result<CompressedPostingList<TW>> {
+                    let mut compressed_posting_builder: CompressedPostingBuilder<TW, TW> = CompressedPostingBuilder::<TW, TW>::new(element_type, true, false)?;
+
+                    // TODO 这个流程可以优化，并不需要逐个的添加到 builder 里面
+                    for element in &posting_list_in_ram.elements {
+                        compressed_posting_builder.add(element.row_id() - row_id_base, TW::to_f32(element.weight()));
+                    }
+
+                    let mut compressed_posting_list = compressed_posting_builder.build()?;
+
+                    // Weights in ram are already quantized, keep their params. Ram blocks and compressed blocks have the same size.
+                    compressed_posting_list.quantization_params = *quantized_param;
+                    compressed_posting_list.block_quantization_params = block_params.clone();
+                    if u4_weights {
+                        compressed_posting_list.pack_u4_weights();
+                    }
+                    Ok(compressed_posting_list)
+                })
+                .collect::<crate::Result<Vec<_>>>()
+        })?;
+
+        Ok(Self { postings, dim_ids: if ram_index.is_sparse() { Some(ram_index.dim_ids()) } else { None }, metrics, row_id_base, element_type, u4_weights: ram_index.u4_weights })
     }
 }
 
@@ -1,19 +1,17 @@
 use crate::core::common::ops::*;
 use crate::core::common::types::{DimId, DimOffset};
 use crate::core::inverted_index::common::{InvertedIndexMeta, InvertedIndexMetrics, Revision, Version};
-use crate::core::posting_list::PostingListIterator;
+use crate::core::posting_list::{ColumnarPostingListIterator, MmapPostingListIterator, PostingListColumns, PostingListIterator};
 use crate::core::{
-    ElementSlice, GenericElementSlice, InvertedIndexMmapAccess, InvertedIndexMmapInit, InvertedIndexRam, InvertedIndexRamAccess, PostingListIterAccess, QuantizedParam,
-    QuantizedWeight, WeightType,
+    DimDirectory, ElementSlice, GenericElementSlice, InvertedIndexMmapAccess, InvertedIndexMmapInit, InvertedIndexRam, InvertedIndexRamAccess, LoadPolicy, MmapSection,
+    PostingListIterAccess, QuantizedWeight, SectionKind, SegmentContainer, SegmentLayout, WeightType,
 };
 use log::error;
-use memmap2::Mmap;
 use std::borrow::Cow;
 use std::marker::PhantomData;
 use std::path::{Path, PathBuf};
-use std::sync::Arc;
 
-use super::{InvertedIndexMmapFileConfig, MmapInvertedIndexMeta, MmapManager, PostingListHeader, POSTING_HEADER_SIZE};
+use super::{InvertedIndexMmapFileConfig, MmapInvertedIndexMeta, MmapManager, PostingListHeader};
 
 /// InvertedIndexMmap
 ///
@@ -22,16 +20,19 @@ use super::{InvertedIndexMmapFileConfig, MmapInvertedIndexMeta, MmapManager, Pos
 #[derive(Debug, Clone)]
 pub struct InvertedIndexMmap<OW: QuantizedWeight, TW: QuantizedWeight> {
     pub path: PathBuf,
-    pub headers_mmap: Arc<Mmap>,
-    pub postings_mmap: Arc<Mmap>,
+    pub headers_mmap: MmapSection,
+    pub postings_mmap: MmapSection,
+    /// Eytzinger ordered dim ids, `None` when headers are dense by dim id.
+    pub dim_directory: Option<MmapSection>,
     pub meta: MmapInvertedIndexMeta,
+    pub layout: SegmentLayout,
     pub _phantom_w: PhantomData<OW>,
     pub _phantom_t: PhantomData<TW>,
 }
 
 impl<OW: QuantizedWeight, TW: QuantizedWeight> InvertedIndexMmapInit<OW, TW> for InvertedIndexMmap<OW, TW> {
-    fn open(path: &Path, segment_id: Option<&str>) -> std::io::Result<Self> {
-        Self::load_under_segment(path.to_path_buf(), segment_id)
+    fn open_with_policy(path: &Path, segment_id: Option<&str>, load_policy: LoadPolicy) -> std::io::Result<Self> {
+        Self::load_with_policy(path.to_path_buf(), segment_id, load_policy)
     }
 
     fn from_ram_index(ram_index: Cow<InvertedIndexRam<TW>>, path: PathBuf, segment_id: Option<&str>) -> crate::Result<Self> {
@@ -41,10 +42,19 @@ impl<OW: QuantizedWeight, TW: QuantizedWeight> InvertedIndexMmapInit<OW, TW> for
 
 impl<OW: QuantizedWeight, TW: QuantizedWeight> PostingListIterAccess<OW, TW> for InvertedIndexMmap<OW, TW> {
     // Pay attention to these weight type order.
-    type Iter<'a> = PostingListIterator<'a, OW, TW>;
+    type Iter<'a> = MmapPostingListIterator<'a, OW, TW>;
 
     fn iter(&self, dim_id: &DimOffset) -> Option<Self::Iter<'_>> {
-        self.posting_with_param(dim_id).map(|(generic_elements_slice, quantized_param)| PostingListIterator::new(generic_elements_slice, quantized_param))
+        let header = self.posting_header(dim_id)?;
+        let elements_bytes: &[u8] = &self.postings_mmap[header.start..header.end];
+        let iterator = if header.columnar {
+            let columns = PostingListColumns::from_bytes(header.element_type, header.row_ids_count as usize, header.block_quantized, elements_bytes);
+            ColumnarPostingListIterator::new(columns, header.quantized_params).with_weight_bounds(header.min_weight, header.max_weight).into()
+        } else {
+            let generic_elements_slice = GenericElementSlice::from_bytes_and_type(header.element_type, elements_bytes);
+            PostingListIterator::new(generic_elements_slice, header.quantized_params).with_weight_bounds(header.min_weight, header.max_weight).into()
+        };
+        Some(iterator)
     }
 }
 
@@ -63,41 +73,54 @@ impl<OW: QuantizedWeight, TW: QuantizedWeight> InvertedIndexMmapAccess<OW, TW> f
     }
 
     fn posting_len(&self, dim_id: &DimId) -> Option<usize> {
-        self.posting_with_param(dim_id).map(|(generic_elements_slice, _)| generic_elements_slice.length())
+        self.posting_header(dim_id).map(|header| match header.columnar {
+            true => header.row_ids_count as usize,
+            false => GenericElementSlice::<TW>::from_bytes_and_type(header.element_type, &self.postings_mmap[header.start..header.end]).length(),
+        })
     }
 
     fn files(&self, segment_id: Option<&str>) -> Vec<PathBuf> {
         // Only get relative path.
-        let get_all_files = InvertedIndexMmapFileConfig::get_all_files(segment_id);
-        get_all_files.iter().map(|p| PathBuf::from(p)).collect()
+        match self.layout {
+            SegmentLayout::SingleFile => vec![PathBuf::from(InvertedIndexMmapFileConfig::container_file_name(segment_id))],
+            SegmentLayout::MultiFile => InvertedIndexMmapFileConfig::get_all_files(segment_id).iter().map(|p| PathBuf::from(p)).collect(),
+        }
     }
 }
 
 impl<OW: QuantizedWeight, TW: QuantizedWeight> InvertedIndexMmap<OW, TW> {
-    /// Get PostingList obj with given dim-id, the weight type should be TW(may be quantized).
-    pub fn posting_with_param(&self, dim_id: &DimId) -> Option<(GenericElementSlice<'_, TW>, Option<QuantizedParam>)> {
-        // check that the id is not out of bounds (posting_count includes the empty zeroth entry)
-        if *dim_id >= self.size() as DimId {
-            error!("dim_id is overflow, dim_id should smaller than {}, but given: {}", self.size(), dim_id);
-            return None;
+    /// Header slot of `dim_id`, dims missing from a sparse segment have none.
+    fn posting_ordinal(&self, dim_id: &DimId) -> Option<usize> {
+        match &self.dim_directory {
+            Some(dim_directory) => DimDirectory::find(transmute_from_u8_to_slice(dim_directory), *dim_id),
+            None => {
+                // check that the id is not out of bounds (posting_count includes the empty zeroth entry)
+                if *dim_id >= self.size() as DimId {
+                    error!("dim_id is overflow, dim_id should smaller than {}, but given: {}", self.size(), dim_id);
+                    return None;
+                }
+                Some(*dim_id as usize)
+            }
         }
-        // loading header obj with offsets.
-        let offset_left = *dim_id as usize * POSTING_HEADER_SIZE;
-        let header: PostingListHeader = transmute_from_u8::<PostingListHeader>(&self.headers_mmap[offset_left..(offset_left + POSTING_HEADER_SIZE)]).clone();
+    }
 
-        // loading posting obj
-        let elements_bytes: &[u8] = &self.postings_mmap[header.start as usize..header.end as usize];
+    /// Sorted dim id of every stored posting.
+    pub fn dim_ids(&self) -> Vec<DimId> {
+        match &self.dim_directory {
+            Some(dim_directory) => DimDirectory::sorted_dims(transmute_from_u8_to_slice(dim_directory)),
+            None => (0..self.size() as DimId).collect(),
+        }
+    }
 
-        Some((GenericElementSlice::from_bytes_and_type(header.element_type, elements_bytes), header.quantized_params))
+    /// Header of `dim_id`, its layout depends on the revision in meta.
+    pub fn posting_header(&self, dim_id: &DimId) -> Option<PostingListHeader> {
+        let ordinal = self.posting_ordinal(dim_id)?;
+        Some(PostingListHeader::read(&self.headers_mmap, ordinal, &self.meta.inverted_index_meta.version.revision))
     }
 
-    /// Converting inverted-index-ram into mmap files.
+    /// Converting inverted-index-ram into a single-file segment.
     /// the weight type in inverted-index-ram may already been quantized.
     pub fn convert_and_save(inverted_index_ram: &InvertedIndexRam<TW>, directory: PathBuf, segment_id: Option<&str>) -> crate::Result<Self> {
-        let (total_headers_storage_size, total_postings_storage_size, headers_mmap, postings_mmap) = MmapManager::write_mmap_files(&directory, segment_id, inverted_index_ram)?;
-
-        let meta_file_path = MmapManager::get_index_meta_file_path(&directory.clone(), segment_id);
-
         let meta = MmapInvertedIndexMeta {
             inverted_index_meta: InvertedIndexMeta::new(
                 inverted_index_ram.size(),
@@ -108,15 +131,29 @@ impl<OW: QuantizedWeight, TW: QuantizedWeight> InvertedIndexMmap<OW, TW> {
                 inverted_index_ram.metrics().max_dim_id,
                 (TW::weight_type() == WeightType::WeightU8) && (OW::weight_type() != TW::weight_type()),
                 inverted_index_ram.element_type(),
-                Version::mmap(Revision::V1),
+                Version::mmap(Revision::V3),
             ),
-            headers_storage_size: total_headers_storage_size as u64,
-            postings_storage_size: total_postings_storage_size as u64,
+            headers_storage_size: 0,
+            postings_storage_size: 0,
         };
 
-        atomic_save_json(&meta_file_path, &meta)?;
+        let (meta, container) = MmapManager::write_segment(&directory, segment_id, inverted_index_ram, meta)?;
 
-        Ok(Self { path: directory.clone(), headers_mmap: headers_mmap.clone(), postings_mmap: postings_mmap.clone(), meta, _phantom_w: PhantomData, _phantom_t: PhantomData })
+        Ok(Self::from_container(directory, &container, meta)?)
+    }
+
+    /// Build index over the sections of an opened container.
+    pub(super) fn from_container(path: PathBuf, container: &SegmentContainer, meta: MmapInvertedIndexMeta) -> std::io::Result<Self> {
+        Ok(Self {
+            path,
+            headers_mmap: container.section(SectionKind::Headers)?,
+            postings_mmap: container.section(SectionKind::Postings)?,
+            dim_directory: container.optional_section(SectionKind::DimDirectory),
+            meta,
+            layout: SegmentLayout::SingleFile,
+            _phantom_w: PhantomData,
+            _phantom_t: PhantomData,
+        })
     }
 
     /// load without segment name.
@@ -126,24 +163,34 @@ impl<OW: QuantizedWeight, TW: QuantizedWeight> InvertedIndexMmap<OW, TW> {
 
     /// load with given segment name.
     pub fn load_under_segment(path: PathBuf, segment_id: Option<&str>) -> std::io::Result<Self> {
+        Self::load_with_policy(path, segment_id, LoadPolicy::Normal)
+    }
+
+    /// load with given segment name and load policy, segments written before the container format are still readable.
+    pub fn load_with_policy(path: PathBuf, segment_id: Option<&str>, load_policy: LoadPolicy) -> std::io::Result<Self> {
+        let container_file_path = MmapManager::get_container_file_path(&path, segment_id);
+        if container_file_path.exists() {
+            let container = SegmentContainer::open_with_policy(&container_file_path, load_policy)?;
+            let meta_data: MmapInvertedIndexMeta = container.read_meta()?;
+            return Self::from_container(path, &container, meta_data);
+        }
+
         // read meta file data.
         let meta_file_path = MmapManager::get_index_meta_file_path(&path, segment_id);
         let meta_data: MmapInvertedIndexMeta = read_json(&meta_file_path)?;
 
         // read inverted index data.
         let (headers_mmap_file_path, postings_mmap_file_path) = MmapManager::get_all_mmap_files_path(&path, segment_id);
-        let headers_mmap = open_read_mmap(headers_mmap_file_path.as_ref())?;
-        let postings_mmap = open_read_mmap(postings_mmap_file_path.as_ref())?;
-
-        // TODO: Compare different advice's influence on QPS.
-        madvise::madvise(&headers_mmap, madvise::Advice::Normal)?;
-        madvise::madvise(&postings_mmap, madvise::Advice::Normal)?;
+        let headers_mmap = open_read_mmap_with_policy(headers_mmap_file_path.as_ref(), load_policy)?;
+        let postings_mmap = open_read_mmap_with_policy(postings_mmap_file_path.as_ref(), load_policy)?;
 
         Ok(Self {
             path: path.clone(),
-            headers_mmap: Arc::new(headers_mmap),
-            postings_mmap: Arc::new(postings_mmap),
+            headers_mmap: MmapSection::from(headers_mmap),
+            postings_mmap: MmapSection::from(postings_mmap),
+            dim_directory: None,
             meta: meta_data,
+            layout: SegmentLayout::MultiFile,
             _phantom_w: PhantomData,
             _phantom_t: PhantomData,
         })
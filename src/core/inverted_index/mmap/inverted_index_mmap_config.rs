@@ -1,4 +1,4 @@
-use crate::core::{INVERTED_INDEX_FILE_NAME, INVERTED_INDEX_HEADERS_SUFFIX, INVERTED_INDEX_META_FILE_SUFFIX, INVERTED_INDEX_POSTINGS_SUFFIX};
+use crate::core::{INVERTED_INDEX_CONTAINER_SUFFIX, INVERTED_INDEX_FILE_NAME, INVERTED_INDEX_HEADERS_SUFFIX, INVERTED_INDEX_META_FILE_SUFFIX, INVERTED_INDEX_POSTINGS_SUFFIX};
 
 pub struct InvertedIndexMmapFileConfig;
 
@@ -12,6 +12,10 @@ impl InvertedIndexMmapFileConfig {
     pub fn inverted_meta_file_name(segment_id: Option<&str>) -> String {
         format!("{}{}", segment_id.unwrap_or(INVERTED_INDEX_FILE_NAME), INVERTED_INDEX_META_FILE_SUFFIX)
     }
+    pub fn container_file_name(segment_id: Option<&str>) -> String {
+        format!("{}{}", segment_id.unwrap_or(INVERTED_INDEX_FILE_NAME), INVERTED_INDEX_CONTAINER_SUFFIX)
+    }
+    /// Files of the legacy multi-file layout.
     pub fn get_all_files(segment_id: Option<&str>) -> Vec<String> {
         vec![Self::headers_file_name(segment_id), Self::postings_file_name(segment_id), Self::inverted_meta_file_name(segment_id)]
     }
@@ -1,23 +1,16 @@
-use std::{
-    io,
-    mem::size_of,
-    path::{Path, PathBuf},
-    sync::Arc,
-};
+use std::path::PathBuf;
 
-use memmap2::{Mmap, MmapMut};
+use rayon::prelude::*;
 
 use crate::{
     core::{
-        create_and_ensure_length,
-        madvise::{self, Advice},
-        open_write_mmap, transmute_to_u8, transmute_to_u8_slice, ElementRead, ElementType, ExtendedElement, InvertedIndexRam, InvertedIndexRamAccess, QuantizedWeight,
-        SimpleElement,
+        install_in_flush_pool, transmute_to_u8_slice, DimSlots, ElementRead, InvertedIndexRam, PostingListColumns, QuantizedWeight, SectionKind, SegmentContainer,
+        SegmentContainerWriter, SegmentMetaCodec,
     },
     RowId,
 };
 
-use super::{InvertedIndexMmapFileConfig, PostingListHeader, POSTING_HEADER_SIZE};
+use super::{InvertedIndexMmapFileConfig, MmapInvertedIndexMeta, PostingListHeader, POSTING_HEADER_SIZE};
 
 pub struct MmapManager;
 
@@ -40,85 +33,98 @@ impl MmapManager {
         inverted_index_meta_file_path
     }
 
-    pub(super) fn create_mmap_file(mmap_file_path: &Path, mmap_file_size: u64, advice: Advice) -> Result<MmapMut, io::Error> {
-        create_and_ensure_length(mmap_file_path, mmap_file_size)?;
-        let mmap: MmapMut = open_write_mmap(mmap_file_path)?;
-        madvise::madvise(&mmap, advice)?;
-        return Ok(mmap);
+    pub(super) fn get_container_file_path(directory: &PathBuf, segment_id: Option<&str>) -> PathBuf {
+        Self::get_file_path(directory, segment_id, InvertedIndexMmapFileConfig::container_file_name)
     }
 
-    // TODO: Refine path parameter.
-    pub fn write_mmap_files<TW: QuantizedWeight>(
+    /// Write meta, headers and postings as sections of a single container file.
+    /// Storage sizes in `meta` are filled here, a sparse ram index also gets a dim directory section.
+    pub fn write_segment<TW: QuantizedWeight>(
         directory: &PathBuf,
         segment_id: Option<&str>,
         inv_idx_ram: &InvertedIndexRam<TW>,
-    ) -> crate::Result<(usize, usize, Arc<Mmap>, Arc<Mmap>)> {
+        mut meta: MmapInvertedIndexMeta,
+    ) -> crate::Result<(MmapInvertedIndexMeta, SegmentContainer)> {
         // compute posting_offsets and elements size.
-        let total_headers_storage_size: usize = inv_idx_ram.size() * POSTING_HEADER_SIZE;
+        let dim_slots = DimSlots::new(&inv_idx_ram.dim_ids(), inv_idx_ram.is_sparse());
+        let total_headers_storage_size: usize = dim_slots.slots_count() * POSTING_HEADER_SIZE;
 
         let total_postings_elements_size: usize = inv_idx_ram
             .postings()
             .iter()
-            .map(|posting| match posting.element_type {
-                ElementType::SIMPLE => posting.len() * size_of::<SimpleElement<TW>>(),
-                ElementType::EXTENDED => posting.len() * size_of::<ExtendedElement<TW>>(),
-            })
+            .zip(inv_idx_ram.block_quantized_params().iter())
+            .map(|(posting, block_params)| PostingListColumns::<TW>::storage_size(posting.element_type, posting.len(), !block_params.is_empty()))
             .sum();
 
-        // Init two mmap file paths.
-        let (headers_mmap_file_path, postings_mmap_file_path) = Self::get_all_mmap_files_path(&directory, segment_id);
-
-        let mut headers_mmap = Self::create_mmap_file(headers_mmap_file_path.as_ref(), total_headers_storage_size as u64, madvise::Advice::Normal)?;
-        let mut postings_mmap = Self::create_mmap_file(postings_mmap_file_path.as_ref(), total_postings_elements_size as u64, madvise::Advice::Normal)?;
+        meta.headers_storage_size = total_headers_storage_size as u64;
+        meta.postings_storage_size = total_postings_elements_size as u64;
+        let meta_bytes = meta.to_bytes();
 
-        Self::save_data_to_mmap::<TW>(&mut headers_mmap, &mut postings_mmap, inv_idx_ram);
-
-        if total_headers_storage_size > 0 {
-            headers_mmap.flush()?;
+        let container_path = Self::get_container_file_path(directory, segment_id);
+        let mut sections = vec![(SectionKind::Meta, meta_bytes.len()), (SectionKind::Headers, total_headers_storage_size), (SectionKind::Postings, total_postings_elements_size)];
+        if let Some(directory_keys) = &dim_slots.directory {
+            sections.push((SectionKind::DimDirectory, transmute_to_u8_slice(directory_keys).len()));
         }
-        if total_postings_elements_size > 0 {
-            postings_mmap.flush()?;
+        let mut writer = SegmentContainerWriter::create(&container_path, &sections)?;
+        {
+            let mut buffers = writer.sections_mut().into_iter();
+            buffers.next().unwrap().copy_from_slice(&meta_bytes);
+            let (headers_buffer, postings_buffer) = (buffers.next().unwrap(), buffers.next().unwrap());
+            Self::save_data_to_mmap::<TW>(headers_buffer, postings_buffer, inv_idx_ram, &dim_slots);
+            if let Some(directory_keys) = &dim_slots.directory {
+                buffers.next().unwrap().copy_from_slice(transmute_to_u8_slice(directory_keys));
+            }
         }
 
-        return Ok((total_headers_storage_size, total_postings_elements_size, Arc::new(headers_mmap.make_read_only()?), Arc::new(postings_mmap.make_read_only()?)));
+        Ok((meta, writer.finish()?))
     }
 
-    fn save_data_to_mmap<TW: QuantizedWeight>(headers_mmap: &mut MmapMut, postings_mmap: &mut MmapMut, inv_idx_ram: &InvertedIndexRam<TW>) {
-        let mut cur_postings_storage_size = 0;
+    /// Postings of a ram index are in dim order, `dim_slots` gives the header slot of each one.
+    fn save_data_to_mmap<TW: QuantizedWeight>(headers_mmap: &mut [u8], postings_mmap: &mut [u8], inv_idx_ram: &InvertedIndexRam<TW>, dim_slots: &DimSlots) {
+        let (postings, quantized_params, block_quantized_params) = (inv_idx_ram.postings(), inv_idx_ram.quantized_params(), inv_idx_ram.block_quantized_params());
+
+        // Offsets of a posting are the sizes of those before it, so each posting gets a disjoint slice of the section
+        // and columns are written in parallel.
+        let mut postings_slices = Vec::with_capacity(postings.len());
+        let mut postings_rest = postings_mmap;
+        for (posting, block_params) in postings.iter().zip(block_quantized_params.iter()) {
+            let posting_storage_size = PostingListColumns::<TW>::storage_size(posting.element_type, posting.len(), !block_params.is_empty());
+            let (posting_slice, rest) = std::mem::take(&mut postings_rest).split_at_mut(posting_storage_size);
+            postings_slices.push(posting_slice);
+            postings_rest = rest;
+        }
+        let weight_bounds: Vec<(f32, f32)> = install_in_flush_pool(|| {
+            postings
+                .par_iter()
+                .zip(quantized_params.par_iter())
+                .zip(block_quantized_params.par_iter())
+                .zip(postings_slices.into_par_iter())
+                .map(|(((posting, param), block_params), posting_slice)| {
+                    PostingListColumns::write(posting.element_type, &posting.elements, block_params, posting_slice);
+                    posting.weight_bounds(*param, block_params)
+                })
+                .collect()
+        });
 
-        for (dim_id, (posting, param)) in inv_idx_ram.postings().iter().zip(inv_idx_ram.quantized_params().iter()).enumerate() {
-            // Step 1.1: Generate header
+        let mut cur_postings_storage_size = 0;
+        let postings = postings.iter().zip(quantized_params.iter()).zip(block_quantized_params.iter()).zip(weight_bounds.iter());
+        for (&(_, slot), (((posting, param), block_params), &(min_weight, max_weight))) in dim_slots.slots.iter().zip(postings) {
+            let posting_storage_size = PostingListColumns::<TW>::storage_size(posting.element_type, posting.len(), !block_params.is_empty());
             let header_obj = PostingListHeader {
                 start: cur_postings_storage_size,
-                end: cur_postings_storage_size + posting.storage_size(),
+                end: cur_postings_storage_size + posting_storage_size,
                 quantized_params: param.clone(),
                 row_ids_count: posting.len() as RowId,
                 max_row_id: posting.elements.last().map(|e| e.row_id()).unwrap_or(0),
                 element_type: posting.element_type,
+                min_weight,
+                max_weight,
+                columnar: true,
+                block_quantized: !block_params.is_empty(),
             };
 
-            // Step 1.2 Save the header obj to mmap.
-            let header_bytes = transmute_to_u8(&header_obj);
-            let header_offset_left = dim_id * POSTING_HEADER_SIZE;
-            let header_offset_right: usize = (dim_id + 1) * POSTING_HEADER_SIZE;
-            headers_mmap[header_offset_left..header_offset_right].copy_from_slice(header_bytes);
-
-            // Step 2.1: Store the posting list to mmap
-            // TODO 放到一个位置重构一下
-            match posting.element_type {
-                ElementType::SIMPLE => {
-                    let simple_els = posting.elements.iter().map(|e| e.as_simple().unwrap().clone()).collect::<Vec<_>>();
-                    let posting_elements_bytes = transmute_to_u8_slice(&simple_els);
-                    postings_mmap[cur_postings_storage_size..(cur_postings_storage_size + posting_elements_bytes.len())].copy_from_slice(posting_elements_bytes);
-                    cur_postings_storage_size += posting_elements_bytes.len();
-                }
-                ElementType::EXTENDED => {
-                    let elements = posting.elements.iter().map(|e| e.as_extended().unwrap().clone()).collect::<Vec<_>>();
-                    let posting_elements_bytes = transmute_to_u8_slice(&elements);
-                    postings_mmap[cur_postings_storage_size..(cur_postings_storage_size + posting_elements_bytes.len())].copy_from_slice(posting_elements_bytes);
-                    cur_postings_storage_size += posting_elements_bytes.len();
-                }
-            }
+            header_obj.write(headers_mmap, slot);
+            cur_postings_storage_size = header_obj.end;
         }
     }
 }
@@ -1,6 +1,8 @@
+use std::io;
+
 use serde::{Deserialize, Serialize};
 
-use crate::core::inverted_index::common::InvertedIndexMeta;
+use crate::core::inverted_index::common::{InvertedIndexMeta, MetaReader, MetaWriter, SegmentMetaCodec};
 
 #[derive(Debug, Serialize, Deserialize, Clone, PartialEq, PartialOrd)]
 pub struct MmapInvertedIndexMeta {
@@ -10,3 +12,15 @@ pub struct MmapInvertedIndexMeta {
     pub headers_storage_size: u64,
     pub postings_storage_size: u64,
 }
+
+impl SegmentMetaCodec for MmapInvertedIndexMeta {
+    fn encode_fields(&self, writer: &mut MetaWriter) {
+        self.inverted_index_meta.encode_fields(writer);
+        writer.put_u64(self.headers_storage_size);
+        writer.put_u64(self.postings_storage_size);
+    }
+
+    fn decode_fields(reader: &mut MetaReader) -> io::Result<Self> {
+        Ok(Self { inverted_index_meta: InvertedIndexMeta::decode_fields(reader)?, headers_storage_size: reader.get_u64()?, postings_storage_size: reader.get_u64()? })
+    }
+}
@@ -1,5 +1,8 @@
+use crate::core::common::ops::{transmute_from_u8, transmute_to_u8};
+use crate::core::inverted_index::common::Revision;
 use crate::core::{ElementType, QuantizedParam};
 
+/// Decoded posting header, the on-disk layout depends on the revision in meta.
 #[derive(Debug, Default, Clone)]
 pub struct PostingListHeader {
     // offset for postings
@@ -14,6 +17,215 @@ pub struct PostingListHeader {
     // TODO: refine these vars.
     pub row_ids_count: u32,
     pub max_row_id: u32,
+
+    /// Smallest and largest (unquantized) weight in this posting, bound the score a query term can contribute.
+    pub min_weight: f32,
+    pub max_weight: f32,
+
+    /// Elements are stored as columns (see [`crate::core::PostingListColumns`]), otherwise interleaved element structs.
+    pub columnar: bool,
+
+    /// Columns hold a quantization param for every skip group, `quantized_params` only covers the whole posting.
+    pub block_quantized: bool,
+}
+
+const FLAG_EXTENDED: u8 = 1;
+const FLAG_QUANTIZED: u8 = 1 << 1;
+const FLAG_COLUMNAR: u8 = 1 << 2;
+const FLAG_BLOCK_QUANTIZED: u8 = 1 << 3;
+
+/// Header layout written by [`Revision::V3`], free of padding and independent of the compiler's struct layout.
+#[repr(C, packed)]
+#[derive(Debug, Default, Clone, Copy)]
+pub struct PackedPostingListHeader {
+    pub start: u64,
+    /// Byte length of the posting elements.
+    pub len: u32,
+    pub row_ids_count: u32,
+    pub max_row_id: u32,
+    pub quantized_min: f32,
+    pub quantized_diff256: f32,
+    pub min_weight: f32,
+    pub max_weight: f32,
+    pub flags: u8,
+}
+
+pub const POSTING_HEADER_SIZE: usize = std::mem::size_of::<PackedPostingListHeader>();
+
+const _: () = assert!(POSTING_HEADER_SIZE == 41);
+
+impl From<&PostingListHeader> for PackedPostingListHeader {
+    fn from(header: &PostingListHeader) -> Self {
+        let quantized_params = header.quantized_params.unwrap_or_default();
+        let mut flags = 0;
+        if header.element_type == ElementType::EXTENDED {
+            flags |= FLAG_EXTENDED;
+        }
+        if header.quantized_params.is_some() {
+            flags |= FLAG_QUANTIZED;
+        }
+        if header.columnar {
+            flags |= FLAG_COLUMNAR;
+        }
+        if header.block_quantized {
+            flags |= FLAG_BLOCK_QUANTIZED;
+        }
+        Self {
+            start: header.start as u64,
+            len: (header.end - header.start) as u32,
+            row_ids_count: header.row_ids_count,
+            max_row_id: header.max_row_id,
+            quantized_min: quantized_params.min(),
+            quantized_diff256: quantized_params.min_precision(),
+            min_weight: header.min_weight,
+            max_weight: header.max_weight,
+            flags,
+        }
+    }
+}
+
+impl From<PackedPostingListHeader> for PostingListHeader {
+    fn from(header: PackedPostingListHeader) -> Self {
+        let start = header.start as usize;
+        Self {
+            start,
+            end: start + header.len as usize,
+            quantized_params: if header.flags & FLAG_QUANTIZED != 0 { Some(QuantizedParam::from_parts(header.quantized_min, header.quantized_diff256)) } else { None },
+            element_type: if header.flags & FLAG_EXTENDED != 0 { ElementType::EXTENDED } else { ElementType::SIMPLE },
+            row_ids_count: header.row_ids_count,
+            max_row_id: header.max_row_id,
+            min_weight: header.min_weight,
+            max_weight: header.max_weight,
+            columnar: header.flags & FLAG_COLUMNAR != 0,
+            block_quantized: header.flags & FLAG_BLOCK_QUANTIZED != 0,
+        }
+    }
+}
+
+/// Header layout written by [`Revision::V2`], the in-memory layout of the struct at that time.
+#[derive(Debug, Default, Clone)]
+pub struct PostingListHeaderV2 {
+    pub start: usize,
+    pub end: usize,
+    pub quantized_params: Option<QuantizedParam>,
+    pub element_type: ElementType,
+    pub row_ids_count: u32,
+    pub max_row_id: u32,
+    pub min_weight: f32,
+    pub max_weight: f32,
 }
 
-pub const POSTING_HEADER_SIZE: usize = std::mem::size_of::<PostingListHeader>();
+pub const POSTING_HEADER_V2_SIZE: usize = std::mem::size_of::<PostingListHeaderV2>();
+
+impl From<PostingListHeaderV2> for PostingListHeader {
+    fn from(header: PostingListHeaderV2) -> Self {
+        Self {
+            start: header.start,
+            end: header.end,
+            quantized_params: header.quantized_params,
+            element_type: header.element_type,
+            row_ids_count: header.row_ids_count,
+            max_row_id: header.max_row_id,
+            min_weight: header.min_weight,
+            max_weight: header.max_weight,
+            columnar: false,
+            block_quantized: false,
+        }
+    }
+}
+
+/// Header layout written by [`Revision::V1`], before weight bounds were added.
+#[derive(Debug, Default, Clone)]
+pub struct PostingListHeaderV1 {
+    pub start: usize,
+    pub end: usize,
+    pub quantized_params: Option<QuantizedParam>,
+    pub element_type: ElementType,
+    pub row_ids_count: u32,
+    pub max_row_id: u32,
+}
+
+pub const POSTING_HEADER_V1_SIZE: usize = std::mem::size_of::<PostingListHeaderV1>();
+
+impl From<PostingListHeaderV1> for PostingListHeader {
+    fn from(header: PostingListHeaderV1) -> Self {
+        Self {
+            start: header.start,
+            end: header.end,
+            quantized_params: header.quantized_params,
+            element_type: header.element_type,
+            row_ids_count: header.row_ids_count,
+            max_row_id: header.max_row_id,
+            // Quantized range is the posting range, otherwise bounds are unknown.
+            min_weight: header.quantized_params.map(|param| param.min()).unwrap_or(f32::NEG_INFINITY),
+            max_weight: header.quantized_params.map(|param| param.max()).unwrap_or(f32::INFINITY),
+            columnar: false,
+            block_quantized: false,
+        }
+    }
+}
+
+impl PostingListHeader {
+    /// Read the header of `dim_id` from a headers file written in given revision.
+    pub fn read(headers: &[u8], dim_id: usize, revision: &Revision) -> PostingListHeader {
+        match revision {
+            Revision::V1 => {
+                let offset_left = dim_id * POSTING_HEADER_V1_SIZE;
+                transmute_from_u8::<PostingListHeaderV1>(&headers[offset_left..(offset_left + POSTING_HEADER_V1_SIZE)]).clone().into()
+            }
+            Revision::V2 => {
+                let offset_left = dim_id * POSTING_HEADER_V2_SIZE;
+                transmute_from_u8::<PostingListHeaderV2>(&headers[offset_left..(offset_left + POSTING_HEADER_V2_SIZE)]).clone().into()
+            }
+            Revision::V3 => {
+                let offset_left = dim_id * POSTING_HEADER_SIZE;
+                (*transmute_from_u8::<PackedPostingListHeader>(&headers[offset_left..(offset_left + POSTING_HEADER_SIZE)])).into()
+            }
+        }
+    }
+
+    /// Write this header into slot `dim_id` of a headers file, always in the latest revision.
+    pub fn write(&self, headers: &mut [u8], dim_id: usize) {
+        let offset_left = dim_id * POSTING_HEADER_SIZE;
+        headers[offset_left..(offset_left + POSTING_HEADER_SIZE)].copy_from_slice(transmute_to_u8(&PackedPostingListHeader::from(self)));
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_packed_header_round_trip() {
+        let header = PostingListHeader {
+            start: 1 << 33,
+            end: (1 << 33) + 4096,
+            quantized_params: Some(QuantizedParam::from_minmax(0.5, 3.0)),
+            element_type: ElementType::EXTENDED,
+            row_ids_count: 512,
+            max_row_id: 100_000,
+            min_weight: 0.5,
+            max_weight: 3.0,
+            columnar: true,
+            block_quantized: true,
+        };
+        let mut headers = vec![0u8; POSTING_HEADER_SIZE * 2];
+        header.write(&mut headers, 1);
+
+        let decoded = PostingListHeader::read(&headers, 1, &Revision::V3);
+        assert_eq!((decoded.start, decoded.end), (header.start, header.end));
+        assert_eq!(decoded.quantized_params, header.quantized_params);
+        assert_eq!(decoded.element_type, header.element_type);
+        assert_eq!((decoded.row_ids_count, decoded.max_row_id), (header.row_ids_count, header.max_row_id));
+        assert_eq!((decoded.min_weight, decoded.max_weight), (header.min_weight, header.max_weight));
+        assert!(decoded.columnar);
+        assert!(decoded.block_quantized);
+
+        let empty = PostingListHeader::read(&headers, 0, &Revision::V3);
+        assert!(empty.quantized_params.is_none());
+        assert_eq!(empty.element_type, ElementType::SIMPLE);
+        assert_eq!(empty.start, empty.end);
+        assert!(!empty.columnar);
+        assert!(!empty.block_quantized);
+    }
+}
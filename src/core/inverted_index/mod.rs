@@ -18,6 +18,9 @@ pub use traits::*;
 pub const INVERTED_INDEX_META_FILE_SUFFIX: &str = ".meta.json";
 pub const INVERTED_INDEX_FILE_NAME: &str = "inverted_index";
 
+// SINGLE FILE SEGMENT, HOLDS META AND ALL SECTIONS BELOW
+pub const INVERTED_INDEX_CONTAINER_SUFFIX: &str = ".segment";
+
 // FOR SIMPLE INVERTED INDEX
 pub const INVERTED_INDEX_HEADERS_SUFFIX: &str = ".headers";
 pub const INVERTED_INDEX_POSTINGS_SUFFIX: &str = ".postings";
@@ -0,0 +1,215 @@
+//! Bulk build: rows are appended as flat (dim, row, weight) triples and radix sorted by (dim, row) once at build,
+//! instead of being upserted into a posting per element.
+
+use super::chunked_arena::ChunkedArena;
+use crate::core::DimId;
+use crate::RowId;
+
+/// Sort key bits consumed by one radix pass.
+const RADIX_BITS: u32 = 8;
+const RADIX_BUCKETS: usize = 1 << RADIX_BITS;
+const RADIX_PASSES: usize = (u64::BITS / RADIX_BITS) as usize;
+
+#[derive(Debug, Default, Clone, Copy, PartialEq)]
+struct BulkElement {
+    dim_id: DimId,
+    row_id: RowId,
+    weight: f32,
+}
+
+impl BulkElement {
+    fn key(&self) -> u64 {
+        ((self.dim_id as u64) << 32) | self.row_id as u64
+    }
+
+    fn digit(&self, pass: usize) -> usize {
+        (self.key() >> (pass as u32 * RADIX_BITS)) as usize & (RADIX_BUCKETS - 1)
+    }
+}
+
+/// Writes `element` to the next slot of its bucket, `offsets` start as the first slot of every bucket.
+fn scatter(element: BulkElement, pass: usize, offsets: &mut [usize; RADIX_BUCKETS], dst: &mut [BulkElement]) {
+    let bucket = element.digit(pass);
+    dst[offsets[bucket]] = element;
+    offsets[bucket] += 1;
+}
+
+/// Stable LSD radix sort by (dim, row), passes where every key shares the digit are skipped.
+/// Counts of all passes are taken in one read of the arena and the first pass scatters straight
+/// from its chunks, freeing each one once scattered, so elements are never copied out unsorted.
+fn radix_sort(elements: ChunkedArena<BulkElement>) -> Vec<BulkElement> {
+    let len = elements.len();
+    let mut counts = [[0usize; RADIX_BUCKETS]; RADIX_PASSES];
+    for element in elements.iter() {
+        for (pass, count) in counts.iter_mut().enumerate() {
+            count[element.digit(pass)] += 1;
+        }
+    }
+    let bucket_offsets = |pass: usize| {
+        let mut offsets = [0usize; RADIX_BUCKETS];
+        let mut offset = 0;
+        for (slot, &count) in offsets.iter_mut().zip(counts[pass].iter()) {
+            *slot = offset;
+            offset += count;
+        }
+        offsets
+    };
+    let mut passes = (0..RADIX_PASSES).filter(|&pass| counts[pass].iter().all(|&count| count != len));
+
+    let mut src = match passes.next() {
+        Some(pass) => {
+            let mut dst = vec![BulkElement::default(); len];
+            let mut offsets = bucket_offsets(pass);
+            for chunk in elements.into_chunks() {
+                for &element in &chunk {
+                    scatter(element, pass, &mut offsets, &mut dst);
+                }
+            }
+            dst
+        }
+        // At most one distinct key, push order is already sorted.
+        None => return elements.into_chunks().flatten().collect(),
+    };
+    let mut dst = Vec::new();
+    for pass in passes {
+        dst.resize(len, BulkElement::default());
+        let mut offsets = bucket_offsets(pass);
+        for &element in &src {
+            scatter(element, pass, &mut offsets, &mut dst);
+        }
+        std::mem::swap(&mut src, &mut dst);
+    }
+    src
+}
+
+#[derive(Debug, Default)]
+pub struct BulkElements {
+    elements: ChunkedArena<BulkElement>,
+    /// Bit per row id that was added, indexed from `rows_base` so memory follows the span of row ids added, not the largest one.
+    rows: Vec<u64>,
+    /// First row id of `rows[0]`, a multiple of 64.
+    rows_base: RowId,
+}
+
+impl BulkElements {
+    /// Returns `true` if `row_id` was not added before, adding a row again updates the weights it shares.
+    pub fn push_row(&mut self, row_id: RowId, dim_ids: &[DimId], weights: &[f32]) -> bool {
+        for (&dim_id, &weight) in dim_ids.iter().zip(weights.iter()) {
+            self.elements.push(BulkElement { dim_id, row_id, weight });
+        }
+
+        let row_base = row_id - row_id % 64;
+        if self.rows.is_empty() {
+            self.rows_base = row_base;
+        } else if row_base < self.rows_base {
+            // Grow downwards at least by the current length, so rows added in descending order shift the bitmap
+            // a logarithmic number of times, never below row id 0.
+            let needed = (self.rows_base - row_base) as usize / 64;
+            let words = needed.max(self.rows.len()).min(self.rows_base as usize / 64);
+            self.rows.splice(0..0, std::iter::repeat(0).take(words));
+            self.rows_base -= (words * 64) as RowId;
+        }
+        let (word, bit) = ((row_id - self.rows_base) as usize / 64, row_id % 64);
+        if word >= self.rows.len() {
+            self.rows.resize(word + 1, 0);
+        }
+        let is_insert = self.rows[word] & (1 << bit) == 0;
+        self.rows[word] |= 1 << bit;
+        is_insert
+    }
+
+    pub fn memory_usage(&self) -> usize {
+        self.elements.memory_usage() + self.rows.capacity() * std::mem::size_of::<u64>()
+    }
+
+    /// Calls `f` with every posting in dim id order, elements sorted by row id. The last weight added for a (dim, row) wins.
+    pub fn for_each_posting<E>(self, mut f: impl FnMut(DimId, &[(RowId, f32)]) -> Result<(), E>) -> Result<(), E> {
+        let sorted = radix_sort(self.elements);
+        let mut posting: Vec<(RowId, f32)> = Vec::new();
+        for (i, element) in sorted.iter().enumerate() {
+            let next = sorted.get(i + 1);
+            if next.map_or(false, |next| next.key() == element.key()) {
+                continue;
+            }
+            posting.push((element.row_id, element.weight));
+            if next.map_or(true, |next| next.dim_id != element.dim_id) {
+                f(element.dim_id, &posting)?;
+                posting.clear();
+            }
+        }
+        Ok(())
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use rand::{rngs::StdRng, Rng, SeedableRng};
+
+    use super::*;
+
+    #[test]
+    fn test_radix_sort() {
+        let mut rng = StdRng::seed_from_u64(42);
+        let elements: Vec<BulkElement> = (0..10000).map(|i| BulkElement { dim_id: rng.gen_range(0..300), row_id: rng.gen_range(0..5000), weight: i as f32 }).collect();
+        let mut arena = ChunkedArena::default();
+        for &element in &elements {
+            arena.push(element);
+        }
+        let mut expected = elements;
+        expected.sort_by_key(|element| element.key());
+        assert_eq!(radix_sort(arena), expected);
+    }
+
+    #[test]
+    fn test_for_each_posting() {
+        let mut bulk = BulkElements::default();
+        assert!(bulk.push_row(7, &[3, 1], &[0.7, 0.1]));
+        assert!(bulk.push_row(2, &[1, 70000], &[0.2, 2.0]));
+        assert!(!bulk.push_row(7, &[1], &[0.9]));
+
+        let mut postings = vec![];
+        bulk.for_each_posting(|dim_id, elements| -> Result<(), ()> {
+            postings.push((dim_id, elements.to_vec()));
+            Ok(())
+        })
+        .unwrap();
+        assert_eq!(postings, vec![(1, vec![(2, 0.2), (7, 0.9)]), (3, vec![(7, 0.7)]), (70000, vec![(2, 2.0)])]);
+    }
+
+    #[test]
+    fn test_rows_from_large_row_id() {
+        let mut bulk = BulkElements::default();
+        let base = 1_000_000_000;
+        assert!(bulk.push_row(base + 100, &[1], &[0.1]));
+        assert!(bulk.push_row(base, &[1], &[0.2]));
+        assert!(bulk.push_row(base - 1000, &[2], &[0.3]));
+        assert!(!bulk.push_row(base + 100, &[2], &[0.4]));
+        assert!(!bulk.push_row(base, &[3], &[0.5]));
+        assert!(!bulk.push_row(base - 1000, &[3], &[0.6]));
+        assert!(bulk.push_row(base + 5000, &[3], &[0.7]));
+
+        // Rows span about 6000 row ids, the bitmap doesn't reserve bits for row ids below them.
+        assert!(bulk.rows.len() <= 6000 / 64 + 2);
+        assert!(bulk.memory_usage() < 64 << 10);
+    }
+
+    #[test]
+    fn test_rows_in_descending_order() {
+        let mut bulk = BulkElements::default();
+        let (low, high) = (1_000_000, 1_100_000);
+        for row_id in (low..high).rev() {
+            assert!(bulk.push_row(row_id, &[1], &[0.1]));
+        }
+        assert!(!bulk.push_row(low, &[1], &[0.2]));
+        assert!(!bulk.push_row(high - 1, &[1], &[0.2]));
+        // Growing by the current length at most doubles the span covered, and stops at row id 0.
+        assert!(bulk.rows.len() <= 2 * (high - low) as usize / 64 + 2);
+        assert!(bulk.rows_base <= low);
+
+        let mut bulk = BulkElements::default();
+        assert!(bulk.push_row(6400, &[1], &[0.1]));
+        assert!(bulk.push_row(6336, &[1], &[0.1]));
+        assert!(bulk.push_row(0, &[1], &[0.1]));
+        assert_eq!(bulk.rows_base, 0);
+    }
+}
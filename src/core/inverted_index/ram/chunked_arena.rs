@@ -0,0 +1,68 @@
+//! Append-only arena of fixed capacity chunks, so memory accounting sees the bytes actually reserved
+//! and growing never copies what was appended before.
+
+use std::mem::size_of;
+
+/// First chunk reserves this many bytes, later ones double up to `MAX_CHUNK_BYTES`.
+const MIN_CHUNK_BYTES: usize = 4 << 10;
+const MAX_CHUNK_BYTES: usize = 1 << 20;
+
+#[derive(Debug, Default)]
+pub struct ChunkedArena<T: Copy> {
+    /// Every chunk but the last is full, none of them ever reallocates.
+    chunks: Vec<Vec<T>>,
+    len: usize,
+    reserved_bytes: usize,
+}
+
+impl<T: Copy> ChunkedArena<T> {
+    pub fn push(&mut self, value: T) {
+        if self.chunks.last().map_or(true, |chunk| chunk.len() == chunk.capacity()) {
+            let chunk_bytes = (self.reserved_bytes.max(MIN_CHUNK_BYTES / 2) * 2).min(MAX_CHUNK_BYTES);
+            let chunk = Vec::with_capacity((chunk_bytes / size_of::<T>()).max(1));
+            self.reserved_bytes += chunk.capacity() * size_of::<T>();
+            self.chunks.push(chunk);
+        }
+        self.chunks.last_mut().unwrap().push(value);
+        self.len += 1;
+    }
+
+    pub fn len(&self) -> usize {
+        self.len
+    }
+
+    /// Bytes reserved by the chunks and the chunk list.
+    pub fn memory_usage(&self) -> usize {
+        self.reserved_bytes + self.chunks.capacity() * size_of::<Vec<T>>()
+    }
+
+    /// Values in push order.
+    pub fn iter(&self) -> impl Iterator<Item = &T> {
+        self.chunks.iter().flatten()
+    }
+
+    /// Chunks in push order, each one is freed as soon as the caller drops it.
+    pub fn into_chunks(self) -> impl Iterator<Item = Vec<T>> {
+        self.chunks.into_iter()
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_chunked_arena() {
+        let mut arena = ChunkedArena::<u64>::default();
+        assert_eq!(arena.memory_usage(), 0);
+        for value in 0..300_000u64 {
+            arena.push(value);
+        }
+        assert_eq!(arena.len(), 300_000);
+        // Chunks grow from 4 KiB up to 1 MiB, the last one is partly used.
+        assert!(arena.memory_usage() >= 300_000 * 8 && arena.memory_usage() < 300_000 * 8 + MAX_CHUNK_BYTES + 4096);
+        assert!(arena.chunks.iter().all(|chunk| chunk.capacity() * 8 <= MAX_CHUNK_BYTES));
+        assert!(arena.iter().copied().eq(0..300_000u64));
+        assert_eq!(arena.into_chunks().flatten().collect::<Vec<_>>(), (0..300_000u64).collect::<Vec<_>>());
+    }
+}
@@ -5,10 +5,17 @@ use crate::core::{ElementType, InvertedIndexRamAccess, QuantizedParam, Quantized
 
 #[derive(Debug, Clone, PartialEq)]
 pub struct InvertedIndexRam<TW: QuantizedWeight> {
+    /// Indexed by dim id, or by position in `dim_ids` when the dim space is sparse.
     pub(super) postings: Vec<PostingList<TW>>,
+    /// Sorted dim id of each posting, `None` when postings are dense by dim id.
+    pub(super) dim_ids: Option<Vec<DimId>>,
     pub(super) element_type: ElementType,
     pub(super) quantized_params: Vec<Option<QuantizedParam>>,
+    /// Param of every `QUANTIZATION_BLOCK_SIZE` elements for each posting, empty when it's not quantized.
+    pub(super) block_quantized_params: Vec<Vec<QuantizedParam>>,
     pub need_quantized: bool,
+    /// Quantized weights are in `0..=15`, see [`QuantizedParam::to_u4`].
+    pub u4_weights: bool,
     pub(super) metrics: InvertedIndexMetrics,
 }
 
@@ -21,9 +28,28 @@ impl<TW: QuantizedWeight> InvertedIndexRam<TW> {
         &self.quantized_params
     }
 
+    pub fn block_quantized_params(&self) -> &Vec<Vec<QuantizedParam>> {
+        &self.block_quantized_params
+    }
+
+    pub fn is_sparse(&self) -> bool {
+        self.dim_ids.is_some()
+    }
+
+    /// Sorted dim id of every stored posting.
+    pub fn dim_ids(&self) -> Vec<DimId> {
+        match &self.dim_ids {
+            Some(dim_ids) => dim_ids.clone(),
+            None => (0..self.postings.len() as DimId).collect(),
+        }
+    }
+
     /// Get posting list for dim-id
     pub fn get(&self, dim_id: &DimId) -> Option<&PostingList<TW>> {
-        self.postings.get(*dim_id as usize)
+        match &self.dim_ids {
+            Some(dim_ids) => dim_ids.binary_search(dim_id).ok().map(|ordinal| &self.postings[ordinal]),
+            None => self.postings.get(*dim_id as usize),
+        }
     }
 }
 
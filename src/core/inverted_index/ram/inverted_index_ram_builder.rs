@@ -1,18 +1,27 @@
+use std::collections::HashMap;
+use std::mem::size_of;
+
 use log::error;
+use rayon::prelude::*;
 use typed_builder::TypedBuilder;
 
+use super::bulk_elements::BulkElements;
 use super::InvertedIndexRam;
-use crate::core::inverted_index::common::InvertedIndexMetrics;
+use crate::core::inverted_index::common::{use_dim_directory, InvertedIndexMetrics};
 use crate::core::sparse_vector::SparseVector;
+use crate::core::{install_in_flush_pool, DimId, ElementType, InvertedIndexError, InvertedIndexRamBuilderTrait, WeightType};
 use crate::core::{posting_list::PostingListBuilder, QuantizedWeight};
-use crate::core::{DimId, ElementType, InvertedIndexError, InvertedIndexRamBuilderTrait, WeightType};
 use crate::RowId;
 
 #[derive(TypedBuilder)]
 pub struct InvertedIndexRamBuilder<OW: QuantizedWeight, TW: QuantizedWeight> {
+    /// In order of first appearance, `dim_ordinals` maps a dim id to its builder.
     #[builder(default=vec![])]
     posting_builders: Vec<PostingListBuilder<OW, TW>>,
 
+    #[builder(default=HashMap::new())]
+    dim_ordinals: HashMap<DimId, usize>,
+
     #[builder(default=ElementType::SIMPLE)]
     element_type: ElementType,
 
@@ -24,6 +33,85 @@ pub struct InvertedIndexRamBuilder<OW: QuantizedWeight, TW: QuantizedWeight> {
 
     #[builder(default = false)]
     propagate_while_upserting: bool,
+
+    /// Quantized weights keep 4 bits, they are nibble packed once the index is compressed.
+    #[builder(default = false)]
+    u4_weights: bool,
+
+    /// Set by `with_bulk_build`, rows are kept as triples and sorted into postings by `build`.
+    #[builder(default = None)]
+    bulk_elements: Option<BulkElements>,
+}
+
+impl<OW: QuantizedWeight, TW: QuantizedWeight> InvertedIndexRamBuilder<OW, TW> {
+    /// Quantize weights into 4 bits, only postings with quantized weights are affected.
+    pub fn with_u4_weights(mut self) -> Self {
+        self.u4_weights = true;
+        self
+    }
+
+    /// Rows added by `add` are appended and sorted once at build, instead of upserted into their postings.
+    /// Cheaper per element and out of order rows cost the same as ordered ones, the sort needs another copy of the triples.
+    pub fn with_bulk_build(mut self) -> Self {
+        self.bulk_elements = Some(BulkElements::default());
+        self
+    }
+
+    /// Add the whole posting of `dim_id` at once, `elements` are sorted by row id. Vector count is left to `set_vector_count`.
+    pub fn add_posting(&mut self, dim_id: DimId, elements: &[(RowId, f32)]) -> Result<(), InvertedIndexError> {
+        if elements.is_empty() {
+            return Ok(());
+        }
+        let builder = Self::filled_posting_builder(self.element_type, self.propagate_while_upserting, self.u4_weights, elements)?;
+        self.push_posting(dim_id, builder, elements)
+    }
+
+    /// Add whole postings of many dims, like `add_posting`. Their builders are filled in parallel on the flush pool.
+    pub fn add_postings(&mut self, postings: &[(DimId, Vec<(RowId, f32)>)]) -> Result<(), InvertedIndexError> {
+        let (element_type, propagate_while_upserting, u4_weights) = (self.element_type, self.propagate_while_upserting, self.u4_weights);
+        let builders = install_in_flush_pool(|| {
+            postings
+                .par_iter()
+                .filter(|(_, elements)| !elements.is_empty())
+                .map(|(dim_id, elements)| Self::filled_posting_builder(element_type, propagate_while_upserting, u4_weights, elements).map(|builder| (*dim_id, builder, elements)))
+                .collect::<Result<Vec<_>, _>>()
+        })?;
+        for (dim_id, builder, elements) in builders {
+            self.push_posting(dim_id, builder, elements)?;
+        }
+        Ok(())
+    }
+
+    fn filled_posting_builder(
+        element_type: ElementType,
+        propagate_while_upserting: bool,
+        u4_weights: bool,
+        elements: &[(RowId, f32)],
+    ) -> Result<PostingListBuilder<OW, TW>, InvertedIndexError> {
+        let mut builder = PostingListBuilder::<OW, TW>::new(element_type, propagate_while_upserting).map_err(|e| InvertedIndexError::from(e))?.with_u4_weights(u4_weights);
+        for &(row_id, weight) in elements {
+            builder.add(row_id, weight);
+        }
+        Ok(builder)
+    }
+
+    /// Register the filled builder of a non empty posting, `elements` are sorted by row id.
+    fn push_posting(&mut self, dim_id: DimId, builder: PostingListBuilder<OW, TW>, elements: &[(RowId, f32)]) -> Result<(), InvertedIndexError> {
+        if self.dim_ordinals.contains_key(&dim_id) {
+            return Err(InvertedIndexError::InvalidParameter(format!("[InvertedIndexRamBuilder] posting of dim {} is already added.", dim_id)));
+        }
+        self.metrics.compare_and_update_row_id(elements[0].0);
+        self.metrics.compare_and_update_row_id(elements[elements.len() - 1].0);
+        self.memory_consumed = self.memory_consumed.saturating_add(builder.memory_usage().0);
+        self.metrics.compare_and_update_dim_id(dim_id);
+        self.dim_ordinals.insert(dim_id, self.posting_builders.len());
+        self.posting_builders.push(builder);
+        Ok(())
+    }
+
+    pub fn set_vector_count(&mut self, vector_count: usize) {
+        self.metrics.vector_count = vector_count;
+    }
 }
 
 /// Operation
@@ -31,6 +119,7 @@ impl<OW: QuantizedWeight, TW: QuantizedWeight> InvertedIndexRamBuilderTrait<TW>
     fn new(element_type: ElementType) -> InvertedIndexRamBuilder<OW, TW> {
         InvertedIndexRamBuilder::builder()
             .posting_builders(vec![])
+            .dim_ordinals(HashMap::new())
             .element_type(element_type)
             .memory_consumed(0)
             .metrics(InvertedIndexMetrics::default())
@@ -38,8 +127,11 @@ impl<OW: QuantizedWeight, TW: QuantizedWeight> InvertedIndexRamBuilderTrait<TW>
             .build()
     }
 
+    /// Bytes reserved by postings, the builders and dim map holding them, and bulk elements.
     fn memory_usage(&self) -> Result<usize, InvertedIndexError> {
-        Ok(self.memory_consumed)
+        let builders = self.posting_builders.capacity() * size_of::<PostingListBuilder<OW, TW>>() + self.dim_ordinals.capacity() * size_of::<(DimId, usize)>();
+        let bulk = self.bulk_elements.as_ref().map_or(0, |bulk| bulk.memory_usage());
+        Ok(self.memory_consumed.saturating_add(builders).saturating_add(bulk))
     }
 
     /// ## brief
@@ -47,19 +139,35 @@ impl<OW: QuantizedWeight, TW: QuantizedWeight> InvertedIndexRamBuilderTrait<TW>
     /// ## return
     /// bool: `true` if operation is `insert`, otherwise is `update`
     fn add(&mut self, row_id: RowId, vector: SparseVector) -> Result<bool, InvertedIndexError> {
+        if let Some(bulk) = self.bulk_elements.as_mut() {
+            let is_insert_operation = bulk.push_row(row_id, &vector.indices, &vector.values);
+            vector.indices.iter().for_each(|&dim_id| self.metrics.compare_and_update_dim_id(dim_id));
+            if is_insert_operation {
+                self.metrics.increase_vector_count();
+            }
+            self.metrics.compare_and_update_row_id(row_id);
+            return Ok(is_insert_operation);
+        }
+
         let mut is_insert_operation = true;
         for (dim_id, weight) in vector.indices.into_iter().zip(vector.values.into_iter()) {
-            let dim_id = dim_id as usize;
-            // resize postings.
-            if dim_id >= self.posting_builders.len() {
-                let empty_builder = PostingListBuilder::<OW, TW>::new(self.element_type, self.propagate_while_upserting).map_err(|e| InvertedIndexError::from(e))?;
-                self.posting_builders.resize_with(dim_id + 1, || empty_builder.clone());
-            }
+            // only dims that appear get a builder, hashed dim ids would explode a dense vector.
+            let ordinal = match self.dim_ordinals.get(&dim_id) {
+                Some(&ordinal) => ordinal,
+                None => {
+                    let builder = PostingListBuilder::<OW, TW>::new(self.element_type, self.propagate_while_upserting)
+                        .map_err(|e| InvertedIndexError::from(e))?
+                        .with_u4_weights(self.u4_weights);
+                    self.posting_builders.push(builder);
+                    self.dim_ordinals.insert(dim_id, self.posting_builders.len() - 1);
+                    self.posting_builders.len() - 1
+                }
+            };
             // insert new sparse_vector into postings.
-            let actual_memory_before = self.posting_builders[dim_id].memory_usage().0;
-            let operation = self.posting_builders[dim_id].add(row_id, weight);
+            let actual_memory_before = self.posting_builders[ordinal].memory_usage().0;
+            let operation = self.posting_builders[ordinal].add(row_id, weight);
             is_insert_operation &= operation;
-            let actual_memory_after = self.posting_builders[dim_id].memory_usage().0;
+            let actual_memory_after = self.posting_builders[ordinal].memory_usage().0;
 
             self.memory_consumed = self.memory_consumed.saturating_add(actual_memory_after - actual_memory_before);
             self.metrics.compare_and_update_dim_id(dim_id as DimId);
@@ -75,7 +183,7 @@ impl<OW: QuantizedWeight, TW: QuantizedWeight> InvertedIndexRamBuilderTrait<TW>
     }
 
     /// Consumes the builder and returns an InvertedIndexRam
-    fn build(self) -> Result<InvertedIndexRam<TW>, InvertedIndexError> {
+    fn build(mut self) -> Result<InvertedIndexRam<TW>, InvertedIndexError> {
         let need_quantized = TW::weight_type() != OW::weight_type() && TW::weight_type() == WeightType::WeightU8;
         if !need_quantized && TW::weight_type() != OW::weight_type() {
             let error_msg = "[InvertedIndexRam] WeightType should keep same, while quantized is disabled.";
@@ -83,15 +191,127 @@ impl<OW: QuantizedWeight, TW: QuantizedWeight> InvertedIndexRamBuilderTrait<TW>
             return Err(InvertedIndexError::InvalidParameter(error_msg.to_string()));
         }
 
-        let mut postings = Vec::with_capacity(self.posting_builders.len());
-        let mut quantized_params = Vec::with_capacity(self.posting_builders.len());
+        if let Some(bulk) = self.bulk_elements.take() {
+            bulk.for_each_posting(|dim_id, elements| self.add_posting(dim_id, elements))?;
+        }
+
+        let mut posting_builders: Vec<Option<PostingListBuilder<OW, TW>>> = self.posting_builders.into_iter().map(Some).collect();
+        let mut dim_ordinals: Vec<(DimId, usize)> = self.dim_ordinals.into_iter().collect();
+        dim_ordinals.sort_unstable();
 
-        for builder in self.posting_builders.into_iter() {
-            let (posting, quantized_param) = builder.build().map_err(|e| InvertedIndexError::from(e))?;
+        // Sparse dim spaces only keep the used dims, dense ones fill the gaps with empty postings.
+        let sparse = dim_ordinals.last().map_or(false, |&(max_dim_id, _)| use_dim_directory(dim_ordinals.len(), max_dim_id));
+        let mut dim_ids = Vec::new();
+        let mut ordered_builders = Vec::new();
+        for (dim_id, ordinal) in dim_ordinals {
+            while !sparse && ordered_builders.len() < dim_id as usize {
+                ordered_builders.push(None);
+            }
+            dim_ids.push(dim_id);
+            ordered_builders.push(posting_builders[ordinal].take());
+        }
+
+        // Postings are sorted and quantized independently, spread over the flush pool.
+        let (element_type, propagate_while_upserting) = (self.element_type, self.propagate_while_upserting);
+        let built = install_in_flush_pool(|| {
+            ordered_builders
+                .into_par_iter()
+                .map(|builder| match builder {
+                    Some(builder) => builder.build_block_quantized(),
+                    None => PostingListBuilder::<OW, TW>::new(element_type, propagate_while_upserting).and_then(|builder| builder.build_block_quantized()),
+                })
+                .collect::<Result<Vec<_>, _>>()
+        })
+        .map_err(|e| InvertedIndexError::from(e))?;
+        let mut postings = Vec::with_capacity(built.len());
+        let mut quantized_params = Vec::with_capacity(built.len());
+        let mut block_quantized_params = Vec::with_capacity(built.len());
+        for (posting, quantized_param, block_params) in built {
             postings.push(posting);
             quantized_params.push(quantized_param);
+            block_quantized_params.push(block_params);
+        }
+
+        Ok(InvertedIndexRam::<TW> {
+            postings,
+            dim_ids: if sparse { Some(dim_ids) } else { None },
+            quantized_params,
+            block_quantized_params,
+            metrics: self.metrics,
+            element_type: self.element_type,
+            need_quantized,
+            u4_weights: self.u4_weights && need_quantized,
+        })
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    /// Rows in shuffled order, some added twice with a weight changed.
+    fn rows() -> Vec<(RowId, SparseVector)> {
+        let mut rows: Vec<(RowId, SparseVector)> =
+            (0..500).map(|row_id| (row_id * 7 % 500, SparseVector { indices: vec![row_id % 13, 20 + row_id % 5, 100], values: vec![row_id as f32 / 100.0, 0.5, 1.0] })).collect();
+        rows.push((42, SparseVector { indices: vec![100], values: vec![3.0] }));
+        rows
+    }
+
+    #[test]
+    fn test_bulk_build_matches_upserts() {
+        let mut upserting = InvertedIndexRamBuilder::<f32, u8>::new(ElementType::SIMPLE);
+        let mut bulk = InvertedIndexRamBuilder::<f32, u8>::new(ElementType::SIMPLE).with_bulk_build();
+        for (row_id, vector) in rows() {
+            assert_eq!(upserting.add(row_id, vector.clone()).unwrap(), bulk.add(row_id, vector).unwrap());
         }
+        assert!(bulk.memory_usage().unwrap() > 0);
+        assert_eq!(bulk.build().unwrap(), upserting.build().unwrap());
+    }
+
+    #[test]
+    fn test_add_postings_matches_add_posting() {
+        let postings: Vec<(DimId, Vec<(RowId, f32)>)> =
+            (0..40).map(|dim_id| (dim_id * 3, (0..dim_id * 10).map(|row_id| (row_id * 2 + dim_id, (row_id + dim_id) as f32 / 50.0)).collect())).collect();
+        let mut one_by_one = InvertedIndexRamBuilder::<f32, u8>::new(ElementType::SIMPLE);
+        let mut parallel = InvertedIndexRamBuilder::<f32, u8>::new(ElementType::SIMPLE);
+        for (dim_id, elements) in &postings {
+            one_by_one.add_posting(*dim_id, elements).unwrap();
+        }
+        parallel.add_postings(&postings).unwrap();
+        assert!(parallel.add_postings(&postings[1..2]).is_err());
+        assert_eq!(parallel.memory_usage().unwrap(), one_by_one.memory_usage().unwrap());
+        assert_eq!(parallel.build().unwrap(), one_by_one.build().unwrap());
+    }
+}
+
+#[cfg(all(test, feature = "unstable"))]
+mod bench {
+    use test::Bencher;
+
+    use super::*;
+
+    /// Rows arrive out of order, e.g. several threads feeding one segment.
+    fn rows() -> Vec<(RowId, SparseVector)> {
+        (0..20000u32).map(|row_id| (row_id * 7919 % 20000, SparseVector { indices: (0..32).map(|i| (row_id * 31 + i * 97) % 5000).collect(), values: vec![0.5; 32] })).collect()
+    }
+
+    fn build(builder: InvertedIndexRamBuilder<f32, f32>, rows: &[(RowId, SparseVector)]) -> InvertedIndexRam<f32> {
+        let mut builder = builder;
+        for (row_id, vector) in rows {
+            builder.add(*row_id, vector.clone()).unwrap();
+        }
+        builder.build().unwrap()
+    }
+
+    #[bench]
+    fn bench_build_upserting(b: &mut Bencher) {
+        let rows = rows();
+        b.iter(|| build(InvertedIndexRamBuilder::new(ElementType::SIMPLE), &rows));
+    }
 
-        Ok(InvertedIndexRam::<TW> { postings, quantized_params, metrics: self.metrics, element_type: self.element_type, need_quantized })
+    #[bench]
+    fn bench_build_bulk(b: &mut Bencher) {
+        let rows = rows();
+        b.iter(|| build(InvertedIndexRamBuilder::new(ElementType::SIMPLE).with_bulk_build(), &rows));
     }
 }
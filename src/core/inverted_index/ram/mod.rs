@@ -1,3 +1,5 @@
+mod bulk_elements;
+mod chunked_arena;
 mod inverted_index_ram;
 mod inverted_index_ram_builder;
 
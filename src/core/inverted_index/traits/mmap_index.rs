@@ -5,11 +5,13 @@ use enum_dispatch::enum_dispatch;
 
 use crate::core::inverted_index::common::InvertedIndexMetrics;
 use crate::core::inverted_index::InvertedIndexRam;
-use crate::core::{DimId, PostingListIter, QuantizedWeight};
+use crate::core::{DimId, LoadPolicy, MmapSection, PostingListIter, QuantizedWeight};
 use std::borrow::Cow;
 use std::fmt::Debug;
 use std::path::{Path, PathBuf};
 
+use crate::RowId;
+
 // OW: weight type before quantized.
 // TW: weight type after quantized. stored in disk.
 pub trait PostingListIterAccess<OW: QuantizedWeight, TW: QuantizedWeight> {
@@ -20,10 +22,30 @@ pub trait PostingListIterAccess<OW: QuantizedWeight, TW: QuantizedWeight> {
 
     /// Get posting list for dimension id
     fn iter(&self, dim_id: &DimId) -> Option<Self::Iter<'_>>;
+
+    /// Read postings of the query dims before iterating them, returns posting cache hits and misses.
+    /// Only indexes reading postings through the posting cache do anything here.
+    fn prefetch(&self, _dim_ids: &[DimId]) -> (u64, u64) {
+        (0, 0)
+    }
+
+    /// External row id of every internal row id, only segments reordered while merging have one.
+    fn row_id_map(&self) -> Option<MmapSection> {
+        None
+    }
+
+    /// Added to row ids of segments storing segment-local ones, unused when a row id map exists.
+    fn row_id_base(&self) -> RowId {
+        0
+    }
 }
 
 pub trait InvertedIndexMmapInit<OW: QuantizedWeight, TW: QuantizedWeight>: Sized + Debug {
-    fn open(path: &Path, segment_id: Option<&str>) -> std::io::Result<Self>;
+    fn open(path: &Path, segment_id: Option<&str>) -> std::io::Result<Self> {
+        Self::open_with_policy(path, segment_id, LoadPolicy::default())
+    }
+    /// open with the given load policy.
+    fn open_with_policy(path: &Path, segment_id: Option<&str>, load_policy: LoadPolicy) -> std::io::Result<Self>;
     /// convert from a simple ram index.
     fn from_ram_index(
         // ram index can be quantized type.
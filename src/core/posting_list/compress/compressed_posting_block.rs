@@ -1,5 +1,7 @@
+use std::mem::{align_of, size_of, size_of_val};
+
 use crate::{
-    core::{ElementType, QuantizedParam, QuantizedWeight, WeightType, COMPRESSION_BLOCK_SIZE},
+    core::{transmute_from_u8_to_slice, transmute_to_u8_slice, u4_weight, ElementType, QuantizedParam, QuantizedWeight, COMPRESSION_BLOCK_SIZE, QUANTIZATION_BLOCK_SIZE},
     RowId,
 };
 
@@ -28,14 +30,34 @@ impl Into<ElementType> for CompressedBlockType {
     }
 }
 
-pub trait CompressedPostingBlock<W: QuantizedWeight> {
-    #[allow(unused)]
-    fn compressed_block_type(&self) -> CompressedBlockType;
+/// Block of a posting written with packed weights, weights of the posting are stored after all of its blocks.
+#[repr(C)]
+#[derive(Debug, Default, Clone, Copy, PartialEq, Eq)]
+pub struct CompressedBlockMeta {
+    pub row_id_start: RowId,
+
+    /// Offset of current block's first weight within the posting's weights.
+    pub weights_offset: u32,
+
+    /// Block's storage offset within the whole `Posting`.
+    pub block_offset: u64,
+
+    /// Current block's `row_ids_compressed`(type is [u8]) data size.
+    pub row_ids_compressed_size: u16,
+
+    /// How many row_ids does current block stored. (We ensure this value smaller than [`COMPRESSION_BLOCK_SIZE`])
+    pub row_ids_count: u8,
 
-    #[allow(unused)]
-    fn approximately_eq(&self, other: &Self, quantized_param: Option<QuantizedParam>) -> bool;
+    /// It's necessary for uncompress operation.
+    pub num_bits: u8,
 }
 
+const _: () = assert!(size_of::<CompressedBlockMeta>() == 24);
+
+// A block shares one quantization param.
+const _: () = assert!(COMPRESSION_BLOCK_SIZE == QUANTIZATION_BLOCK_SIZE);
+
+/// Fixed-size block written before weights were packed, it is only read from old segments.
 #[derive(Debug, Clone, PartialEq, Eq)]
 pub struct SimpleCompressedPostingBlock<TW>
 where
@@ -59,6 +81,7 @@ where
     pub weights: [TW; COMPRESSION_BLOCK_SIZE],
 }
 
+/// Fixed-size block written before weights were packed, it is only read from old segments.
 #[derive(Debug, Clone, PartialEq, Eq)]
 pub struct ExtendedCompressedPostingBlock<TW>
 where
@@ -85,72 +108,269 @@ where
     pub max_next_weights: [TW; COMPRESSION_BLOCK_SIZE],
 }
 
-impl<TW: QuantizedWeight> CompressedPostingBlock<TW> for SimpleCompressedPostingBlock<TW> {
-    fn compressed_block_type(&self) -> CompressedBlockType {
-        CompressedBlockType::Simple
+/// How the blocks bytes of a stored posting are split into `CompressedBlocks`, known from its header before the bytes are read.
+#[derive(Debug, Clone, Copy)]
+pub enum BlocksLayout {
+    Packed { row_ids_count: usize, block_type: CompressedBlockType, block_quantized: bool },
+    PackedU4 { row_ids_count: usize },
+    Legacy(CompressedBlockType),
+}
+
+impl BlocksLayout {
+    pub fn blocks<'a, TW: QuantizedWeight>(&self, bytes: &'a [u8]) -> CompressedBlocks<'a, TW> {
+        match *self {
+            BlocksLayout::Packed { row_ids_count, block_type, block_quantized } => CompressedBlocks::from_packed_bytes(bytes, row_ids_count, block_type, block_quantized),
+            BlocksLayout::PackedU4 { row_ids_count } => CompressedBlocks::from_packed_u4_bytes(bytes, row_ids_count),
+            BlocksLayout::Legacy(CompressedBlockType::Simple) => CompressedBlocks::LegacySimple(transmute_from_u8_to_slice(bytes)),
+            BlocksLayout::Legacy(CompressedBlockType::Extended) => CompressedBlocks::LegacyExtended(transmute_from_u8_to_slice(bytes)),
+        }
     }
+}
 
-    fn approximately_eq(&self, other: &Self, quantized_param: Option<QuantizedParam>) -> bool {
-        if quantized_param.is_none() {
-            return self == other;
-        } else {
-            assert_eq!(TW::weight_type(), WeightType::WeightU8)
+/// Blocks of one posting.
+///
+/// Packed postings are stored as `[metas][params][weights][max_next_weights]` padded to 8 bytes, `params` holds the
+/// quantization param of every block and is empty unless the posting is block quantized, weights hold exactly
+/// `row_ids_count` elements and `max_next_weights` is empty for simple postings.
+///
+/// `u4` postings are simple and block quantized, stored as `[metas][params][weights]` with two weights in a byte.
+#[derive(Debug, Clone, Copy)]
+pub enum CompressedBlocks<'a, TW: QuantizedWeight> {
+    Packed { metas: &'a [CompressedBlockMeta], params: &'a [QuantizedParam], weights: &'a [TW], max_next_weights: &'a [TW] },
+    PackedU4 { metas: &'a [CompressedBlockMeta], params: &'a [QuantizedParam], weights: &'a [u8] },
+    LegacySimple(&'a [SimpleCompressedPostingBlock<TW>]),
+    LegacyExtended(&'a [ExtendedCompressedPostingBlock<TW>]),
+}
+
+impl<'a, TW: QuantizedWeight> Default for CompressedBlocks<'a, TW> {
+    fn default() -> Self {
+        CompressedBlocks::Packed { metas: &[], params: &[], weights: &[], max_next_weights: &[] }
+    }
+}
+
+macro_rules! legacy_meta {
+    ($block:expr, $block_idx:expr) => {
+        CompressedBlockMeta {
+            row_id_start: $block.row_id_start,
+            weights_offset: ($block_idx * COMPRESSION_BLOCK_SIZE) as u32,
+            block_offset: $block.block_offset,
+            row_ids_compressed_size: $block.row_ids_compressed_size,
+            row_ids_count: $block.row_ids_count,
+            num_bits: $block.num_bits,
         }
-        let left = Self { weights: [TW::MINIMUM(); COMPRESSION_BLOCK_SIZE], ..self.clone() };
-        let right = Self { weights: [TW::MINIMUM(); COMPRESSION_BLOCK_SIZE], ..other.clone() };
+    };
+}
+
+impl<'a, TW: QuantizedWeight> CompressedBlocks<'a, TW> {
+    /// Size of a packed posting in blocks storage.
+    pub fn packed_storage_size(row_ids_count: usize, block_type: CompressedBlockType, block_quantized: bool) -> usize {
+        let blocks_count = (row_ids_count + COMPRESSION_BLOCK_SIZE - 1) / COMPRESSION_BLOCK_SIZE;
+        let weights_columns = match block_type {
+            CompressedBlockType::Simple => 1,
+            CompressedBlockType::Extended => 2,
+        };
+        let params_size = if block_quantized { blocks_count * size_of::<QuantizedParam>() } else { 0 };
+        let size = blocks_count * size_of::<CompressedBlockMeta>() + params_size + weights_columns * row_ids_count * size_of::<TW>();
+        (size + PACKED_ALIGNMENT - 1) / PACKED_ALIGNMENT * PACKED_ALIGNMENT
+    }
 
-        if left != right {
-            return false;
+    /// Split the bytes of a packed posting, `bytes` should start at an 8 bytes aligned address.
+    pub fn from_packed_bytes(bytes: &'a [u8], row_ids_count: usize, block_type: CompressedBlockType, block_quantized: bool) -> Self {
+        let blocks_count = (row_ids_count + COMPRESSION_BLOCK_SIZE - 1) / COMPRESSION_BLOCK_SIZE;
+        let (metas, params) = bytes.split_at(blocks_count * size_of::<CompressedBlockMeta>());
+        let (params, weights) = params.split_at(if block_quantized { blocks_count * size_of::<QuantizedParam>() } else { 0 });
+        let (weights, max_next_weights) = weights.split_at(row_ids_count * size_of::<TW>());
+        let max_next_weights = match block_type {
+            CompressedBlockType::Simple => &max_next_weights[..0],
+            CompressedBlockType::Extended => &max_next_weights[..row_ids_count * size_of::<TW>()],
+        };
+        CompressedBlocks::Packed {
+            metas: transmute_from_u8_to_slice(metas),
+            params: transmute_from_u8_to_slice(params),
+            weights: transmute_from_u8_to_slice(weights),
+            max_next_weights: transmute_from_u8_to_slice(max_next_weights),
         }
+    }
+
+    /// Split the bytes of a packed `u4` posting, `bytes` should start at an 8 bytes aligned address.
+    pub fn from_packed_u4_bytes(bytes: &'a [u8], row_ids_count: usize) -> Self {
+        let blocks_count = (row_ids_count + COMPRESSION_BLOCK_SIZE - 1) / COMPRESSION_BLOCK_SIZE;
+        let (metas, params) = bytes.split_at(blocks_count * size_of::<CompressedBlockMeta>());
+        let (params, weights) = params.split_at(blocks_count * size_of::<QuantizedParam>());
+        CompressedBlocks::PackedU4 { metas: transmute_from_u8_to_slice(metas), params: transmute_from_u8_to_slice(params), weights: &weights[..(row_ids_count + 1) / 2] }
+    }
+
+    pub fn is_packed(&self) -> bool {
+        matches!(self, CompressedBlocks::Packed { .. } | CompressedBlocks::PackedU4 { .. })
+    }
+
+    /// Whether every block is quantized with its own param.
+    pub fn is_block_quantized(&self) -> bool {
+        match self {
+            CompressedBlocks::Packed { params, .. } => !params.is_empty(),
+            CompressedBlocks::PackedU4 { .. } => true,
+            _ => false,
+        }
+    }
+
+    pub fn is_u4(&self) -> bool {
+        matches!(self, CompressedBlocks::PackedU4 { .. })
+    }
 
-        let param = quantized_param.unwrap();
-        for (&w1, &w2) in self.weights.iter().zip(&other.weights) {
-            if param.approximately_eq(w1, w2) {
-                continue;
-            } else {
-                return false;
+    pub fn len(&self) -> usize {
+        match self {
+            CompressedBlocks::Packed { metas, .. } => metas.len(),
+            CompressedBlocks::PackedU4 { metas, .. } => metas.len(),
+            CompressedBlocks::LegacySimple(blocks) => blocks.len(),
+            CompressedBlocks::LegacyExtended(blocks) => blocks.len(),
+        }
+    }
+
+    pub fn meta(&self, block_idx: usize) -> Option<CompressedBlockMeta> {
+        match self {
+            CompressedBlocks::Packed { metas, .. } => metas.get(block_idx).copied(),
+            CompressedBlocks::PackedU4 { metas, .. } => metas.get(block_idx).copied(),
+            CompressedBlocks::LegacySimple(blocks) => blocks.get(block_idx).map(|block| legacy_meta!(block, block_idx)),
+            CompressedBlocks::LegacyExtended(blocks) => blocks.get(block_idx).map(|block| legacy_meta!(block, block_idx)),
+        }
+    }
+
+    /// Weights of the block, one for each row id. Nibble packed `u4` weights can't be borrowed as `TW`, it's empty for them.
+    pub fn weights(&self, block_idx: usize) -> &'a [TW] {
+        match *self {
+            CompressedBlocks::Packed { metas, weights, .. } => {
+                let meta = &metas[block_idx];
+                &weights[meta.weights_offset as usize..meta.weights_offset as usize + meta.row_ids_count as usize]
             }
+            CompressedBlocks::PackedU4 { .. } => &[],
+            CompressedBlocks::LegacySimple(blocks) => &blocks[block_idx].weights[..blocks[block_idx].row_ids_count as usize],
+            CompressedBlocks::LegacyExtended(blocks) => &blocks[block_idx].weights[..blocks[block_idx].row_ids_count as usize],
         }
+    }
 
-        return true;
+    /// Weights of the block in any layout, one for each row id.
+    pub fn block_weights(&self, block_idx: usize) -> BlockWeights<'a, TW> {
+        match *self {
+            CompressedBlocks::PackedU4 { metas, weights, .. } => {
+                // Only the tail block has less than 128 weights, so every block starts at a byte boundary.
+                let meta = &metas[block_idx];
+                BlockWeights::U4 { packed: &weights[meta.weights_offset as usize / 2..], start: 0, len: meta.row_ids_count as usize }
+            }
+            _ => BlockWeights::Plain(self.weights(block_idx)),
+        }
     }
-}
 
-impl<TW: QuantizedWeight> CompressedPostingBlock<TW> for ExtendedCompressedPostingBlock<TW> {
-    fn compressed_block_type(&self) -> CompressedBlockType {
-        CompressedBlockType::Extended
+    /// Quantization param of the block, `None` unless the posting is block quantized.
+    pub fn quantized_param(&self, block_idx: usize) -> Option<QuantizedParam> {
+        match self {
+            CompressedBlocks::Packed { params, .. } => params.get(block_idx).copied(),
+            CompressedBlocks::PackedU4 { params, .. } => params.get(block_idx).copied(),
+            _ => None,
+        }
     }
 
-    fn approximately_eq(&self, other: &Self, quantized_param: Option<QuantizedParam>) -> bool {
-        if quantized_param.is_none() {
-            return self == other;
-        } else {
-            assert_eq!(TW::weight_type(), WeightType::WeightU8)
+    /// `max_next_weights` of the block, empty for simple blocks.
+    pub fn max_next_weights(&self, block_idx: usize) -> &'a [TW] {
+        match *self {
+            CompressedBlocks::Packed { metas, max_next_weights, .. } if !max_next_weights.is_empty() => {
+                let meta = &metas[block_idx];
+                &max_next_weights[meta.weights_offset as usize..meta.weights_offset as usize + meta.row_ids_count as usize]
+            }
+            CompressedBlocks::LegacyExtended(blocks) => &blocks[block_idx].max_next_weights[..blocks[block_idx].row_ids_count as usize],
+            _ => &[],
         }
-        let left = Self { weights: [TW::MINIMUM(); COMPRESSION_BLOCK_SIZE], ..self.clone() };
-        let right = Self { weights: [TW::MINIMUM(); COMPRESSION_BLOCK_SIZE], ..other.clone() };
+    }
 
-        if left != right {
-            return false;
+    /// Number of blocks from `block_idx` whose first row id is not greater than `row_id`, the first one excluded.
+    pub fn skippable(&self, block_idx: usize, row_id: RowId) -> usize {
+        match self {
+            CompressedBlocks::Packed { metas, .. } => metas.get(block_idx + 1..).unwrap_or_default().partition_point(|meta| meta.row_id_start <= row_id),
+            CompressedBlocks::PackedU4 { metas, .. } => metas.get(block_idx + 1..).unwrap_or_default().partition_point(|meta| meta.row_id_start <= row_id),
+            CompressedBlocks::LegacySimple(blocks) => blocks.get(block_idx + 1..).unwrap_or_default().partition_point(|block| block.row_id_start <= row_id),
+            CompressedBlocks::LegacyExtended(blocks) => blocks.get(block_idx + 1..).unwrap_or_default().partition_point(|block| block.row_id_start <= row_id),
         }
+    }
 
-        let param = quantized_param.unwrap();
-        // for `weights` and `max_next_weights`.
-        for idx in 0..COMPRESSION_BLOCK_SIZE {
-            let w1 = TW::to_u8(self.weights[idx]);
-            let w2 = TW::to_u8(other.weights[idx]);
-            let mw1 = TW::to_u8(self.max_next_weights[idx]);
-            let mw2 = TW::to_u8(other.max_next_weights[idx]);
+    pub fn storage_size(&self) -> usize {
+        match *self {
+            CompressedBlocks::Packed { metas, params, weights, max_next_weights } => {
+                let size = size_of_val(metas) + size_of_val(params) + size_of_val(weights) + size_of_val(max_next_weights);
+                (size + PACKED_ALIGNMENT - 1) / PACKED_ALIGNMENT * PACKED_ALIGNMENT
+            }
+            CompressedBlocks::PackedU4 { metas, params, weights } => {
+                let size = size_of_val(metas) + size_of_val(params) + weights.len();
+                (size + PACKED_ALIGNMENT - 1) / PACKED_ALIGNMENT * PACKED_ALIGNMENT
+            }
+            CompressedBlocks::LegacySimple(blocks) => size_of_val(blocks),
+            CompressedBlocks::LegacyExtended(blocks) => size_of_val(blocks),
+        }
+    }
 
-            if TW::unquantize_with_param(w1, param.clone()) == TW::unquantize_with_param(w2, param.clone())
-                && TW::unquantize_with_param(mw1, param.clone()) == TW::unquantize_with_param(mw2, param.clone())
-            {
-                continue;
-            } else {
-                return false;
+    /// Write blocks into `output`, whose length is [`Self::storage_size`].
+    pub fn write(&self, output: &mut [u8]) {
+        match *self {
+            CompressedBlocks::Packed { metas, params, weights, max_next_weights } => {
+                let mut offset = 0;
+                for bytes in [transmute_to_u8_slice(metas), transmute_to_u8_slice(params), transmute_to_u8_slice(weights), transmute_to_u8_slice(max_next_weights)] {
+                    output[offset..offset + bytes.len()].copy_from_slice(bytes);
+                    offset += bytes.len();
+                }
+                output[offset..].fill(0);
             }
+            CompressedBlocks::PackedU4 { metas, params, weights } => {
+                let mut offset = 0;
+                for bytes in [transmute_to_u8_slice(metas), transmute_to_u8_slice(params), weights] {
+                    output[offset..offset + bytes.len()].copy_from_slice(bytes);
+                    offset += bytes.len();
+                }
+                output[offset..].fill(0);
+            }
+            CompressedBlocks::LegacySimple(blocks) => output.copy_from_slice(transmute_to_u8_slice(blocks)),
+            CompressedBlocks::LegacyExtended(blocks) => output.copy_from_slice(transmute_to_u8_slice(blocks)),
         }
+    }
+}
+
+/// Packed postings are padded to keep the block metas of the next one aligned.
+const PACKED_ALIGNMENT: usize = align_of::<CompressedBlockMeta>();
+
+/// Weights of a block, nibble packed ones are read without being expanded.
+#[derive(Debug, Clone, Copy)]
+pub enum BlockWeights<'a, TW: QuantizedWeight> {
+    Plain(&'a [TW]),
+    /// `len` weights from nibble `start` of `packed`, low nibble first.
+    U4 {
+        packed: &'a [u8],
+        start: usize,
+        len: usize,
+    },
+}
+
+impl<'a, TW: QuantizedWeight> BlockWeights<'a, TW> {
+    pub fn len(&self) -> usize {
+        match self {
+            BlockWeights::Plain(weights) => weights.len(),
+            BlockWeights::U4 { len, .. } => *len,
+        }
+    }
+
+    pub fn get(&self, idx: usize) -> TW {
+        match *self {
+            BlockWeights::Plain(weights) => weights[idx],
+            BlockWeights::U4 { packed, start, .. } => TW::from_u8(u4_weight(packed, start + idx)),
+        }
+    }
+
+    /// `len` weights from `start`.
+    pub fn slice(&self, start: usize, len: usize) -> Self {
+        match *self {
+            BlockWeights::Plain(weights) => BlockWeights::Plain(&weights[start..start + len]),
+            BlockWeights::U4 { packed, start: offset, .. } => BlockWeights::U4 { packed, start: offset + start, len },
+        }
+    }
 
-        return true;
+    pub fn iter(&self) -> impl Iterator<Item = TW> + 'a {
+        let weights = *self;
+        (0..weights.len()).map(move |idx| weights.get(idx))
     }
 }
@@ -1,8 +1,8 @@
-use super::{CompressedBlockType, CompressedPostingList, ExtendedCompressedPostingBlock, SimpleCompressedPostingBlock};
+use super::{CompressedBlockMeta, CompressedBlockType, CompressedPostingList};
 use crate::{
     core::{
-        posting_list::encoder::VIntEncoder, BlockEncoder, DimWeight, ElementRead, ElementType, ElementWrite, ExtendedElement, GenericElement, PostingList, PostingListError,
-        QuantizedParam, QuantizedWeight, SimpleElement, WeightType, COMPRESSION_BLOCK_SIZE, DEFAULT_MAX_NEXT_WEIGHT,
+        gen_quantized_param_of, BlockEncoder, DimWeight, ElementRead, ElementType, ElementWrite, ExtendedElement, GenericElement, PostingList, PostingListError, QuantizedParam,
+        QuantizedWeight, RowIdCodec, SimpleElement, WeightType, COMPRESSION_BLOCK_SIZE, DEFAULT_MAX_NEXT_WEIGHT,
     },
     RowId,
 };
@@ -38,6 +38,10 @@ where
     #[builder(default = false)]
     pub(super) finally_propagate: bool,
 
+    /// Quantized weights keep 4 bits and are nibble packed.
+    #[builder(default = false)]
+    pub(super) u4_weights: bool,
+
     _phantom_tw: PhantomData<TW>,
 }
 
@@ -67,6 +71,12 @@ impl<OW: QuantizedWeight, TW: QuantizedWeight> CompressedPostingBuilder<OW, TW>
             ._phantom_tw(PhantomData)
             .build())
     }
+
+    /// Quantize weights into 4 bits, it takes effect only when weights need to be quantized.
+    pub fn with_u4_weights(mut self, u4_weights: bool) -> Self {
+        self.u4_weights = u4_weights && self.need_quantized;
+        self
+    }
 }
 
 impl<OW: QuantizedWeight, TW: QuantizedWeight> CompressedPostingBuilder<OW, TW> {
@@ -185,17 +195,36 @@ impl<OW: QuantizedWeight, TW: QuantizedWeight> CompressedPostingBuilder<OW, TW>
 
     fn compress_blocks(
         self,
-        quantized_param: Option<QuantizedParam>,
+        row_id_codec: RowIdCodec,
     ) -> Result<
         (
-            Vec<u8>,                                 // row_ids_compressed
-            Vec<SimpleCompressedPostingBlock<TW>>,   // quantized_blocks may not been quantized.
-            Vec<ExtendedCompressedPostingBlock<TW>>, // quantized_blocks may not been quantized.
+            Vec<u8>,                  // row_ids_compressed
+            Vec<CompressedBlockMeta>, // blocks
+            Vec<QuantizedParam>,      // quantization param of each block, empty if not quantized.
+            Vec<TW>,                  // weights, may not been quantized.
+            Vec<TW>,                  // max_next_weights, empty for simple element.
             RowId,
             Option<RowId>,
         ),
         PostingListError,
     > {
+        // Boundary.
+        if !self.need_quantized && OW::weight_type() != TW::weight_type() {
+            let error_msg = format!(
+                "WeightType should keep same, while quantized is disabled. OW: {:?}, TW: {:?}.
+                 This Error happended during generate compressed blocks.",
+                OW::weight_type(),
+                TW::weight_type()
+            );
+            error!("{}", error_msg);
+            return Err(PostingListError::InvalidParameter(error_msg.to_string()));
+        }
+        if self.need_quantized && self.element_type == ElementType::EXTENDED {
+            let error_msg = "`ExtendedElement` shouldn't be quantized! This error happended during generate compressed blocks.";
+            error!("{}", error_msg);
+            return Err(PostingListError::InvalidParameter(error_msg.to_string()));
+        }
+
         // Init mertics for posting list.
         let mut max_row_id: Option<RowId> = None;
         let mut total_row_ids_count: RowId = 0;
@@ -206,14 +235,13 @@ impl<OW: QuantizedWeight, TW: QuantizedWeight> CompressedPostingBuilder<OW, TW>
         // Init output `row_ids` compressed data for posting list.
         let mut output_row_ids_compressed_in_posting: Vec<u8> = Vec::with_capacity(self.posting.len() / COMPRESSION_BLOCK_SIZE);
 
-        // Init output posting blocks for posting list.
-        let mut output_simple_posting_blocks: Vec<SimpleCompressedPostingBlock<TW>> = match self.element_type {
-            ElementType::SIMPLE => Vec::with_capacity(self.posting.len() / COMPRESSION_BLOCK_SIZE + 1),
-            ElementType::EXTENDED => vec![],
-        };
-        let mut output_extended_posting_blocks: Vec<ExtendedCompressedPostingBlock<TW>> = match self.element_type {
+        // Init output posting blocks and weights, weights are packed without padding.
+        let mut output_posting_blocks: Vec<CompressedBlockMeta> = Vec::with_capacity(self.posting.len() / COMPRESSION_BLOCK_SIZE + 1);
+        let mut output_block_params: Vec<QuantizedParam> = vec![];
+        let mut output_weights: Vec<TW> = Vec::with_capacity(self.posting.len());
+        let mut output_max_next_weights: Vec<TW> = match self.element_type {
             ElementType::SIMPLE => vec![],
-            ElementType::EXTENDED => Vec::with_capacity(self.posting.len() / COMPRESSION_BLOCK_SIZE + 1),
+            ElementType::EXTENDED => Vec::with_capacity(self.posting.len()),
         };
 
         // Init `block_offsets` in compressed row_ids for each 128-Block.
@@ -228,13 +256,7 @@ impl<OW: QuantizedWeight, TW: QuantizedWeight> CompressedPostingBuilder<OW, TW>
             let offset = row_id_start_in_block.checked_sub(1).unwrap_or(0);
 
             // Compress current block's row_ids.
-            let (num_bits, row_ids_compressed_in_block) = if current_block.len() == COMPRESSION_BLOCK_SIZE {
-                // Full block compression
-                encoder.compress_block_sorted(&row_ids_uncompressed_in_block, offset)
-            } else {
-                // Partial block compression (last block)
-                (0, encoder.compress_vint_sorted(&row_ids_uncompressed_in_block, offset))
-            };
+            let (num_bits, row_ids_compressed_in_block) = encoder.compress_row_ids(row_id_codec, &row_ids_uncompressed_in_block, offset);
 
             // Save compressed row_ids to output.
             output_row_ids_compressed_in_posting.extend_from_slice(row_ids_compressed_in_block);
@@ -244,64 +266,27 @@ impl<OW: QuantizedWeight, TW: QuantizedWeight> CompressedPostingBuilder<OW, TW>
             max_row_id = Some(max(max_row_id.unwrap_or(0), current_block.last().map(|w| w.row_id()).unwrap_or(0)));
 
             // Save compressed posting block to output.
+            output_posting_blocks.push(CompressedBlockMeta {
+                row_id_start: row_id_start_in_block,
+                weights_offset: output_weights.len() as u32,
+                block_offset: block_offsets,
+                row_ids_compressed_size: row_ids_compressed_in_block.len() as u16, // We can ensure that the block row_ids compressed size won't exceed u16::max -> 65535.
+                row_ids_count: current_block.len() as u8,                          // We can ensure that the block size won't exceed `COMPRESSION_BLOCK_SIZE`.
+                num_bits,
+            });
+
+            // Save weights of current block to output, quantized ones use the range of current block.
             match self.need_quantized {
                 true => {
-                    match CompressedBlockType::from(self.element_type) {
-                        CompressedBlockType::Simple => {
-                            let block: SimpleCompressedPostingBlock<TW> = SimpleCompressedPostingBlock {
-                                row_id_start: row_id_start_in_block,
-                                block_offset: block_offsets,
-                                row_ids_compressed_size: row_ids_compressed_in_block.len() as u16, // We can ensure that the block row_ids compressed size won't exceed u16::max -> 65535.
-                                row_ids_count: current_block.len() as u8,                          // We can ensure that the block size won't exceed `COMPRESSION_BLOCK_SIZE`.
-                                num_bits,
-                                weights: quantized_weights_for_block::<OW, TW, _>(current_block, quantized_param, |w| w.weight())?,
-                            };
-                            output_simple_posting_blocks.push(block);
-                        }
-                        CompressedBlockType::Extended => {
-                            let error_msg = "`ExtendedElement` shouldn't be quantized! This error happended during generate compressed blocks.";
-                            error!("{}", error_msg);
-                            return Err(PostingListError::InvalidParameter(error_msg.to_string()));
-                        }
-                    }
+                    let block_param = gen_quantized_param_of(current_block.iter().map(|e| e.weight()));
+                    let block_param = if self.u4_weights { block_param.to_u4() } else { block_param };
+                    output_block_params.push(block_param);
+                    output_weights.extend(quantized_weights_for_block::<OW, TW, _>(current_block, Some(block_param), |w| w.weight()));
                 }
                 false => {
-                    // Boundary.
-                    if OW::weight_type() != TW::weight_type() {
-                        let error_msg = format!(
-                            "WeightType should keep same, while quantized is disabled. OW: {:?}, TW: {:?}.
-                             This Error happended during generate compressed blocks.",
-                            OW::weight_type(),
-                            TW::weight_type()
-                        );
-                        error!("{}", error_msg);
-                        return Err(PostingListError::InvalidParameter(error_msg.to_string()));
-                    }
-
-                    match CompressedBlockType::from(self.element_type) {
-                        CompressedBlockType::Simple => {
-                            let block: SimpleCompressedPostingBlock<TW> = SimpleCompressedPostingBlock {
-                                row_id_start: row_id_start_in_block,
-                                block_offset: block_offsets,
-                                row_ids_compressed_size: row_ids_compressed_in_block.len() as u16, // We can ensure that the block row_ids compressed size won't exceed u16::max -> 65535.
-                                row_ids_count: current_block.len() as u8,                          // We can ensure that the block size won't exceed `COMPRESSION_BLOCK_SIZE`.
-                                num_bits,
-                                weights: convert_weights_type_for_block::<OW, TW, _>(current_block, |w| w.weight())?,
-                            };
-                            output_simple_posting_blocks.push(block);
-                        }
-                        CompressedBlockType::Extended => {
-                            let block: ExtendedCompressedPostingBlock<TW> = ExtendedCompressedPostingBlock {
-                                row_id_start: row_id_start_in_block,
-                                block_offset: block_offsets,
-                                row_ids_compressed_size: row_ids_compressed_in_block.len() as u16, // We can ensure that the block row_ids compressed size won't exceed u16::max -> 65535.
-                                row_ids_count: current_block.len() as u8,                          // We can ensure that the block size won't exceed `COMPRESSION_BLOCK_SIZE`.
-                                num_bits,
-                                weights: convert_weights_type_for_block::<OW, TW, _>(current_block, |w| w.weight())?,
-                                max_next_weights: convert_weights_type_for_block::<OW, TW, _>(current_block, |w| w.max_next_weight())?,
-                            };
-                            output_extended_posting_blocks.push(block);
-                        }
+                    output_weights.extend(convert_weights_type_for_block::<OW, TW, _>(current_block, |w| w.weight()));
+                    if self.element_type == ElementType::EXTENDED {
+                        output_max_next_weights.extend(convert_weights_type_for_block::<OW, TW, _>(current_block, |w| w.max_next_weight()));
                     }
                 }
             }
@@ -309,68 +294,65 @@ impl<OW: QuantizedWeight, TW: QuantizedWeight> CompressedPostingBuilder<OW, TW>
             block_offsets += row_ids_compressed_in_block.len() as u64;
         }
 
-        return Ok((output_row_ids_compressed_in_posting, output_simple_posting_blocks, output_extended_posting_blocks, total_row_ids_count, max_row_id));
+        return Ok((output_row_ids_compressed_in_posting, output_posting_blocks, output_block_params, output_weights, output_max_next_weights, total_row_ids_count, max_row_id));
     }
 
     pub fn build(mut self) -> Result<CompressedPostingList<TW>, PostingListError> {
         let element_type = self.element_type;
+        let u4_weights = self.u4_weights;
 
         let quantized_param = self.propagate_and_quantize()?;
 
-        let (output_row_ids_compressed_in_posting, output_simple_posting_blocks, output_extended_posting_blocks, total_row_ids_count, max_row_id) =
-            self.compress_blocks(quantized_param.clone())?;
+        // Codec is chosen per posting by its length and density.
+        let row_id_span = match (self.posting.elements.first(), self.posting.elements.last()) {
+            (Some(first), Some(last)) => (last.row_id() - first.row_id()) as u64,
+            _ => 0,
+        };
+        let row_id_codec = RowIdCodec::choose(self.posting.len(), row_id_span);
+
+        let (output_row_ids_compressed_in_posting, output_posting_blocks, output_block_params, output_weights, output_max_next_weights, total_row_ids_count, max_row_id) =
+            self.compress_blocks(row_id_codec)?;
 
-        let compressed_posting: CompressedPostingList<TW> = CompressedPostingList::<TW> {
+        let mut compressed_posting: CompressedPostingList<TW> = CompressedPostingList::<TW> {
             row_ids_compressed: output_row_ids_compressed_in_posting,
-            simple_blocks: output_simple_posting_blocks,
-            extended_blocks: output_extended_posting_blocks,
+            blocks: output_posting_blocks,
+            weights: output_weights,
+            max_next_weights: output_max_next_weights,
             compressed_block_type: CompressedBlockType::from(element_type),
+            row_id_codec,
             quantization_params: quantized_param,
+            block_quantization_params: output_block_params,
+            u4_weights: false,
             row_ids_count: total_row_ids_count,
             max_row_id,
         };
+        if u4_weights {
+            compressed_posting.pack_u4_weights();
+        }
 
         return Ok(compressed_posting);
     }
 }
 
-fn quantized_weights_for_block<OW: QuantizedWeight, TW: QuantizedWeight, F: Fn(&GenericElement<OW>) -> OW>(
-    block: &[GenericElement<OW>],
+fn quantized_weights_for_block<'b, OW: QuantizedWeight, TW: QuantizedWeight, F: Fn(&GenericElement<OW>) -> OW + 'b>(
+    block: &'b [GenericElement<OW>],
     quantization_params: Option<QuantizedParam>,
     weight_selector: F,
-) -> Result<[TW; COMPRESSION_BLOCK_SIZE], PostingListError> {
-    let quantized_weights: Vec<TW> = block.iter().map(|e| TW::from_u8(OW::quantize_with_param(weight_selector(e), quantization_params.unwrap()))).collect::<Vec<TW>>();
-    if quantized_weights.len() > COMPRESSION_BLOCK_SIZE {
-        let error_msg = format!("Expected at most {} elements in a single block, found {}", COMPRESSION_BLOCK_SIZE, quantized_weights.len());
-        error!("{}", error_msg);
-        return Err(PostingListError::LogicError(error_msg));
-    }
-    let mut quantized_weights_slice: [TW; COMPRESSION_BLOCK_SIZE] = [TW::MINIMUM(); COMPRESSION_BLOCK_SIZE];
-    quantized_weights_slice[..quantized_weights.len()].copy_from_slice(&quantized_weights);
-
-    Ok(quantized_weights_slice)
+) -> impl Iterator<Item = TW> + 'b {
+    block.iter().map(move |e| TW::from_u8(OW::quantize_with_param(weight_selector(e), quantization_params.unwrap())))
 }
 
-fn convert_weights_type_for_block<OW: QuantizedWeight, TW: QuantizedWeight, F: Fn(&GenericElement<OW>) -> OW>(
-    block: &[GenericElement<OW>],
+fn convert_weights_type_for_block<'b, OW: QuantizedWeight, TW: QuantizedWeight, F: Fn(&GenericElement<OW>) -> OW + 'b>(
+    block: &'b [GenericElement<OW>],
     weight_selector: F,
-) -> Result<[TW; COMPRESSION_BLOCK_SIZE], PostingListError> {
-    let weights: Vec<TW> = block.iter().map(|e: &GenericElement<OW>| TW::from_f32(OW::to_f32(weight_selector(e)))).collect::<Vec<TW>>();
-    if weights.len() > COMPRESSION_BLOCK_SIZE {
-        let error_msg = format!("Expected at most {} elements in a single block, found {}", COMPRESSION_BLOCK_SIZE, weights.len());
-        error!("{}", error_msg);
-        return Err(PostingListError::LogicError(error_msg));
-    }
-    let mut weights_slice: [TW; COMPRESSION_BLOCK_SIZE] = [TW::MINIMUM(); COMPRESSION_BLOCK_SIZE];
-    weights_slice[..weights.len()].copy_from_slice(&weights);
-
-    Ok(weights_slice)
+) -> impl Iterator<Item = TW> + 'b {
+    block.iter().map(move |e: &GenericElement<OW>| TW::from_f32(OW::to_f32(weight_selector(e))))
 }
 
 #[cfg(test)]
 mod test {
     use super::super::test::{generate_elements, mock_build_compressed_posting, uncompress_row_ids_from_compressed_posting};
-    use crate::core::{CompressedBlockType, ElementType, QuantizedParam, QuantizedWeight, WeightType, DEFAULT_MAX_NEXT_WEIGHT};
+    use crate::core::{CompressedPostingListIterator, ElementType, PostingListIter, QuantizedParam, QuantizedWeight, WeightType, COMPRESSION_BLOCK_SIZE, DEFAULT_MAX_NEXT_WEIGHT};
     use itertools::Itertools;
 
     use super::CompressedPostingBuilder;
@@ -383,13 +365,13 @@ mod test {
         {
             let (cmp_posting, _) = mock_build_compressed_posting::<f32, f32>(ElementType::EXTENDED, elements.clone());
 
-            assert_eq!(cmp_posting.simple_blocks.len(), 0);
-            assert_eq!(cmp_posting.extended_blocks.len(), 1);
-            assert_eq!(cmp_posting.extended_blocks[0].row_id_start, 7);
-            assert_eq!(cmp_posting.extended_blocks[0].row_ids_count, 5);
-            assert_eq!(cmp_posting.extended_blocks[0].block_offset, 0);
-            assert_eq!(cmp_posting.extended_blocks[0].weights[0..5], [1.389, 2.41, 3.56, 0.9, 0.31]);
-            assert_eq!(cmp_posting.extended_blocks[0].max_next_weights[0..5], [3.56, 3.56, 0.9, 0.31, DEFAULT_MAX_NEXT_WEIGHT]);
+            assert_eq!(cmp_posting.blocks.len(), 1);
+            assert_eq!(cmp_posting.blocks[0].row_id_start, 7);
+            assert_eq!(cmp_posting.blocks[0].row_ids_count, 5);
+            assert_eq!(cmp_posting.blocks[0].block_offset, 0);
+            assert_eq!(cmp_posting.blocks[0].weights_offset, 0);
+            assert_eq!(cmp_posting.weights, [1.389, 2.41, 3.56, 0.9, 0.31]);
+            assert_eq!(cmp_posting.max_next_weights, [3.56, 3.56, 0.9, 0.31, DEFAULT_MAX_NEXT_WEIGHT]);
         }
         // Extended with quantized
         {
@@ -400,17 +382,17 @@ mod test {
         {
             let (cmp_posting, _) = mock_build_compressed_posting::<f32, f32>(ElementType::SIMPLE, elements.clone());
 
-            assert_eq!(cmp_posting.simple_blocks.len(), 1);
-            assert_eq!(cmp_posting.extended_blocks.len(), 0);
-            assert_eq!(cmp_posting.simple_blocks[0].row_id_start, 7);
-            assert_eq!(cmp_posting.simple_blocks[0].row_ids_count, 5);
-            assert_eq!(cmp_posting.simple_blocks[0].block_offset, 0);
-            assert_eq!(cmp_posting.simple_blocks[0].weights[0..5], [1.389, 2.41, 3.56, 0.9, 0.31]);
+            assert_eq!(cmp_posting.blocks.len(), 1);
+            assert_eq!(cmp_posting.blocks[0].row_id_start, 7);
+            assert_eq!(cmp_posting.blocks[0].row_ids_count, 5);
+            assert_eq!(cmp_posting.blocks[0].block_offset, 0);
+            assert_eq!(cmp_posting.weights, [1.389, 2.41, 3.56, 0.9, 0.31]);
+            assert!(cmp_posting.max_next_weights.is_empty());
         }
         // Simple with quantized
         {
             let (cmp_posting, _) = mock_build_compressed_posting::<f32, u8>(ElementType::SIMPLE, elements.clone());
-            assert_eq!(cmp_posting.simple_blocks[0].weights[0..5], [85, 165, 255, 46, 0]);
+            assert_eq!(cmp_posting.weights, [85, 165, 255, 46, 0]);
             assert_eq!(cmp_posting.quantization_params.unwrap(), QuantizedParam::from_minmax(0.31, 3.56));
         }
     }
@@ -439,10 +421,7 @@ mod test {
         }
         let cmp_posting = builder.build().unwrap();
         let row_ids_restore = uncompress_row_ids_from_compressed_posting(&cmp_posting);
-        let weights_restore = match cmp_posting.compressed_block_type {
-            CompressedBlockType::Simple => cmp_posting.simple_blocks.iter().map(|e| e.weights[0..e.row_ids_count as usize].to_vec()).flatten().collect::<Vec<TW>>(),
-            CompressedBlockType::Extended => cmp_posting.extended_blocks.iter().map(|e| e.weights[0..e.row_ids_count as usize].to_vec()).flatten().collect::<Vec<TW>>(),
-        };
+        let weights_restore = cmp_posting.blocks.iter().flat_map(|e| cmp_posting.weights[e.weights_offset as usize..][..e.row_ids_count as usize].to_vec()).collect::<Vec<TW>>();
 
         // Assert the row_ids compressed and restored are equal.
         assert_eq!(row_ids_origin, row_ids_restore);
@@ -450,9 +429,14 @@ mod test {
         if need_quantized {
             // Assert the quantized_params are equal.
             assert_eq!(cmp_posting.quantization_params.unwrap(), quantized_param.unwrap());
-            // Assert the quantized weights are equal.
+            // Assert the quantized weights are equal, each block is quantized with its own param.
+            assert_eq!(cmp_posting.block_quantization_params.len(), cmp_posting.blocks.len());
             assert_eq!(
-                weights.iter().map(|e| TW::from_u8(OW::quantize_with_param(OW::from_f32(*e), cmp_posting.quantization_params.unwrap()))).collect::<Vec<_>>(),
+                weights
+                    .chunks(COMPRESSION_BLOCK_SIZE)
+                    .zip(cmp_posting.block_quantization_params.iter())
+                    .flat_map(|(block, &param)| block.iter().map(move |e| TW::from_u8(OW::quantize_with_param(OW::from_f32(*e), param))))
+                    .collect::<Vec<_>>(),
                 weights_restore
             );
         } else {
@@ -461,6 +445,48 @@ mod test {
         }
     }
 
+    #[test]
+    fn test_block_quantized_weights() {
+        // An outlier in the first block widens the posting range, the second block keeps its own narrow range.
+        let elements: Vec<(u32, f32)> = (0..256).map(|i| (i, if i == 0 { 100.0 } else { 1.0 + (i % 7) as f32 * 0.01 })).collect();
+        let (cmp_posting, _) = mock_build_compressed_posting::<f32, u8>(ElementType::SIMPLE, elements.clone());
+        let param = cmp_posting.quantization_params.unwrap();
+        assert_eq!(param, QuantizedParam::from_minmax(1.0, 100.0));
+        assert_eq!(cmp_posting.block_quantization_params[1], QuantizedParam::from_minmax(1.0, 1.06));
+
+        let view = cmp_posting.view();
+        let mut iterator = CompressedPostingListIterator::<f32, u8>::new(&view);
+        let mut restored = vec![];
+        iterator.for_each_weight_till_row_id(u32::MAX, |_, weight| restored.push(weight));
+        for ((_, origin), weight) in elements.iter().zip(restored.iter()).skip(COMPRESSION_BLOCK_SIZE) {
+            assert!((origin - weight).abs() <= cmp_posting.block_quantization_params[1].min_precision());
+            assert!((origin - weight).abs() * 1000.0 < param.min_precision());
+        }
+    }
+
+    #[test]
+    fn test_u4_weights() {
+        let elements: Vec<(u32, f32)> = (0..301).map(|i| (i * 2, 1.0 + (i % 13) as f32 * 0.25)).collect();
+        let mut builder = CompressedPostingBuilder::<f32, u8>::new(ElementType::SIMPLE, true, false).unwrap().with_u4_weights(true);
+        for &(row_id, weight) in &elements {
+            builder.add(row_id, weight);
+        }
+        let cmp_posting = builder.build().unwrap();
+        assert!(cmp_posting.u4_weights);
+        assert_eq!(cmp_posting.weights.len(), (elements.len() + 1) / 2);
+        assert_eq!(cmp_posting.block_quantization_params[0], QuantizedParam::from_minmax(1.0, 4.0).to_u4());
+
+        let view = cmp_posting.view();
+        assert!(view.blocks.is_u4());
+        let mut iterator = CompressedPostingListIterator::<f32, u8>::new(&view);
+        let mut restored = vec![];
+        iterator.for_each_weight_till_row_id(u32::MAX, |_, weight| restored.push(weight));
+        assert_eq!(restored.len(), elements.len());
+        for ((_, origin), weight) in elements.iter().zip(restored.iter()) {
+            assert!((origin - weight).abs() <= cmp_posting.block_quantization_params[0].min_precision());
+        }
+    }
+
     #[test]
     fn test_compressed_posting_compress() {
         // Sequence row_ids.
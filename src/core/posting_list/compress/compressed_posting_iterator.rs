@@ -1,32 +1,114 @@
 use crate::{
-    core::{BlockDecoder, ElementRead, ExtendedElement, GenericElement, PostingListIter, QuantizedWeight, SimpleElement, COMPRESSION_BLOCK_SIZE},
+    core::{
+        u4_weights_to_scores, u8_weights_to_scores, weights_as_u8, BlockDecoder, BlockWeights, BlocksLayout, CachedPosting, ElementRead, ExtendedElement, GenericElement,
+        PostingListIter, QuantizedParam, QuantizedWeight, SimpleElement, COMPRESSION_BLOCK_SIZE,
+    },
     RowId,
 };
+use std::borrow::Cow;
 use std::marker::PhantomData;
+use std::sync::Arc;
 
-use super::{CompressedPostingListView, ExtendedCompressedPostingBlock, SimpleCompressedPostingBlock};
+use super::{CompressedPostingListView, DecodedBlock};
+
+/// Bytes iterated, borrowed from a mapped or in memory posting, or owned by an entry of the posting cache.
+#[derive(Debug, Clone)]
+enum PostingSource<'a, TW: QuantizedWeight> {
+    View(CompressedPostingListView<'a, TW>),
+    /// `view` holds every field but the bytes, which are split out of `posting` by `layout` whenever they are read.
+    Cached {
+        view: CompressedPostingListView<'static, TW>,
+        layout: BlocksLayout,
+        posting: Arc<CachedPosting>,
+    },
+}
+
+impl<'a, TW: QuantizedWeight> PostingSource<'a, TW> {
+    /// Fields of the posting, its bytes may be empty.
+    fn meta(&self) -> &CompressedPostingListView<'_, TW> {
+        match self {
+            PostingSource::View(view) => view,
+            PostingSource::Cached { view, .. } => view,
+        }
+    }
+
+    fn posting(&self) -> Cow<'_, CompressedPostingListView<'_, TW>> {
+        match self {
+            PostingSource::View(view) => Cow::Borrowed(view),
+            PostingSource::Cached { view, layout, posting } => Cow::Owned(view.with_bytes(posting.row_ids(), layout.blocks(posting.blocks()))),
+        }
+    }
+}
 
 /// `TW` means wieght type stored in disk.
 /// `OW` means weight type before stored or quantized.
 #[derive(Debug, Clone)]
 pub struct CompressedPostingListIterator<'a, OW: QuantizedWeight, TW: QuantizedWeight> {
-    posting: CompressedPostingListView<'a, TW>,
+    source: PostingSource<'a, TW>,
     is_uncompressed: bool,
     row_ids_uncompressed_in_block: Vec<RowId>,
     cursor: usize,
     decoder: BlockDecoder,
+    blocks_decompressed: usize,
+    /// Current block when it comes from the decoded block cache, `row_ids_uncompressed_in_block` is stale then.
+    decoded_block: Option<Arc<DecodedBlock>>,
+    /// Weights or scores restored by a block scan, kept across scans so per-candidate scoring doesn't clear a block each time.
+    values_in_block: Vec<f32>,
     _tw: PhantomData<OW>,
 }
 
 impl<'a, OW: QuantizedWeight, TW: QuantizedWeight> CompressedPostingListIterator<'a, OW, TW> {
     pub fn new(posting: &CompressedPostingListView<'a, TW>) -> Self {
-        Self { posting: posting.clone(), is_uncompressed: false, row_ids_uncompressed_in_block: vec![], cursor: 0, decoder: BlockDecoder::default(), _tw: PhantomData }
+        Self::with_source(PostingSource::View(posting.clone()))
+    }
+
+    /// Iterate a posting of the posting cache, `view` is the posting without its bytes and `layout` splits its blocks.
+    pub fn from_cached_posting(view: CompressedPostingListView<'static, TW>, layout: BlocksLayout, posting: Arc<CachedPosting>) -> Self {
+        Self::with_source(PostingSource::Cached { view, layout, posting })
+    }
+
+    fn with_source(source: PostingSource<'a, TW>) -> Self {
+        Self {
+            source,
+            is_uncompressed: false,
+            row_ids_uncompressed_in_block: vec![],
+            cursor: 0,
+            decoder: BlockDecoder::default(),
+            blocks_decompressed: 0,
+            decoded_block: None,
+            values_in_block: vec![],
+            _tw: PhantomData,
+        }
+    }
+
+    /// Uncompress the block, or take it from the decoded block cache when the posting has a cache key.
+    fn load_block(&mut self, block_idx: usize) {
+        let posting = self.source.posting();
+        self.decoded_block = match posting.decoded_block(block_idx, &mut self.decoder, &mut self.row_ids_uncompressed_in_block) {
+            Some((block, hit)) => {
+                self.blocks_decompressed += !hit as usize;
+                Some(block)
+            }
+            None => {
+                posting.uncompress_block(block_idx, &mut self.decoder, &mut self.row_ids_uncompressed_in_block).unwrap_or_default();
+                self.blocks_decompressed += 1;
+                None
+            }
+        };
+        self.is_uncompressed = true;
+    }
+
+    fn block_row_ids(&self) -> &[RowId] {
+        match &self.decoded_block {
+            Some(block) => &block.row_ids,
+            None => &self.row_ids_uncompressed_in_block,
+        }
     }
 
     // TODO: make sure element returned should be current element, and then increase cursor, keep same with SimplePosting.Qzz
     pub fn next(&mut self) -> Option<GenericElement<OW>> {
         // Boundary
-        if self.cursor >= self.posting.row_ids_count as usize {
+        if self.cursor >= self.source.meta().row_ids_count as usize {
             return None;
         }
         // If cursor enter new block range, mark it not been decompressed.
@@ -44,12 +126,69 @@ impl<'a, OW: QuantizedWeight, TW: QuantizedWeight> CompressedPostingListIterator
         }
         element_opt
     }
+
+    /// Iterate block by block till `row_id` (included). For each block, `restore` converts the weights from cursor till `row_id`
+    /// into `f32` values with the block's quantization param in one pass over contiguous memory, then values are yielded with row_ids.
+    /// Blocks from the decoded block cache are already restored, `restore_decoded` maps their weights instead.
+    fn scan_blocks_till_row_id(
+        &mut self,
+        row_id: RowId,
+        restore: impl Fn(Option<QuantizedParam>, BlockWeights<'_, TW>, &mut [f32]),
+        restore_decoded: impl Fn(&[f32], &mut [f32]),
+        f: &mut impl FnMut(RowId, f32),
+    ) {
+        let row_ids_count = self.source.meta().row_ids_count as usize;
+        // Bytes are borrowed from a clone of the source, so they don't borrow `self`.
+        let source = self.source.clone();
+        let posting = source.posting();
+        let blocks = posting.blocks;
+        // Only the first scan of the iterator allocates and zeroes it, restored values overwrite it afterwards.
+        let mut values_in_block = std::mem::take(&mut self.values_in_block);
+        values_in_block.resize(COMPRESSION_BLOCK_SIZE, 0.0);
+
+        while self.cursor < row_ids_count {
+            let block_idx = self.cursor / COMPRESSION_BLOCK_SIZE;
+            if !self.is_uncompressed {
+                self.load_block(block_idx);
+            }
+            let block_start = block_idx * COMPRESSION_BLOCK_SIZE;
+            let block_len = std::cmp::min(self.block_row_ids().len(), row_ids_count - block_start);
+            let relative_start = self.cursor - block_start;
+            if relative_start >= block_len {
+                // block uncompress failed, nothing can be read.
+                break;
+            }
+
+            // Row ids are sorted, only weights which will be yielded are restored.
+            let row_ids = &self.block_row_ids()[relative_start..block_len];
+            let consumed = row_ids.partition_point(|&current_row_id| current_row_id <= row_id);
+
+            let values = &mut values_in_block[..consumed];
+            match &self.decoded_block {
+                Some(block) => restore_decoded(&block.weights[relative_start..relative_start + consumed], values),
+                None => restore(posting.quantized_param(block_idx), blocks.block_weights(block_idx).slice(relative_start, consumed), values),
+            }
+
+            for (&current_row_id, &value) in row_ids[..consumed].iter().zip(values.iter()) {
+                f(current_row_id, value);
+            }
+
+            self.cursor += consumed;
+            if relative_start + consumed < block_len {
+                // stopped by `row_id` inside current block.
+                break;
+            }
+            // current block is exhausted, next block should be uncompressed.
+            self.is_uncompressed = false;
+        }
+        self.values_in_block = values_in_block;
+    }
 }
 
 impl<'a, OW: QuantizedWeight, TW: QuantizedWeight> PostingListIter<OW, TW> for CompressedPostingListIterator<'a, OW, TW> {
     fn peek(&mut self) -> Option<GenericElement<OW>> {
         // Boundary
-        if self.cursor >= self.posting.row_ids_count as usize {
+        if self.cursor >= self.source.meta().row_ids_count as usize {
             return None;
         }
 
@@ -58,36 +197,42 @@ impl<'a, OW: QuantizedWeight, TW: QuantizedWeight> PostingListIter<OW, TW> for C
         if !self.is_uncompressed {
             // dynamic decompresse block in `CompressedPostingListView`
             // swallow error exception.
-            self.posting.uncompress_block(self.posting.compressed_block_type, block_idx, &mut self.decoder, &mut self.row_ids_uncompressed_in_block).unwrap_or_default();
-            self.is_uncompressed = true;
+            self.load_block(block_idx);
         }
 
         let relative_row_id = self.cursor % COMPRESSION_BLOCK_SIZE;
 
-        match self.posting.compressed_block_type {
-            super::CompressedBlockType::Simple => {
-                let block: &SimpleCompressedPostingBlock<TW> = &self.posting.simple_blocks[block_idx];
-                let row_id = self.row_ids_uncompressed_in_block[relative_row_id];
+        let row_id = self.block_row_ids()[relative_row_id];
+        let posting = self.source.posting();
+        let weight = posting.blocks.block_weights(block_idx).get(relative_row_id);
 
-                let raw_simple_element = GenericElement::SimpleElement(SimpleElement { row_id, weight: block.weights[relative_row_id] });
-                Some(raw_simple_element.convert_or_unquantize::<OW>(self.posting.quantization_params))
+        match posting.compressed_block_type {
+            super::CompressedBlockType::Simple => {
+                let raw_simple_element = GenericElement::SimpleElement(SimpleElement { row_id, weight });
+                Some(raw_simple_element.convert_or_unquantize::<OW>(posting.quantized_param(block_idx)))
             }
             super::CompressedBlockType::Extended => {
-                let block: &ExtendedCompressedPostingBlock<TW> = &self.posting.extended_blocks[block_idx];
-                let row_id = self.row_ids_uncompressed_in_block[relative_row_id];
-
-                let raw_extended_element =
-                    GenericElement::ExtendedElement(ExtendedElement { row_id, weight: block.weights[relative_row_id], max_next_weight: block.max_next_weights[relative_row_id] });
-                Some(raw_extended_element.convert_or_unquantize::<OW>(self.posting.quantization_params))
+                let max_next_weight = posting.blocks.max_next_weights(block_idx)[relative_row_id];
+                let raw_extended_element = GenericElement::ExtendedElement(ExtendedElement { row_id, weight, max_next_weight });
+                Some(raw_extended_element.convert_or_unquantize::<OW>(posting.quantized_param(block_idx)))
             }
         }
     }
 
     fn last_id(&self) -> Option<RowId> {
-        self.posting.max_row_id
+        self.source.meta().max_row_id
     }
 
     fn skip_to(&mut self, row_id: RowId) -> Option<GenericElement<OW>> {
+        // Jump to the block which may contain `row_id`, blocks in between are never uncompressed.
+        if self.cursor < self.source.meta().row_ids_count as usize {
+            let block_idx = self.cursor / COMPRESSION_BLOCK_SIZE;
+            let target_block_idx = self.source.posting().seek_block(block_idx, row_id);
+            if target_block_idx > block_idx {
+                self.cursor = target_block_idx * COMPRESSION_BLOCK_SIZE;
+                self.is_uncompressed = false;
+            }
+        }
         while let Some(element) = self.peek() {
             match element.row_id().cmp(&row_id) {
                 std::cmp::Ordering::Less => {
@@ -102,20 +247,36 @@ impl<'a, OW: QuantizedWeight, TW: QuantizedWeight> PostingListIter<OW, TW> for C
 
     fn skip_to_end(&mut self) {
         // If skip operation trigger cursor enter a new block range, we should mark it with uncompressed status.
-        if (self.posting.row_ids_count - self.cursor as u32) / COMPRESSION_BLOCK_SIZE as u32 >= 1 {
+        let row_ids_count = self.source.meta().row_ids_count;
+        if (row_ids_count - self.cursor as u32) / COMPRESSION_BLOCK_SIZE as u32 >= 1 {
             self.is_uncompressed = false;
         }
-        self.cursor = (self.posting.row_ids_count - 1) as usize;
+        self.cursor = (row_ids_count - 1) as usize;
     }
 
     fn remains(&self) -> usize {
-        self.posting.row_ids_count as usize - self.cursor
+        self.source.meta().row_ids_count as usize - self.cursor
     }
 
     fn cursor(&self) -> usize {
         self.cursor
     }
 
+    fn min_weight(&self) -> f32 {
+        // Quantized range is the posting range.
+        let meta = self.source.meta();
+        meta.weight_bounds.map(|(min, _)| min).or(meta.quantization_params.map(|param| param.min())).unwrap_or(f32::NEG_INFINITY)
+    }
+
+    fn blocks_decompressed(&self) -> usize {
+        self.blocks_decompressed
+    }
+
+    fn max_weight(&self) -> f32 {
+        let meta = self.source.meta();
+        meta.weight_bounds.map(|(_, max)| max).or(meta.quantization_params.map(|param| param.max())).unwrap_or(f32::INFINITY)
+    }
+
     fn for_each_till_row_id(&mut self, row_id: RowId, mut f: impl FnMut(&GenericElement<OW>)) {
         while let Some(element) = self.next() {
             if element.row_id() > row_id {
@@ -124,39 +285,100 @@ impl<'a, OW: QuantizedWeight, TW: QuantizedWeight> PostingListIter<OW, TW> for C
             f(&element);
         }
     }
+
+    fn for_each_weight_till_row_id(&mut self, row_id: RowId, mut f: impl FnMut(RowId, f32)) {
+        self.scan_blocks_till_row_id(
+            row_id,
+            |quantized_param, weights, values| match quantized_param {
+                Some(param) => {
+                    for (value, weight) in values.iter_mut().zip(weights.iter()) {
+                        *value = f32::unquantize_with_param(TW::to_u8(weight), param);
+                    }
+                }
+                None => {
+                    for (value, weight) in values.iter_mut().zip(weights.iter()) {
+                        *value = TW::to_f32(weight);
+                    }
+                }
+            },
+            |weights, values| values.copy_from_slice(weights),
+            &mut f,
+        );
+    }
+
+    fn for_each_score_till_row_id(&mut self, row_id: RowId, query_dim_weight: f32, mut f: impl FnMut(RowId, f32)) {
+        // u8 and u4 weights (quantized or not) are restored by SIMD kernels, scale and offset are folded once per block.
+        self.scan_blocks_till_row_id(
+            row_id,
+            |quantized_param, weights, scores| {
+                let (scale, offset) = match quantized_param {
+                    Some(param) => param.scale_and_offset(query_dim_weight),
+                    None => (query_dim_weight, 0.0),
+                };
+                match weights {
+                    BlockWeights::U4 { packed, start, .. } => u4_weights_to_scores(packed, start, scale, offset, scores),
+                    BlockWeights::Plain(weights) => match weights_as_u8(weights) {
+                        Some(u8_weights) => u8_weights_to_scores(u8_weights, scale, offset, scores),
+                        None => {
+                            for (score, &weight) in scores.iter_mut().zip(weights.iter()) {
+                                *score = TW::to_f32(weight) * query_dim_weight;
+                            }
+                        }
+                    },
+                }
+            },
+            |weights, scores| {
+                for (score, &weight) in scores.iter_mut().zip(weights.iter()) {
+                    *score = weight * query_dim_weight;
+                }
+            },
+            &mut f,
+        );
+    }
 }
 
 #[cfg(test)]
 mod test {
     use super::super::test::{get_compressed_posting_iterator, mock_build_compressed_posting, mock_compressed_posting_from_sequence_elements};
+    use super::CompressedPostingListIterator;
     use crate::{
-        core::{CompressedPostingListView, ElementRead, ElementType, PostingListIter, QuantizedWeight},
+        core::{CompressedBlockMeta, CompressedBlocks, CompressedPostingListView, DecodedBlockCache, ElementRead, ElementType, PostingListIter, QuantizedWeight},
         RowId,
     };
 
+    fn packed_slices<'a, TW: QuantizedWeight>(blocks: CompressedBlocks<'a, TW>) -> (&'a [CompressedBlockMeta], &'a [TW], &'a [TW]) {
+        match blocks {
+            CompressedBlocks::Packed { metas, weights, max_next_weights, .. } => (metas, weights, max_next_weights),
+            _ => panic!("blocks built in memory should be packed"),
+        }
+    }
+
     fn inner_test_iterator_clone_from_view<OW: QuantizedWeight, TW: QuantizedWeight>(count: usize, element_type: ElementType) {
         let (cmp_posting, _) = mock_compressed_posting_from_sequence_elements::<OW, TW>(element_type, count);
 
         // Get references from cmp_posting.
         let row_ids_ref = cmp_posting.row_ids_compressed.as_slice();
-        let simple_blocks_ref = cmp_posting.simple_blocks.as_slice();
-        let extend_blocks_ref = cmp_posting.extended_blocks.as_slice();
+        let blocks_ref = cmp_posting.blocks.as_slice();
+        let weights_ref = cmp_posting.weights.as_slice();
 
         // create view from this compressed posting.
         let cmp_posting_view: CompressedPostingListView<'_, TW> = cmp_posting.view();
+        let (view_blocks, view_weights, _) = packed_slices(cmp_posting_view.blocks);
 
-        // Assert the address of [`row_ids_compressed`, `simple_blocks`, `extended_blocks`] in cmp_posting.view() is same with cmp_posting.
+        // Assert the address of [`row_ids_compressed`, `blocks`, `weights`] in cmp_posting.view() is same with cmp_posting.
         assert!(std::ptr::addr_eq(row_ids_ref as *const _, cmp_posting_view.row_ids_compressed as *const _));
-        assert!(std::ptr::addr_eq(simple_blocks_ref as *const _, cmp_posting_view.simple_blocks as *const _));
-        assert!(std::ptr::addr_eq(extend_blocks_ref as *const _, cmp_posting_view.extended_blocks as *const _));
+        assert!(std::ptr::addr_eq(blocks_ref as *const _, view_blocks as *const _));
+        assert!(std::ptr::addr_eq(weights_ref as *const _, view_weights as *const _));
 
         // Create iterator from this cmp_posting.view().
         let iterator = get_compressed_posting_iterator::<OW, TW>(&cmp_posting);
+        let iter_posting = iterator.source.posting();
+        let (iter_blocks, iter_weights, _) = packed_slices(iter_posting.blocks);
 
-        // Assert the address of [`row_ids_compressed`, `simple_blocks`, `extended_blocks`] in iterator is same with cmp_posting.view().
-        assert!(std::ptr::addr_eq(cmp_posting_view.row_ids_compressed as *const _, iterator.posting.row_ids_compressed as *const _));
-        assert!(std::ptr::addr_eq(cmp_posting_view.simple_blocks as *const _, iterator.posting.simple_blocks as *const _));
-        assert!(std::ptr::addr_eq(cmp_posting_view.extended_blocks as *const _, iterator.posting.extended_blocks as *const _));
+        // Assert the address of [`row_ids_compressed`, `blocks`, `weights`] in iterator is same with cmp_posting.view().
+        assert!(std::ptr::addr_eq(cmp_posting_view.row_ids_compressed as *const _, iter_posting.row_ids_compressed as *const _));
+        assert!(std::ptr::addr_eq(view_blocks as *const _, iter_blocks as *const _));
+        assert!(std::ptr::addr_eq(view_weights as *const _, iter_weights as *const _));
     }
 
     #[test]
@@ -334,6 +556,80 @@ mod test {
         assert_eq!(elements_idx, element_iter_count);
     }
 
+    fn inner_test_for_each_weight_till_row_id<OW: QuantizedWeight, TW: QuantizedWeight>(element_type: ElementType, element_total_count: usize, element_iter_count: usize) {
+        let (cmp_posting, elements) = mock_compressed_posting_from_sequence_elements::<OW, TW>(element_type, element_total_count);
+        let mut cmp_iterator = get_compressed_posting_iterator::<OW, TW>(&cmp_posting);
+
+        let mut elements_idx = 0;
+        cmp_iterator.for_each_weight_till_row_id(element_iter_count as RowId, |row_id, weight| {
+            assert_eq!(row_id, elements[elements_idx].0);
+            if let Some(param) = cmp_posting.quantization_params {
+                assert!((weight - elements[elements_idx].1).abs() <= param.min_precision() * 1.005);
+            } else {
+                assert_eq!(OW::from_f32(weight), OW::from_f32(elements[elements_idx].1));
+            }
+            elements_idx += 1;
+        });
+
+        // Element beyond `element_iter_count` should not be consumed.
+        assert_eq!(elements_idx, element_iter_count);
+        assert_eq!(cmp_iterator.cursor(), element_iter_count);
+        if element_iter_count < element_total_count {
+            assert_eq!(cmp_iterator.peek().unwrap().row_id(), elements[element_iter_count].0);
+        }
+
+        // Consume all remaining elements.
+        cmp_iterator.for_each_weight_till_row_id(RowId::MAX, |row_id, _| {
+            assert_eq!(row_id, elements[elements_idx].0);
+            elements_idx += 1;
+        });
+        assert_eq!(elements_idx, element_total_count);
+        assert_eq!(cmp_iterator.remains(), 0);
+    }
+
+    #[test]
+    fn test_for_each_weight_till_row_id() {
+        // Boundary Test
+        inner_test_for_each_weight_till_row_id::<f32, f32>(ElementType::SIMPLE, 20097, 0);
+        inner_test_for_each_weight_till_row_id::<f32, f32>(ElementType::SIMPLE, 20097, 128);
+
+        // Normal Test
+        inner_test_for_each_weight_till_row_id::<f32, f32>(ElementType::SIMPLE, 20097, 1776);
+        inner_test_for_each_weight_till_row_id::<f32, f32>(ElementType::EXTENDED, 20097, 1776);
+        inner_test_for_each_weight_till_row_id::<f32, u8>(ElementType::SIMPLE, 20097, 1776);
+        inner_test_for_each_weight_till_row_id::<half::f16, half::f16>(ElementType::SIMPLE, 20097, 1776);
+        inner_test_for_each_weight_till_row_id::<u8, u8>(ElementType::SIMPLE, 20097, 1776);
+    }
+
+    fn inner_test_for_each_score_till_row_id<OW: QuantizedWeight, TW: QuantizedWeight>(element_type: ElementType, element_total_count: usize, query_dim_weight: f32) {
+        let (cmp_posting, elements) = mock_compressed_posting_from_sequence_elements::<OW, TW>(element_type, element_total_count);
+        let mut weight_iterator = get_compressed_posting_iterator::<OW, TW>(&cmp_posting);
+        let mut score_iterator = get_compressed_posting_iterator::<OW, TW>(&cmp_posting);
+
+        let mut expected = Vec::new();
+        weight_iterator.for_each_weight_till_row_id(RowId::MAX, |row_id, weight| expected.push((row_id, weight * query_dim_weight)));
+        let mut scores = Vec::new();
+        score_iterator.for_each_score_till_row_id(RowId::MAX, query_dim_weight, |row_id, score| scores.push((row_id, score)));
+
+        assert_eq!(scores.len(), elements.len());
+        assert_eq!(scores.len(), expected.len());
+        for ((row_id, score), (expected_row_id, expected_score)) in scores.iter().zip(expected.iter()) {
+            assert_eq!(row_id, expected_row_id);
+            // Folding query weight into scale and offset may differ in the last float bits.
+            assert!((score - expected_score).abs() <= expected_score.abs() * 1e-5 + 1e-5);
+        }
+    }
+
+    #[test]
+    fn test_for_each_score_till_row_id() {
+        inner_test_for_each_score_till_row_id::<f32, f32>(ElementType::SIMPLE, 20097, 0.7);
+        inner_test_for_each_score_till_row_id::<f32, u8>(ElementType::SIMPLE, 20097, 0.7);
+        inner_test_for_each_score_till_row_id::<f32, u8>(ElementType::SIMPLE, 20097, -1.3);
+        inner_test_for_each_score_till_row_id::<half::f16, u8>(ElementType::SIMPLE, 20097, 0.7);
+        inner_test_for_each_score_till_row_id::<u8, u8>(ElementType::SIMPLE, 20097, 0.7);
+        inner_test_for_each_score_till_row_id::<u8, u8>(ElementType::EXTENDED, 131, 0.7);
+    }
+
     #[test]
     fn test_for_each_till_row_id() {
         // Boundary Test
@@ -432,4 +728,45 @@ mod test {
         inner_test_skip_to_end::<half::f16, half::f16>(ElementType::EXTENDED, 20096);
         inner_test_skip_to_end::<half::f16, u8>(ElementType::SIMPLE, 20096);
     }
+
+    #[test]
+    fn test_skip_to_jumps_over_blocks() {
+        // Long and sparse posting, stored with Elias-Fano.
+        let elements: Vec<(RowId, f32)> = (1..=4096).map(|i| (i * 20, 1.0)).collect();
+        let (cmp_posting, _) = mock_build_compressed_posting::<f32, f32>(ElementType::SIMPLE, elements);
+        assert_eq!(cmp_posting.row_id_codec, crate::core::RowIdCodec::EliasFano);
+
+        let mut cmp_iterator = get_compressed_posting_iterator::<f32, f32>(&cmp_posting);
+        assert_eq!(cmp_iterator.skip_to(3000 * 20).unwrap().row_id(), 3000 * 20);
+        assert_eq!(cmp_iterator.cursor(), 2999);
+        assert_eq!(cmp_iterator.blocks_decompressed(), 1);
+
+        assert!(cmp_iterator.skip_to(3500 * 20 + 1).is_none());
+        assert_eq!(cmp_iterator.peek().unwrap().row_id(), 3501 * 20);
+        assert_eq!(cmp_iterator.blocks_decompressed(), 2);
+    }
+
+    #[test]
+    fn test_decoded_block_cache() {
+        DecodedBlockCache::global().set_capacity(16 << 20);
+        let (cmp_posting, _) = mock_compressed_posting_from_sequence_elements::<f32, u8>(ElementType::SIMPLE, 1000);
+        let mut expected = vec![];
+        get_compressed_posting_iterator::<f32, u8>(&cmp_posting).for_each_score_till_row_id(RowId::MAX, 0.7, |row_id, score| expected.push((row_id, score)));
+
+        // Keys of this test don't collide with segments opened by other tests.
+        let view = cmp_posting.view().with_block_cache_key(u64::MAX, 1);
+        for blocks_decompressed in [8, 0] {
+            let mut cmp_iterator = CompressedPostingListIterator::<f32, u8>::new(&view);
+            let mut scores = vec![];
+            cmp_iterator.for_each_score_till_row_id(RowId::MAX, 0.7, |row_id, score| scores.push((row_id, score)));
+            assert_eq!(cmp_iterator.blocks_decompressed(), blocks_decompressed);
+            assert_eq!(scores.len(), expected.len());
+            for ((row_id, score), (expected_row_id, expected_score)) in scores.iter().zip(expected.iter()) {
+                assert_eq!(row_id, expected_row_id);
+                assert!((score - expected_score).abs() < 1e-4);
+            }
+        }
+        assert_eq!(CompressedPostingListIterator::<f32, u8>::new(&view).peek().unwrap().row_id(), 1);
+        DecodedBlockCache::global().set_capacity(0);
+    }
 }
@@ -1,9 +1,9 @@
 use crate::{
-    core::{QuantizedParam, QuantizedWeight},
+    core::{pack_u4_weights, weights_as_u8, QuantizedParam, QuantizedWeight, RowIdCodec},
     RowId,
 };
 
-use super::{CompressedBlockType, CompressedPostingListView, ExtendedCompressedPostingBlock, SimpleCompressedPostingBlock};
+use super::{CompressedBlockMeta, CompressedBlockType, CompressedBlocks, CompressedPostingListView};
 
 #[derive(Default, Debug, Clone, PartialEq, Eq)]
 pub struct CompressedPostingList<TW>
@@ -13,16 +13,30 @@ where
     /// Compressed row_ids data, each block will has it's own offset in it.
     pub row_ids_compressed: Vec<u8>,
 
-    /// Fixed-size blocks.
-    pub simple_blocks: Vec<SimpleCompressedPostingBlock<TW>>,
-    pub extended_blocks: Vec<ExtendedCompressedPostingBlock<TW>>,
+    /// Block metas, the weights of block `i` start at `blocks[i].weights_offset`.
+    pub blocks: Vec<CompressedBlockMeta>,
+
+    /// One weight for each row id, no padding after the tail block. Two `u4` weights share one element, low nibble first.
+    pub weights: Vec<TW>,
+
+    /// Same length with `weights` for extended postings, empty for simple postings.
+    pub max_next_weights: Vec<TW>,
 
     /// `compressed_block_type` in blocks.
     pub compressed_block_type: CompressedBlockType,
 
+    /// How row ids of every block are encoded.
+    pub row_id_codec: RowIdCodec,
+
     /// Quantization parameters.
     pub quantization_params: Option<QuantizedParam>,
 
+    /// Quantization param of every block, empty unless weights are quantized block by block.
+    pub block_quantization_params: Vec<QuantizedParam>,
+
+    /// Weights are `u4` and nibble packed, only for block quantized `u8` weights.
+    pub u4_weights: bool,
+
     /// Total row ids count.
     pub row_ids_count: RowId,
 
@@ -39,12 +53,27 @@ where
         self.row_ids_count as usize
     }
 
+    /// Pack `u4` weights (in `0..=15`) two in a byte.
+    pub fn pack_u4_weights(&mut self) {
+        let packed = pack_u4_weights(weights_as_u8(&self.weights).expect("u4 weights should be quantized into u8"));
+        self.weights = packed.into_iter().map(TW::from_u8).collect();
+        self.u4_weights = true;
+    }
+
     pub fn view(&self) -> CompressedPostingListView<TW> {
+        let blocks = match self.u4_weights {
+            true => CompressedBlocks::PackedU4 {
+                metas: &self.blocks,
+                params: &self.block_quantization_params,
+                weights: weights_as_u8(&self.weights).expect("u4 weights should be quantized into u8"),
+            },
+            false => CompressedBlocks::Packed { metas: &self.blocks, params: &self.block_quantization_params, weights: &self.weights, max_next_weights: &self.max_next_weights },
+        };
         CompressedPostingListView::new(
             &self.row_ids_compressed,
-            &self.simple_blocks,
-            &self.extended_blocks,
+            blocks,
             self.compressed_block_type,
+            self.row_id_codec,
             self.quantization_params,
             self.row_ids_count,
             self.max_row_id,
@@ -53,28 +82,27 @@ where
 
     #[cfg(test)]
     pub fn approximately_eq(&self, other: &Self) -> bool {
-        use super::CompressedPostingBlock;
+        let left = Self { weights: vec![], max_next_weights: vec![], block_quantization_params: vec![], ..self.clone() };
+        let right = Self { weights: vec![], max_next_weights: vec![], block_quantization_params: vec![], ..other.clone() };
 
-        let left = Self { simple_blocks: vec![], extended_blocks: vec![], ..self.clone() };
-        let right = Self { simple_blocks: vec![], extended_blocks: vec![], ..self.clone() };
-
-        // compare fields without blocks.
-        if left != right {
+        // compare fields without weights.
+        if left != right || self.block_quantization_params.len() != other.block_quantization_params.len() {
             return false;
         }
 
-        // compare blocks.
-        match self.compressed_block_type {
-            CompressedBlockType::Simple => {
-                let cur_blocks: &Vec<SimpleCompressedPostingBlock<TW>> = &self.simple_blocks;
-                let other_blocks: &Vec<SimpleCompressedPostingBlock<TW>> = &other.simple_blocks;
-                cur_blocks.iter().zip(other_blocks).all(|(left, right)| left.approximately_eq(right, self.quantization_params.clone()))
-            }
-            CompressedBlockType::Extended => {
-                let cur_blocks: &Vec<ExtendedCompressedPostingBlock<TW>> = &self.extended_blocks;
-                let other_blocks: &Vec<ExtendedCompressedPostingBlock<TW>> = &other.extended_blocks;
-                cur_blocks.iter().zip(other_blocks).all(|(left, right)| left.approximately_eq(right, self.quantization_params.clone()))
-            }
-        }
+        // compare weights, each block with its own quantization param.
+        let (view, other_view) = (self.view(), other.view());
+        let weight_eq = |block_idx: usize, w1: &TW, w2: &TW| match view.quantized_param(block_idx) {
+            Some(param) => param.approximately_eq(*w1, *w2),
+            None => w1 == w2,
+        };
+        let block_eq = |block_idx: usize, left: &[TW], right: &[TW]| left.iter().zip(right).all(|(w1, w2)| weight_eq(block_idx, w1, w2));
+        self.weights.len() == other.weights.len()
+            && self.max_next_weights.len() == other.max_next_weights.len()
+            && (0..self.blocks.len()).all(|block_idx| {
+                let (left, right) = (view.blocks.block_weights(block_idx), other_view.blocks.block_weights(block_idx));
+                left.iter().zip(right.iter()).all(|(w1, w2)| weight_eq(block_idx, &w1, &w2))
+                    && block_eq(block_idx, view.blocks.max_next_weights(block_idx), other_view.blocks.max_next_weights(block_idx))
+            })
     }
 }
@@ -1,22 +1,40 @@
-use crate::core::{ElementType, GenericElement, PostingListError, PostingListIter, PostingListMerger, QuantizedParam, QuantizedWeight};
+use crate::{
+    core::{ElementRead, ElementType, ElementWrite, GenericElement, PostingListError, PostingListIter, PostingListMerger, QuantizedParam, QuantizedWeight},
+    RowId,
+};
 
 use super::{CompressedPostingBuilder, CompressedPostingList, CompressedPostingListIterator};
 
 pub struct CompressedPostingListMerger;
 
 impl CompressedPostingListMerger {
-    /// input a group of postings, they are in the same dim-id.
+    /// input a group of postings, they are in the same dim-id. Quantized weights of the result keep 4 bits for `u4_weights`.
     pub fn merge_posting_lists<OW: QuantizedWeight, TW: QuantizedWeight>(
         compressed_posting_iterators: &mut Vec<CompressedPostingListIterator<'_, OW, TW>>,
         element_type: ElementType,
+        u4_weights: bool,
+    ) -> Result<(CompressedPostingList<TW>, Option<QuantizedParam>), PostingListError> {
+        let row_id_offsets = vec![0; compressed_posting_iterators.len()];
+        Self::merge_shifted_posting_lists(compressed_posting_iterators, &row_id_offsets, element_type, u4_weights)
+    }
+
+    /// Same as `merge_posting_lists`, row ids of each posting are shifted by its wrapping offset in `row_id_offsets`.
+    pub fn merge_shifted_posting_lists<OW: QuantizedWeight, TW: QuantizedWeight>(
+        compressed_posting_iterators: &mut Vec<CompressedPostingListIterator<'_, OW, TW>>,
+        row_id_offsets: &[RowId],
+        element_type: ElementType,
+        u4_weights: bool,
     ) -> Result<(CompressedPostingList<TW>, Option<QuantizedParam>), PostingListError> {
         let mut postings: Vec<Vec<GenericElement<OW>>> = Vec::with_capacity(compressed_posting_iterators.len());
-        for iterator in compressed_posting_iterators {
+        for (iterator, &row_id_offset) in compressed_posting_iterators.iter_mut().zip(row_id_offsets.iter()) {
             let mut elements = Vec::new();
             while iterator.remains() != 0 {
                 let element = iterator.next();
                 if element.is_some() {
-                    let element = element.unwrap();
+                    let mut element = element.unwrap();
+                    if row_id_offset != 0 {
+                        element.update_row_id(element.row_id().wrapping_add(row_id_offset));
+                    }
                     elements.push(element);
                 } else {
                     break;
@@ -28,7 +46,7 @@ impl CompressedPostingListMerger {
         // Reuse the code of `PostingListMerger`
         match element_type {
             ElementType::SIMPLE => {
-                let mut builder: CompressedPostingBuilder<OW, TW> = CompressedPostingBuilder::<OW, TW>::new(element_type, false, false)?;
+                let mut builder: CompressedPostingBuilder<OW, TW> = CompressedPostingBuilder::<OW, TW>::new(element_type, false, false)?.with_u4_weights(u4_weights);
                 let (merged, _, _) = PostingListMerger::merge_simple_postings(&postings)?;
                 builder.posting = merged;
                 let compressed_merged = builder.build()?;
@@ -109,7 +127,7 @@ mod tests {
         let use_quantized = OW::weight_type() != TW::weight_type() && TW::weight_type() == WeightType::WeightU8;
         let (candidates, (expected_cmp_posting, expected_quantized_param)) = mock_compressed_posting_candidates::<OW, TW>(element_type, enlarge);
         let mut candidate_iterators = get_compressed_posting_iterators(&candidates);
-        let (result_cmp_posting, result_quantized_param) = CompressedPostingListMerger::merge_posting_lists::<OW, TW>(&mut candidate_iterators, element_type).unwrap();
+        let (result_cmp_posting, result_quantized_param) = CompressedPostingListMerger::merge_posting_lists::<OW, TW>(&mut candidate_iterators, element_type, false).unwrap();
 
         if use_quantized {
             assert!(result_quantized_param.is_some());
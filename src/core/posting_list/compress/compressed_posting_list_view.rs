@@ -1,13 +1,13 @@
-use std::mem::size_of;
+use std::sync::Arc;
 
 use log::error;
 
 use crate::{
-    core::{posting_list::encoder::VIntDecoder, BlockDecoder, PostingListError, QuantizedParam, QuantizedWeight, COMPRESSION_BLOCK_SIZE},
+    core::{BlockDecoder, DimId, PostingListError, QuantizedParam, QuantizedWeight, RowIdCodec, COMPRESSION_BLOCK_SIZE},
     RowId,
 };
 
-use super::{CompressedBlockType, CompressedPostingList, ExtendedCompressedPostingBlock, SimpleCompressedPostingBlock};
+use super::{CompressedBlockMeta, CompressedBlockType, CompressedBlocks, CompressedPostingList, DecodedBlock, DecodedBlockCache};
 
 #[derive(Default, Debug, Clone)]
 pub struct CompressedPostingListView<'a, TW>
@@ -15,12 +15,16 @@ where
     TW: QuantizedWeight,
 {
     pub row_ids_compressed: &'a [u8],
-    pub simple_blocks: &'a [SimpleCompressedPostingBlock<TW>],
-    pub extended_blocks: &'a [ExtendedCompressedPostingBlock<TW>],
+    pub blocks: CompressedBlocks<'a, TW>,
     pub compressed_block_type: CompressedBlockType,
+    pub row_id_codec: RowIdCodec,
     pub quantization_params: Option<QuantizedParam>,
     pub row_ids_count: RowId,
     pub max_row_id: Option<RowId>,
+    /// Smallest and largest weight restored into `f32`, only known when the view is loaded from mmap headers.
+    pub weight_bounds: Option<(f32, f32)>,
+    /// (segment key, dim id) of a posting stored in a segment, its blocks can be kept in the decoded block cache.
+    pub block_cache_key: Option<(u64, DimId)>,
 }
 
 #[allow(unused)]
@@ -30,27 +34,123 @@ where
 {
     pub fn new(
         row_ids_compressed: &'a [u8],
-        simple_blocks: &'a [SimpleCompressedPostingBlock<TW>],
-        extended_blocks: &'a [ExtendedCompressedPostingBlock<TW>],
+        blocks: CompressedBlocks<'a, TW>,
         compressed_block_type: CompressedBlockType,
+        row_id_codec: RowIdCodec,
         quantized_params: Option<QuantizedParam>,
         row_ids_count: RowId,
         max_row_id: Option<RowId>,
     ) -> Self {
-        Self { row_ids_compressed, simple_blocks, extended_blocks, compressed_block_type, quantization_params: quantized_params, row_ids_count, max_row_id }
+        Self {
+            row_ids_compressed,
+            blocks,
+            compressed_block_type,
+            row_id_codec,
+            quantization_params: quantized_params,
+            row_ids_count,
+            max_row_id,
+            weight_bounds: None,
+            block_cache_key: None,
+        }
+    }
+
+    pub fn with_weight_bounds(mut self, min_weight: f32, max_weight: f32) -> Self {
+        self.weight_bounds = Some((min_weight, max_weight));
+        self
+    }
+
+    pub fn with_block_cache_key(mut self, segment_key: u64, dim_id: DimId) -> Self {
+        self.block_cache_key = Some((segment_key, dim_id));
+        self
+    }
+
+    /// Same view over other bytes.
+    pub fn with_bytes<'b>(&self, row_ids_compressed: &'b [u8], blocks: CompressedBlocks<'b, TW>) -> CompressedPostingListView<'b, TW> {
+        CompressedPostingListView {
+            row_ids_compressed,
+            blocks,
+            compressed_block_type: self.compressed_block_type,
+            row_id_codec: self.row_id_codec,
+            quantization_params: self.quantization_params,
+            row_ids_count: self.row_ids_count,
+            max_row_id: self.max_row_id,
+            weight_bounds: self.weight_bounds,
+            block_cache_key: self.block_cache_key,
+        }
+    }
+
+    /// Quantization param of the block, block quantized postings keep their own one for every block.
+    pub fn quantized_param(&self, block_idx: usize) -> Option<QuantizedParam> {
+        self.blocks.quantized_param(block_idx).or(self.quantization_params)
+    }
+
+    /// Scan all blocks for the smallest and largest weight restored into `f32`,
+    /// `(f32::INFINITY, f32::NEG_INFINITY)` for empty posting.
+    pub fn compute_weight_bounds(&self) -> (f32, f32) {
+        // Every block is restored into the same buffer.
+        let mut weights = Vec::with_capacity(COMPRESSION_BLOCK_SIZE);
+        (0..self.blocks.len()).fold((f32::INFINITY, f32::NEG_INFINITY), |bounds, block_idx| {
+            self.restore_block_weights_into(block_idx, &mut weights);
+            weights.iter().fold(bounds, |(min, max), &weight| (min.min(weight), max.max(weight)))
+        })
+    }
+
+    /// Weights of the block restored into `f32`.
+    fn restore_block_weights(&self, block_idx: usize) -> Vec<f32> {
+        let mut weights = Vec::with_capacity(COMPRESSION_BLOCK_SIZE);
+        self.restore_block_weights_into(block_idx, &mut weights);
+        weights
+    }
+
+    /// Replace `restored` with the weights of the block restored into `f32`.
+    fn restore_block_weights_into(&self, block_idx: usize, restored: &mut Vec<f32>) {
+        let weights = self.blocks.block_weights(block_idx);
+        restored.clear();
+        match self.quantized_param(block_idx) {
+            Some(param) => restored.extend(weights.iter().map(|weight| f32::unquantize_with_param(TW::to_u8(weight), param))),
+            None => restored.extend(weights.iter().map(|weight| TW::to_f32(weight))),
+        }
     }
 
     pub fn last_id(&self) -> Option<RowId> {
         self.max_row_id
     }
 
+    /// Owned posting always packs its weights, blocks loaded from old segments are converted.
     pub fn to_owned(&self) -> CompressedPostingList<TW> {
+        let blocks_count = self.blocks.len();
+        if let CompressedBlocks::PackedU4 { metas, params, weights } = self.blocks {
+            return CompressedPostingList {
+                row_ids_compressed: self.row_ids_compressed.to_vec(),
+                blocks: metas.to_vec(),
+                weights: weights.iter().map(|&byte| TW::from_u8(byte)).collect(),
+                max_next_weights: vec![],
+                compressed_block_type: self.compressed_block_type,
+                row_id_codec: self.row_id_codec,
+                quantization_params: self.quantization_params,
+                block_quantization_params: params.to_vec(),
+                u4_weights: true,
+                row_ids_count: self.row_ids_count,
+                max_row_id: self.max_row_id,
+            };
+        }
         CompressedPostingList {
             row_ids_compressed: self.row_ids_compressed.to_vec(),
-            simple_blocks: self.simple_blocks.to_vec(),
-            extended_blocks: self.extended_blocks.to_vec(),
+            blocks: (0..blocks_count)
+                .filter_map(|block_idx| self.blocks.meta(block_idx))
+                .scan(0, |weights_offset, meta| {
+                    let packed = CompressedBlockMeta { weights_offset: *weights_offset, ..meta };
+                    *weights_offset += meta.row_ids_count as u32;
+                    Some(packed)
+                })
+                .collect(),
+            weights: (0..blocks_count).flat_map(|block_idx| self.blocks.weights(block_idx).iter().copied()).collect(),
+            max_next_weights: (0..blocks_count).flat_map(|block_idx| self.blocks.max_next_weights(block_idx).iter().copied()).collect(),
             compressed_block_type: self.compressed_block_type,
+            row_id_codec: self.row_id_codec,
             quantization_params: self.quantization_params,
+            block_quantization_params: (0..blocks_count).filter_map(|block_idx| self.blocks.quantized_param(block_idx)).collect(),
+            u4_weights: false,
             row_ids_count: self.row_ids_count,
             max_row_id: self.max_row_id,
         }
@@ -76,102 +176,67 @@ where
 
         row_ids_uncompressed_in_block.clear();
 
-        if row_ids_count as usize == COMPRESSION_BLOCK_SIZE {
-            let consumed_bytes: usize = decoder.uncompress_block_sorted(row_ids_compressed_in_block, row_id_start.checked_sub(1).unwrap_or(0), num_bits, true);
-
-            if consumed_bytes != row_ids_compressed_size as usize {
-                let error_msg =
-                    format!("During block uncompressing-block-sorted, `consumed_bytes`:{} not equal with `row_ids_compressed_size`:{}", consumed_bytes, row_ids_compressed_size);
-                error!("{}", error_msg);
-                return Err(PostingListError::UncompressError(error_msg));
-            }
-            let res: &[u32; COMPRESSION_BLOCK_SIZE] = decoder.full_output();
-
-            row_ids_uncompressed_in_block.reserve(COMPRESSION_BLOCK_SIZE);
-            row_ids_uncompressed_in_block.extend_from_slice(res);
-        } else {
-            let consumed_bytes: usize = decoder.uncompress_vint_sorted(row_ids_compressed_in_block, row_id_start.checked_sub(1).unwrap_or(0), row_ids_count as usize, RowId::MAX);
-
-            if consumed_bytes != row_ids_compressed_size as usize {
-                let error_msg =
-                    format!("During block uncompressing-vint-sorted, `consumed_bytes`:{} not equal with `row_ids_compressed_size`:{}", consumed_bytes, row_ids_compressed_size);
-                error!("{}", error_msg);
-                return Err(PostingListError::UncompressError(error_msg));
-            }
-            let res: &[u32] = &decoder.output_array()[0..decoder.output_len];
-
-            row_ids_uncompressed_in_block.reserve(res.len());
-            row_ids_uncompressed_in_block.extend_from_slice(res);
+        let consumed_bytes: usize =
+            decoder.uncompress_row_ids(self.row_id_codec, row_ids_compressed_in_block, row_id_start.checked_sub(1).unwrap_or(0), num_bits, row_ids_count as usize);
+        if consumed_bytes != row_ids_compressed_size as usize {
+            let error_msg = format!(
+                "During block uncompressing with {:?}, `consumed_bytes`:{} not equal with `row_ids_compressed_size`:{}",
+                self.row_id_codec, consumed_bytes, row_ids_compressed_size
+            );
+            error!("{}", error_msg);
+            return Err(PostingListError::UncompressError(error_msg));
         }
+        let res: &[u32] = decoder.output_array();
+
+        row_ids_uncompressed_in_block.reserve(res.len());
+        row_ids_uncompressed_in_block.extend_from_slice(res);
         Ok(())
     }
 
-    pub fn uncompress_block(
-        &self,
-        block_type: CompressedBlockType,
-        block_idx: usize,
-        decoder: &mut BlockDecoder,
-        row_ids_uncompressed_in_block: &mut Vec<RowId>,
-    ) -> Result<(), PostingListError> {
-        match block_type {
-            CompressedBlockType::Simple => {
-                // Boundary.
-                if block_idx >= self.simple_blocks.len() {
-                    let error_msg = format!(
-                        "Can't uncompress SimpleBlock for `CompressedPostingList`, `block_idx` is overflow, [simple:{}, extended:{}]",
-                        self.simple_blocks.len(),
-                        self.extended_blocks.len()
-                    );
-                    error!("{}", error_msg);
-                    return Err(PostingListError::UncompressError(error_msg));
-                }
-                // uncompress simple block
-                let simple_block_ref: &SimpleCompressedPostingBlock<TW> = &self.simple_blocks[block_idx];
-
-                let block_offset_start = simple_block_ref.block_offset as usize;
-                let block_offset_end = (simple_block_ref.block_offset + simple_block_ref.row_ids_compressed_size as u64) as usize;
-
-                self.inner_uncompress_block(
-                    decoder,
-                    row_ids_uncompressed_in_block,
-                    block_offset_start,
-                    block_offset_end,
-                    simple_block_ref.row_ids_count,
-                    simple_block_ref.row_id_start,
-                    simple_block_ref.num_bits,
-                    simple_block_ref.row_ids_compressed_size,
-                )?;
-            }
-            CompressedBlockType::Extended => {
-                // Boundary.
-                if block_idx >= self.extended_blocks.len() {
-                    let error_msg = format!(
-                        "Can't uncompress ExtendedBlock for `CompressedPostingList`, `block_idx` is overflow, [simple:{}, extended:{}]",
-                        self.simple_blocks.len(),
-                        self.extended_blocks.len()
-                    );
-                    error!("{}", error_msg);
-                    return Err(PostingListError::UncompressError(error_msg));
-                }
-                // uncompress extended block
-                let extended_block_ref: &ExtendedCompressedPostingBlock<TW> = &self.extended_blocks[block_idx];
-
-                let block_offset_start = extended_block_ref.block_offset as usize;
-                let block_offset_end = (extended_block_ref.block_offset + extended_block_ref.row_ids_compressed_size as u64) as usize;
-
-                self.inner_uncompress_block(
-                    decoder,
-                    row_ids_uncompressed_in_block,
-                    block_offset_start,
-                    block_offset_end,
-                    extended_block_ref.row_ids_count,
-                    extended_block_ref.row_id_start,
-                    extended_block_ref.num_bits,
-                    extended_block_ref.row_ids_compressed_size,
-                )?;
-            }
+    pub fn uncompress_block(&self, block_idx: usize, decoder: &mut BlockDecoder, row_ids_uncompressed_in_block: &mut Vec<RowId>) -> Result<(), PostingListError> {
+        // Boundary.
+        let Some(block) = self.blocks.meta(block_idx) else {
+            let error_msg = format!("Can't uncompress block for `CompressedPostingList`, `block_idx`:{} is overflow, blocks:{}", block_idx, self.blocks.len());
+            error!("{}", error_msg);
+            return Err(PostingListError::UncompressError(error_msg));
+        };
+
+        let block_offset_start = block.block_offset as usize;
+        let block_offset_end = (block.block_offset + block.row_ids_compressed_size as u64) as usize;
+
+        self.inner_uncompress_block(
+            decoder,
+            row_ids_uncompressed_in_block,
+            block_offset_start,
+            block_offset_end,
+            block.row_ids_count,
+            block.row_id_start,
+            block.num_bits,
+            block.row_ids_compressed_size,
+        )
+    }
+
+    /// Block from the decoded block cache, uncompressed with `decoder` into `row_ids_uncompressed_in_block` and cached on a miss.
+    /// `None` when the view has no cache key, the cache is disabled or the block can't be uncompressed. The flag tells whether it was a hit.
+    pub fn decoded_block(&self, block_idx: usize, decoder: &mut BlockDecoder, row_ids_uncompressed_in_block: &mut Vec<RowId>) -> Option<(Arc<DecodedBlock>, bool)> {
+        let (segment_key, dim_id) = self.block_cache_key?;
+        let cache = DecodedBlockCache::global();
+        if cache.capacity() == 0 {
+            return None;
         }
-        return Ok(());
+        let (block, hit) = cache
+            .get_or_load((segment_key, dim_id, block_idx), || {
+                self.uncompress_block(block_idx, decoder, row_ids_uncompressed_in_block)?;
+                Ok::<_, PostingListError>(DecodedBlock { row_ids: row_ids_uncompressed_in_block.clone(), weights: self.restore_block_weights(block_idx) })
+            })
+            .ok()?;
+        cache.record(hit);
+        Some((block, hit))
+    }
+
+    /// Last block from `block_idx` whose first row id is not greater than `row_id`, blocks before it can be skipped without uncompressing.
+    pub fn seek_block(&self, block_idx: usize, row_id: RowId) -> usize {
+        block_idx + self.blocks.skippable(block_idx, row_id)
     }
 
     fn storage_size<F>(&self, calculator: F) -> usize
@@ -182,44 +247,78 @@ where
     }
 
     pub fn blocks_storage_size(&self) -> usize {
-        self.storage_size(|e| match e.compressed_block_type {
-            CompressedBlockType::Simple => e.simple_blocks.len() * size_of::<SimpleCompressedPostingBlock<TW>>(),
-            CompressedBlockType::Extended => e.extended_blocks.len() * size_of::<ExtendedCompressedPostingBlock<TW>>(),
-        })
+        self.storage_size(|e| e.blocks.storage_size())
     }
 
     pub fn row_ids_storage_size(&self) -> usize {
-        self.storage_size(|e| e.row_ids_compressed.len() * size_of::<u8>())
+        self.storage_size(|e| e.row_ids_compressed.len())
     }
 }
 
 #[cfg(test)]
 mod tests {
+    use super::super::test::mock_build_compressed_posting;
+    use super::super::ExtendedCompressedPostingBlock;
     use super::*;
+    use crate::core::{ElementType, COMPRESSION_BLOCK_SIZE};
 
     #[test]
     fn test_view_clone() {
         let row_ids_compressed: &[u8] = &vec![1, 2, 3];
-        let simple_blocks: &[SimpleCompressedPostingBlock<f32>] = &[];
-        let extended_blocks: &[ExtendedCompressedPostingBlock<f32>] = &[];
+        let weights: &[f32] = &[0.1, 0.2, 0.3];
 
         let original: CompressedPostingListView<'_, f32> = CompressedPostingListView {
             row_ids_compressed,
-            simple_blocks,
-            extended_blocks,
+            blocks: CompressedBlocks::Packed { metas: &[], params: &[], weights, max_next_weights: &[] },
             compressed_block_type: CompressedBlockType::Simple,
+            row_id_codec: RowIdCodec::default(),
             quantization_params: None,
             row_ids_count: 3,
             max_row_id: None,
+            weight_bounds: None,
+            block_cache_key: None,
         };
 
         let cloned = original.clone();
 
         // Ensure that both the original and cloned views point to the same memory locations for their data.
         assert!(std::ptr::addr_eq(original.row_ids_compressed as *const _, cloned.row_ids_compressed as *const _));
-        assert!(std::ptr::addr_eq(original.simple_blocks as *const _, cloned.simple_blocks as *const _));
-        assert!(std::ptr::addr_eq(original.extended_blocks as *const _, cloned.extended_blocks as *const _));
+        assert!(std::ptr::addr_eq(original.blocks.weights(0) as *const _, cloned.blocks.weights(0) as *const _));
     }
 
-    // TODO 测试 uncompress 逻辑是否正确
+    #[test]
+    fn test_legacy_blocks_read_as_packed() {
+        let elements: Vec<(RowId, f32)> = (0..300).map(|i| (i * 3, i as f32)).collect();
+        let (posting, _) = mock_build_compressed_posting::<f32, f32>(ElementType::EXTENDED, elements);
+        assert_eq!(posting.blocks.iter().map(|meta| meta.weights_offset).collect::<Vec<_>>(), [0, 128, 256]);
+        assert_eq!(posting.weights.len(), 300);
+
+        // Old segments embed 128 weights in every block.
+        let legacy_blocks: Vec<ExtendedCompressedPostingBlock<f32>> = posting
+            .blocks
+            .iter()
+            .map(|meta| {
+                let (start, count) = (meta.weights_offset as usize, meta.row_ids_count as usize);
+                let mut weights = [0.0; COMPRESSION_BLOCK_SIZE];
+                let mut max_next_weights = [0.0; COMPRESSION_BLOCK_SIZE];
+                weights[..count].copy_from_slice(&posting.weights[start..start + count]);
+                max_next_weights[..count].copy_from_slice(&posting.max_next_weights[start..start + count]);
+                ExtendedCompressedPostingBlock {
+                    row_id_start: meta.row_id_start,
+                    block_offset: meta.block_offset,
+                    row_ids_compressed_size: meta.row_ids_compressed_size,
+                    row_ids_count: meta.row_ids_count,
+                    num_bits: meta.num_bits,
+                    weights,
+                    max_next_weights,
+                }
+            })
+            .collect();
+        let legacy_view = CompressedPostingListView { blocks: CompressedBlocks::LegacyExtended(&legacy_blocks), ..posting.view() };
+
+        assert_eq!(legacy_view.blocks.weights(2), &posting.weights[256..]);
+        assert_eq!(legacy_view.to_owned(), posting);
+        assert_eq!(posting.view().blocks_storage_size(), CompressedBlocks::<f32>::packed_storage_size(300, CompressedBlockType::Extended, false));
+        assert!(posting.view().blocks_storage_size() < legacy_view.blocks_storage_size());
+    }
 }
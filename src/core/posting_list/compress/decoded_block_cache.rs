@@ -0,0 +1,33 @@
+use std::mem::size_of;
+
+use once_cell::sync::Lazy;
+
+use crate::{
+    core::{CacheEntry, ClockCache, DimId},
+    RowId,
+};
+
+static GLOBAL_DECODED_BLOCK_CACHE: Lazy<DecodedBlockCache> = Lazy::new(|| DecodedBlockCache::new(0));
+
+/// Row ids and weights of one block, weights are restored into `f32` with the block's quantization param.
+#[derive(Debug, Default, Clone, PartialEq)]
+pub struct DecodedBlock {
+    pub row_ids: Vec<RowId>,
+    pub weights: Vec<f32>,
+}
+
+impl CacheEntry for DecodedBlock {
+    fn size(&self) -> usize {
+        self.row_ids.len() * size_of::<RowId>() + self.weights.len() * size_of::<f32>()
+    }
+}
+
+/// Decoded blocks keyed by (segment key, dim id, block index).
+pub type DecodedBlockCache = ClockCache<(u64, DimId, usize), DecodedBlock>;
+
+impl DecodedBlockCache {
+    /// Cache shared by all compressed segments, disabled until a capacity is set.
+    pub fn global() -> &'static DecodedBlockCache {
+        &GLOBAL_DECODED_BLOCK_CACHE
+    }
+}
@@ -4,6 +4,7 @@ mod compressed_posting_iterator;
 mod compressed_posting_list;
 mod compressed_posting_list_merger;
 mod compressed_posting_list_view;
+mod decoded_block_cache;
 
 pub use compressed_posting_block::*;
 pub use compressed_posting_builder::CompressedPostingBuilder;
@@ -11,13 +12,14 @@ pub use compressed_posting_iterator::CompressedPostingListIterator;
 pub use compressed_posting_list::CompressedPostingList;
 pub use compressed_posting_list_merger::CompressedPostingListMerger;
 pub use compressed_posting_list_view::*;
+pub use decoded_block_cache::*;
 
 #[cfg(test)]
 mod test {
     use rand::Rng;
 
     use crate::{
-        core::{posting_list::encoder::VIntDecoder, BlockDecoder, ElementType, QuantizedParam, QuantizedWeight, COMPRESSION_BLOCK_SIZE},
+        core::{BlockDecoder, ElementType, QuantizedParam, QuantizedWeight, RowIdCodec, COMPRESSION_BLOCK_SIZE},
         RowId,
     };
 
@@ -118,37 +120,18 @@ mod test {
         let mut decoder = BlockDecoder::default();
         let row_ids_compressed = &compressed_posting.row_ids_compressed;
 
-        match compressed_posting.compressed_block_type {
-            super::CompressedBlockType::Simple => {
-                for simple_block in &compressed_posting.simple_blocks {
-                    let row_ids_compressed_in_block =
-                        &row_ids_compressed[simple_block.block_offset as usize..(simple_block.block_offset as usize + simple_block.row_ids_compressed_size as usize)];
-                    let mut row_ids_uncompressed = inner_uncompress_row_ids(
-                        &mut decoder,
-                        simple_block.row_id_start,
-                        simple_block.num_bits,
-                        simple_block.row_ids_compressed_size,
-                        simple_block.row_ids_count,
-                        row_ids_compressed_in_block,
-                    );
-                    row_ids_restore.append(&mut row_ids_uncompressed);
-                }
-            }
-            super::CompressedBlockType::Extended => {
-                for extend_block in &compressed_posting.extended_blocks {
-                    let row_ids_compressed_in_block =
-                        &row_ids_compressed[extend_block.block_offset as usize..(extend_block.block_offset as usize + extend_block.row_ids_compressed_size as usize)];
-                    let mut row_ids_uncompressed = inner_uncompress_row_ids(
-                        &mut decoder,
-                        extend_block.row_id_start,
-                        extend_block.num_bits,
-                        extend_block.row_ids_compressed_size,
-                        extend_block.row_ids_count,
-                        row_ids_compressed_in_block,
-                    );
-                    row_ids_restore.append(&mut row_ids_uncompressed);
-                }
-            }
+        for block in &compressed_posting.blocks {
+            let row_ids_compressed_in_block = &row_ids_compressed[block.block_offset as usize..(block.block_offset as usize + block.row_ids_compressed_size as usize)];
+            let mut row_ids_uncompressed = inner_uncompress_row_ids(
+                &mut decoder,
+                compressed_posting.row_id_codec,
+                block.row_id_start,
+                block.num_bits,
+                block.row_ids_compressed_size,
+                block.row_ids_count,
+                row_ids_compressed_in_block,
+            );
+            row_ids_restore.append(&mut row_ids_uncompressed);
         }
 
         row_ids_restore
@@ -156,16 +139,15 @@ mod test {
 
     fn inner_uncompress_row_ids(
         decoder: &mut BlockDecoder,
+        row_id_codec: RowIdCodec,
         row_id_start: RowId,
         num_bits: u8,
         row_ids_compressed_size: u16,
         row_ids_count: u8,
         row_ids_compressed_in_block: &[u8],
     ) -> Vec<u32> {
-        let consumed_bytes: usize = match row_ids_count as usize == COMPRESSION_BLOCK_SIZE {
-            true => decoder.uncompress_block_sorted(row_ids_compressed_in_block, row_id_start.checked_sub(1).unwrap_or(0), num_bits, true),
-            false => decoder.uncompress_vint_sorted(row_ids_compressed_in_block, row_id_start.checked_sub(1).unwrap_or(0), row_ids_count as usize, RowId::MAX),
-        };
+        let consumed_bytes: usize =
+            decoder.uncompress_row_ids(row_id_codec, row_ids_compressed_in_block, row_id_start.checked_sub(1).unwrap_or(0), num_bits, row_ids_count as usize);
 
         assert_eq!(consumed_bytes, row_ids_compressed_size as usize);
         let row_ids_uncompressed: Vec<u32> = match row_ids_count as usize == COMPRESSION_BLOCK_SIZE {
@@ -31,6 +31,10 @@ impl<W: QuantizedWeight> ElementWrite<W> for ExtendedElement<W> {
     fn update_max_next_weight(&mut self, value: W) {
         self.max_next_weight = value;
     }
+
+    fn update_row_id(&mut self, row_id: RowId) {
+        self.row_id = row_id;
+    }
 }
 
 impl<W: QuantizedWeight> ElementRead<W> for ExtendedElement<W> {
@@ -34,6 +34,7 @@ impl std::fmt::Display for ElementType {
 pub trait ElementWrite<W: QuantizedWeight> {
     fn update_weight(&mut self, value: W);
     fn update_max_next_weight(&mut self, value: W);
+    fn update_row_id(&mut self, row_id: RowId);
 }
 
 #[enum_dispatch]
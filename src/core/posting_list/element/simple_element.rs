@@ -23,6 +23,10 @@ impl<W: QuantizedWeight> ElementWrite<W> for SimpleElement<W> {
     }
 
     fn update_max_next_weight(&mut self, _value: W) {}
+
+    fn update_row_id(&mut self, row_id: RowId) {
+        self.row_id = row_id;
+    }
 }
 
 impl<W: QuantizedWeight> ElementRead<W> for SimpleElement<W> {
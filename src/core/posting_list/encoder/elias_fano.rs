@@ -0,0 +1,101 @@
+//! Elias-Fano coding of a sorted block: the `num_bits` low bits of every value are packed densely,
+//! the high parts are stored in unary as a bit vector. It takes about `2 + num_bits` bits per value,
+//! no matter how the gaps are distributed.
+
+/// `floor(log2(universe / num_els))`, the number of low bits minimizing the encoded size.
+pub fn low_bits_len(num_els: usize, universe: u64) -> u8 {
+    let ratio = universe / (num_els.max(1) as u64);
+    match ratio {
+        0 => 0,
+        // High parts are restored into `u32`, keep them shiftable.
+        _ => (63 - ratio.leading_zeros()).min(31) as u8,
+    }
+}
+
+#[inline]
+fn read_u64(bytes: &[u8]) -> u64 {
+    let mut word = [0u8; 8];
+    let len = bytes.len().min(8);
+    word[..len].copy_from_slice(&bytes[..len]);
+    u64::from_le_bytes(word)
+}
+
+/// Values are encoded relative to `offset`, which should not be greater than the first value.
+pub fn compress_sorted<'a>(input: &[u32], output: &'a mut [u8], offset: u32) -> (u8, &'a [u8]) {
+    let Some(&last) = input.last() else {
+        return (0, &output[..0]);
+    };
+    let num_bits = low_bits_len(input.len(), (last - offset) as u64 + 1);
+    let low_len = (input.len() * num_bits as usize + 7) / 8;
+    let high_bits = input.len() + ((last - offset) >> num_bits) as usize;
+    let byte_written = low_len + (high_bits + 7) / 8;
+    output[..byte_written].fill(0);
+
+    for (idx, &v) in input.iter().enumerate() {
+        let value = v - offset;
+        let low_pos = idx * num_bits as usize;
+        for bit in 0..num_bits as usize {
+            if value >> bit & 1 != 0 {
+                output[(low_pos + bit) / 8] |= 1 << ((low_pos + bit) % 8);
+            }
+        }
+        let high_pos = (value >> num_bits) as usize + idx;
+        output[low_len + high_pos / 8] |= 1 << (high_pos % 8);
+    }
+    (num_bits, &output[..byte_written])
+}
+
+/// Decode `output.len()` values, returns the number of bytes read.
+pub fn uncompress_sorted(compressed_data: &[u8], output: &mut [u32], offset: u32, num_bits: u8) -> usize {
+    if output.is_empty() {
+        return 0;
+    }
+    let low_len = (output.len() * num_bits as usize + 7) / 8;
+    let (lows, highs) = compressed_data.split_at(low_len);
+
+    // The `idx`-th set bit at position `pos` holds high part `pos - idx`.
+    let mut idx = 0;
+    let mut high_len = 0;
+    for (word_idx, word_bytes) in highs.chunks(8).enumerate() {
+        let mut word = read_u64(word_bytes);
+        while word != 0 && idx < output.len() {
+            let pos = word_idx * 64 + word.trailing_zeros() as usize;
+            output[idx] = ((pos - idx) as u32) << num_bits;
+            word &= word - 1;
+            idx += 1;
+            high_len = pos / 8 + 1;
+        }
+        if idx == output.len() {
+            break;
+        }
+    }
+
+    let mask = (1u64 << num_bits) - 1;
+    for (idx, value) in output.iter_mut().enumerate() {
+        let low_pos = idx * num_bits as usize;
+        let low = if num_bits == 0 { 0 } else { (read_u64(&lows[low_pos / 8..]) >> (low_pos % 8)) & mask };
+        *value = (*value | low as u32) + offset;
+    }
+    low_len + high_len
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_compress_and_uncompress_sorted() {
+        let mut output = [0u8; 128 * 5];
+        let dense: Vec<u32> = (1..=128).collect();
+        let sparse: Vec<u32> = (0..128u32).map(|i| 7 + i * i * 977).collect();
+        let huge_gap: Vec<u32> = vec![5, u32::MAX - 1];
+        for (vals, offset) in [(dense, 0), (sparse, 6), (huge_gap, 4), (vec![9], 8), (vec![], 0)] {
+            let (num_bits, compressed) = compress_sorted(&vals, &mut output, offset);
+            let compressed = compressed.to_vec();
+
+            let mut restored = vec![0u32; vals.len()];
+            assert_eq!(uncompress_sorted(&compressed, &mut restored, offset, num_bits), compressed.len());
+            assert_eq!(restored, vals);
+        }
+    }
+}
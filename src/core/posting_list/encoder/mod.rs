@@ -2,10 +2,56 @@ use bitpacking::{BitPacker, BitPacker4x};
 use common::FixedSize;
 
 pub const COMPRESSION_BLOCK_SIZE: usize = BitPacker4x::BLOCK_LEN;
-const COMPRESSED_BLOCK_MAX_SIZE: usize = COMPRESSION_BLOCK_SIZE * u32::SIZE_IN_BYTES;
+/// Worst case of all row id codecs, vint takes up to 5 bytes per value.
+const ENCODER_OUTPUT_MAX_SIZE: usize = COMPRESSION_BLOCK_SIZE * (u32::SIZE_IN_BYTES + 1);
 
+mod elias_fano;
+mod stream_vbyte;
 mod vint;
 
+/// Postings with fewer blocks than this use StreamVByte, a bit width per block doesn't pay off there.
+const STREAM_VBYTE_MAX_BLOCKS: usize = 4;
+/// Postings with at least this many blocks use Elias-Fano when row ids are sparse enough.
+const ELIAS_FANO_MIN_BLOCKS: usize = 16;
+/// Elias-Fano takes about `2 + log2(avg_gap)` bits per row id, bitpacking pays for the largest gap of each block.
+const ELIAS_FANO_MIN_AVG_GAP: u64 = 16;
+
+/// How the row ids of each block in a compressed posting are encoded, stored in the posting header.
+#[derive(Default, Copy, Debug, Clone, PartialEq, Eq)]
+#[repr(u8)]
+pub enum RowIdCodec {
+    /// `BitPacker4x` for full blocks, vint for the last partial block.
+    #[default]
+    BitPacking = 0,
+    /// Byte aligned deltas with separate length codes, fast SIMD decoding.
+    StreamVByte = 1,
+    /// Size independent of the gap distribution, suits very long and sparse postings.
+    EliasFano = 2,
+}
+
+impl RowIdCodec {
+    pub fn from_u8(code: u8) -> Option<Self> {
+        match code {
+            0 => Some(RowIdCodec::BitPacking),
+            1 => Some(RowIdCodec::StreamVByte),
+            2 => Some(RowIdCodec::EliasFano),
+            _ => None,
+        }
+    }
+
+    /// Codec for a posting of `row_ids_count` row ids spread over `row_id_span` (max row id - min row id).
+    pub fn choose(row_ids_count: usize, row_id_span: u64) -> Self {
+        let blocks = (row_ids_count + COMPRESSION_BLOCK_SIZE - 1) / COMPRESSION_BLOCK_SIZE;
+        if blocks < STREAM_VBYTE_MAX_BLOCKS {
+            RowIdCodec::StreamVByte
+        } else if blocks >= ELIAS_FANO_MIN_BLOCKS && row_id_span / row_ids_count as u64 >= ELIAS_FANO_MIN_AVG_GAP {
+            RowIdCodec::EliasFano
+        } else {
+            RowIdCodec::BitPacking
+        }
+    }
+}
+
 /// Returns the size in bytes of a compressed block, given `num_bits`.
 pub fn compressed_block_size(num_bits: u8) -> usize {
     (num_bits as usize) * COMPRESSION_BLOCK_SIZE / 8
@@ -13,7 +59,7 @@ pub fn compressed_block_size(num_bits: u8) -> usize {
 
 pub struct BlockEncoder {
     bitpacker: BitPacker4x,
-    pub output: [u8; COMPRESSED_BLOCK_MAX_SIZE],
+    pub output: [u8; ENCODER_OUTPUT_MAX_SIZE],
     pub output_len: usize,
 }
 
@@ -25,7 +71,7 @@ impl Default for BlockEncoder {
 
 impl BlockEncoder {
     pub fn new() -> BlockEncoder {
-        BlockEncoder { bitpacker: BitPacker4x::new(), output: [0u8; COMPRESSED_BLOCK_MAX_SIZE], output_len: 0 }
+        BlockEncoder { bitpacker: BitPacker4x::new(), output: [0u8; ENCODER_OUTPUT_MAX_SIZE], output_len: 0 }
     }
 
     pub fn compress_block_sorted(&mut self, block: &[u32], offset: u32) -> (u8, &[u8]) {
@@ -38,6 +84,16 @@ impl BlockEncoder {
         (num_bits, &self.output[..written_size])
     }
 
+    /// Compress sorted row ids of one block with `codec`, returns `num_bits` needed for uncompressing and the compressed bytes.
+    pub fn compress_row_ids(&mut self, codec: RowIdCodec, block: &[u32], offset: u32) -> (u8, &[u8]) {
+        match codec {
+            RowIdCodec::BitPacking if block.len() == COMPRESSION_BLOCK_SIZE => self.compress_block_sorted(block, offset),
+            RowIdCodec::BitPacking => (0, vint::compress_sorted(block, &mut self.output, offset)),
+            RowIdCodec::StreamVByte => (0, stream_vbyte::compress_sorted(block, &mut self.output, offset)),
+            RowIdCodec::EliasFano => elias_fano::compress_sorted(block, &mut self.output, offset),
+        }
+    }
+
     /// Compress a single block of unsorted numbers.
     ///
     /// If `minus_one_encoded` is set, each value must be >= 1, and will be encoded in a sligly
@@ -106,6 +162,24 @@ impl BlockDecoder {
         }
     }
 
+    /// Decompress `num_els` sorted row ids compressed by [`BlockEncoder::compress_row_ids`], returns the number of bytes read.
+    pub fn uncompress_row_ids(&mut self, codec: RowIdCodec, compressed_data: &[u8], offset: u32, num_bits: u8, num_els: usize) -> usize {
+        match codec {
+            RowIdCodec::BitPacking if num_els == COMPRESSION_BLOCK_SIZE => self.uncompress_block_sorted(compressed_data, offset, num_bits, true),
+            RowIdCodec::BitPacking => self.uncompress_vint_sorted(compressed_data, offset, num_els, u32::MAX),
+            RowIdCodec::StreamVByte => {
+                self.output_len = num_els;
+                self.output[num_els..].fill(u32::MAX);
+                stream_vbyte::uncompress_sorted(compressed_data, &mut self.output[..num_els], offset)
+            }
+            RowIdCodec::EliasFano => {
+                self.output_len = num_els;
+                self.output[num_els..].fill(u32::MAX);
+                elias_fano::uncompress_sorted(compressed_data, &mut self.output[..num_els], offset, num_bits)
+            }
+        }
+    }
+
     /// Decompress block of unsorted integers.
     ///
     /// `minus_one_encoded` depends on what encoding was used. Older version of tantivy never use
@@ -318,6 +392,32 @@ pub mod tests {
             }
         }
     }
+
+    #[test]
+    fn test_row_id_codecs() {
+        let mut encoder = BlockEncoder::new();
+        let mut decoder = BlockDecoder::default();
+        for codec in [RowIdCodec::BitPacking, RowIdCodec::StreamVByte, RowIdCodec::EliasFano] {
+            for num_els in [1, 77, COMPRESSION_BLOCK_SIZE] {
+                let vals: Vec<u32> = (0..num_els as u32).map(|i| 1000 + i * i * 31).collect();
+                let (num_bits, compressed) = encoder.compress_row_ids(codec, &vals, 999);
+                let consumed_num_bytes = decoder.uncompress_row_ids(codec, compressed, 999, num_bits, num_els);
+                assert_eq!(consumed_num_bytes, compressed.len());
+                assert_eq!(decoder.output_array(), &vals[..]);
+            }
+        }
+    }
+
+    #[test]
+    fn test_choose_row_id_codec() {
+        assert_eq!(RowIdCodec::choose(100, 100), RowIdCodec::StreamVByte);
+        assert_eq!(RowIdCodec::choose(COMPRESSION_BLOCK_SIZE * 20, (COMPRESSION_BLOCK_SIZE * 20) as u64), RowIdCodec::BitPacking);
+        assert_eq!(RowIdCodec::choose(COMPRESSION_BLOCK_SIZE * 20, (COMPRESSION_BLOCK_SIZE * 20 * 64) as u64), RowIdCodec::EliasFano);
+        assert_eq!(RowIdCodec::choose(COMPRESSION_BLOCK_SIZE * 8, (COMPRESSION_BLOCK_SIZE * 8 * 64) as u64), RowIdCodec::BitPacking);
+        for codec in [RowIdCodec::BitPacking, RowIdCodec::StreamVByte, RowIdCodec::EliasFano] {
+            assert_eq!(RowIdCodec::from_u8(codec as u8), Some(codec));
+        }
+    }
 }
 
 #[cfg(all(test, feature = "unstable"))]
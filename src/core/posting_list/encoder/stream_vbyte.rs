@@ -0,0 +1,163 @@
+//! Stream VByte: the byte length of 4 deltas is packed as 2-bit codes in one control byte,
+//! all control bytes come first and data bytes follow. A whole quad is decoded with one shuffle.
+
+#[inline]
+fn byte_len(value: u32) -> usize {
+    match value {
+        0..=0xff => 1,
+        0x100..=0xffff => 2,
+        0x1_0000..=0xff_ffff => 3,
+        _ => 4,
+    }
+}
+
+#[inline]
+fn control_len(num_els: usize) -> usize {
+    (num_els + 3) / 4
+}
+
+pub fn compress_sorted<'a>(input: &[u32], output: &'a mut [u8], mut offset: u32) -> &'a [u8] {
+    let control_len = control_len(input.len());
+    output[..control_len].fill(0);
+    let mut byte_written = control_len;
+    for (idx, &v) in input.iter().enumerate() {
+        let delta = v - offset;
+        offset = v;
+        let len = byte_len(delta);
+        output[idx / 4] |= ((len - 1) as u8) << (2 * (idx % 4));
+        output[byte_written..byte_written + len].copy_from_slice(&delta.to_le_bytes()[..len]);
+        byte_written += len;
+    }
+    &output[..byte_written]
+}
+
+/// Decode `output.len()` values, returns the number of bytes read.
+pub fn uncompress_sorted(compressed_data: &[u8], output: &mut [u32], offset: u32) -> usize {
+    #[cfg(target_arch = "x86_64")]
+    if has_ssse3() {
+        return unsafe { ssse3::uncompress_sorted(compressed_data, output, offset) };
+    }
+    let (control, data) = compressed_data.split_at(control_len(output.len()));
+    control.len() + uncompress_from(control, data, 0, output, 0, offset)
+}
+
+/// Feature detection is cached, decoding runs once per block.
+#[cfg(target_arch = "x86_64")]
+#[inline]
+fn has_ssse3() -> bool {
+    use std::sync::atomic::{AtomicU8, Ordering};
+    static HAS_SSSE3: AtomicU8 = AtomicU8::new(u8::MAX);
+    let has_ssse3 = HAS_SSSE3.load(Ordering::Relaxed);
+    if has_ssse3 == u8::MAX {
+        let detected = is_x86_feature_detected!("ssse3");
+        HAS_SSSE3.store(detected as u8, Ordering::Relaxed);
+        return detected;
+    }
+    has_ssse3 != 0
+}
+
+/// Scalar decoding of `output[start..]`, data of `output[start]` begins at `data[read_byte]`. Returns the data bytes read in total.
+fn uncompress_from(control: &[u8], data: &[u8], mut read_byte: usize, output: &mut [u32], start: usize, mut offset: u32) -> usize {
+    for idx in start..output.len() {
+        let len = ((control[idx / 4] >> (2 * (idx % 4))) & 3) as usize + 1;
+        let mut bytes = [0u8; 4];
+        bytes[..len].copy_from_slice(&data[read_byte..read_byte + len]);
+        offset += u32::from_le_bytes(bytes);
+        output[idx] = offset;
+        read_byte += len;
+    }
+    read_byte
+}
+
+#[cfg(target_arch = "x86_64")]
+mod ssse3 {
+    use std::arch::x86_64::*;
+
+    /// Shuffle mask of every control byte, lanes of 4 little endian deltas, `0xff` zeroes the unused bytes.
+    const SHUFFLE_MASKS: [[u8; 16]; 256] = {
+        let mut masks = [[0xffu8; 16]; 256];
+        let mut code = 0;
+        while code < 256 {
+            let mut source = 0;
+            let mut lane = 0;
+            while lane < 4 {
+                let len = ((code >> (2 * lane)) & 3) + 1;
+                let mut byte = 0;
+                while byte < len {
+                    masks[code][lane * 4 + byte] = source as u8;
+                    source += 1;
+                    byte += 1;
+                }
+                lane += 1;
+            }
+            code += 1;
+        }
+        masks
+    };
+
+    /// Data bytes taken by the quad of every control byte.
+    const QUAD_LENGTHS: [u8; 256] = {
+        let mut lengths = [0u8; 256];
+        let mut code = 0;
+        while code < 256 {
+            lengths[code] = ((code & 3) + ((code >> 2) & 3) + ((code >> 4) & 3) + ((code >> 6) & 3) + 4) as u8;
+            code += 1;
+        }
+        lengths
+    };
+
+    #[target_feature(enable = "ssse3")]
+    pub(super) unsafe fn uncompress_sorted(compressed_data: &[u8], output: &mut [u32], offset: u32) -> usize {
+        let (control, data) = compressed_data.split_at(super::control_len(output.len()));
+        let mut read_byte = 0;
+        let mut idx = 0;
+        let mut previous = _mm_set1_epi32(offset as i32);
+        // Full quads whose 16 bytes load stays inside `data`, the rest goes through scalar decoding.
+        while idx + 4 <= output.len() && read_byte + 16 <= data.len() {
+            let code = control[idx / 4] as usize;
+            let raw = _mm_loadu_si128(data.as_ptr().add(read_byte) as *const __m128i);
+            let deltas = _mm_shuffle_epi8(raw, _mm_loadu_si128(SHUFFLE_MASKS[code].as_ptr() as *const __m128i));
+            // Prefix sum of 4 lanes, then add the last value of previous quad.
+            let sums = _mm_add_epi32(deltas, _mm_slli_si128(deltas, 4));
+            let sums = _mm_add_epi32(sums, _mm_slli_si128(sums, 8));
+            let values = _mm_add_epi32(sums, previous);
+            _mm_storeu_si128(output.as_mut_ptr().add(idx) as *mut __m128i, values);
+            previous = _mm_shuffle_epi32(values, 0xff);
+            read_byte += QUAD_LENGTHS[code] as usize;
+            idx += 4;
+        }
+        let offset = if idx == 0 { offset } else { output[idx - 1] };
+        control.len() + super::uncompress_from(control, data, read_byte, output, idx, offset)
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_compress_and_uncompress_sorted() {
+        let mut output = [0u8; 128 * 5];
+        for num_els in [0, 1, 3, 4, 5, 17, 127, 128] {
+            // Deltas of 1 to 4 bytes.
+            let mut value = 10u32;
+            let vals: Vec<u32> = (0..num_els as u32)
+                .map(|i| {
+                    value += [1, 300, 70_000, 20_000_000][i as usize % 4];
+                    value
+                })
+                .collect();
+            let compressed = compress_sorted(&vals, &mut output, 10).to_vec();
+
+            let mut restored = vec![0u32; num_els];
+            let consumed = uncompress_sorted(&compressed, &mut restored, 10);
+            assert_eq!(consumed, compressed.len());
+            assert_eq!(restored, vals);
+
+            let (control, data) = compressed.split_at(control_len(num_els));
+            let mut scalar_restored = vec![0u32; num_els];
+            assert_eq!(uncompress_from(control, data, 0, &mut scalar_restored, 0, 10), data.len());
+            assert_eq!(scalar_restored, vals);
+        }
+    }
+}
@@ -6,11 +6,12 @@ mod simple;
 mod element;
 mod errors;
 pub use compress::*;
-pub use encoder::{BlockDecoder, BlockEncoder, COMPRESSION_BLOCK_SIZE};
+pub use encoder::{BlockDecoder, BlockEncoder, RowIdCodec, COMPRESSION_BLOCK_SIZE};
 use enum_dispatch::enum_dispatch;
-pub use simple::{PostingList, PostingListBuilder, PostingListIterator, PostingListMerger};
+pub use simple::{
+    ColumnarPostingListIterator, MmapPostingListIterator, PostingList, PostingListBuilder, PostingListColumns, PostingListIterator, PostingListMerger, COLUMNAR_SKIP_INTERVAL,
+};
 // pub use traits::*;
-use crate::core::dispatch::PostingListIteratorWrapper;
 pub use element::*;
 pub use errors::*;
 
@@ -35,9 +36,27 @@ pub trait PostingListIter<OW: QuantizedWeight, TW: QuantizedWeight> {
 
     fn cursor(&self) -> usize;
 
+    /// Lower bound of all weights in this posting restored into `f32`, `f32::NEG_INFINITY` when unknown.
+    /// Pruning needs it to bound the contribution of a negative query weight.
+    fn min_weight(&self) -> f32;
+
+    /// Upper bound of all weights in this posting restored into `f32`, `f32::INFINITY` when unknown.
+    fn max_weight(&self) -> f32;
+
+    /// How many blocks this iterator has decompressed, always 0 for uncompressed postings.
+    fn blocks_decompressed(&self) -> usize;
+
     /// Iter till specific row_id.
     /// TODO: If need contains this row_id.
     fn for_each_till_row_id(&mut self, row_id: RowId, f: impl FnMut(&GenericElement<OW>));
+
+    /// Iter till specific row_id (included), yields `(row_id, weight)` with weight restored into `f32`.
+    /// Element stopped at is not consumed. Search kernels use this to avoid building `GenericElement`.
+    fn for_each_weight_till_row_id(&mut self, row_id: RowId, f: impl FnMut(RowId, f32));
+
+    /// Same as `for_each_weight_till_row_id`, but yields `weight * query_dim_weight`.
+    /// For u8 weights the query weight is folded into scale and offset once, no per element unquantize.
+    fn for_each_score_till_row_id(&mut self, row_id: RowId, query_dim_weight: f32, f: impl FnMut(RowId, f32));
 }
 
 #[cfg(test)]
@@ -1,10 +1,14 @@
 mod posting_list;
 mod posting_list_builder;
+mod posting_list_columns;
+mod posting_list_columns_iterator;
 mod posting_list_iterator;
 mod posting_list_merge;
 
 pub use posting_list::PostingList;
 pub use posting_list_builder::PostingListBuilder;
+pub use posting_list_columns::{PostingListColumns, COLUMNAR_SKIP_INTERVAL};
+pub use posting_list_columns_iterator::{ColumnarPostingListIterator, MmapPostingListIterator};
 pub use posting_list_iterator::PostingListIterator;
 pub use posting_list_merge::PostingListMerger;
 
@@ -1,6 +1,9 @@
 use std::mem::size_of;
 
-use crate::core::{ElementRead, ElementType, ElementWrite, ExtendedElement, GenericElement, QuantizedWeight, SimpleElement, DEFAULT_MAX_NEXT_WEIGHT};
+use crate::core::{
+    gen_quantized_param_of, ElementRead, ElementType, ElementWrite, ExtendedElement, GenericElement, QuantizedParam, QuantizedWeight, SimpleElement, DEFAULT_MAX_NEXT_WEIGHT,
+    QUANTIZATION_BLOCK_SIZE,
+};
 use crate::RowId;
 use log::{debug, error};
 
@@ -45,6 +48,33 @@ impl<OW: QuantizedWeight> PostingList<OW> {
         self.elements.len()
     }
 
+    /// Smallest and largest weight restored into `f32`, `(f32::INFINITY, f32::NEG_INFINITY)` for empty posting.
+    /// Elements covered by `block_params` are restored with the param of their block.
+    pub fn weight_bounds(&self, quantized_param: Option<QuantizedParam>, block_params: &[QuantizedParam]) -> (f32, f32) {
+        self.elements
+            .iter()
+            .enumerate()
+            .map(|(idx, e)| match block_params.get(idx / QUANTIZATION_BLOCK_SIZE).copied().or(quantized_param) {
+                Some(param) => f32::unquantize_with_param(OW::to_u8(e.weight()), param),
+                None => OW::to_f32(e.weight()),
+            })
+            .fold((f32::INFINITY, f32::NEG_INFINITY), |(min, max), weight| (min.min(weight), max.max(weight)))
+    }
+
+    /// Quantize every `QUANTIZATION_BLOCK_SIZE` elements with the param of their own range, into `0..=15` for `u4_weights`.
+    /// Returns the quantized posting, the param covering the whole posting and the param of each block.
+    pub fn quantize_by_blocks<TW: QuantizedWeight>(self, u4_weights: bool) -> (PostingList<TW>, QuantizedParam, Vec<QuantizedParam>) {
+        let quantized_param = gen_quantized_param_of(self.elements.iter().map(|e| e.weight()));
+        let block_params: Vec<QuantizedParam> = self
+            .elements
+            .chunks(QUANTIZATION_BLOCK_SIZE)
+            .map(|block| gen_quantized_param_of(block.iter().map(|e| e.weight())))
+            .map(|param| if u4_weights { param.to_u4() } else { param })
+            .collect();
+        let elements = self.elements.iter().enumerate().map(|(idx, e)| e.quantize_with_param::<TW>(block_params[idx / QUANTIZATION_BLOCK_SIZE])).collect();
+        (PostingList { elements, element_type: self.element_type }, quantized_param, block_params)
+    }
+
     #[allow(unused)]
     pub fn delete(&mut self, row_id: RowId) -> (usize, bool) {
         let search_result = self.elements.binary_search_by_key(&row_id, |e| e.row_id());
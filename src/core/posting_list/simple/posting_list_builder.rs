@@ -34,6 +34,10 @@ pub struct PostingListBuilder<OW: QuantizedWeight, TW: QuantizedWeight> {
     #[builder(default = false)]
     finally_propagate: bool,
 
+    /// Quantized weights keep 4 bits, only used by [`Self::build_block_quantized`].
+    #[builder(default = false)]
+    u4_weights: bool,
+
     pub(super) _phantom_tw: PhantomData<TW>,
 }
 
@@ -81,6 +85,12 @@ impl<OW: QuantizedWeight, TW: QuantizedWeight> PostingListBuilder<OW, TW> {
 
     //     Ok(posting_list_builder.build()?.0)
     // }
+    /// Quantize weights into 4 bits, it takes effect only when weights need to be quantized.
+    pub fn with_u4_weights(mut self, u4_weights: bool) -> Self {
+        self.u4_weights = u4_weights && self.need_quantized;
+        self
+    }
+
     #[cfg(test)]
     pub fn update_inner_posting(&mut self, posting: PostingList<OW>) {
         self.posting = posting
@@ -105,9 +115,9 @@ impl<OW: QuantizedWeight, TW: QuantizedWeight> PostingListBuilder<OW, TW> {
         }
     }
 
-    /// return actual and inner memory usage
+    /// return actual and inner memory usage, actual one counts the capacity reserved by the posting.
     pub fn memory_usage(&self) -> (usize, usize) {
-        let actual_memory_usage = self.posting.len() * size_of::<GenericElement<OW>>();
+        let actual_memory_usage = self.posting.elements.capacity() * size_of::<GenericElement<OW>>();
         let inner_memory_usage = match self.element_type {
             ElementType::SIMPLE => self.posting.len() * size_of::<SimpleElement<OW>>(),
             ElementType::EXTENDED => self.posting.len() * size_of::<ExtendedElement<OW>>(),
@@ -171,7 +181,7 @@ impl<OW: QuantizedWeight, TW: QuantizedWeight> PostingListBuilder<OW, TW> {
         }
     }
 
-    pub fn build(mut self) -> Result<(PostingList<TW>, Option<QuantizedParam>), PostingListError> {
+    fn check_sorted(&self) -> Result<(), PostingListError> {
         #[cfg(debug_assertions)]
         {
             if let Some(res) = self.posting.elements.windows(2).find(|e| e[0].row_id() >= e[1].row_id()) {
@@ -180,6 +190,23 @@ impl<OW: QuantizedWeight, TW: QuantizedWeight> PostingListBuilder<OW, TW> {
                 return Err(PostingListError::DuplicatedRowId(error_msg));
             }
         }
+        Ok(())
+    }
+
+    /// Same with [`Self::build`], but a quantized posting is quantized block by block, the param of
+    /// each `QUANTIZATION_BLOCK_SIZE` elements is returned after the param covering the whole posting.
+    pub fn build_block_quantized(self) -> Result<(PostingList<TW>, Option<QuantizedParam>, Vec<QuantizedParam>), PostingListError> {
+        if !self.need_quantized || self.finally_propagate {
+            let (posting, quantized_param) = self.build()?;
+            return Ok((posting, quantized_param, vec![]));
+        }
+        self.check_sorted()?;
+        let (posting, quantized_param, block_params) = self.posting.quantize_by_blocks::<TW>(self.u4_weights);
+        Ok((posting, Some(quantized_param), block_params))
+    }
+
+    pub fn build(mut self) -> Result<(PostingList<TW>, Option<QuantizedParam>), PostingListError> {
+        self.check_sorted()?;
 
         let mut quantized_param: Option<QuantizedParam> = None;
 
@@ -0,0 +1,182 @@
+use std::mem::size_of;
+
+use crate::core::{
+    transmute_from_u8_to_slice, transmute_to_u8_slice, ElementRead, ElementType, ExtendedElement, GenericElement, QuantizedParam, QuantizedWeight, SimpleElement,
+    QUANTIZATION_BLOCK_SIZE,
+};
+use crate::RowId;
+
+/// Elements covered by one skip entry of a columnar posting.
+pub const COLUMNAR_SKIP_INTERVAL: usize = 128;
+
+// A skip group shares one quantization param.
+const _: () = assert!(COLUMNAR_SKIP_INTERVAL == QUANTIZATION_BLOCK_SIZE);
+
+/// Every column starts on this boundary, so a posting can be viewed in place.
+const COLUMN_ALIGNMENT: usize = size_of::<RowId>();
+
+fn align_column(size: usize) -> usize {
+    (size + COLUMN_ALIGNMENT - 1) / COLUMN_ALIGNMENT * COLUMN_ALIGNMENT
+}
+
+/// Structure-of-arrays view of an uncompressed posting.
+///
+/// Stored columns: `row_ids`, `skips` (last row_id of every `COLUMNAR_SKIP_INTERVAL` elements), `block_params`
+/// (quantization param of every `COLUMNAR_SKIP_INTERVAL` elements) for block quantized postings, `weights`,
+/// and `max_next_weights` for extended postings.
+#[derive(Debug, Clone, Copy)]
+pub struct PostingListColumns<'a, TW: QuantizedWeight> {
+    pub element_type: ElementType,
+    pub row_ids: &'a [RowId],
+    pub skips: &'a [RowId],
+    /// Empty unless the posting is block quantized.
+    pub block_params: &'a [QuantizedParam],
+    pub weights: &'a [TW],
+    /// Empty for simple postings.
+    pub max_next_weights: &'a [TW],
+}
+
+impl<'a, TW: QuantizedWeight> PostingListColumns<'a, TW> {
+    fn skips_count(len: usize) -> usize {
+        (len + COLUMNAR_SKIP_INTERVAL - 1) / COLUMNAR_SKIP_INTERVAL
+    }
+
+    fn block_params_size(len: usize, block_quantized: bool) -> usize {
+        match block_quantized {
+            true => Self::skips_count(len) * size_of::<QuantizedParam>(),
+            false => 0,
+        }
+    }
+
+    /// Bytes taken by a posting of `len` elements.
+    pub fn storage_size(element_type: ElementType, len: usize, block_quantized: bool) -> usize {
+        let weights_size = align_column(len * size_of::<TW>());
+        let row_ids_size = (len + Self::skips_count(len)) * size_of::<RowId>() + Self::block_params_size(len, block_quantized);
+        match element_type {
+            ElementType::SIMPLE => row_ids_size + weights_size,
+            ElementType::EXTENDED => row_ids_size + weights_size * 2,
+        }
+    }
+
+    pub fn from_bytes(element_type: ElementType, len: usize, block_quantized: bool, bytes: &'a [u8]) -> Self {
+        let (row_ids, rest) = bytes.split_at(len * size_of::<RowId>());
+        let (skips, rest) = rest.split_at(Self::skips_count(len) * size_of::<RowId>());
+        let (block_params, rest) = rest.split_at(Self::block_params_size(len, block_quantized));
+        let (weights, rest) = rest.split_at(align_column(len * size_of::<TW>()));
+        let max_next_weights = match element_type {
+            ElementType::SIMPLE => &rest[..0],
+            ElementType::EXTENDED => &rest[..len * size_of::<TW>()],
+        };
+        Self {
+            element_type,
+            row_ids: transmute_from_u8_to_slice(row_ids),
+            skips: transmute_from_u8_to_slice(skips),
+            block_params: transmute_from_u8_to_slice(block_params),
+            weights: transmute_from_u8_to_slice(&weights[..len * size_of::<TW>()]),
+            max_next_weights: transmute_from_u8_to_slice(max_next_weights),
+        }
+    }
+
+    /// Write `elements` into `bytes`, whose length should be `storage_size`.
+    /// `block_params` is empty, or holds the param of every `COLUMNAR_SKIP_INTERVAL` elements.
+    pub fn write(element_type: ElementType, elements: &[GenericElement<TW>], block_params: &[QuantizedParam], bytes: &mut [u8]) {
+        let len = elements.len();
+        let row_ids: Vec<RowId> = elements.iter().map(|element| element.row_id()).collect();
+        let skips: Vec<RowId> = row_ids.chunks(COLUMNAR_SKIP_INTERVAL).map(|chunk| *chunk.last().unwrap()).collect();
+        let weights: Vec<TW> = elements.iter().map(|element| element.weight()).collect();
+
+        let mut offset = 0;
+        for column in [transmute_to_u8_slice(&row_ids), transmute_to_u8_slice(&skips), transmute_to_u8_slice(block_params)] {
+            bytes[offset..offset + column.len()].copy_from_slice(column);
+            offset += column.len();
+        }
+        bytes[offset..offset + len * size_of::<TW>()].copy_from_slice(transmute_to_u8_slice(&weights));
+        offset += align_column(len * size_of::<TW>());
+        if element_type == ElementType::EXTENDED {
+            let max_next_weights: Vec<TW> = elements.iter().map(|element| element.max_next_weight()).collect();
+            bytes[offset..offset + len * size_of::<TW>()].copy_from_slice(transmute_to_u8_slice(&max_next_weights));
+        }
+    }
+
+    pub fn len(&self) -> usize {
+        self.row_ids.len()
+    }
+
+    /// Quantization param of the element at `idx`, `None` unless the posting is block quantized.
+    pub fn block_param(&self, idx: usize) -> Option<QuantizedParam> {
+        self.block_params.get(idx / COLUMNAR_SKIP_INTERVAL).copied()
+    }
+
+    pub fn element(&self, idx: usize) -> Option<GenericElement<TW>> {
+        let row_id = *self.row_ids.get(idx)?;
+        let weight = self.weights[idx];
+        Some(match self.element_type {
+            ElementType::SIMPLE => GenericElement::SimpleElement(SimpleElement { row_id, weight }),
+            ElementType::EXTENDED => GenericElement::ExtendedElement(ExtendedElement { row_id, weight, max_next_weight: self.max_next_weights[idx] }),
+        })
+    }
+
+    /// First position from `cursor` whose row_id is not smaller than `row_id`, `len()` if none.
+    /// Skip entries locate the group, only that group of row ids is searched.
+    pub fn seek(&self, cursor: usize, row_id: RowId) -> usize {
+        let first_group = cursor / COLUMNAR_SKIP_INTERVAL;
+        let group = first_group + self.skips.get(first_group..).unwrap_or_default().partition_point(|&last_row_id| last_row_id < row_id);
+        if group >= self.skips.len() {
+            return self.len();
+        }
+        let start = cursor.max(group * COLUMNAR_SKIP_INTERVAL);
+        let end = self.len().min((group + 1) * COLUMNAR_SKIP_INTERVAL);
+        start + self.row_ids[start..end].partition_point(|&current_row_id| current_row_id < row_id)
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_write_and_seek() {
+        let elements: Vec<GenericElement<u8>> =
+            (0..300).map(|i| GenericElement::ExtendedElement(ExtendedElement { row_id: i * 3, weight: (i % 250) as u8, max_next_weight: 255 })).collect();
+        let size = PostingListColumns::<u8>::storage_size(ElementType::EXTENDED, elements.len(), false);
+        assert_eq!(size % COLUMN_ALIGNMENT, 0);
+
+        let mut bytes = vec![0u32; size / COLUMN_ALIGNMENT];
+        let bytes: &mut [u8] = unsafe { std::slice::from_raw_parts_mut(bytes.as_mut_ptr() as *mut u8, size) };
+        PostingListColumns::write(ElementType::EXTENDED, &elements, &[], bytes);
+
+        let columns = PostingListColumns::<u8>::from_bytes(ElementType::EXTENDED, elements.len(), false, bytes);
+        assert!(columns.block_params.is_empty());
+        assert_eq!(columns.skips, &[381, 765, 897]);
+        for (idx, element) in elements.iter().enumerate() {
+            assert_eq!(columns.element(idx).as_ref(), Some(element));
+        }
+        assert!(columns.element(elements.len()).is_none());
+
+        assert_eq!(columns.seek(0, 0), 0);
+        assert_eq!(columns.seek(0, 382), 128);
+        assert_eq!(columns.seek(0, 383), 128);
+        assert_eq!(columns.seek(200, 3), 200);
+        assert_eq!(columns.seek(0, 897), 299);
+        assert_eq!(columns.seek(0, 898), 300);
+    }
+
+    #[test]
+    fn test_write_block_params() {
+        let elements: Vec<GenericElement<u8>> = (0..200).map(|i| GenericElement::SimpleElement(SimpleElement { row_id: i, weight: i as u8 })).collect();
+        let block_params = [QuantizedParam::from_minmax(0.0, 1.0), QuantizedParam::from_minmax(5.0, 9.0)];
+        let size = PostingListColumns::<u8>::storage_size(ElementType::SIMPLE, elements.len(), true);
+        assert_eq!(size, PostingListColumns::<u8>::storage_size(ElementType::SIMPLE, elements.len(), false) + 2 * size_of::<QuantizedParam>());
+
+        let mut bytes = vec![0u32; size / COLUMN_ALIGNMENT];
+        let bytes: &mut [u8] = unsafe { std::slice::from_raw_parts_mut(bytes.as_mut_ptr() as *mut u8, size) };
+        PostingListColumns::write(ElementType::SIMPLE, &elements, &block_params, bytes);
+
+        let columns = PostingListColumns::<u8>::from_bytes(ElementType::SIMPLE, elements.len(), true, bytes);
+        assert_eq!(columns.block_params, &block_params);
+        assert_eq!(columns.block_param(127), Some(block_params[0]));
+        assert_eq!(columns.block_param(128), Some(block_params[1]));
+        assert_eq!(columns.weights.len(), elements.len());
+        assert_eq!(columns.element(199).as_ref(), Some(&elements[199]));
+    }
+}
@@ -0,0 +1,254 @@
+use std::marker::PhantomData;
+
+use enum_dispatch::enum_dispatch;
+
+use crate::core::{u8_weights_to_scores, weights_as_u8, ElementRead, GenericElement, PostingListIter, QuantizedParam, QuantizedWeight};
+use crate::RowId;
+
+use super::{PostingListColumns, PostingListIterator, COLUMNAR_SKIP_INTERVAL};
+
+/// Iterator over a columnar posting, row ids and weights can be borrowed as slices from the cursor.
+#[derive(Debug, Clone)]
+pub struct ColumnarPostingListIterator<'a, OW: QuantizedWeight, TW: QuantizedWeight> {
+    pub columns: PostingListColumns<'a, TW>,
+    pub quantized_param: Option<QuantizedParam>,
+    pub cursor: usize,
+    /// `(min_weight, max_weight)` recorded in mmap header, see [`PostingListIter::min_weight`].
+    pub weight_bounds: Option<(f32, f32)>,
+    _ow: PhantomData<OW>,
+}
+
+impl<'a, OW: QuantizedWeight, TW: QuantizedWeight> ColumnarPostingListIterator<'a, OW, TW> {
+    pub fn new(columns: PostingListColumns<'a, TW>, quantized_param: Option<QuantizedParam>) -> Self {
+        Self { columns, quantized_param, cursor: 0, weight_bounds: None, _ow: PhantomData }
+    }
+
+    pub fn with_weight_bounds(mut self, min_weight: f32, max_weight: f32) -> Self {
+        self.weight_bounds = Some((min_weight, max_weight));
+        self
+    }
+
+    /// Row ids not consumed yet.
+    pub fn row_ids(&self) -> &'a [RowId] {
+        &self.columns.row_ids[self.cursor.min(self.columns.len())..]
+    }
+
+    /// Stored weights not consumed yet, the same length as `row_ids`.
+    pub fn weights(&self) -> &'a [TW] {
+        &self.columns.weights[self.cursor.min(self.columns.len())..]
+    }
+
+    /// Quantization param of the element at `idx`, block quantized postings keep one for every skip group.
+    fn quantized_param_at(&self, idx: usize) -> Option<QuantizedParam> {
+        self.columns.block_param(idx).or(self.quantized_param)
+    }
+
+    /// Restore weights from cursor till `row_id` (included) skip group by skip group, `restore` handles one contiguous
+    /// run of weights sharing the same quantization param.
+    fn scan_till_row_id(&mut self, row_id: RowId, restore: impl Fn(Option<QuantizedParam>, &[TW], &mut [f32]), f: &mut impl FnMut(RowId, f32)) {
+        let end = self.cursor + self.row_ids().partition_point(|&current_row_id| current_row_id <= row_id);
+        let mut values: [f32; COLUMNAR_SKIP_INTERVAL] = [0.0; COLUMNAR_SKIP_INTERVAL];
+        while self.cursor < end {
+            let chunk_end = end.min((self.cursor / COLUMNAR_SKIP_INTERVAL + 1) * COLUMNAR_SKIP_INTERVAL);
+            let weights = &self.columns.weights[self.cursor..chunk_end];
+            let values = &mut values[..weights.len()];
+            restore(self.quantized_param_at(self.cursor), weights, values);
+            for (&current_row_id, &value) in self.columns.row_ids[self.cursor..chunk_end].iter().zip(values.iter()) {
+                f(current_row_id, value);
+            }
+            self.cursor = chunk_end;
+        }
+    }
+}
+
+impl<'a, OW: QuantizedWeight, TW: QuantizedWeight> PostingListIter<OW, TW> for ColumnarPostingListIterator<'a, OW, TW> {
+    fn peek(&mut self) -> Option<GenericElement<OW>> {
+        self.columns.element(self.cursor).map(|element| element.convert_or_unquantize(self.quantized_param_at(self.cursor)))
+    }
+
+    fn last_id(&self) -> Option<RowId> {
+        self.columns.row_ids.last().copied()
+    }
+
+    fn skip_to(&mut self, row_id: RowId) -> Option<GenericElement<OW>> {
+        if self.cursor >= self.columns.len() {
+            return None;
+        }
+        self.cursor = self.columns.seek(self.cursor, row_id);
+        match self.columns.row_ids.get(self.cursor) {
+            Some(&current_row_id) if current_row_id == row_id => self.peek(),
+            _ => None,
+        }
+    }
+
+    fn skip_to_end(&mut self) {
+        self.cursor = self.columns.len();
+    }
+
+    fn remains(&self) -> usize {
+        self.columns.len() - self.cursor
+    }
+
+    fn cursor(&self) -> usize {
+        self.cursor
+    }
+
+    fn min_weight(&self) -> f32 {
+        // Quantized range is the posting range.
+        self.weight_bounds.map(|(min, _)| min).or(self.quantized_param.map(|param| param.min())).unwrap_or(f32::NEG_INFINITY)
+    }
+
+    fn max_weight(&self) -> f32 {
+        self.weight_bounds.map(|(_, max)| max).or(self.quantized_param.map(|param| param.max())).unwrap_or(f32::INFINITY)
+    }
+
+    fn blocks_decompressed(&self) -> usize {
+        0
+    }
+
+    fn for_each_till_row_id(&mut self, row_id: RowId, mut f: impl FnMut(&GenericElement<OW>)) {
+        while let Some(element) = self.peek() {
+            if element.row_id() > row_id {
+                break;
+            }
+            f(&element);
+            self.cursor += 1;
+        }
+    }
+
+    fn for_each_weight_till_row_id(&mut self, row_id: RowId, mut f: impl FnMut(RowId, f32)) {
+        self.scan_till_row_id(
+            row_id,
+            |quantized_param, weights, values| match quantized_param {
+                Some(param) => {
+                    for (value, &weight) in values.iter_mut().zip(weights.iter()) {
+                        *value = f32::unquantize_with_param(TW::to_u8(weight), param);
+                    }
+                }
+                None => {
+                    for (value, &weight) in values.iter_mut().zip(weights.iter()) {
+                        *value = TW::to_f32(weight);
+                    }
+                }
+            },
+            &mut f,
+        );
+    }
+
+    fn for_each_score_till_row_id(&mut self, row_id: RowId, query_dim_weight: f32, mut f: impl FnMut(RowId, f32)) {
+        // u8 weights (quantized or not) are restored by SIMD kernel, scale and offset are folded once per skip group.
+        self.scan_till_row_id(
+            row_id,
+            |quantized_param, weights, scores| {
+                let (scale, offset) = match quantized_param {
+                    Some(param) => param.scale_and_offset(query_dim_weight),
+                    None => (query_dim_weight, 0.0),
+                };
+                match weights_as_u8(weights) {
+                    Some(u8_weights) => u8_weights_to_scores(u8_weights, scale, offset, scores),
+                    None => {
+                        for (score, &weight) in scores.iter_mut().zip(weights.iter()) {
+                            *score = TW::to_f32(weight) * query_dim_weight;
+                        }
+                    }
+                }
+            },
+            &mut f,
+        );
+    }
+}
+
+/// Iterator handed out by a simple mmap index, postings are interleaved in old segments and columnar in new ones.
+#[enum_dispatch(PostingListIter<OW, TW>)]
+#[derive(Debug, Clone)]
+pub enum MmapPostingListIterator<'a, OW: QuantizedWeight, TW: QuantizedWeight> {
+    Interleaved(PostingListIterator<'a, OW, TW>),
+    Columnar(ColumnarPostingListIterator<'a, OW, TW>),
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::core::{ElementType, PostingList, SimpleElement};
+
+    fn build_columns(elements: &[(RowId, f32)]) -> Vec<u32> {
+        let elements: Vec<GenericElement<f32>> = elements.iter().map(|&(row_id, weight)| GenericElement::SimpleElement(SimpleElement { row_id, weight })).collect();
+        let size = PostingListColumns::<f32>::storage_size(ElementType::SIMPLE, elements.len(), false);
+        let mut storage = vec![0u32; size / 4];
+        PostingListColumns::write(ElementType::SIMPLE, &elements, &[], unsafe { std::slice::from_raw_parts_mut(storage.as_mut_ptr() as *mut u8, size) });
+        storage
+    }
+
+    fn columns(storage: &[u32], len: usize) -> PostingListColumns<'_, f32> {
+        PostingListColumns::from_bytes(ElementType::SIMPLE, len, false, unsafe { std::slice::from_raw_parts(storage.as_ptr() as *const u8, storage.len() * 4) })
+    }
+
+    #[test]
+    fn test_skip_to_and_slices() {
+        let elements: Vec<(RowId, f32)> = (0..500).map(|i| (i * 2, i as f32)).collect();
+        let storage = build_columns(&elements);
+        let mut iterator = ColumnarPostingListIterator::<f32, f32>::new(columns(&storage, elements.len()), None);
+
+        assert_eq!(iterator.last_id(), Some(998));
+        assert_eq!(iterator.skip_to(400).unwrap().weight(), 200.0);
+        assert_eq!(iterator.row_ids()[..2], [400, 402]);
+        assert_eq!(iterator.weights()[..2], [200.0, 201.0]);
+        assert!(iterator.skip_to(401).is_none());
+        assert_eq!(iterator.cursor(), 201);
+        // skip to old elements
+        assert!(iterator.skip_to(14).is_none());
+        assert_eq!(iterator.cursor(), 201);
+        assert!(iterator.skip_to(1000).is_none());
+        assert_eq!(iterator.remains(), 0);
+    }
+
+    #[test]
+    fn test_for_each_score_till_row_id() {
+        let elements: Vec<(RowId, f32)> = (0..300).map(|i| (i, 1.0 + i as f32)).collect();
+        let storage = build_columns(&elements);
+        let mut iterator = ColumnarPostingListIterator::<f32, f32>::new(columns(&storage, elements.len()), None);
+
+        let mut scores = Vec::new();
+        iterator.for_each_score_till_row_id(199, 0.5, |row_id, score| scores.push((row_id, score)));
+        assert_eq!(scores.len(), 200);
+        assert_eq!(scores[150], (150, 75.5));
+        // boundary element should not be consumed.
+        assert_eq!(iterator.peek().unwrap().row_id(), 200);
+
+        let mut weights = Vec::new();
+        iterator.for_each_weight_till_row_id(RowId::MAX, |row_id, weight| weights.push((row_id, weight)));
+        assert_eq!(weights.first(), Some(&(200, 201.0)));
+        assert_eq!(iterator.remains(), 0);
+    }
+
+    #[test]
+    fn test_block_quantized_weights() {
+        // An outlier in the first block widens the posting range, the second block keeps its own narrow range.
+        let weights: Vec<f32> = (0..256).map(|i| if i == 0 { 100.0 } else { 1.0 + (i % 7) as f32 * 0.01 }).collect();
+        let elements = weights.iter().enumerate().map(|(i, &weight)| GenericElement::SimpleElement(SimpleElement { row_id: i as RowId, weight })).collect();
+        let (quantized, param, block_params) = PostingList { elements, element_type: ElementType::SIMPLE }.quantize_by_blocks::<u8>(false);
+        assert_eq!(block_params.len(), 2);
+        assert!(block_params[1].min_precision() * 1000.0 < param.min_precision());
+
+        let size = PostingListColumns::<u8>::storage_size(ElementType::SIMPLE, weights.len(), true);
+        let mut storage = vec![0u32; size / 4];
+        let bytes: &mut [u8] = unsafe { std::slice::from_raw_parts_mut(storage.as_mut_ptr() as *mut u8, size) };
+        PostingListColumns::write(ElementType::SIMPLE, &quantized.elements, &block_params, bytes);
+        let columns = PostingListColumns::<u8>::from_bytes(ElementType::SIMPLE, weights.len(), true, bytes);
+
+        let mut restored = Vec::new();
+        ColumnarPostingListIterator::<f32, u8>::new(columns, Some(param)).for_each_weight_till_row_id(RowId::MAX, |_, weight| restored.push(weight));
+        assert_eq!(restored.len(), weights.len());
+        assert_eq!(restored[0], 100.0);
+        for (&origin, &weight) in weights.iter().zip(restored.iter()).skip(128) {
+            assert!((origin - weight).abs() <= block_params[1].min_precision());
+        }
+
+        let mut iterator = ColumnarPostingListIterator::<f32, u8>::new(columns, Some(param));
+        assert_eq!(iterator.skip_to(200).unwrap().weight(), restored[200]);
+        let mut scores = Vec::new();
+        iterator.for_each_score_till_row_id(RowId::MAX, 2.0, |_, score| scores.push(score));
+        assert_eq!(scores.len(), 56);
+        assert!((scores[0] - restored[200] * 2.0).abs() < 1e-4);
+    }
+}
@@ -8,17 +8,48 @@ pub struct PostingListIterator<'a, OW: QuantizedWeight, TW: QuantizedWeight> {
     pub generic_elements_slice: GenericElementSlice<'a, TW>,
     pub quantized_param: Option<QuantizedParam>,
     pub cursor: usize,
+    /// `(min_weight, max_weight)` recorded in mmap header, see [`PostingListIter::min_weight`].
+    pub weight_bounds: Option<(f32, f32)>,
     _ow: PhantomData<OW>,
 }
 
 impl<'a, OW: QuantizedWeight, TW: QuantizedWeight> PostingListIterator<'a, OW, TW> {
     pub fn new(generic_elements_slice: GenericElementSlice<'a, TW>, quantized_param: Option<QuantizedParam>) -> PostingListIterator<'a, OW, TW> {
-        PostingListIterator { generic_elements_slice, quantized_param, cursor: 0, _ow: PhantomData }
+        PostingListIterator { generic_elements_slice, quantized_param, cursor: 0, weight_bounds: None, _ow: PhantomData }
+    }
+
+    pub fn with_weight_bounds(mut self, min_weight: f32, max_weight: f32) -> Self {
+        self.weight_bounds = Some((min_weight, max_weight));
+        self
     }
 
     fn type_convert(&self, raw_element: &GenericElement<TW>) -> GenericElement<OW> {
         raw_element.convert_or_unquantize(self.quantized_param)
     }
+
+    /// Scan a concrete element slice, returns how many elements are consumed.
+    #[inline]
+    fn scan_elements<E: ElementRead<TW>>(elements: &[E], row_id: RowId, restore: impl Fn(TW) -> f32, f: &mut impl FnMut(RowId, f32)) -> usize {
+        let mut consumed = 0;
+        for element in elements {
+            if element.row_id() > row_id {
+                break;
+            }
+            f(element.row_id(), restore(element.weight()));
+            consumed += 1;
+        }
+        consumed
+    }
+
+    /// Match element slice type once, then scan from cursor till `row_id` (included).
+    #[inline]
+    fn scan_till_row_id(&mut self, row_id: RowId, restore: impl Fn(TW) -> f32, f: &mut impl FnMut(RowId, f32)) {
+        let consumed = match self.generic_elements_slice {
+            GenericElementSlice::SimpleElementSlice(elements) => Self::scan_elements(elements.get(self.cursor..).unwrap_or_default(), row_id, restore, f),
+            GenericElementSlice::ExtendedElementSlice(elements) => Self::scan_elements(elements.get(self.cursor..).unwrap_or_default(), row_id, restore, f),
+        };
+        self.cursor += consumed;
+    }
 }
 
 impl<'a, OW: QuantizedWeight, TW: QuantizedWeight> PostingListIter<OW, TW> for PostingListIterator<'a, OW, TW> {
@@ -63,6 +94,19 @@ impl<'a, OW: QuantizedWeight, TW: QuantizedWeight> PostingListIter<OW, TW> for P
         self.cursor
     }
 
+    fn min_weight(&self) -> f32 {
+        // Quantized range is the posting range.
+        self.weight_bounds.map(|(min, _)| min).or(self.quantized_param.map(|param| param.min())).unwrap_or(f32::NEG_INFINITY)
+    }
+
+    fn blocks_decompressed(&self) -> usize {
+        0
+    }
+
+    fn max_weight(&self) -> f32 {
+        self.weight_bounds.map(|(_, max)| max).or(self.quantized_param.map(|param| param.max())).unwrap_or(f32::INFINITY)
+    }
+
     fn for_each_till_row_id(&mut self, row_id: RowId, mut f: impl FnMut(&GenericElement<OW>)) {
         let mut cursor = self.cursor;
 
@@ -77,6 +121,23 @@ impl<'a, OW: QuantizedWeight, TW: QuantizedWeight> PostingListIter<OW, TW> for P
         }
         self.cursor = cursor;
     }
+
+    fn for_each_weight_till_row_id(&mut self, row_id: RowId, mut f: impl FnMut(RowId, f32)) {
+        match self.quantized_param {
+            Some(param) => self.scan_till_row_id(row_id, |weight| f32::unquantize_with_param(TW::to_u8(weight), param), &mut f),
+            None => self.scan_till_row_id(row_id, |weight| TW::to_f32(weight), &mut f),
+        }
+    }
+
+    fn for_each_score_till_row_id(&mut self, row_id: RowId, query_dim_weight: f32, mut f: impl FnMut(RowId, f32)) {
+        match self.quantized_param {
+            Some(param) => {
+                let (scale, offset) = param.scale_and_offset(query_dim_weight);
+                self.scan_till_row_id(row_id, |weight| offset + TW::to_u8(weight) as f32 * scale, &mut f)
+            }
+            None => self.scan_till_row_id(row_id, |weight| TW::to_f32(weight) * query_dim_weight, &mut f),
+        }
+    }
 }
 
 #[cfg(test)]
@@ -182,4 +243,54 @@ mod tests {
 
         assert_eq!(values, vec![70.0, 45.0, 10.0, 30.0]);
     }
+
+    #[test]
+    fn test_for_each_weight_till_row_id() {
+        let simple_elements = create_simple_elements::<f32>(vec![(6, 70.0), (14, 45.0), (17, 10.0), (18, 30.0), (21, 20.0)]);
+
+        let generic_elements_slice = GenericElementSlice::from_simple_slice(&simple_elements);
+        let mut iterator = PostingListIterator::<f32, f32>::new(generic_elements_slice, None);
+
+        let mut values = Vec::new();
+        iterator.for_each_weight_till_row_id(17, |row_id, weight| values.push((row_id, weight)));
+        assert_eq!(values, vec![(6, 70.0), (14, 45.0), (17, 10.0)]);
+        // boundary element should not be consumed.
+        assert_eq!(iterator.peek().unwrap().row_id(), 18);
+
+        values.clear();
+        iterator.for_each_weight_till_row_id(RowId::MAX, |row_id, weight| values.push((row_id, weight)));
+        assert_eq!(values, vec![(18, 30.0), (21, 20.0)]);
+        assert_eq!(iterator.remains(), 0);
+    }
+
+    #[test]
+    fn test_for_each_score_till_row_id() {
+        let simple_elements = create_simple_elements::<f32>(vec![(6, 70.0), (14, 45.0), (17, 10.0), (18, 30.0), (21, 20.0)]);
+        // test without quantized.
+        {
+            let generic_elements_slice = GenericElementSlice::from_simple_slice(&simple_elements);
+            let mut iterator = PostingListIterator::<f32, f32>::new(generic_elements_slice, None);
+
+            let mut scores = Vec::new();
+            iterator.for_each_score_till_row_id(17, 0.5, |row_id, score| scores.push((row_id, score)));
+            assert_eq!(scores, vec![(6, 35.0), (14, 22.5), (17, 5.0)]);
+            assert_eq!(iterator.remains(), 2);
+        }
+        // test with quantized.
+        {
+            let param = f32::gen_quantized_param(10.0, 70.0);
+            let generic_elements: Vec<GenericElement<f32>> = simple_elements.clone().into_iter().map(|e| e.into()).collect::<Vec<GenericElement<f32>>>();
+            let quantized_simple_elements: Vec<SimpleElement<u8>> = generic_elements.iter().map(|e| e.quantize_with_param::<u8>(param).as_simple().unwrap().clone()).collect();
+            let generic_elements_slice = GenericElementSlice::from_simple_slice(&quantized_simple_elements);
+            let mut iterator = PostingListIterator::<f32, u8>::new(generic_elements_slice, Some(param));
+
+            let mut scores = Vec::new();
+            iterator.for_each_score_till_row_id(RowId::MAX, 2.0, |row_id, score| scores.push((row_id, score)));
+            assert_eq!(scores.len(), simple_elements.len());
+            for ((row_id, score), element) in scores.iter().zip(simple_elements.iter()) {
+                assert_eq!(*row_id, element.row_id);
+                assert!((score - element.weight * 2.0).abs() <= param.min_precision() * 2.0 * 1.005);
+            }
+        }
+    }
 }
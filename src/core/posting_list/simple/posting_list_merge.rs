@@ -172,6 +172,22 @@ impl PostingListMerger {
             }
         }
     }
+
+    /// Same with [`Self::merge_posting_lists`], but a quantized posting is quantized block by block,
+    /// the param of each `QUANTIZATION_BLOCK_SIZE` elements is returned after the param covering the whole posting.
+    pub fn merge_posting_lists_block_quantized<OW: QuantizedWeight, TW: QuantizedWeight>(
+        lists: &Vec<Vec<GenericElement<OW>>>,
+        element_type: ElementType,
+    ) -> Result<(PostingList<TW>, Option<QuantizedParam>, Vec<QuantizedParam>), PostingListError> {
+        let use_quantized = OW::weight_type() != TW::weight_type() && TW::weight_type() == WeightType::WeightU8;
+        if !use_quantized || element_type != ElementType::SIMPLE {
+            let (posting_list, quantized_param) = Self::merge_posting_lists::<OW, TW>(lists, element_type)?;
+            return Ok((posting_list, quantized_param, vec![]));
+        }
+        let (merged, _, _) = Self::merge_simple_postings(lists)?;
+        let (posting_list, quantized_param, block_params) = merged.quantize_by_blocks::<TW>(false);
+        Ok((posting_list, Some(quantized_param), block_params))
+    }
 }
 
 #[cfg(test)]
@@ -14,5 +14,9 @@ lazy_static! {
     pub static ref POOL_KEEP_LIMIT: usize = num_cpus::get().clamp(8, 128);
 }
 
+/// Larger pooled elements are freed on return, so a pool retains at most `POOL_KEEP_LIMIT` x 1 MiB.
+pub const POOL_KEEP_MAX_SCORES: usize = 1 << 18;
+
+pub use scores_memory_pool::ScoresMemoryPool;
 pub use sparse_bitmap::SparseBitmap;
 pub use top_k::TopK;
@@ -1,7 +1,8 @@
 use crate::core::scores::pooled_scores_handle::PooledScoresHandle;
-use crate::core::scores::{PooledScores, POOL_KEEP_LIMIT};
+use crate::core::scores::{PooledScores, POOL_KEEP_LIMIT, POOL_KEEP_MAX_SCORES};
 use parking_lot::Mutex;
 
+/// Keeps up to `POOL_KEEP_LIMIT` returned buffers of at most `POOL_KEEP_MAX_SCORES` scores each.
 #[derive(Debug)]
 pub struct ScoresMemoryPool {
     pool: Mutex<Vec<PooledScores>>,
@@ -20,6 +21,9 @@ impl ScoresMemoryPool {
     }
 
     pub(super) fn return_back(&self, data: PooledScores) {
+        if data.capacity() > POOL_KEEP_MAX_SCORES {
+            return;
+        }
         let mut pool = self.pool.lock();
         if pool.len() < *POOL_KEEP_LIMIT {
             pool.push(data);
@@ -32,3 +36,18 @@ impl Default for ScoresMemoryPool {
         Self::new()
     }
 }
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_large_buffers_are_not_kept() {
+        let pool = ScoresMemoryPool::new();
+        pool.get().scores.resize(POOL_KEEP_MAX_SCORES, 0.0);
+        assert_eq!(pool.get().scores.capacity(), POOL_KEEP_MAX_SCORES);
+
+        pool.get().scores.resize(POOL_KEEP_MAX_SCORES + 1, 0.0);
+        assert_eq!(pool.pool.lock().len(), 0);
+    }
+}
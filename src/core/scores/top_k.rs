@@ -1,6 +1,6 @@
 use std::cmp::Reverse;
 
-use crate::{core::common::ScoreType, ffi::ScoredPointOffset};
+use crate::{core::common::ScoreType, ffi::ScoredPointOffset, RowId};
 use ordered_float::Float;
 
 /// TopK implementation following the median algorithm described in
@@ -47,6 +47,13 @@ impl TopK {
         }
     }
 
+    /// Rewrite row ids of kept elements, scores and the threshold are unchanged.
+    pub fn map_row_ids(&mut self, f: impl Fn(RowId) -> RowId) {
+        for Reverse(element) in self.elements.iter_mut() {
+            element.row_id = f(element.row_id);
+        }
+    }
+
     // TODO 优化 combine 函数, 在 combine 时可以考虑不同 TopK 的上下界, 不符合上下界的可以直接跳过
     pub fn combine(&mut self, other: &TopK) {
         for element in &other.elements {
@@ -1,6 +1,10 @@
 mod prune_generic_posting;
+mod row_filter;
 mod search_env;
+mod search_plan;
 mod search_posting_iterator;
+mod search_profile;
 mod searcher;
 
+pub use search_profile::{NoProfile, ProfileSink, SearchProfile};
 pub use searcher::Searcher;
@@ -1,12 +1,20 @@
-use crate::{core::ElementRead, RowId};
+use crate::{
+    core::{ElementRead, GenericElement, PostingListIter, QuantizedWeight},
+    RowId,
+};
 
 use super::search_posting_iterator::SearchPostingIterator;
 
-pub fn prune_longest_posting(longest_posting: &mut SearchPostingIterator, min_score: f32, right_postings: &mut [SearchPostingIterator]) -> bool {
+pub fn prune_longest_posting<OW, TW, I>(longest_posting: &mut SearchPostingIterator<I>, min_score: f32, right_postings: &mut [SearchPostingIterator<I>]) -> bool
+where
+    OW: QuantizedWeight,
+    TW: QuantizedWeight,
+    I: PostingListIter<OW, TW>,
+{
     // 获得最左侧 longest posting iter 的首个未遍历的元素
-    if let Some(element) = longest_posting.generic_posting.peek() {
+    if let Some(element) = longest_posting.posting.peek() {
         // 在 right iterators 中找到最小的 row_id
-        let min_row_id_in_right = get_min_row_id(right_postings);
+        let min_row_id_in_right = get_min_row_id::<OW, TW, I>(right_postings);
         match min_row_id_in_right {
             Some(min_row_id_in_right) => {
                 match min_row_id_in_right.cmp(&element.row_id()) {
@@ -23,14 +31,13 @@ pub fn prune_longest_posting(longest_posting: &mut SearchPostingIterator, min_sc
                         // 最好的情形是 longest posting 中最小的 row_id 一直到 right set 中最小的 row_id 这个区间都能够被 cut 掉
 
                         // 获得 longest posting 能够贡献的最大分数
-                        let max_weight_in_longest = element.weight().max(element.max_next_weight());
-                        let max_score_contribution = max_weight_in_longest * longest_posting.dim_weight;
+                        let max_score_contribution = upper_bound_contribution::<OW, TW, I>(&element, longest_posting);
 
                         // 根据贡献的最大分数判断是否能够剪枝
                         if max_score_contribution <= min_score {
-                            let cursor_before_pruning = longest_posting.generic_posting.cursor();
-                            longest_posting.generic_posting.skip_to(min_row_id_in_right);
-                            let cursor_after_pruning = longest_posting.generic_posting.cursor();
+                            let cursor_before_pruning = longest_posting.posting.cursor();
+                            longest_posting.posting.skip_to(min_row_id_in_right);
+                            let cursor_after_pruning = longest_posting.posting.cursor();
                             return cursor_before_pruning != cursor_after_pruning;
                         }
                     }
@@ -39,10 +46,9 @@ pub fn prune_longest_posting(longest_posting: &mut SearchPostingIterator, min_sc
             None => {
                 // min_row_id_in_right 为 None 时, 表示仅剩余左侧 1 个 posting
                 // 直接判断左侧 posting 是否能够全部剪掉就行
-                let max_weight_in_longest = element.weight().max(element.max_next_weight());
-                let max_score_contribution = max_weight_in_longest * longest_posting.dim_weight;
+                let max_score_contribution = upper_bound_contribution::<OW, TW, I>(&element, longest_posting);
                 if max_score_contribution <= min_score {
-                    longest_posting.generic_posting.skip_to_end();
+                    longest_posting.posting.skip_to_end();
                     return true;
                 }
             }
@@ -51,6 +57,50 @@ pub fn prune_longest_posting(longest_posting: &mut SearchPostingIterator, min_sc
     false
 }
 
-pub fn get_min_row_id(postings: &mut [SearchPostingIterator]) -> Option<RowId> {
-    postings.iter_mut().filter_map(|iter| iter.generic_posting.peek().map(|e| e.row_id())).min()
+/// Upper bound of `dim_weight * weight` over the remaining elements of `posting`, `element` is the peeked one.
+/// Positive query weight is bounded by max weight, negative one by the posting's min weight.
+fn upper_bound_contribution<OW, TW, I>(element: &GenericElement<OW>, posting: &SearchPostingIterator<I>) -> f32
+where
+    OW: QuantizedWeight,
+    TW: QuantizedWeight,
+    I: PostingListIter<OW, TW>,
+{
+    if posting.dim_weight >= 0.0 {
+        let max_weight = OW::to_f32(element.weight()).max(OW::to_f32(element.max_next_weight()));
+        max_weight * posting.dim_weight
+    } else {
+        posting.posting.min_weight() * posting.dim_weight
+    }
+}
+
+pub fn get_min_row_id<OW: QuantizedWeight, TW: QuantizedWeight, I: PostingListIter<OW, TW>>(postings: &mut [SearchPostingIterator<I>]) -> Option<RowId> {
+    postings.iter_mut().filter_map(|iter| iter.posting.peek().map(|e| e.row_id())).min()
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::core::{GenericElementSlice, PostingListIterator, SimpleElement};
+
+    fn search_posting<'a>(elements: &'a [SimpleElement<f32>], dim_weight: f32) -> SearchPostingIterator<PostingListIterator<'a, f32, f32>> {
+        SearchPostingIterator { posting: PostingListIterator::new(GenericElementSlice::from_simple_slice(elements), None), dim_id: 0, dim_weight }
+    }
+
+    #[test]
+    fn test_prune_with_negative_query_weight() {
+        let longest_elements: Vec<SimpleElement<f32>> = (1..=5).map(|row_id| SimpleElement { row_id, weight: row_id as f32 + 1.0 }).collect();
+        let right_elements = vec![SimpleElement { row_id: 10, weight: 1.0 }];
+
+        // Without min weight bound the negative contribution is unbounded, can't prune.
+        let mut longest = search_posting(&longest_elements, -1.0);
+        let mut right = vec![search_posting(&right_elements, 1.0)];
+        assert!(!prune_longest_posting::<f32, f32, _>(&mut longest, 0.5, &mut right));
+        assert_eq!(longest.posting.cursor(), 0);
+
+        // Min weight 2.0 bounds the contribution by -2.0, rows before 10 can be skipped.
+        let mut longest = search_posting(&longest_elements, -1.0);
+        longest.posting = longest.posting.with_weight_bounds(2.0, 6.0);
+        assert!(prune_longest_posting::<f32, f32, _>(&mut longest, 0.5, &mut right));
+        assert_eq!(longest.posting.cursor(), longest_elements.len());
+    }
 }
@@ -0,0 +1,44 @@
+use crate::{
+    core::{transmute_from_u8_to_slice, MmapSection, SparseBitmap},
+    RowId,
+};
+
+/// Rows a query may return. Postings of reordered segments store internal row ids, postings of other
+/// segments store row ids relative to `row_id_base`. The bitmap and the results use external ones.
+#[derive(Debug, Clone, Default)]
+pub struct RowFilter {
+    sparse_bitmap: Option<SparseBitmap>,
+    row_id_map: Option<MmapSection>,
+    row_id_base: RowId,
+}
+
+impl RowFilter {
+    pub fn new(sparse_bitmap: Option<SparseBitmap>, row_id_map: Option<MmapSection>, row_id_base: RowId) -> Self {
+        Self { sparse_bitmap, row_id_map, row_id_base }
+    }
+
+    /// Whether posting row ids differ from external ones.
+    pub fn translates(&self) -> bool {
+        self.row_id_map.is_some() || self.row_id_base != 0
+    }
+
+    fn row_id_map(&self) -> Option<&[RowId]> {
+        self.row_id_map.as_ref().map(|row_id_map| transmute_from_u8_to_slice(row_id_map))
+    }
+
+    #[inline]
+    pub fn external_row_id(&self, row_id: RowId) -> RowId {
+        match self.row_id_map() {
+            Some(row_id_map) => row_id_map[row_id as usize],
+            None => self.row_id_base + row_id,
+        }
+    }
+
+    #[inline]
+    pub fn is_alive(&self, row_id: RowId) -> bool {
+        match &self.sparse_bitmap {
+            Some(bitmap) => bitmap.is_alive(self.external_row_id(row_id)),
+            None => true,
+        }
+    }
+}
@@ -1,17 +1,52 @@
 use crate::{
-    core::{SparseBitmap, TopK},
+    core::{PostingListIter, QuantizedWeight, TopK},
     RowId,
 };
 
-use super::search_posting_iterator::SearchPostingIterator;
+use super::{row_filter::RowFilter, search_posting_iterator::SearchPostingIterator, search_profile::ProfileSink};
 
-pub struct SearchEnv<'a> {
+pub struct SearchEnv<I, P> {
     // single query(sparse_vector) will use these iterators.
-    pub postings: Vec<SearchPostingIterator<'a>>,
+    pub postings: Vec<SearchPostingIterator<I>>,
     // single query(sparse_vector) will use `min_row_id` during search
     pub min_row_id: Option<RowId>,
     pub max_row_id: Option<RowId>,
-    pub sparse_bitmap: Option<SparseBitmap>,
+    pub row_filter: RowFilter,
     pub use_pruning: bool,
     pub top_k: TopK,
+    pub profile: P,
+}
+
+impl<I, P: ProfileSink> SearchEnv<I, P> {
+    /// Remove postings already finished iter, their decompressed blocks are recorded before dropped.
+    pub fn retain_unfinished_postings<OW: QuantizedWeight, TW: QuantizedWeight>(&mut self)
+    where
+        I: PostingListIter<OW, TW>,
+    {
+        let profile = &mut self.profile;
+        self.postings.retain(|posting| {
+            if posting.posting.remains() != 0 {
+                return true;
+            }
+            profile.record(|profile| profile.blocks_decompressed += posting.posting.blocks_decompressed() as u64);
+            false
+        });
+    }
+
+    pub fn finish<OW: QuantizedWeight, TW: QuantizedWeight>(mut self) -> (TopK, P)
+    where
+        I: PostingListIter<OW, TW>,
+    {
+        let postings = &self.postings;
+        self.profile.record(|profile| {
+            for posting in postings.iter() {
+                profile.blocks_decompressed += posting.posting.blocks_decompressed() as u64;
+            }
+        });
+        if self.row_filter.translates() {
+            let row_filter = &self.row_filter;
+            self.top_k.map_row_ids(|row_id| row_filter.external_row_id(row_id));
+        }
+        (self.top_k, self.profile)
+    }
 }
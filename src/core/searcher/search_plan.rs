@@ -0,0 +1,136 @@
+use crate::core::{PostingListIter, QuantizedWeight};
+
+use super::search_env::SearchEnv;
+
+/// Upper bound of the dense accumulator used by term-at-a-time search (16 MiB of `f32`).
+pub const TAAT_MAX_ACCUMULATOR_LEN: usize = 1 << 22;
+
+/// When pruning is available, only short queries are worth running without it.
+pub const TAAT_MAX_QUERY_TERMS: usize = 8;
+
+/// TAAT zeroes and scans every accumulator row, worth it while postings hold at least one element per this many rows.
+pub const TAAT_MAX_ROWS_PER_ELEMENT: usize = 16;
+
+/// MaxScore needs a term to become non-essential, which takes at least two terms.
+pub const MAX_SCORE_MIN_QUERY_TERMS: usize = 2;
+
+/// MaxScore scores candidate by candidate, slower per element than DAAT batches. It only pays off once low terms turn
+/// non-essential, which happens early when the highest term bound is at least this many times the lowest one.
+/// Compare `bench_*_spread_bounds` with `bench_*_flat_bounds` in searcher.rs when tuning it.
+pub const MAX_SCORE_MIN_BOUND_SPREAD: f32 = 2.0;
+
+/// How a single query is executed against one segment.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum SearchPlan {
+    /// Walk all postings together batch by batch, allows pruning the longest posting.
+    DocumentAtATime,
+    /// Stream each posting fully into one dense accumulator, then select top-k once.
+    TermAtATime,
+    /// Order terms by max score, once top-k threshold rises the low ones only score candidates of the others.
+    MaxScore,
+}
+
+impl SearchPlan {
+    pub fn choose<OW: QuantizedWeight, TW: QuantizedWeight, I: PostingListIter<OW, TW>, P>(search_env: &SearchEnv<I, P>) -> SearchPlan {
+        // Lowest and highest positive bound of the terms, none when a term has no bound.
+        let bounds = search_env.postings.iter().try_fold((f32::INFINITY, 0.0f32), |(lowest, highest), posting| {
+            let bound = posting.max_score::<OW, TW>();
+            bound.is_finite().then(|| (lowest.min(bound.max(0.0)), highest.max(bound.max(0.0))))
+        });
+        let bound_spread = bounds.map(|(lowest, highest)| if lowest > 0.0 { highest / lowest } else { f32::INFINITY });
+        let (min_row_id, max_row_id) = match (search_env.min_row_id, search_env.max_row_id) {
+            (Some(min_row_id), Some(max_row_id)) if min_row_id <= max_row_id => (min_row_id, max_row_id),
+            _ => return SearchPlan::DocumentAtATime,
+        };
+        let row_range = (max_row_id - min_row_id) as usize + 1;
+        let lengths = search_env.postings.iter().map(|posting| posting.posting.remains());
+
+        Self::plan(search_env.use_pruning, bound_spread, row_range, lengths)
+    }
+
+    /// TAAT zeroes and scans every row in `row_range`, while DAAT batches jump over rows no posting holds.
+    /// So TAAT only wins when postings are dense in the range and its accumulator is small enough, and
+    /// no postings can be skipped, either by DAAT pruning a dominant longest posting or by MaxScore.
+    /// MaxScore is picked when every term has a score bound, `bound_spread` being the highest bound over
+    /// the lowest one, and they are spread enough for low terms to turn non-essential early.
+    fn plan(use_pruning: bool, bound_spread: Option<f32>, row_range: usize, posting_lengths: impl Iterator<Item = usize>) -> SearchPlan {
+        let mut query_terms = 0;
+        let mut total_length = 0;
+        let mut longest_length = 0;
+        for length in posting_lengths {
+            query_terms += 1;
+            total_length += length;
+            longest_length = longest_length.max(length);
+        }
+
+        let max_score = bound_spread.map_or(false, |spread| query_terms >= MAX_SCORE_MIN_QUERY_TERMS && spread >= MAX_SCORE_MIN_BOUND_SPREAD);
+        let skipping_plan = if max_score { SearchPlan::MaxScore } else { SearchPlan::DocumentAtATime };
+        if row_range > TAAT_MAX_ACCUMULATOR_LEN {
+            return skipping_plan;
+        }
+        if total_length.saturating_mul(TAAT_MAX_ROWS_PER_ELEMENT) < row_range {
+            return skipping_plan;
+        }
+        if !use_pruning && !max_score {
+            return SearchPlan::TermAtATime;
+        }
+        if query_terms <= TAAT_MAX_QUERY_TERMS && longest_length * 2 <= total_length {
+            SearchPlan::TermAtATime
+        } else {
+            skipping_plan
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    const SPREAD: Option<f32> = Some(MAX_SCORE_MIN_BOUND_SPREAD * 2.0);
+
+    #[test]
+    fn test_plan_accumulator_limit() {
+        let dense = vec![TAAT_MAX_ACCUMULATOR_LEN / 4; 2];
+        assert_eq!(SearchPlan::plan(false, None, TAAT_MAX_ACCUMULATOR_LEN, dense.clone().into_iter()), SearchPlan::TermAtATime);
+        assert_eq!(SearchPlan::plan(false, None, TAAT_MAX_ACCUMULATOR_LEN + 1, dense.into_iter()), SearchPlan::DocumentAtATime);
+    }
+
+    #[test]
+    fn test_plan_sparse_postings() {
+        // 20 elements spread over 4M rows, DAAT batches skip the empty gaps.
+        assert_eq!(SearchPlan::plan(false, None, TAAT_MAX_ACCUMULATOR_LEN, vec![10, 10].into_iter()), SearchPlan::DocumentAtATime);
+        assert_eq!(SearchPlan::plan(false, SPREAD, TAAT_MAX_ACCUMULATOR_LEN, vec![10, 10].into_iter()), SearchPlan::MaxScore);
+        assert_eq!(SearchPlan::plan(false, None, 320, vec![10, 10].into_iter()), SearchPlan::TermAtATime);
+        assert_eq!(SearchPlan::plan(false, None, 321, vec![10, 10].into_iter()), SearchPlan::DocumentAtATime);
+    }
+
+    #[test]
+    fn test_plan_with_pruning() {
+        // Balanced short query.
+        assert_eq!(SearchPlan::plan(true, None, 1000, vec![100, 120, 90].into_iter()), SearchPlan::TermAtATime);
+        // Longest posting dominates, pruning it is cheaper.
+        assert_eq!(SearchPlan::plan(true, None, 1000, vec![900, 10, 20].into_iter()), SearchPlan::DocumentAtATime);
+        // Too many terms.
+        assert_eq!(SearchPlan::plan(true, None, 1000, vec![10; TAAT_MAX_QUERY_TERMS + 1].into_iter()), SearchPlan::DocumentAtATime);
+    }
+
+    #[test]
+    fn test_plan_with_score_bounds() {
+        // Balanced short query still prefers the accumulator.
+        assert_eq!(SearchPlan::plan(false, SPREAD, 1000, vec![100, 120, 90].into_iter()), SearchPlan::TermAtATime);
+        assert_eq!(SearchPlan::plan(false, SPREAD, 1000, vec![900, 10, 20].into_iter()), SearchPlan::MaxScore);
+        assert_eq!(SearchPlan::plan(true, SPREAD, TAAT_MAX_ACCUMULATOR_LEN + 1, vec![10, 20].into_iter()), SearchPlan::MaxScore);
+    }
+
+    #[test]
+    fn test_plan_max_score_cost() {
+        let flat = Some(MAX_SCORE_MIN_BOUND_SPREAD / 2.0);
+        // Flat bounds, low terms stay essential, DAAT batches score them faster.
+        assert_eq!(SearchPlan::plan(false, flat, TAAT_MAX_ACCUMULATOR_LEN, vec![10, 10].into_iter()), SearchPlan::DocumentAtATime);
+        assert_eq!(SearchPlan::plan(false, flat, 1000, vec![900, 10, 20].into_iter()), SearchPlan::TermAtATime);
+        // A single term has nothing to skip.
+        assert_eq!(SearchPlan::plan(false, Some(1.0), TAAT_MAX_ACCUMULATOR_LEN, vec![10].into_iter()), SearchPlan::DocumentAtATime);
+        // Zero lowest bound, that term is non-essential from the start.
+        assert_eq!(SearchPlan::plan(false, Some(f32::INFINITY), TAAT_MAX_ACCUMULATOR_LEN, vec![10, 10].into_iter()), SearchPlan::MaxScore);
+    }
+}
@@ -1,7 +1,24 @@
-use crate::core::{dispatch::GenericPostingListIterator, DimId, DimWeight};
+use crate::core::{DimId, DimWeight, PostingListIter, QuantizedWeight};
 
-pub struct SearchPostingIterator<'a> {
-    pub generic_posting: GenericPostingListIterator<'a>,
+/// `I` is the concrete posting iterator of one storage type, e.g. `PostingListIterator<OW, TW>`.
+pub struct SearchPostingIterator<I> {
+    pub posting: I,
     pub dim_id: DimId,
     pub dim_weight: DimWeight,
 }
+
+impl<I> SearchPostingIterator<I> {
+    /// Upper bound of `dim_weight * weight` over the whole posting, `f32::INFINITY` when weight bounds are unknown.
+    pub fn max_score<OW: QuantizedWeight, TW: QuantizedWeight>(&self) -> f32
+    where
+        I: PostingListIter<OW, TW>,
+    {
+        if self.dim_weight == 0.0 {
+            0.0
+        } else if self.dim_weight > 0.0 {
+            self.dim_weight * self.posting.max_weight()
+        } else {
+            self.dim_weight * self.posting.min_weight()
+        }
+    }
+}
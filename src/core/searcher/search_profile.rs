@@ -0,0 +1,147 @@
+use std::time::Instant;
+
+/// Execution counters of a single query, filled per segment and merged by the reader.
+#[derive(Debug, Default, Clone, PartialEq, Eq)]
+pub struct SearchProfile {
+    pub segments_searched: u64,
+    pub postings_opened: u64,
+    pub elements_scored: u64,
+    pub blocks_decompressed: u64,
+    /// DAAT batches, or candidates visited by MaxScore.
+    pub batches: u64,
+    pub prune_attempts: u64,
+    pub prune_successes: u64,
+    pub bitmap_rejections: u64,
+    /// Query postings found in the posting cache, or read from disk, by `LoadPolicy::Pread` segments.
+    pub posting_cache_hits: u64,
+    pub posting_cache_misses: u64,
+
+    /// Collect postings and their row_id range.
+    pub pre_search_ns: u64,
+    /// Score postings (and push top-k for DAAT and MaxScore).
+    pub scoring_ns: u64,
+    /// Select top-k from the TAAT accumulator.
+    pub select_ns: u64,
+    /// Combine top-k of all segments.
+    pub merge_ns: u64,
+}
+
+impl SearchProfile {
+    pub fn merge(&mut self, other: &SearchProfile) {
+        self.segments_searched += other.segments_searched;
+        self.postings_opened += other.postings_opened;
+        self.elements_scored += other.elements_scored;
+        self.blocks_decompressed += other.blocks_decompressed;
+        self.batches += other.batches;
+        self.prune_attempts += other.prune_attempts;
+        self.prune_successes += other.prune_successes;
+        self.bitmap_rejections += other.bitmap_rejections;
+        self.posting_cache_hits += other.posting_cache_hits;
+        self.posting_cache_misses += other.posting_cache_misses;
+        self.pre_search_ns += other.pre_search_ns;
+        self.scoring_ns += other.scoring_ns;
+        self.select_ns += other.select_ns;
+        self.merge_ns += other.merge_ns;
+    }
+
+    /// Nanoseconds elapsed since `start`.
+    pub fn elapsed_ns(start: Instant) -> u64 {
+        start.elapsed().as_nanos() as u64
+    }
+}
+
+/// Where a query records its execution profile. Searches are generic over the sink, [`NoProfile`] does nothing
+/// and is inlined away, so a query without profile neither reads the clock nor counts elements.
+pub trait ProfileSink: Default + Send {
+    type Clock: Copy;
+
+    fn start() -> Self::Clock;
+
+    /// Update counters, `update` only runs when the profile is collected.
+    fn record(&mut self, update: impl FnOnce(&mut SearchProfile));
+
+    /// Add nanoseconds elapsed since `start` to the timer picked by `timer`.
+    fn record_elapsed(&mut self, start: Self::Clock, timer: impl FnOnce(&mut SearchProfile) -> &mut u64);
+
+    fn merge_from(&mut self, other: &Self);
+}
+
+impl ProfileSink for SearchProfile {
+    type Clock = Instant;
+
+    #[inline]
+    fn start() -> Instant {
+        Instant::now()
+    }
+
+    #[inline]
+    fn record(&mut self, update: impl FnOnce(&mut SearchProfile)) {
+        update(self)
+    }
+
+    #[inline]
+    fn record_elapsed(&mut self, start: Instant, timer: impl FnOnce(&mut SearchProfile) -> &mut u64) {
+        *timer(self) += SearchProfile::elapsed_ns(start);
+    }
+
+    fn merge_from(&mut self, other: &Self) {
+        self.merge(other)
+    }
+}
+
+/// Sink of queries run without profile.
+#[derive(Debug, Default, Clone, Copy)]
+pub struct NoProfile;
+
+impl ProfileSink for NoProfile {
+    type Clock = ();
+
+    #[inline(always)]
+    fn start() {}
+
+    #[inline(always)]
+    fn record(&mut self, _update: impl FnOnce(&mut SearchProfile)) {}
+
+    #[inline(always)]
+    fn record_elapsed(&mut self, _start: (), _timer: impl FnOnce(&mut SearchProfile) -> &mut u64) {}
+
+    #[inline(always)]
+    fn merge_from(&mut self, _other: &Self) {}
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_merge() {
+        let mut left = SearchProfile { segments_searched: 1, elements_scored: 10, prune_attempts: 2, posting_cache_hits: 3, scoring_ns: 100, ..Default::default() };
+        let right = SearchProfile { segments_searched: 1, elements_scored: 5, prune_successes: 1, posting_cache_misses: 2, scoring_ns: 50, ..Default::default() };
+        left.merge(&right);
+        assert_eq!(
+            left,
+            SearchProfile {
+                segments_searched: 2,
+                elements_scored: 15,
+                prune_attempts: 2,
+                prune_successes: 1,
+                posting_cache_hits: 3,
+                posting_cache_misses: 2,
+                scoring_ns: 150,
+                ..Default::default()
+            }
+        );
+    }
+
+    #[test]
+    fn test_no_profile_skips_updates() {
+        let mut sink = NoProfile;
+        sink.record(|_| panic!("NoProfile must not run updates"));
+        sink.record_elapsed(NoProfile::start(), |_| panic!("NoProfile must not read timers"));
+
+        let mut profile = SearchProfile::default();
+        profile.record(|profile| profile.elements_scored += 3);
+        profile.record_elapsed(<SearchProfile as ProfileSink>::start(), |profile| &mut profile.scoring_ns);
+        assert_eq!(profile.elements_scored, 3);
+    }
+}
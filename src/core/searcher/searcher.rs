@@ -1,21 +1,36 @@
 use std::cmp::min;
 
+use lazy_static::lazy_static;
 use log::trace;
 
 use crate::{
-    core::{dispatch::GenericInvertedIndex, DimId, DimWeight, ElementRead, ScoreType, SparseBitmap, SparseVector, TopK},
+    core::{
+        dispatch::{GenericInvertedIndex, InvertedIndexWrapper},
+        ElementRead, InvertedIndexMetrics, PostingListIter, PostingListIterAccess, QuantizedWeight, ScoreType, ScoresMemoryPool, SparseBitmap, SparseVector, TopK,
+    },
     ffi::ScoredPointOffset,
     RowId,
 };
 
 use super::{
     prune_generic_posting::{get_min_row_id, prune_longest_posting},
+    row_filter::RowFilter,
     search_env::SearchEnv,
+    search_plan::SearchPlan,
     search_posting_iterator::SearchPostingIterator,
+    search_profile::{NoProfile, ProfileSink},
 };
 
 const ADVANCE_BATCH_SIZE: usize = 10_000;
 
+/// Accumulator chunk scanned at once while selecting top-k in TAAT mode.
+const TAAT_SELECT_CHUNK_SIZE: usize = 256;
+
+lazy_static! {
+    /// Dense accumulators reused by term-at-a-time queries of every segment, see [`ScoresMemoryPool`] for what it keeps.
+    static ref TAAT_SCORES_POOL: ScoresMemoryPool = ScoresMemoryPool::new();
+}
+
 #[derive(Debug, Clone)]
 pub struct Searcher {
     inverted_index: GenericInvertedIndex,
@@ -30,98 +45,186 @@ impl Searcher {
         return &self.inverted_index;
     }
 
-    // Bind SearchEnv inner iterator's lifetime annotation into IndexSearcher Self-Object.
-    fn pre_search<'a>(&'a self, sparse_vector: &SparseVector, sparse_bitmap: &Option<SparseBitmap>, limits: u32) -> SearchEnv<'a> {
-        let mut postings: Vec<SearchPostingIterator<'a>> = Vec::new();
+    pub fn search(&self, query: &SparseVector, sparse_bitmap: &Option<SparseBitmap>, limits: u32) -> TopK {
+        self.search_profiled::<NoProfile>(query, sparse_bitmap, limits).0
+    }
+
+    pub fn plain_search(&self, query: &SparseVector, sparse_bitmap: &Option<SparseBitmap>, limits: u32) -> TopK {
+        self.plain_search_profiled::<NoProfile>(query, sparse_bitmap, limits).0
+    }
+
+    /// Enum dispatch only happens here, search loops below are instantiated
+    /// once for each (OW, TW, storage, profile sink) combination.
+    #[rustfmt::skip]
+    pub fn search_profiled<P: ProfileSink>(&self, query: &SparseVector, sparse_bitmap: &Option<SparseBitmap>, limits: u32) -> (TopK, P) {
+        match &self.inverted_index {
+            GenericInvertedIndex::F32NoQuantized(e) => self.search_in_wrapper(e, query, sparse_bitmap, limits),
+            GenericInvertedIndex::F32Quantized(e) => self.search_in_wrapper(e, query, sparse_bitmap, limits),
+            GenericInvertedIndex::F16NoQuantized(e) => self.search_in_wrapper(e, query, sparse_bitmap, limits),
+            GenericInvertedIndex::F16Quantized(e) => self.search_in_wrapper(e, query, sparse_bitmap, limits),
+            GenericInvertedIndex::U8NoQuantized(e) => self.search_in_wrapper(e, query, sparse_bitmap, limits),
+        }
+    }
+
+    // TODO 应该将 index 中所有的 row_id 给存储起来
+    #[rustfmt::skip]
+    pub fn plain_search_profiled<P: ProfileSink>(&self, query: &SparseVector, sparse_bitmap: &Option<SparseBitmap>, limits: u32) -> (TopK, P) {
+        let metrics = self.inverted_index.metrics();
+        match &self.inverted_index {
+            GenericInvertedIndex::F32NoQuantized(e) => self.plain_search_in_wrapper(e, &metrics, query, sparse_bitmap, limits),
+            GenericInvertedIndex::F32Quantized(e) => self.plain_search_in_wrapper(e, &metrics, query, sparse_bitmap, limits),
+            GenericInvertedIndex::F16NoQuantized(e) => self.plain_search_in_wrapper(e, &metrics, query, sparse_bitmap, limits),
+            GenericInvertedIndex::F16Quantized(e) => self.plain_search_in_wrapper(e, &metrics, query, sparse_bitmap, limits),
+            GenericInvertedIndex::U8NoQuantized(e) => self.plain_search_in_wrapper(e, &metrics, query, sparse_bitmap, limits),
+        }
+    }
+
+    #[rustfmt::skip]
+    fn search_in_wrapper<OW: QuantizedWeight, TW: QuantizedWeight, P: ProfileSink>(&self, index: &InvertedIndexWrapper<OW, TW>, query: &SparseVector, sparse_bitmap: &Option<SparseBitmap>, limits: u32) -> (TopK, P) {
+        // Negative query weights are bounded by posting min weight, pruning works for mixed-sign queries.
+        let use_pruning = index.support_pruning();
+        match index {
+            InvertedIndexWrapper::SimpleInvertedIndex(e) => self.search_typed::<OW, TW, _, P>(e, query, sparse_bitmap, limits, use_pruning),
+            InvertedIndexWrapper::CompressedInvertedIndex(e) => self.search_typed::<OW, TW, _, P>(e, query, sparse_bitmap, limits, use_pruning),
+        }
+    }
+
+    #[rustfmt::skip]
+    fn plain_search_in_wrapper<OW: QuantizedWeight, TW: QuantizedWeight, P: ProfileSink>(&self, index: &InvertedIndexWrapper<OW, TW>, metrics: &InvertedIndexMetrics, query: &SparseVector, sparse_bitmap: &Option<SparseBitmap>, limits: u32) -> (TopK, P) {
+        match index {
+            InvertedIndexWrapper::SimpleInvertedIndex(e) => self.plain_search_typed::<OW, TW, _, P>(Self::pre_search::<OW, TW, _, P>(e, query, sparse_bitmap, limits, false), metrics),
+            InvertedIndexWrapper::CompressedInvertedIndex(e) => self.plain_search_typed::<OW, TW, _, P>(Self::pre_search::<OW, TW, _, P>(e, query, sparse_bitmap, limits, false), metrics),
+        }
+    }
+
+    /// Collect concrete posting iterators of one storage type, `SearchEnv` borrows from `index`.
+    fn pre_search<'a, OW, TW, A, P>(index: &'a A, sparse_vector: &SparseVector, sparse_bitmap: &Option<SparseBitmap>, limits: u32, use_pruning: bool) -> SearchEnv<A::Iter<'a>, P>
+    where
+        OW: QuantizedWeight,
+        TW: QuantizedWeight,
+        A: PostingListIterAccess<OW, TW>,
+        P: ProfileSink,
+    {
+        let start = P::start();
+        let mut postings: Vec<SearchPostingIterator<A::Iter<'a>>> = Vec::new();
 
         // The min and max row_id indicate the range of row IDs that may be used in this query.
-        let mut max_row_id = 0;
-        let mut min_row_id = u32::MAX;
+        let mut max_row_id: RowId = 0;
+        let mut min_row_id: RowId = RowId::MAX;
 
+        let (posting_cache_hits, posting_cache_misses) = index.prefetch(&sparse_vector.indices);
         for (i, dim_id) in sparse_vector.indices.iter().enumerate() {
-            if let Some(generic_posting) = self.inverted_index.get_posting_opt(*dim_id, &mut min_row_id, &mut max_row_id) {
-                postings.push(SearchPostingIterator { generic_posting, dim_id: *dim_id, dim_weight: sparse_vector.values[i] });
+            if let Some(mut posting) = index.iter(dim_id) {
+                if let (Some(first), Some(last_id)) = (posting.peek(), posting.last_id()) {
+                    min_row_id = min(min_row_id, first.row_id());
+                    max_row_id = std::cmp::max(max_row_id, last_id);
+                }
+                postings.push(SearchPostingIterator { posting, dim_id: *dim_id, dim_weight: sparse_vector.values[i] });
             }
         }
-        // TODO: if enable quantized, we will not use `max_next_weight`, that is to say we should not use pruning.
-        let use_pruning = sparse_vector.values.iter().all(|v| *v >= 0.0) && self.inverted_index.support_pruning();
 
         let top_k = TopK::new(limits as usize);
-
-        SearchEnv { postings, min_row_id: Some(min_row_id), max_row_id: Some(max_row_id), use_pruning, top_k, sparse_bitmap: sparse_bitmap.clone() }
+        let mut profile = P::default();
+        profile.record(|profile| {
+            profile.segments_searched = 1;
+            profile.postings_opened = postings.len() as u64;
+            profile.posting_cache_hits = posting_cache_hits;
+            profile.posting_cache_misses = posting_cache_misses;
+        });
+        profile.record_elapsed(start, |profile| &mut profile.pre_search_ns);
+
+        let row_filter = RowFilter::new(sparse_bitmap.clone(), index.row_id_map(), index.row_id_base());
+        SearchEnv { postings, min_row_id: Some(min_row_id), max_row_id: Some(max_row_id), use_pruning, top_k, row_filter, profile }
     }
 
-    // TODO 应该将 index 中所有的 row_id 给存储起来
-    pub fn plain_search(&self, sparse_vector: &SparseVector, sparse_bitmap: &Option<SparseBitmap>, limits: u32) -> TopK {
-        let mut search_env: SearchEnv<'_> = self.pre_search(sparse_vector, sparse_bitmap, limits);
-
-        let metrics = self.inverted_index.metrics();
-
+    fn plain_search_typed<OW: QuantizedWeight, TW: QuantizedWeight, I: PostingListIter<OW, TW>, P: ProfileSink>(
+        &self,
+        mut search_env: SearchEnv<I, P>,
+        metrics: &InvertedIndexMetrics,
+    ) -> (TopK, P) {
+        let start = P::start();
         // iter all rows stored in self.inverted_index.
         for row_id in metrics.min_row_id..=metrics.max_row_id {
             // filter row_id which is already deleted.
-            if let Some(bitmap) = &search_env.sparse_bitmap {
-                if !bitmap.is_alive(row_id) {
-                    continue;
-                }
+            if !search_env.row_filter.is_alive(row_id) {
+                search_env.profile.record(|profile| profile.bitmap_rejections += 1);
+                continue;
             }
-            let mut dim_ids: Vec<DimId> = Vec::with_capacity(sparse_vector.indices.len());
-            let mut dim_weights: Vec<DimWeight> = Vec::with_capacity(sparse_vector.values.len());
+            // score against query.
+            let mut score: ScoreType = 0.0;
             for posting in search_env.postings.iter_mut() {
-                let generic_posting_ref = &mut posting.generic_posting;
-                match generic_posting_ref.get_element_opt(row_id) {
-                    Some(element) => {
-                        dim_ids.push(posting.dim_id);
-                        dim_weights.push(element.weight());
-                    }
-                    None => {}
+                if let Some(element) = posting.posting.skip_to(row_id) {
+                    score += OW::to_f32(element.weight()) * posting.dim_weight;
+                    search_env.profile.record(|profile| profile.elements_scored += 1);
                 }
             }
-            // reconstruct sparse vector and score against query
-            let sparse_vector: SparseVector = SparseVector { indices: dim_ids, values: dim_weights };
-            search_env.top_k.push(ScoredPointOffset { score: sparse_vector.score(&sparse_vector).unwrap_or(0.0), row_id });
+            search_env.top_k.push(ScoredPointOffset { score, row_id });
         }
-        search_env.top_k
+        search_env.profile.record_elapsed(start, |profile| &mut profile.scoring_ns);
+        search_env.finish::<OW, TW>()
     }
 
     /// Iterate through all postings involved in the query(sparse-vector).
     /// And for each `Posting`, processing elements within a specified batch range(batch_start_id ~ batch_end_id).
-    fn advance_batch(&self, batch_start_row_id: RowId, batch_end_row_id: RowId, search_env: &mut SearchEnv) {
+    fn advance_batch<OW: QuantizedWeight, TW: QuantizedWeight, I: PostingListIter<OW, TW>, P: ProfileSink>(
+        &self,
+        batch_start_row_id: RowId,
+        batch_end_row_id: RowId,
+        search_env: &mut SearchEnv<I, P>,
+    ) {
         let batch_size = batch_end_row_id - batch_start_row_id + 1;
         let mut batch_scores: Vec<ScoreType> = vec![0.0; batch_size as usize];
 
         trace!("[advance_batch] batch_scores len (batch_size):{}, batch_start_row_id:{}, batch_end_row_id:{}", batch_size, batch_start_row_id, batch_end_row_id);
+        search_env.profile.record(|profile| profile.batches += 1);
         for posting in search_env.postings.iter_mut() {
-            posting.generic_posting.batch_compute(&mut batch_scores, posting.dim_weight, batch_start_row_id, batch_end_row_id);
+            let query_dim_weight = posting.dim_weight;
+            let cursor_before = posting.posting.cursor();
+            posting.posting.for_each_score_till_row_id(batch_end_row_id, query_dim_weight, |row_id, score| {
+                batch_scores[(row_id - batch_start_row_id) as usize] += score;
+            });
+            search_env.profile.record(|profile| profile.elements_scored += (posting.posting.cursor() - cursor_before) as u64);
         }
 
         for (local_id, &score) in batch_scores.iter().enumerate() {
             if score > 0.0 && score > search_env.top_k.threshold() {
-                let mut is_alive = true;
                 let real_row_id = local_id as RowId + batch_start_row_id;
-                if let Some(bitmap) = &search_env.sparse_bitmap {
-                    is_alive = bitmap.is_alive(real_row_id)
-                }
-                if is_alive {
+                if search_env.row_filter.is_alive(real_row_id) {
                     search_env.top_k.push(ScoredPointOffset { row_id: real_row_id as RowId, score });
+                } else {
+                    search_env.profile.record(|profile| profile.bitmap_rejections += 1);
                 }
             }
         }
     }
 
     // only remains one posting.
-    fn process_last_posting_list(&self, search_env: &mut SearchEnv) {
+    fn process_last_posting_list<OW: QuantizedWeight, TW: QuantizedWeight, I: PostingListIter<OW, TW>, P: ProfileSink>(&self, search_env: &mut SearchEnv<I, P>) {
         debug_assert_eq!(search_env.postings.len(), 1);
         let posting = &mut search_env.postings[0];
         let query_dim_weight = posting.dim_weight;
-
-        posting.generic_posting.full_compute(search_env.max_row_id.unwrap_or(RowId::MAX), query_dim_weight, &search_env.sparse_bitmap, &mut search_env.top_k);
+        let row_filter = &search_env.row_filter;
+        let top_k = &mut search_env.top_k;
+        let mut bitmap_rejections = 0;
+        let cursor_before = posting.posting.cursor();
+
+        posting.posting.for_each_score_till_row_id(search_env.max_row_id.unwrap_or(RowId::MAX), query_dim_weight, |row_id, score| {
+            if !row_filter.is_alive(row_id) {
+                bitmap_rejections += 1;
+                return;
+            }
+            top_k.push(ScoredPointOffset { row_id, score });
+        });
+        search_env.profile.record(|profile| {
+            profile.elements_scored += (posting.posting.cursor() - cursor_before) as u64;
+            profile.bitmap_rejections += bitmap_rejections;
+        });
     }
 
     // move the posting which has longest remain size to the front of iterators.
-    fn promote_longest_posting_lists_to_the_front(&self, search_env: &mut SearchEnv) {
+    fn promote_longest_posting_lists_to_the_front<OW: QuantizedWeight, TW: QuantizedWeight, I: PostingListIter<OW, TW>, P: ProfileSink>(&self, search_env: &mut SearchEnv<I, P>) {
         // find index of longest posting list (remain size)
-        let posting_index = search_env.postings.iter().enumerate().max_by(|(_, a), (_, b)| a.generic_posting.remains().cmp(&b.generic_posting.remains())).map(|(index, _)| index);
+        let posting_index = search_env.postings.iter().enumerate().max_by(|(_, a), (_, b)| a.posting.remains().cmp(&b.posting.remains())).map(|(index, _)| index);
 
         if let Some(posting_index) = posting_index {
             // make sure it is not already at the head
@@ -133,23 +236,167 @@ impl Searcher {
     }
 
     // cut the longest posting.
-    fn prune_longest_posting_list(&self, min_score: f32, search_env: &mut SearchEnv) -> bool {
+    fn prune_longest_posting_list<OW: QuantizedWeight, TW: QuantizedWeight, I: PostingListIter<OW, TW>, P>(&self, min_score: f32, search_env: &mut SearchEnv<I, P>) -> bool {
         if search_env.postings.is_empty() {
             return false;
         }
         // split posting iterators into two parts, left contains single longest posting, right contains the others.
         let (left_iters, right_postings) = search_env.postings.split_at_mut(1);
 
-        prune_longest_posting(&mut left_iters[0], min_score, right_postings)
+        prune_longest_posting::<OW, TW, I>(&mut left_iters[0], min_score, right_postings)
     }
 
-    pub fn search(&self, query: &SparseVector, sparse_bitmap: &Option<SparseBitmap>, limits: u32) -> TopK {
-        let mut search_env = self.pre_search(query, sparse_bitmap, limits);
+    /// Term-at-a-time: stream every posting into a dense accumulator over `[min_row_id, max_row_id]`,
+    /// then run a single top-k selection pass.
+    fn term_at_a_time_search<OW: QuantizedWeight, TW: QuantizedWeight, I: PostingListIter<OW, TW>, P: ProfileSink>(&self, mut search_env: SearchEnv<I, P>) -> (TopK, P) {
+        let (base_row_id, end_row_id) = match (search_env.min_row_id, search_env.max_row_id) {
+            (Some(min_row_id), Some(max_row_id)) if min_row_id <= max_row_id => (min_row_id, max_row_id),
+            _ => return search_env.finish::<OW, TW>(),
+        };
+        let start = P::start();
+
+        let mut pooled_scores = TAAT_SCORES_POOL.get();
+        let accumulator: &mut Vec<ScoreType> = &mut pooled_scores.scores;
+        accumulator.clear();
+        accumulator.resize((end_row_id - base_row_id) as usize + 1, 0.0);
+
+        for posting in search_env.postings.iter_mut() {
+            let query_dim_weight = posting.dim_weight;
+            let cursor_before = posting.posting.cursor();
+            posting.posting.for_each_score_till_row_id(RowId::MAX, query_dim_weight, |row_id, score| {
+                accumulator[(row_id - base_row_id) as usize] += score;
+            });
+            search_env.profile.record(|profile| profile.elements_scored += (posting.posting.cursor() - cursor_before) as u64);
+        }
+        search_env.profile.record_elapsed(start, |profile| &mut profile.scoring_ns);
+
+        let start = P::start();
+        let bitmap_rejections = Self::select_top_k(accumulator, base_row_id, &search_env.row_filter, &mut search_env.top_k);
+        search_env.profile.record(|profile| profile.bitmap_rejections += bitmap_rejections);
+        search_env.profile.record_elapsed(start, |profile| &mut profile.select_ns);
+        search_env.finish::<OW, TW>()
+    }
+
+    /// Scan the accumulator chunk by chunk, the chunk max is a branch-free reduction
+    /// which lets us skip most chunks once `top_k` threshold becomes high.
+    /// Returns how many rows are rejected by `row_filter`.
+    fn select_top_k(accumulator: &[ScoreType], base_row_id: RowId, row_filter: &RowFilter, top_k: &mut TopK) -> u64 {
+        let mut bitmap_rejections = 0;
+        for (chunk_idx, chunk) in accumulator.chunks(TAAT_SELECT_CHUNK_SIZE).enumerate() {
+            let chunk_max = chunk.iter().fold(ScoreType::MIN, |max, &score| if score > max { score } else { max });
+            if chunk_max <= 0.0 || chunk_max <= top_k.threshold() {
+                continue;
+            }
+            let chunk_start_row_id = base_row_id + (chunk_idx * TAAT_SELECT_CHUNK_SIZE) as RowId;
+            for (offset, &score) in chunk.iter().enumerate() {
+                if score > 0.0 && score > top_k.threshold() {
+                    let row_id = chunk_start_row_id + offset as RowId;
+                    if !row_filter.is_alive(row_id) {
+                        bitmap_rejections += 1;
+                        continue;
+                    }
+                    top_k.push(ScoredPointOffset { row_id, score });
+                }
+            }
+        }
+        bitmap_rejections
+    }
+
+    /// MaxScore: postings are sorted by max score, the prefix whose bounds sum up to no more than
+    /// top-k threshold is non-essential. Candidates only come from essential postings, non-essential
+    /// ones are probed with `skip_to` while the candidate can still enter top-k.
+    fn max_score_search<OW: QuantizedWeight, TW: QuantizedWeight, I: PostingListIter<OW, TW>, P: ProfileSink>(&self, mut search_env: SearchEnv<I, P>) -> (TopK, P) {
+        let start = P::start();
+        // Only positive scores are kept, a negative bound can't lift any row.
+        let bound = |posting: &SearchPostingIterator<I>| posting.max_score::<OW, TW>().max(0.0);
+        let mut postings = std::mem::take(&mut search_env.postings);
+        postings.sort_by(|a, b| bound(a).total_cmp(&bound(b)));
+
+        // `prefix_bounds[i]` is the sum of bounds of `postings[..=i]`.
+        let prefix_bounds: Vec<f32> = postings
+            .iter()
+            .scan(0.0, |sum, posting| {
+                *sum += bound(posting);
+                Some(*sum)
+            })
+            .collect();
+
+        let mut first_essential = 0;
+        loop {
+            let threshold = search_env.top_k.threshold().max(0.0);
+            while first_essential < postings.len() && prefix_bounds[first_essential] <= threshold {
+                first_essential += 1;
+            }
+            let (non_essential, essential) = postings.split_at_mut(first_essential);
+
+            let candidate = match get_min_row_id::<OW, TW, _>(essential) {
+                Some(row_id) => row_id,
+                None => break,
+            };
+
+            search_env.profile.record(|profile| profile.batches += 1);
+            let mut score: ScoreType = 0.0;
+            for posting in essential.iter_mut() {
+                let query_dim_weight = posting.dim_weight;
+                let cursor_before = posting.posting.cursor();
+                posting.posting.for_each_score_till_row_id(candidate, query_dim_weight, |_, element_score| score += element_score);
+                search_env.profile.record(|profile| profile.elements_scored += (posting.posting.cursor() - cursor_before) as u64);
+            }
+
+            if !search_env.row_filter.is_alive(candidate) {
+                search_env.profile.record(|profile| profile.bitmap_rejections += 1);
+                continue;
+            }
+
+            for (posting_idx, posting) in non_essential.iter_mut().enumerate().rev() {
+                if score + prefix_bounds[posting_idx] <= threshold {
+                    break;
+                }
+                if let Some(element) = posting.posting.skip_to(candidate) {
+                    if element.row_id() == candidate {
+                        score += OW::to_f32(element.weight()) * posting.dim_weight;
+                        search_env.profile.record(|profile| profile.elements_scored += 1);
+                    }
+                }
+            }
+
+            if score > threshold {
+                search_env.top_k.push(ScoredPointOffset { row_id: candidate, score });
+            }
+        }
+        search_env.postings = postings;
+        search_env.profile.record_elapsed(start, |profile| &mut profile.scoring_ns);
+        search_env.finish::<OW, TW>()
+    }
+
+    fn search_typed<OW, TW, A, P>(&self, index: &A, query: &SparseVector, sparse_bitmap: &Option<SparseBitmap>, limits: u32, use_pruning: bool) -> (TopK, P)
+    where
+        OW: QuantizedWeight,
+        TW: QuantizedWeight,
+        A: PostingListIterAccess<OW, TW>,
+        P: ProfileSink,
+    {
+        let mut search_env = Self::pre_search::<OW, TW, A, P>(index, query, sparse_bitmap, limits, use_pruning);
 
         if search_env.postings.is_empty() {
-            return TopK::default();
+            return (TopK::default(), search_env.profile);
+        }
+
+        match SearchPlan::choose::<OW, TW, _, P>(&search_env) {
+            SearchPlan::TermAtATime => self.term_at_a_time_search::<OW, TW, _, P>(search_env),
+            SearchPlan::MaxScore => self.max_score_search::<OW, TW, _, P>(search_env),
+            SearchPlan::DocumentAtATime => self.document_at_a_time_search::<OW, TW, _, P>(search_env, limits),
         }
+    }
 
+    /// Document-at-a-time: score all postings batch by batch, the longest posting is pruned once
+    /// it can't lift any row above top-k threshold.
+    fn document_at_a_time_search<OW: QuantizedWeight, TW: QuantizedWeight, I: PostingListIter<OW, TW>, P: ProfileSink>(
+        &self,
+        mut search_env: SearchEnv<I, P>,
+        limits: u32,
+    ) -> (TopK, P) {
+        let start = P::start();
         let mut best_min_score = f32::MIN;
 
         // loop process each batch.
@@ -159,20 +406,20 @@ impl Searcher {
             }
 
             let last_batch_id = min(search_env.min_row_id.unwrap_or(0) + ADVANCE_BATCH_SIZE as RowId, search_env.max_row_id.unwrap_or(RowId::MAX));
-            self.advance_batch(search_env.min_row_id.unwrap_or(0), last_batch_id, &mut search_env);
+            self.advance_batch::<OW, TW, _, P>(search_env.min_row_id.unwrap_or(0), last_batch_id, &mut search_env);
 
             // remove the posting already finished iter.
-            search_env.postings.retain(|posting_iterator| posting_iterator.generic_posting.remains() != 0);
+            search_env.retain_unfinished_postings::<OW, TW>();
 
             if search_env.postings.is_empty() {
                 break;
             }
 
             // update min_row_id in search_env.
-            search_env.min_row_id = get_min_row_id(&mut search_env.postings);
+            search_env.min_row_id = get_min_row_id::<OW, TW, _>(&mut search_env.postings);
 
             if search_env.postings.len() == 1 {
-                self.process_last_posting_list(&mut search_env);
+                self.process_last_posting_list::<OW, TW, _, P>(&mut search_env);
                 break;
             }
 
@@ -185,15 +432,93 @@ impl Searcher {
                     best_min_score = new_min_score;
                 }
                 // prepare for posting cut.
-                self.promote_longest_posting_lists_to_the_front(&mut search_env);
+                self.promote_longest_posting_lists_to_the_front::<OW, TW, _, P>(&mut search_env);
                 // execute posting cut.
-                let pruned = self.prune_longest_posting_list(new_min_score, &mut search_env);
+                let pruned = self.prune_longest_posting_list::<OW, TW, _, P>(new_min_score, &mut search_env);
+                search_env.profile.record(|profile| {
+                    profile.prune_attempts += 1;
+                    profile.prune_successes += pruned as u64;
+                });
                 // update row_ids range after posting cut.
                 if pruned {
-                    search_env.min_row_id = get_min_row_id(&mut search_env.postings);
+                    search_env.min_row_id = get_min_row_id::<OW, TW, _>(&mut search_env.postings);
                 }
             }
         }
-        search_env.top_k
+        search_env.profile.record_elapsed(start, |profile| &mut profile.scoring_ns);
+        search_env.finish::<OW, TW>()
+    }
+}
+
+#[cfg(all(test, feature = "unstable"))]
+mod bench {
+    use std::borrow::Cow;
+
+    use tempfile::TempDir;
+    use test::Bencher;
+
+    use super::*;
+    use crate::core::{CompressedInvertedIndexMmap, DimId, ElementType, InvertedIndexRamBuilder, InvertedIndexRamBuilderTrait};
+
+    const ROWS_COUNT: RowId = 200_000;
+    const QUERY_TERMS: u32 = 4;
+    const TOP_K: u32 = 10;
+
+    /// Dim `d` holds one row in `2^d`, rarer dims weigh more when `spread_bounds`, all dims weigh about the same otherwise.
+    fn build_index(spread_bounds: bool) -> (TempDir, CompressedInvertedIndexMmap<f32, f32>) {
+        let dir = tempfile::tempdir().unwrap();
+        let mut builder = InvertedIndexRamBuilder::<f32, f32>::new(ElementType::SIMPLE);
+        for row_id in 0..ROWS_COUNT {
+            let hash = row_id.wrapping_mul(2654435761);
+            let indices: Vec<DimId> = (0..QUERY_TERMS).filter(|&dim_id| hash % (1 << dim_id) == 0).collect();
+            let values = indices
+                .iter()
+                .map(|&dim_id| {
+                    let noise = 0.5 + ((row_id * 31 + dim_id * 7) % 100) as f32 / 200.0;
+                    if spread_bounds {
+                        noise * (1.0 + 2.0 * dim_id as f32)
+                    } else {
+                        noise
+                    }
+                })
+                .collect();
+            builder.add(row_id, SparseVector { indices, values }).unwrap();
+        }
+        let index = CompressedInvertedIndexMmap::from_ram_index(Cow::Owned(builder.build().unwrap()), dir.path().to_path_buf(), Some("bench")).unwrap();
+        (dir, index)
+    }
+
+    fn search_with_plan(b: &mut Bencher, spread_bounds: bool, plan: SearchPlan) {
+        let (_dir, index) = build_index(spread_bounds);
+        let searcher = Searcher::new(GenericInvertedIndex::F32NoQuantized(InvertedIndexWrapper::CompressedInvertedIndex(index.clone())));
+        let query = SparseVector { indices: (0..QUERY_TERMS).collect(), values: vec![1.0; QUERY_TERMS as usize] };
+        b.iter(|| {
+            let search_env = Searcher::pre_search::<f32, f32, _, NoProfile>(&index, &query, &None, TOP_K, false);
+            match plan {
+                SearchPlan::DocumentAtATime => searcher.document_at_a_time_search::<f32, f32, _, NoProfile>(search_env, TOP_K),
+                SearchPlan::TermAtATime => searcher.term_at_a_time_search::<f32, f32, _, NoProfile>(search_env),
+                SearchPlan::MaxScore => searcher.max_score_search::<f32, f32, _, NoProfile>(search_env),
+            }
+        });
+    }
+
+    #[bench]
+    fn bench_daat_flat_bounds(b: &mut Bencher) {
+        search_with_plan(b, false, SearchPlan::DocumentAtATime);
+    }
+
+    #[bench]
+    fn bench_max_score_flat_bounds(b: &mut Bencher) {
+        search_with_plan(b, false, SearchPlan::MaxScore);
+    }
+
+    #[bench]
+    fn bench_daat_spread_bounds(b: &mut Bencher) {
+        search_with_plan(b, true, SearchPlan::DocumentAtATime);
+    }
+
+    #[bench]
+    fn bench_max_score_spread_bounds(b: &mut Bencher) {
+        search_with_plan(b, true, SearchPlan::MaxScore);
     }
 }
@@ -13,9 +13,12 @@ use crate::{INDEX_FORMAT_OLDEST_SUPPORTED_VERSION, INDEX_FORMAT_VERSION};
 const FOOTER_MAX_LEN: u32 = 50_000;
 
 /// The magic byte of the footer to identify corruption
-/// or an old version of the footer.
+/// or an old version of the footer. Its payload is json.
 const FOOTER_MAGIC_NUMBER: u32 = 1337;
 
+/// Magic of footers with a bincode payload, every file open reads its footer without parsing json.
+const BINARY_FOOTER_MAGIC_NUMBER: u32 = 1338;
+
 type CrcHashU32 = u32;
 
 /// A Footer is appended to every file
@@ -36,10 +39,10 @@ impl Footer {
     }
     pub fn append_footer<W: io::Write>(&self, mut write: &mut W) -> io::Result<()> {
         let mut counting_write = CountingWriter::wrap(&mut write);
-        counting_write.write_all(serde_json::to_string(&self)?.as_ref())?;
+        bincode::serialize_into(&mut counting_write, &self).map_err(|e| io::Error::new(io::ErrorKind::Other, e))?;
         let footer_payload_len = counting_write.written_bytes();
         BinarySerializable::serialize(&(footer_payload_len as u32), write)?;
-        BinarySerializable::serialize(&FOOTER_MAGIC_NUMBER, write)?;
+        BinarySerializable::serialize(&BINARY_FOOTER_MAGIC_NUMBER, write)?;
         Ok(())
     }
 
@@ -51,7 +54,7 @@ impl Footer {
         let footer_metadata_len = <(u32, u32)>::SIZE_IN_BYTES;
         let (footer_len, footer_magic_byte): (u32, u32) = file.slice_from_end(footer_metadata_len).read_bytes()?.as_ref().deserialize()?;
 
-        if footer_magic_byte != FOOTER_MAGIC_NUMBER {
+        if footer_magic_byte != FOOTER_MAGIC_NUMBER && footer_magic_byte != BINARY_FOOTER_MAGIC_NUMBER {
             return Err(io::Error::new(
                 io::ErrorKind::InvalidData,
                 "Footer magic byte mismatch. File corrupted or index was created using old an \
@@ -81,7 +84,11 @@ impl Footer {
             ));
         }
 
-        let footer: Footer = serde_json::from_slice(&file.read_bytes_slice(file.len() - total_footer_size..file.len() - footer_metadata_len)?)?;
+        let payload = file.read_bytes_slice(file.len() - total_footer_size..file.len() - footer_metadata_len)?;
+        let footer: Footer = match footer_magic_byte {
+            BINARY_FOOTER_MAGIC_NUMBER => bincode::deserialize(&payload).map_err(|e| io::Error::new(io::ErrorKind::InvalidData, e))?,
+            _ => serde_json::from_slice(&payload)?,
+        };
 
         let body = file.slice_to(file.len() - total_footer_size);
         Ok((footer, body))
@@ -156,6 +163,21 @@ mod tests {
         let (footer_deser, _body) = Footer::extract_footer(fileslice).unwrap();
         assert_eq!(footer_deser.crc(), footer.crc());
     }
+
+    #[test]
+    fn test_deserialize_json_footer() {
+        // Files written before footers were binary.
+        let footer = Footer::new(123);
+        let mut buf: Vec<u8> = b"body".to_vec();
+        let payload = serde_json::to_vec(&footer).unwrap();
+        buf.extend_from_slice(&payload);
+        BinarySerializable::serialize(&(payload.len() as u32), &mut buf).unwrap();
+        BinarySerializable::serialize(&FOOTER_MAGIC_NUMBER, &mut buf).unwrap();
+
+        let (footer_deser, body) = Footer::extract_footer(FileSlice::new(Arc::new(OwnedBytes::new(buf)))).unwrap();
+        assert_eq!(footer_deser, footer);
+        assert_eq!(body.read_bytes().unwrap().as_slice(), b"body");
+    }
     #[test]
     fn test_deserialize_footer_missing_magic_byte() {
         let mut buf: Vec<u8> = vec![];
@@ -1,5 +1,4 @@
 use std::collections::HashSet;
-use std::io::Write;
 use std::path::{Path, PathBuf};
 use std::sync::{Arc, RwLock, RwLockWriteGuard};
 use std::{io, result, thread};
@@ -9,6 +8,7 @@ use log::{debug, error, info};
 
 use super::Directory;
 use crate::common::errors::{DataCorruption, SparseError};
+use crate::core::{decode_bin_or_json, encode_bin_file};
 use crate::directory::error::{DeleteError, LockError, OpenReadError, OpenWriteError};
 use crate::directory::footer::{Footer, FooterProxy};
 use crate::directory::{DirectoryLock, FileHandle, FileSlice, GarbageCollectionResult, Lock, WatchCallback, WatchHandle, WritePtr, META_LOCK};
@@ -48,10 +48,9 @@ struct MetaInformation {
 /// Saves the file containing the list of existing files
 /// that were created by sparse.
 ///
-/// These files will record in `.managed.json`.
+/// These files will record in `.managed.json`, binary since index files are read without parsing json.
 fn save_managed_paths(directory: &dyn Directory, wlock: &RwLockWriteGuard<'_, MetaInformation>) -> io::Result<()> {
-    let mut w = serde_json::to_vec(&wlock.managed_paths)?;
-    writeln!(&mut w)?;
+    let w = encode_bin_file(&wlock.managed_paths)?;
     directory.atomic_write(&MANAGED_FILEPATH, &w[..])?;
     Ok(())
 }
@@ -61,9 +60,9 @@ impl ManagedDirectory {
     pub fn wrap(directory: Box<dyn Directory>) -> crate::Result<ManagedDirectory> {
         match directory.atomic_read(&MANAGED_FILEPATH) {
             Ok(data) => {
-                let managed_files_json = String::from_utf8_lossy(&data);
-                let managed_files: HashSet<PathBuf> = serde_json::from_str(&managed_files_json)
-                    .map_err(|e| DataCorruption::new(MANAGED_FILEPATH.to_path_buf(), format!("Managed file cannot be deserialized: {e:?}. ")))?;
+                // Json when written before the managed list was binary.
+                let managed_files: HashSet<PathBuf> =
+                    decode_bin_or_json(&data).map_err(|e| DataCorruption::new(MANAGED_FILEPATH.to_path_buf(), format!("Managed file cannot be deserialized: {e:?}. ")))?;
                 Ok(ManagedDirectory { directory, meta_informations: Arc::new(RwLock::new(MetaInformation { managed_paths: managed_files })) })
             }
             Err(OpenReadError::FileDoesNotExist(_)) => Ok(ManagedDirectory { directory, meta_informations: Arc::default() }),
@@ -1,5 +1,6 @@
 use crate::common::errors::{DataCorruption, SparseError};
 use crate::common::executor::Executor;
+use crate::core::LoadPolicy;
 use crate::directory::error::OpenReadError;
 use crate::directory::managed_directory::ManagedDirectory;
 use crate::directory::mmap_directory::MmapDirectory;
@@ -24,12 +25,11 @@ use super::{IndexBuilder, IndexSettings, Segment, SegmentId, SegmentMeta};
 /// Return the `IndexMeta` object.
 fn load_metas(directory: &dyn Directory, inventory: &SegmentMetaInventory) -> crate::Result<IndexMeta> {
     let meta_data = directory.atomic_read(&META_FILEPATH)?;
-    let meta_string = String::from_utf8(meta_data).map_err(|_utf8_err| {
-        error!("Meta data is not valid utf8.");
-        DataCorruption::new(META_FILEPATH.to_path_buf(), "Meta file does not contain valid utf8 file.".to_string())
-    })?;
-    IndexMeta::deserialize(&meta_string, inventory)
-        .map_err(|e| DataCorruption::new(META_FILEPATH.to_path_buf(), format!("Meta file cannot be deserialized. {e:?}. Content: {meta_string:?}")))
+    IndexMeta::deserialize(&meta_data, inventory)
+        .map_err(|e| {
+            error!("Meta file cannot be deserialized, {}", e);
+            DataCorruption::new(META_FILEPATH.to_path_buf(), format!("Meta file cannot be deserialized. {e:?}. Content: {:?}", String::from_utf8_lossy(&meta_data)))
+        })
         .map_err(From::from)
 }
 
@@ -160,6 +160,11 @@ impl Index {
         return self.index_settings.clone();
     }
 
+    /// Override the load policy of readers opened from this index, it's not persisted into index settings.
+    pub fn set_load_policy(&mut self, load_policy: LoadPolicy) {
+        self.index_settings.load_policy = load_policy;
+    }
+
     #[doc(hidden)]
     pub fn segment(&self, segment_meta: SegmentMeta) -> Segment {
         Segment::for_index(self.clone(), segment_meta)
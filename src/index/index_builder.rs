@@ -44,8 +44,6 @@ impl IndexBuilder {
 
     /// Create mmap index in given directory.
     pub fn create_in_dir<P: AsRef<Path>>(self, directory_path: P) -> crate::Result<Index> {
-        debug_assert_ne!(self.index_settings.inverted_index_config.storage_type, StorageType::Ram);
-
         let mmap_directory: Box<dyn Directory> = Box::new(MmapDirectory::open(directory_path)?);
         if Index::exists(&*mmap_directory)? {
             return Err(SparseError::IndexAlreadyExists);
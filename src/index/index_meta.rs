@@ -1,7 +1,7 @@
 use super::SegmentComponent;
 use crate::core::{
-    COMPRESSED_INVERTED_INDEX_HEADERS_SUFFIX, COMPRESSED_INVERTED_INDEX_POSTING_BLOCKS_SUFFIX, COMPRESSED_INVERTED_INDEX_ROW_IDS_SUFFIX, INVERTED_INDEX_HEADERS_SUFFIX,
-    INVERTED_INDEX_META_FILE_SUFFIX, INVERTED_INDEX_POSTINGS_SUFFIX,
+    decode_bin_or_json, encode_bin_file, FileOperationError, COMPRESSED_INVERTED_INDEX_HEADERS_SUFFIX, COMPRESSED_INVERTED_INDEX_POSTING_BLOCKS_SUFFIX,
+    COMPRESSED_INVERTED_INDEX_ROW_IDS_SUFFIX, INVERTED_INDEX_CONTAINER_SUFFIX, INVERTED_INDEX_HEADERS_SUFFIX, INVERTED_INDEX_META_FILE_SUFFIX, INVERTED_INDEX_POSTINGS_SUFFIX,
 };
 use crate::index::SegmentId;
 use crate::{Opstamp, RowId};
@@ -80,6 +80,7 @@ impl SegmentMeta {
     pub fn relative_path(&self, component: SegmentComponent) -> PathBuf {
         let mut path = self.id().uuid_string();
         path.push_str(&match component {
+            SegmentComponent::InvertedIndexContainer => INVERTED_INDEX_CONTAINER_SUFFIX.to_string(),
             SegmentComponent::InvertedIndexMeta => INVERTED_INDEX_META_FILE_SUFFIX.to_string(),
             SegmentComponent::InvertedIndexHeaders => INVERTED_INDEX_HEADERS_SUFFIX.to_string(),
             SegmentComponent::InvertedIndexPostings => INVERTED_INDEX_POSTINGS_SUFFIX.to_string(),
@@ -165,10 +166,15 @@ impl IndexMeta {
         Self { segments: Vec::new(), opstamp: 0u64, payload: None }
     }
 
-    /// parse meta.json into IndexMeta obj.
-    pub(crate) fn deserialize(meta_json: &str, inventory: &SegmentMetaInventory) -> serde_json::Result<IndexMeta> {
-        let untracked_meta_json: UntrackedIndexMeta = serde_json::from_str(meta_json)?;
-        Ok(untracked_meta_json.track(inventory))
+    /// Binary meta.json, fields in the order of `UntrackedIndexMeta`. `payload` is always written, unlike the json.
+    pub(crate) fn serialize(&self) -> Result<Vec<u8>, FileOperationError> {
+        encode_bin_file(&(&self.segments, self.opstamp, &self.payload))
+    }
+
+    /// parse meta.json into IndexMeta obj, json ones are written by indexes before meta.json was binary.
+    pub(crate) fn deserialize(meta: &[u8], inventory: &SegmentMetaInventory) -> Result<IndexMeta, FileOperationError> {
+        let untracked_meta: UntrackedIndexMeta = decode_bin_or_json(meta)?;
+        Ok(untracked_meta.track(inventory))
     }
 }
 
@@ -198,7 +204,10 @@ impl UntrackedIndexMeta {
 
 #[cfg(test)]
 mod tests {
-    use crate::index::index_meta::{IndexMeta, UntrackedIndexMeta};
+    use std::path::PathBuf;
+
+    use crate::index::index_meta::{IndexMeta, SegmentMetaInventory, UntrackedIndexMeta};
+    use crate::index::SegmentId;
 
     #[test]
     fn test_serialize_metas() {
@@ -210,4 +219,19 @@ mod tests {
 
         assert_eq!(index_metas.opstamp, deser_meta.opstamp);
     }
+
+    #[test]
+    fn test_binary_metas() {
+        let inventory = SegmentMetaInventory::default();
+        let segment_meta = inventory.new_segment_meta(PathBuf::from("index"), SegmentId::generate_random(), 0).with_rows_count(42);
+        for payload in [None, Some("payload".to_string())] {
+            let index_metas = IndexMeta { segments: vec![segment_meta.clone()], opstamp: 7, payload: payload.clone() };
+            let metas = IndexMeta::deserialize(&index_metas.serialize().unwrap(), &inventory).unwrap();
+            assert_eq!((metas.segments.len(), metas.segments[0].id(), metas.segments[0].rows_count()), (1, segment_meta.id(), 42));
+            assert_eq!((metas.opstamp, metas.payload), (7, payload));
+
+            let metas = IndexMeta::deserialize(serde_json::to_string(&index_metas).unwrap().as_bytes(), &inventory).unwrap();
+            assert_eq!(metas.segments[0].id(), segment_meta.id());
+        }
+    }
 }
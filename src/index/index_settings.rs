@@ -2,8 +2,9 @@ use std::path::Path;
 
 use serde::{Deserialize, Serialize};
 
-use crate::core::{atomic_save_json, read_json, FileOperationError, InvertedIndexConfig};
+use crate::core::{atomic_save_bin_file, read_bin_or_json, FileOperationError, InvertedIndexConfig, LoadPolicy, StorageType};
 
+/// Binary since index files are read without parsing json, the name is kept so indexes written before still open.
 pub const INDEX_SETTINGS: &str = "index_settings.json";
 
 /// Search Index Settings.
@@ -13,18 +14,30 @@ pub const INDEX_SETTINGS: &str = "index_settings.json";
 #[derive(Clone, Debug, Serialize, Deserialize, Eq, PartialEq, Default)]
 pub struct IndexSettings {
     pub inverted_index_config: InvertedIndexConfig,
+    /// How segment files are brought into memory when index readers load them.
+    #[serde(default)]
+    pub load_policy: LoadPolicy,
 }
 
 impl From<InvertedIndexConfig> for IndexSettings {
     fn from(value: InvertedIndexConfig) -> Self {
-        Self { inverted_index_config: value }
+        Self { inverted_index_config: value, load_policy: LoadPolicy::default() }
     }
 }
 
 impl IndexSettings {
+    /// Load policy of segment readers, `ram` storage is always read into memory.
+    pub fn reader_load_policy(&self) -> LoadPolicy {
+        match (self.inverted_index_config.storage_type, self.load_policy) {
+            (StorageType::Ram, LoadPolicy::InMemoryHugePages) => LoadPolicy::InMemoryHugePages,
+            (StorageType::Ram, _) => LoadPolicy::InMemory,
+            (_, load_policy) => load_policy,
+        }
+    }
+
     pub fn load(index_path: &Path) -> Result<Self, FileOperationError> {
         let file_path = index_path.join(INDEX_SETTINGS);
-        read_json(&file_path)
+        read_bin_or_json(&file_path)
     }
 
     pub fn save(&self, index_path: &Path) -> Result<(), FileOperationError> {
@@ -32,7 +45,7 @@ impl IndexSettings {
         if !index_path.exists() {
             std::fs::create_dir_all(index_path).map_err(|e| FileOperationError::IoError(e))?;
         }
-        Ok(atomic_save_json(&file_path, self)?)
+        Ok(atomic_save_bin_file(&file_path, self)?)
     }
 }
 
@@ -41,6 +54,34 @@ mod tests {
     use super::*;
     use tempfile::tempdir;
 
+    #[test]
+    fn test_load_policy_setting() {
+        let settings: IndexSettings = serde_json::from_str(r#"{"inverted_index_config":{"storage":"compressed_mmap"}}"#).unwrap();
+        assert_eq!(settings.load_policy, LoadPolicy::Normal);
+
+        let settings: IndexSettings = serde_json::from_str(r#"{"inverted_index_config":{},"load_policy":"mlock"}"#).unwrap();
+        assert_eq!(settings.load_policy, LoadPolicy::Mlock);
+        assert!(serde_json::from_str::<IndexSettings>(r#"{"inverted_index_config":{},"load_policy":"resident"}"#).is_err());
+
+        // Ram storage ignores policies which keep segments in the page cache.
+        let settings: IndexSettings = serde_json::from_str(r#"{"inverted_index_config":{"storage":"ram"},"load_policy":"mlock"}"#).unwrap();
+        assert_eq!(settings.reader_load_policy(), LoadPolicy::InMemory);
+        let settings: IndexSettings = serde_json::from_str(r#"{"inverted_index_config":{"storage":"ram"},"load_policy":"in_memory_huge_pages"}"#).unwrap();
+        assert_eq!(settings.reader_load_policy(), LoadPolicy::InMemoryHugePages);
+    }
+
+    #[test]
+    fn test_save_and_load() {
+        let temp_dir = tempdir().unwrap();
+        let settings: IndexSettings = serde_json::from_str(r#"{"inverted_index_config":{"storage":"compressed_mmap","bulk_build":true},"load_policy":"pread"}"#).unwrap();
+        settings.save(temp_dir.path()).unwrap();
+        assert_eq!(IndexSettings::load(temp_dir.path()).unwrap(), settings);
+
+        // Settings of indexes written before are json.
+        std::fs::write(temp_dir.path().join(INDEX_SETTINGS), serde_json::to_vec(&settings).unwrap()).unwrap();
+        assert_eq!(IndexSettings::load(temp_dir.path()).unwrap(), settings);
+    }
+
     // #[test]
     // fn test_parse_config() {
     //     let empty_config = "{}";
@@ -6,6 +6,8 @@ use std::slice;
 /// except the delete component that takes an `segment_uuid`.`delete_opstamp`.`component_extension`
 #[derive(Copy, Clone, Eq, PartialEq)]
 pub enum SegmentComponent {
+    // Single-file segment, replaces all the components below.
+    InvertedIndexContainer,
     InvertedIndexMeta,
     // For simple inverted index.
     InvertedIndexHeaders,
@@ -24,7 +26,8 @@ pub enum SegmentComponent {
 impl SegmentComponent {
     /// Iterates through the components.
     pub fn iterator() -> slice::Iter<'static, SegmentComponent> {
-        static SEGMENT_COMPONENTS: [SegmentComponent; 6] = [
+        static SEGMENT_COMPONENTS: [SegmentComponent; 7] = [
+            SegmentComponent::InvertedIndexContainer,
             SegmentComponent::InvertedIndexMeta,
             SegmentComponent::InvertedIndexHeaders,
             SegmentComponent::InvertedIndexPostings,
@@ -1,6 +1,6 @@
 use super::{Segment, SegmentId};
-use crate::core::searcher::Searcher;
-use crate::core::{GenericInvertedIndex, SparseBitmap, SparseVector, StorageType, TopK};
+use crate::core::searcher::{ProfileSink, Searcher};
+use crate::core::{GenericInvertedIndex, LoadPolicy, SparseBitmap, SparseVector, TopK};
 use crate::directory::Directory;
 use crate::RowId;
 use std::fmt;
@@ -29,17 +29,27 @@ impl SegmentReader {
 }
 
 impl SegmentReader {
+    /// Open for searching with the load policy of index settings.
     pub fn open(segment: &Segment) -> crate::Result<SegmentReader> {
+        Self::open_with_policy(segment, segment.index().index_settings.reader_load_policy())
+    }
+
+    pub fn open_with_policy(segment: &Segment, load_policy: LoadPolicy) -> crate::Result<SegmentReader> {
         let rows_count: RowId = segment.meta().rows_count();
         let index_path = segment.index().directory().get_path().unwrap();
 
-        assert_ne!(segment.index().index_settings.inverted_index_config.storage_type, StorageType::Ram);
-
-        let inverted_index: GenericInvertedIndex = GenericInvertedIndex::open_from(&index_path, Some(&segment.id().uuid_string()), &segment.index().index_settings)?;
+        let inverted_index: GenericInvertedIndex = GenericInvertedIndex::open_from(&index_path, Some(&segment.id().uuid_string()), &segment.index().index_settings, load_policy)?;
 
         Ok(SegmentReader { index_searcher: Searcher::new(inverted_index), segment_id: segment.id(), rows_count })
     }
 
+    /// Open for a pass over every posting (merging, conversion), the container checksum is verified first since the whole file is read anyway.
+    pub fn open_verified(segment: &Segment) -> crate::Result<SegmentReader> {
+        let index_path = segment.index().directory().get_path().unwrap();
+        GenericInvertedIndex::verify_checksum(&index_path, Some(&segment.id().uuid_string()), &segment.index().index_settings)?;
+        Self::open_with_policy(segment, LoadPolicy::Normal)
+    }
+
     pub fn search(&self, query: &SparseVector, sparse_bitmap: &Option<SparseBitmap>, limits: u32) -> crate::Result<TopK> {
         Ok(self.index_searcher.search(query, sparse_bitmap, limits))
     }
@@ -47,6 +57,15 @@ impl SegmentReader {
     pub fn brute_force_search(&self, query: &SparseVector, sparse_bitmap: &Option<SparseBitmap>, limits: u32) -> crate::Result<TopK> {
         Ok(self.index_searcher.plain_search(query, sparse_bitmap, limits))
     }
+
+    /// Same as [`search`](SegmentReader::search), also records how the query was executed in this segment into `P`.
+    pub fn search_profiled<P: ProfileSink>(&self, query: &SparseVector, sparse_bitmap: &Option<SparseBitmap>, limits: u32, brute_force: bool) -> crate::Result<(TopK, P)> {
+        if brute_force {
+            Ok(self.index_searcher.plain_search_profiled::<P>(query, sparse_bitmap, limits))
+        } else {
+            Ok(self.index_searcher.search_profiled::<P>(query, sparse_bitmap, limits))
+        }
+    }
 }
 
 impl fmt::Debug for SegmentReader {
@@ -0,0 +1,121 @@
+use std::path::Path;
+
+use log::info;
+use rayon::prelude::*;
+
+use super::segment_updater::save_metas;
+use crate::{
+    common::errors::SparseError,
+    core::{DimId, GenericInvertedIndexRamBuilder},
+    index::{Index, IndexMeta, IndexSettings, SegmentMeta, SegmentReader},
+    RowId,
+};
+
+/// Rewrites every segment of an index with other `IndexSettings`, e.g. mmap into compressed_mmap, f32 into u8 or simple into extended elements.
+///
+/// Weights are restored into `f32` and quantized again by the target settings, segments keep their ids and row ids.
+pub struct IndexConverter {
+    index: Index,
+}
+
+impl IndexConverter {
+    pub fn open<P: AsRef<Path>>(index_path: P) -> crate::Result<IndexConverter> {
+        Ok(Self { index: Index::open_in_dir(index_path)? })
+    }
+
+    /// Write the converted index into `target_path`, which must not hold an index yet.
+    pub fn convert<P: AsRef<Path>>(&self, target_path: P, target_settings: IndexSettings) -> crate::Result<Index> {
+        let _ = target_settings.inverted_index_config.is_valid()?;
+        let index_meta = self.index.load_metas()?;
+        std::fs::create_dir_all(target_path.as_ref())?;
+        let target = Index::create_in_dir(target_path, target_settings.clone())?;
+        let directory = target.directory().get_path().ok_or_else(|| SparseError::Error("Converted index should live in a directory.".to_string()))?;
+        let config = target_settings.inverted_index_config;
+
+        let mut segment_metas: Vec<SegmentMeta> = Vec::with_capacity(index_meta.segments.len());
+        for segment in self.index.searchable_segments()? {
+            // Every posting is read once, verify the segment and keep it out of resident memory.
+            let reader = SegmentReader::open_verified(&segment)?;
+            let inverted_index = reader.get_inverted_index();
+            let postings: Vec<(DimId, Vec<(RowId, f32)>)> = inverted_index.dim_ids().into_par_iter().map(|dim_id| (dim_id, inverted_index.posting_elements(dim_id))).collect();
+
+            // Postings are filled, then sorted, quantized, compressed and written per posting on the flush pool.
+            let mut builder = GenericInvertedIndexRamBuilder::new(config.weight_type, config.quantized, config.element_type());
+            builder.add_postings(&postings)?;
+            builder.set_vector_count(inverted_index.metrics().vector_count);
+            drop(postings);
+
+            let segment_id = segment.id();
+            let _ = builder.build_and_flush(config.storage_type, config.weight_type, config.quantized, &directory, Some(&segment_id.uuid_string()))?;
+            info!("[IndexConverter] converted segment: {}, rows_count: {}", segment_id.uuid_string(), segment.meta().rows_count());
+            segment_metas.push(target.new_segment_meta(segment_id, segment.meta().rows_count()));
+        }
+
+        save_metas(&IndexMeta { segments: segment_metas, opstamp: index_meta.opstamp, payload: index_meta.payload }, target.directory())?;
+        Ok(target)
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::core::{ElementType, IndexWeightType, InvertedIndexConfig, InvertedIndexMmapFileConfig, LoadPolicy, SparseRowContent, SparseVector, StorageType};
+    use tempfile::tempdir;
+
+    #[test]
+    fn test_convert_mmap_into_compressed_u8() {
+        let source_dir = tempdir().unwrap();
+        let source_settings = IndexSettings::from(InvertedIndexConfig::new(StorageType::Mmap, IndexWeightType::Float32, ElementType::SIMPLE, false).unwrap());
+        let index = Index::create_in_dir(source_dir.path(), source_settings).unwrap();
+        let mut writer = index.writer_with_num_threads(1, 64 << 20).unwrap();
+        for row_id in 0..100 {
+            let sparse_vector = SparseVector { indices: vec![row_id % 7, 10 + row_id % 3], values: vec![row_id as f32 / 10.0, 1.5] };
+            writer.add_document(SparseRowContent { row_id, sparse_vector }).unwrap();
+        }
+        writer.commit().unwrap();
+
+        let target_dir = tempdir().unwrap();
+        let target_settings = IndexSettings::from(InvertedIndexConfig::new(StorageType::CompressedMmap, IndexWeightType::Float32, ElementType::SIMPLE, true).unwrap());
+        let target = IndexConverter::open(source_dir.path()).unwrap().convert(target_dir.path().join("converted"), target_settings).unwrap();
+
+        let source_segments = index.searchable_segments().unwrap();
+        let target_segments = target.searchable_segments().unwrap();
+        assert_eq!(source_segments.iter().map(|s| s.id()).collect::<Vec<_>>(), target_segments.iter().map(|s| s.id()).collect::<Vec<_>>());
+        for (source, converted) in source_segments.iter().zip(target_segments.iter()) {
+            let source_reader = SegmentReader::open_with_policy(source, LoadPolicy::Normal).unwrap();
+            let converted_reader = SegmentReader::open_with_policy(converted, LoadPolicy::Normal).unwrap();
+            let (source_index, converted_index) = (source_reader.get_inverted_index(), converted_reader.get_inverted_index());
+            assert_eq!(source_index.metrics().vector_count, converted_index.metrics().vector_count);
+            for dim_id in source_index.dim_ids() {
+                let (expected, actual) = (source_index.posting_elements(dim_id), converted_index.posting_elements(dim_id));
+                assert_eq!(expected.iter().map(|e| e.0).collect::<Vec<_>>(), actual.iter().map(|e| e.0).collect::<Vec<_>>());
+                for (e, a) in expected.iter().zip(actual.iter()) {
+                    // u8 quantization of weights in [0, 9.9].
+                    assert!((e.1 - a.1).abs() < 0.05, "dim {}, row {}: {} vs {}", dim_id, e.0, e.1, a.1);
+                }
+            }
+        }
+    }
+
+    #[test]
+    fn test_convert_rejects_corrupted_segment() {
+        let source_dir = tempdir().unwrap();
+        let settings = IndexSettings::from(InvertedIndexConfig::new(StorageType::Mmap, IndexWeightType::Float32, ElementType::SIMPLE, false).unwrap());
+        let index = Index::create_in_dir(source_dir.path(), settings.clone()).unwrap();
+        let mut writer = index.writer_with_num_threads(1, 64 << 20).unwrap();
+        for row_id in 0..10 {
+            writer.add_document(SparseRowContent { row_id, sparse_vector: SparseVector { indices: vec![row_id % 3], values: vec![1.0] } }).unwrap();
+        }
+        writer.commit().unwrap();
+
+        let segment = &index.searchable_segments().unwrap()[0];
+        let path = source_dir.path().join(InvertedIndexMmapFileConfig::container_file_name(Some(&segment.id().uuid_string())));
+        let mut bytes = std::fs::read(&path).unwrap();
+        bytes[crate::core::SECTION_ALIGNMENT] ^= 0xff;
+        std::fs::write(&path, bytes).unwrap();
+
+        let target_dir = tempdir().unwrap();
+        let result = IndexConverter::open(source_dir.path()).unwrap().convert(target_dir.path().join("converted"), settings);
+        assert!(matches!(result, Err(SparseError::DataCorruption(_))));
+    }
+}
@@ -15,12 +15,11 @@ use crate::core::SparseRowContent;
 use crate::directory::{DirectoryLock, GarbageCollectionResult};
 
 use crate::future_result::FutureResult;
-use crate::index::{Index, IndexSettings, Segment, SegmentId, SegmentMeta};
+use crate::index::{Index, Segment, SegmentId, SegmentMeta};
 use crate::indexer::index_writer_status::IndexWriterStatus;
 use crate::indexer::stamper::Stamper;
 use crate::indexer::{MergePolicy, SegmentEntry, SegmentWriter};
 
-use crate::core::StorageType;
 use crate::Opstamp;
 
 /// Used to set the boundary size for the memory arena;
@@ -78,17 +77,8 @@ pub struct IndexWriter {
 /// - memory_budget: Memory budget for indexing a single segment.
 /// - grouped_sv_iterator: Retrieves sparse-vector from the channel.
 /// - segment_updater: Object for updating the written segment.
-fn index_documents(
-    index_settings: &IndexSettings,
-    memory_budget: usize,
-    segment: Segment,
-    grouped_sv_iterator: &mut dyn Iterator<Item = AddBatch>,
-    segment_updater: &SegmentUpdater,
-) -> crate::Result<()> {
+fn index_documents(memory_budget: usize, segment: Segment, grouped_sv_iterator: &mut dyn Iterator<Item = AddBatch>, segment_updater: &SegmentUpdater) -> crate::Result<()> {
     debug!("{} [index documents] enter", thread::current().name().unwrap_or_default());
-    let mmap_type: StorageType = index_settings.inverted_index_config.storage_type;
-    assert_ne!(mmap_type, StorageType::Ram);
-
     let mut segment_writer = SegmentWriter::for_segment(memory_budget, segment.clone())?;
 
     // iterate the sparse-vector we received
@@ -285,7 +275,7 @@ impl IndexWriter {
                     return Ok(());
                 }
 
-                index_documents(&index.index_settings(), mem_budget, index.new_segment(), &mut document_iterator, &segment_updater)?;
+                index_documents(mem_budget, index.new_segment(), &mut document_iterator, &segment_updater)?;
             }
         })?;
         self.worker_id += 1;
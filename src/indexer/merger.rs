@@ -19,7 +19,8 @@ impl IndexMerger {
         if segments.len() == 0 {
             return Err(SparseError::Error("Can't create IndexMerger with given ZERO segments.".to_string()));
         }
-        let segment_readers: Vec<SegmentReader> = segments.iter().map(|seg| SegmentReader::open(seg)).collect::<crate::Result<Vec<SegmentReader>>>()?;
+        // Segments are read once while merging, so they are verified and kept out of resident memory.
+        let segment_readers: Vec<SegmentReader> = segments.iter().map(SegmentReader::open_verified).collect::<crate::Result<Vec<SegmentReader>>>()?;
 
         // make sure all index_settings are same.
         let index_settings_vec: Vec<_> = segments.iter().map(|seg| seg.index().index_settings()).collect();
@@ -41,6 +42,6 @@ impl IndexMerger {
             self.readers.iter().map(|segment_reader| segment_reader.get_inverted_index()).collect::<Vec<&GenericInvertedIndex>>();
 
         info!(">> try call generic_inverted_index merge, indexes size:{}", generic_inverted_indexes.len());
-        GenericInvertedIndex::merge(generic_inverted_indexes, directory, segment_id, Some(self.index_config.element_type))
+        GenericInvertedIndex::merge(generic_inverted_indexes, directory, segment_id, Some(self.index_config.element_type), self.index_config.reorder_rows)
     }
 }
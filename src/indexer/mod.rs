@@ -1,3 +1,4 @@
+pub mod converter;
 pub mod index_writer;
 pub mod index_writer_status;
 pub mod log_merge_policy;
@@ -17,6 +18,7 @@ pub mod stamper;
 use crossbeam_channel as channel;
 use smallvec::SmallVec;
 
+pub use self::converter::IndexConverter;
 pub use self::index_writer::IndexWriter;
 pub use self::log_merge_policy::LogMergePolicy;
 pub use self::merge_operation::MergeOperation;
@@ -1,6 +1,5 @@
 use std::borrow::BorrowMut;
 use std::collections::HashSet;
-use std::io::Write;
 use std::ops::Deref;
 use std::path::PathBuf;
 use std::sync::atomic::{AtomicBool, Ordering};
@@ -25,9 +24,7 @@ const NUM_MERGE_THREADS: usize = 4;
 
 /// store index meta.json into disk.
 pub fn save_metas(metas: &IndexMeta, directory: &dyn Directory) -> crate::Result<()> {
-    let mut buffer = serde_json::to_vec_pretty(metas)?;
-    // Just adding a new line at the end of the buffer.
-    writeln!(&mut buffer)?;
+    let buffer = metas.serialize()?;
     directory.sync_directory()?;
     directory.atomic_write(&META_FILEPATH, &buffer[..])?;
     debug!("[{}] - [save_metas] segments size: {}, opstamp: {}, payload: {:?}", thread::current().name().unwrap_or_default(), metas.segments.len(), metas.opstamp, metas.payload);
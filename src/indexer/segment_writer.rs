@@ -20,7 +20,8 @@ pub struct SegmentWriter {
 impl SegmentWriter {
     pub fn for_segment(memory_budget_in_bytes: usize, segment: Segment) -> crate::Result<Self> {
         let index_config = &segment.index().index_settings().inverted_index_config;
-        let index_ram_builder = GenericInvertedIndexRamBuilder::new(index_config.weight_type, index_config.quantized, index_config.element_type());
+        let index_ram_builder =
+            GenericInvertedIndexRamBuilder::new(index_config.weight_type, index_config.quantized, index_config.element_type()).with_bulk_build(index_config.bulk_build);
         Ok(Self { num_rows_count: 0, memory_budget_in_bytes, segment, index_ram_builder, index_config: *index_config })
     }
 
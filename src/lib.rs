@@ -40,6 +40,10 @@ pub const INDEX_FORMAT_OLDEST_SUPPORTED_VERSION: u32 = 4;
 
 // re-export log ffi function.
 pub use api::cxx_ffi::{sparse_index_log4rs_initialize, sparse_index_log4rs_initialize_with_callback};
+// re-export offline tools.
+pub use core::export_segment_meta_json;
+pub use index::IndexSettings;
+pub use indexer::IndexConverter;
 
 #[cxx::bridge(namespace = "SPARSE")]
 pub mod ffi {
@@ -61,6 +65,45 @@ pub mod ffi {
         pub result: Vec<ScoredPointOffset>,
         pub error: FFIError,
     }
+    /// Execution counters of one query merged across segments, `*_ns` are nanoseconds.
+    #[derive(Debug, Clone, Default)]
+    pub struct FFISearchProfile {
+        pub segments_searched: u64,
+        pub postings_opened: u64,
+        pub elements_scored: u64,
+        pub blocks_decompressed: u64,
+        pub batches: u64,
+        pub prune_attempts: u64,
+        pub prune_successes: u64,
+        pub bitmap_rejections: u64,
+        pub posting_cache_hits: u64,
+        pub posting_cache_misses: u64,
+        pub pre_search_ns: u64,
+        pub scoring_ns: u64,
+        pub select_ns: u64,
+        pub merge_ns: u64,
+    }
+
+    /// Usage of the caches shared by all index readers, hit ratios are 0 before any lookup.
+    #[derive(Debug, Clone, Default)]
+    pub struct FFICacheStats {
+        pub posting_cache_bytes: u64,
+        pub posting_cache_capacity_bytes: u64,
+        pub posting_cache_hit_ratio: f64,
+        pub decoded_block_cache_bytes: u64,
+        pub decoded_block_cache_capacity_bytes: u64,
+        pub decoded_block_cache_hits: u64,
+        pub decoded_block_cache_misses: u64,
+        pub decoded_block_cache_hit_ratio: f64,
+    }
+
+    #[derive(Debug, Clone)]
+    pub struct FFIScoreProfileResult {
+        pub result: Vec<ScoredPointOffset>,
+        pub profile: FFISearchProfile,
+        pub error: FFIError,
+    }
+
     #[derive(Debug, Clone)]
     pub struct FFIBoolResult {
         pub result: bool,
@@ -100,12 +143,26 @@ pub mod ffi {
         pub fn ffi_insert_sparse_vector(index_path: &CxxString, row_id: u32, sparse_vector: &Vec<TupleElement>) -> FFIBoolResult;
         pub fn ffi_free_index_writer(index_path: &CxxString) -> FFIBoolResult;
 
+        pub fn ffi_convert_index(index_path: &CxxString, target_index_path: &CxxString, target_json_parameter: &CxxString) -> FFIBoolResult;
+
         /* index searcher */
         pub fn ffi_load_index_reader(index_path: &CxxString) -> FFIBoolResult;
 
+        pub fn ffi_load_index_reader_with_parameter(index_path: &CxxString, reader_json_parameter: &CxxString) -> FFIBoolResult;
+
         pub fn ffi_free_index_reader(index_path: &CxxString) -> FFIBoolResult;
 
         pub fn ffi_sparse_search(index_path: &CxxString, sparse_vector: &Vec<TupleElement>, filter: &CxxVector<u8>, enable_filter: bool, top_k: u32) -> FFIScoreResult;
+
+        pub fn ffi_sparse_search_with_profile(
+            index_path: &CxxString,
+            sparse_vector: &Vec<TupleElement>,
+            filter: &CxxVector<u8>,
+            enable_filter: bool,
+            top_k: u32,
+        ) -> FFIScoreProfileResult;
+
+        pub fn ffi_get_cache_stats() -> FFICacheStats;
     }
 }
 
@@ -5,6 +5,7 @@ use std::{fmt, io};
 use census::TrackedObject;
 
 use crate::common::executor::Executor;
+use crate::core::searcher::{NoProfile, ProfileSink, SearchProfile};
 use crate::core::{SparseBitmap, SparseRowContent, SparseVector, TopK};
 use crate::ffi::ScoredPointOffset;
 use crate::index::{Index, SegmentId, SegmentReader};
@@ -118,6 +119,12 @@ impl Searcher {
         self.search_with_executor(sparse_vector, sparse_bitmap, limits, executor, false)
     }
 
+    /// Same as [`search(...)`](Searcher::search), also returns the execution profile merged across all segments.
+    pub fn search_with_profile(&self, sparse_vector: &SparseVector, sparse_bitmap: &Option<SparseBitmap>, limits: u32) -> crate::Result<(Vec<ScoredPointOffset>, SearchProfile)> {
+        let executor = self.inner.index.search_executor();
+        self.search_segments::<SearchProfile>(sparse_vector, sparse_bitmap, limits, executor, false)
+    }
+
     /// Same as [`search(...)`](Searcher::search) but multithreaded.
     ///
     /// The current implementation is rather naive :
@@ -138,22 +145,32 @@ impl Searcher {
         executor: &Executor,
         brute_force: bool,
     ) -> crate::Result<Vec<ScoredPointOffset>> {
+        let (results, _) = self.search_segments::<NoProfile>(sparse_vector, sparse_bitmap, limits, executor, brute_force)?;
+        Ok(results)
+    }
+
+    /// Search every segment on `executor` and combine their top-k, profiles of all segments are merged into `P`.
+    fn search_segments<P: ProfileSink>(
+        &self,
+        sparse_vector: &SparseVector,
+        sparse_bitmap: &Option<SparseBitmap>,
+        limits: u32,
+        executor: &Executor,
+        brute_force: bool,
+    ) -> crate::Result<(Vec<ScoredPointOffset>, P)> {
         let mut topk_combine = TopK::new(limits as usize);
-        let results: Vec<TopK> = executor.map(
-            |seg_reader| {
-                if brute_force {
-                    seg_reader.brute_force_search(sparse_vector, sparse_bitmap, limits)
-                } else {
-                    seg_reader.search(sparse_vector, sparse_bitmap, limits)
-                }
-            },
-            self.segment_readers().iter(),
-        )?;
-        for res in results {
+        let results: Vec<(TopK, P)> =
+            executor.map(|seg_reader| seg_reader.search_profiled::<P>(sparse_vector, sparse_bitmap, limits, brute_force), self.segment_readers().iter())?;
+
+        let start = P::start();
+        let mut merged_profile = P::default();
+        for (res, segment_profile) in results {
             topk_combine.combine(&res);
+            merged_profile.merge_from(&segment_profile);
         }
-
-        Ok(topk_combine.into_vec())
+        let results = topk_combine.into_vec();
+        merged_profile.record_elapsed(start, |profile| &mut profile.merge_ns);
+        Ok((results, merged_profile))
     }
 }
 